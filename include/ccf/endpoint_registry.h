@@ -8,6 +8,8 @@
 #include "ds/ccf_deprecated.h"
 #include "ds/json_schema.h"
 #include "ds/openapi.h"
+#include "endpoints/latency_metrics.h"
+#include "endpoints/path_template_trie.h"
 #include "http/http_consts.h"
 #include "node/certs.h"
 #include "node/rpc/serialization.h"
@@ -159,6 +161,8 @@ namespace ccf::endpoints
       std::string,
       std::map<RESTVerb, std::shared_ptr<PathTemplatedEndpoint>>>
       templated_endpoints;
+    PathTemplateTrie<std::shared_ptr<PathTemplatedEndpoint>>
+      templated_endpoints_trie;
 
     std::mutex metrics_lock;
     std::map<std::string, std::map<std::string, Metrics>> metrics;
@@ -166,6 +170,8 @@ namespace ccf::endpoints
     EndpointRegistry::Metrics& get_metrics_for_endpoint(
       const EndpointDefinitionPtr& e);
 
+    endpoints::LatencyMetrics latency_metrics;
+
     kv::Consensus* consensus = nullptr;
     kv::TxHistory* history = nullptr;
 
@@ -217,7 +223,9 @@ namespace ccf::endpoints
     /** Install the given endpoint, using its method and verb
      *
      * If an implementation is already installed for this method and verb, it
-     * will be replaced.
+     * will be replaced. Throws if the method is a templated path which could
+     * match the same request paths as another templated path installed for
+     * this verb.
      * @param endpoint Endpoint object describing the new resource to install
      */
     void install(Endpoint& endpoint) override;
@@ -265,5 +273,23 @@ namespace ccf::endpoints
     void increment_metrics_errors(const EndpointDefinitionPtr& e);
     void increment_metrics_failures(const EndpointDefinitionPtr& e);
     void increment_metrics_retries(const EndpointDefinitionPtr& e);
+
+    /** Record the time spent in each stage of handling a request to e. Must
+     * be called from the thread which handled the request.
+     */
+    void record_latencies(
+      const EndpointDefinitionPtr& e,
+      const endpoints::RequestLatencies& latencies);
+
+    /** Track a transaction committed locally by a request to e, so that its
+     * time to global commit is recorded once consensus commits it.
+     */
+    void record_pending_global_commit(
+      const EndpointDefinitionPtr& e, const ccf::TxID& tx_id);
+
+    /** Record the time to global commit of tracked transactions which have
+     * been committed since the last call.
+     */
+    void record_global_commit_latencies();
   };
 }
\ No newline at end of file
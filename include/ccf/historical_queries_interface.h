@@ -5,6 +5,7 @@
 #include "ccf/receipt.h"
 #include "ccf/tx_id.h"
 #include "consensus/ledger_enclave_types.h"
+#include "ds/json.h"
 #include "kv/store.h"
 #include "node/history.h"
 #include "tls/base64.h"
@@ -100,6 +101,37 @@ namespace ccf::historical
 
   using ExpiryDuration = std::chrono::seconds;
 
+  /** Soft limit, in bytes, on the size of all historical stores held by a
+   * state cache.
+   */
+  using CacheSize = size_t;
+
+  struct CacheMetrics
+  {
+    /// Requested seqnos which were already held by the cache
+    size_t hits = 0;
+    /// Requested seqnos which had to be fetched from the ledger
+    size_t misses = 0;
+    /// Requests dropped to bring the cache back under its soft limit
+    size_t evictions = 0;
+    /// Currently active requests
+    size_t requests = 0;
+    /// Size of the ledger entries backing all currently held stores
+    CacheSize cached_bytes = 0;
+    /// Configured soft limit
+    CacheSize soft_limit_bytes = 0;
+  };
+
+  DECLARE_JSON_TYPE(CacheMetrics)
+  DECLARE_JSON_REQUIRED_FIELDS(
+    CacheMetrics,
+    hits,
+    misses,
+    evictions,
+    requests,
+    cached_bytes,
+    soft_limit_bytes)
+
   /** Stores the progress of historical query requests.
    *
    * A request will generally need to be made multiple times (with the same
@@ -125,6 +157,18 @@ namespace ccf::historical
     virtual void set_default_expiry_duration(
       ExpiryDuration seconds_until_expiry) = 0;
 
+    /** Set the soft limit on the total size of stores held by the cache. When
+     * this is exceeded, the least recently requested handles are dropped until
+     * the cache fits within the limit again. The most recently requested
+     * handle is never dropped, so a single request may exceed the limit.
+     */
+    virtual void set_soft_cache_limit(CacheSize cache_limit) = 0;
+
+    /** Retrieve hit, miss and eviction counts, and the current size of the
+     * cache.
+     */
+    virtual CacheMetrics get_metrics() = 0;
+
     /** Retrieve a Store containing the state written at the given seqno.
      *
      * See @c get_store_range for a description of the caching behaviour. This
@@ -0,0 +1,169 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+#pragma once
+
+#include "ccf/indexing/strategy.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace ccf::indexing::strategies
+{
+  /** Records every seqno at which each key of map M was written or removed.
+   *
+   * Memory grows with the number of writes to the map, so this is best suited
+   * to maps where each key is written rarely. See @c SeqnosByKeyBucketed for a
+   * coarser index.
+   */
+  template <typename M>
+  class SeqnosByKey : public Strategy
+  {
+  public:
+    using Key = typename M::ReadOnlyHandle::KeyType;
+
+  protected:
+    std::unordered_map<kv::untyped::SerialisedEntry, std::vector<ccf::SeqNo>>
+      seqnos_by_key;
+
+    void handle_write(
+      ccf::SeqNo seqno,
+      const kv::untyped::SerialisedEntry& key,
+      const std::optional<kv::untyped::SerialisedEntry>&) override
+    {
+      // Transactions are committed in order, so each list stays sorted
+      seqnos_by_key[key].push_back(seqno);
+    }
+
+    void clear() override
+    {
+      seqnos_by_key.clear();
+    }
+
+  public:
+    SeqnosByKey(const M& map) : Strategy(map.get_name()) {}
+
+    /** Returns the seqnos in [from, to] at which key was written or removed, in
+     * ascending order. Returns nullopt if part of this range was not indexed.
+     */
+    std::optional<std::vector<ccf::SeqNo>> get_write_txs_in_range(
+      const Key& key, ccf::SeqNo from, ccf::SeqNo to)
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      if (from < indexed_from)
+      {
+        return std::nullopt;
+      }
+
+      const auto it =
+        seqnos_by_key.find(M::KeySerialiser::to_serialised(key));
+      if (it == seqnos_by_key.end())
+      {
+        return std::vector<ccf::SeqNo>();
+      }
+
+      const auto& seqnos = it->second;
+      return std::vector<ccf::SeqNo>(
+        std::lower_bound(seqnos.begin(), seqnos.end(), from),
+        std::upper_bound(seqnos.begin(), seqnos.end(), to));
+    }
+  };
+
+  /** Records, for each key of map M, which buckets of bucket_size consecutive
+   * seqnos contain a write to that key.
+   *
+   * Memory grows with the number of distinct (key, bucket) pairs rather than
+   * with the number of writes, at the cost of returning ranges which must
+   * still be scanned to find the precise transactions.
+   */
+  template <typename M>
+  class SeqnosByKeyBucketed : public Strategy
+  {
+  public:
+    using Key = typename M::ReadOnlyHandle::KeyType;
+    using Range = std::pair<ccf::SeqNo, ccf::SeqNo>;
+
+  protected:
+    const size_t bucket_size;
+
+    std::unordered_map<kv::untyped::SerialisedEntry, std::vector<size_t>>
+      buckets_by_key;
+
+    void handle_write(
+      ccf::SeqNo seqno,
+      const kv::untyped::SerialisedEntry& key,
+      const std::optional<kv::untyped::SerialisedEntry>&) override
+    {
+      const auto bucket = seqno / bucket_size;
+      auto& buckets = buckets_by_key[key];
+      if (buckets.empty() || buckets.back() != bucket)
+      {
+        buckets.push_back(bucket);
+      }
+    }
+
+    void clear() override
+    {
+      buckets_by_key.clear();
+    }
+
+  public:
+    SeqnosByKeyBucketed(const M& map, size_t bucket_size_ = 1000) :
+      Strategy(map.get_name()),
+      bucket_size(bucket_size_)
+    {
+      if (bucket_size == 0)
+      {
+        throw std::logic_error("Bucket size must be greater than 0");
+      }
+    }
+
+    /** Returns the disjoint, ascending ranges within [from, to] which contain
+     * every write or removal of key. Adjacent buckets are merged into a single
+     * range. Returns nullopt if part of this range was not indexed.
+     */
+    std::optional<std::vector<Range>> get_write_ranges_in_range(
+      const Key& key, ccf::SeqNo from, ccf::SeqNo to)
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      if (from < indexed_from)
+      {
+        return std::nullopt;
+      }
+
+      std::vector<Range> ranges;
+      const auto it =
+        buckets_by_key.find(M::KeySerialiser::to_serialised(key));
+      if (it == buckets_by_key.end())
+      {
+        return ranges;
+      }
+
+      const auto& buckets = it->second;
+      auto bucket_it =
+        std::lower_bound(buckets.begin(), buckets.end(), from / bucket_size);
+      for (; bucket_it != buckets.end(); ++bucket_it)
+      {
+        const ccf::SeqNo bucket_start = *bucket_it * bucket_size;
+        if (bucket_start > to)
+        {
+          break;
+        }
+
+        const auto range_start = std::max(bucket_start, from);
+        const auto range_end = std::min(bucket_start + bucket_size - 1, to);
+        if (!ranges.empty() && ranges.back().second + 1 == range_start)
+        {
+          ranges.back().second = range_end;
+        }
+        else
+        {
+          ranges.emplace_back(range_start, range_end);
+        }
+      }
+
+      return ranges;
+    }
+  };
+}
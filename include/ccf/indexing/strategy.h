@@ -0,0 +1,109 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+#pragma once
+
+#include "ccf/tx_id.h"
+#include "kv/untyped_map_handle.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace ccf::indexing
+{
+  /** Base class for an index over the writes to a single KV map.
+   *
+   * Once installed on the node's indexer, a strategy is given the writes to
+   * its map from every committed transaction, in seqno order. It can then
+   * answer questions about the ledger (such as "which transactions wrote to
+   * this key?") without deserialising historical transactions, so that only
+   * the relevant entries need be fetched through the historical state cache.
+   *
+   * Writes are only seen from the point the strategy is installed, or from
+   * the last snapshot applied to this node. Earlier seqnos are not indexed,
+   * and are reported by @c get_indexed_from so that callers may fall back to
+   * scanning them.
+   */
+  class Strategy
+  {
+  protected:
+    const std::string map_name;
+
+    // Guards all indexed state. Writes are indexed from the thread which
+    // compacts the store, while lookups come from endpoint threads.
+    std::mutex lock;
+
+    ccf::SeqNo indexed_from = 1;
+
+    /** Called for each key written (or removed, if @c value is nullopt) by a
+     * committed transaction at seqno, with the lock held.
+     */
+    virtual void handle_write(
+      ccf::SeqNo seqno,
+      const kv::untyped::SerialisedEntry& key,
+      const std::optional<kv::untyped::SerialisedEntry>& value) = 0;
+
+    /** Called with the lock held when all indexed state must be discarded.
+     */
+    virtual void clear() = 0;
+
+  public:
+    Strategy(const std::string& map_name_) : map_name(map_name_) {}
+    virtual ~Strategy() = default;
+
+    const std::string& get_indexed_map_name() const
+    {
+      return map_name;
+    }
+
+    /** Lowest seqno from which every write to the map has been indexed.
+     */
+    ccf::SeqNo get_indexed_from()
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      return indexed_from;
+    }
+
+    void handle_committed_writes(
+      ccf::SeqNo seqno, const kv::untyped::Write& writes)
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      if (seqno < indexed_from)
+      {
+        return;
+      }
+
+      for (const auto& [key, value] : writes)
+      {
+        handle_write(seqno, key, value);
+      }
+    }
+
+    /** Discard everything indexed so far, and only index writes from
+     * first_seqno.
+     */
+    void reset(ccf::SeqNo first_seqno)
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      clear();
+      indexed_from = first_seqno;
+    }
+  };
+
+  using StrategyPtr = std::shared_ptr<Strategy>;
+
+  /** Feeds the writes of committed transactions to installed strategies.
+   */
+  class AbstractIndexer
+  {
+  public:
+    virtual ~AbstractIndexer() = default;
+
+    /** Install a strategy, which will see the writes to its map from all
+     * transactions committed after this call.
+     */
+    virtual void install_strategy(const StrategyPtr& strategy) = 0;
+
+    virtual bool uninstall_strategy(const StrategyPtr& strategy) = 0;
+  };
+}
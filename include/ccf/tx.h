@@ -120,7 +120,8 @@ namespace kv
       return typed_handle;
     }
 
-    auto get_map_and_change_set_by_name(const std::string& map_name)
+    auto get_map_and_change_set_by_name(
+      const std::string& map_name, bool with_ordered_keys = false)
     {
       if (!read_txid.has_value())
       {
@@ -168,22 +169,39 @@ namespace kv
       }
 
       return std::make_pair(
-        abstract_map, untyped_map->create_change_set(read_txid->version));
+        abstract_map,
+        untyped_map->create_change_set(
+          read_txid->version, with_ordered_keys));
     }
 
     template <class THandle>
     THandle* get_handle_by_name(const std::string& map_name)
     {
+      constexpr auto with_ordered_keys =
+        std::is_base_of_v<AbstractOrderedHandle, THandle>;
+
       auto search = all_changes.find(map_name);
       if (search != all_changes.end())
       {
+        if constexpr (with_ordered_keys)
+        {
+          auto untyped_map =
+            std::dynamic_pointer_cast<kv::untyped::Map>(search->second.map);
+          if (untyped_map == nullptr)
+          {
+            throw std::logic_error(
+              fmt::format("Map {} has unexpected type", map_name));
+          }
+          untyped_map->add_ordered_keys(*search->second.changeset);
+        }
+
         auto handle =
           get_or_insert_handle<THandle>(*search->second.changeset, map_name);
         return handle;
       }
 
       auto [abstract_map, change_set] =
-        get_map_and_change_set_by_name(map_name);
+        get_map_and_change_set_by_name(map_name, with_ordered_keys);
       return check_and_store_change_set<THandle>(
         std::move(change_set), map_name, abstract_map);
     }
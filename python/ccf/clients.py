@@ -281,6 +281,8 @@ class CurlClient:
                 request.http_verb,
                 "-i",
                 f"-m {timeout}",
+                # Output is parsed as an HTTP/1.1 response
+                "--http1.1",
             ]
 
             if request.allow_redirects:
@@ -9,6 +9,7 @@
 #include "apps/utils/metrics_tracker.h"
 #include "ccf/app_interface.h"
 #include "ccf/historical_queries_adapter.h"
+#include "ccf/indexing/strategies/seqnos_by_key.h"
 #include "ccf/http_query.h"
 #include "ccf/user_frontend.h"
 #include "ccf/version.h"
@@ -133,6 +134,13 @@ namespace loggingapp
 
     metrics::Tracker metrics_tracker;
 
+    // Records which buckets of seqnos contain writes to each private record,
+    // so that historical range queries only fetch the relevant parts of the
+    // ledger
+    using RecordsIndex =
+      ccf::indexing::strategies::SeqnosByKeyBucketed<RecordsMap>;
+    std::shared_ptr<RecordsIndex> index_per_private_key = nullptr;
+
     static void update_first_write(kv::Tx& tx, size_t id)
     {
       auto first_writes = tx.rw<FirstWritesMap>("first_write_version");
@@ -159,6 +167,10 @@ namespace loggingapp
       const ccf::AuthnPolicies auth_policies = {ccf::jwt_auth_policy,
                                                 ccf::user_cert_auth_policy};
 
+      index_per_private_key =
+        std::make_shared<RecordsIndex>(RecordsMap(PRIVATE_RECORDS));
+      context.get_indexer().install_strategy(index_per_private_key);
+
       // SNIPPET_START: record
       auto record = [this](auto& ctx, nlohmann::json&& params) {
         // SNIPPET_START: macro_validation_record
@@ -952,11 +964,40 @@ namespace loggingapp
           return;
         }
 
-        // Set a maximum range, paginate larger requests
+        // Set a maximum range, paginate larger requests. Where the index
+        // covers the requested range, skip ahead to the next part of it which
+        // contains writes to this id
         static constexpr size_t max_seqno_per_page = 20;
-        const auto range_begin = from_seqno;
-        const auto range_end =
-          std::min(to_seqno, range_begin + max_seqno_per_page);
+        auto get_page = [this, id](ccf::SeqNo begin, ccf::SeqNo end)
+          -> std::optional<std::pair<ccf::SeqNo, ccf::SeqNo>> {
+          const auto write_ranges =
+            index_per_private_key->get_write_ranges_in_range(id, begin, end);
+          if (write_ranges.has_value())
+          {
+            if (write_ranges->empty())
+            {
+              return std::nullopt;
+            }
+            begin = write_ranges->front().first;
+          }
+          return std::make_pair(
+            begin, std::min(end, begin + max_seqno_per_page));
+        };
+
+        const auto page = get_page(from_seqno, to_seqno);
+        if (!page.has_value())
+        {
+          // The index shows no writes to this id in the requested range
+          LoggingGetHistoricalRange::Out response;
+          nlohmann::json j_response = response;
+          ctx.rpc_ctx->set_response_status(HTTP_STATUS_OK);
+          ctx.rpc_ctx->set_response_header(
+            http::headers::CONTENT_TYPE, http::headervalues::contenttype::JSON);
+          ctx.rpc_ctx->set_response_body(j_response.dump());
+          return;
+        }
+
+        const auto [range_begin, range_end] = page.value();
 
         // Use hash of request as RequestHandle. WARNING: This means identical
         // requests from different users will collide, and overwrite each
@@ -1023,11 +1064,12 @@ namespace loggingapp
 
         // If this didn't cover the total requested range, begin fetching the
         // next page and tell the caller how to retrieve it
-        if (range_end != to_seqno)
+        const auto next_page = range_end != to_seqno ?
+          get_page(range_end + 1, to_seqno) :
+          std::nullopt;
+        if (next_page.has_value())
         {
-          const auto next_page_start = range_end + 1;
-          const auto next_page_end =
-            std::min(to_seqno, next_page_start + max_seqno_per_page);
+          const auto [next_page_start, next_page_end] = next_page.value();
 
           ccf::historical::RequestHandle next_page_handle =
             make_handle(next_page_start, next_page_end, id);
@@ -1191,7 +1233,7 @@ namespace loggingapp
         "This CCF sample app implements a simple logging application, securely "
         "recording messages at client-specified IDs. It demonstrates most of "
         "the features available to CCF apps.";
-      logger_handlers.openapi_info.document_version = "0.1.0";
+      logger_handlers.openapi_info.document_version = "0.3.0";
     }
   };
 }
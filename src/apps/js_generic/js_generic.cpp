@@ -8,11 +8,14 @@
 #include "crypto/entropy.h"
 #include "crypto/key_wrap.h"
 #include "crypto/rsa_key_pair.h"
+#include "ds/thread_ids.h"
 #include "js/wrap.h"
 #include "kv/untyped_map.h"
 #include "named_auth_policies.h"
 
+#include <map>
 #include <memory>
+#include <mutex>
 #include <quickjs/quickjs-exports.h>
 #include <quickjs/quickjs.h>
 #include <stdexcept>
@@ -34,6 +37,60 @@ namespace ccfapp
     ccfapp::AbstractNodeContext& context;
     metrics::Tracker metrics_tracker;
 
+    // A QuickJS runtime which is reused by successive requests on a single
+    // worker thread, so that its class definitions are only registered once.
+    // Each request still evaluates the app in a fresh context, and QuickJS
+    // keeps loaded modules per context, so no JS state (globals, module-level
+    // variables, module code) is shared between requests.
+    class JSInterpreter
+    {
+    private:
+      // Transaction modules are loaded from for the current request
+      kv::Tx* modules_tx = nullptr;
+
+      static JSModuleDef* module_loader(
+        JSContext* ctx, const char* module_name, void* opaque)
+      {
+        auto interpreter = (JSInterpreter*)opaque;
+        return js::js_app_module_loader(
+          ctx, module_name, interpreter->modules_tx);
+      }
+
+    public:
+      js::Runtime rt;
+
+      JSInterpreter()
+      {
+        rt.add_ccf_classdefs();
+        JS_SetModuleLoaderFunc(rt, nullptr, module_loader, this);
+      }
+
+      void set_modules_tx(kv::Tx* tx)
+      {
+        modules_tx = tx;
+      }
+    };
+
+    std::mutex interpreters_lock;
+    std::map<uint16_t, std::unique_ptr<JSInterpreter>> interpreters;
+
+    std::unique_ptr<JSInterpreter>& get_interpreter()
+    {
+      std::unique_ptr<JSInterpreter>* interpreter;
+      {
+        std::lock_guard<std::mutex> guard(interpreters_lock);
+        // Each slot is only ever accessed from its own thread
+        interpreter = &interpreters[threading::get_current_thread_id()];
+      }
+
+      if (*interpreter == nullptr)
+      {
+        *interpreter = std::make_unique<JSInterpreter>();
+      }
+
+      return *interpreter;
+    }
+
     static JSValue create_json_obj(const nlohmann::json& j, JSContext* ctx)
     {
       const auto buf = j.dump();
@@ -259,15 +316,40 @@ namespace ccfapp
       const std::optional<ccf::TxID>& transaction_id,
       ccf::historical::TxReceiptPtr receipt)
     {
-      js::Runtime rt;
-      rt.add_ccf_classdefs();
+      auto& interpreter = get_interpreter();
+      interpreter->set_modules_tx(&endpoint_ctx.tx);
 
-      JS_SetModuleLoaderFunc(
-        rt, nullptr, js::js_app_module_loader, &endpoint_ctx.tx);
+      try
+      {
+        do_execute_request(
+          props,
+          endpoint_ctx,
+          target_tx,
+          transaction_id,
+          receipt,
+          *interpreter);
+      }
+      catch (...)
+      {
+        interpreter.reset();
+        throw;
+      }
 
-      js::Context ctx(rt);
-      js::TxContext txctx{&target_tx, js::TxAccess::APP};
+      interpreter->set_modules_tx(nullptr);
+    }
 
+    void do_execute_request(
+      const ccf::endpoints::EndpointProperties& props,
+      ccf::endpoints::EndpointContext& endpoint_ctx,
+      kv::Tx& target_tx,
+      const std::optional<ccf::TxID>& transaction_id,
+      ccf::historical::TxReceiptPtr receipt,
+      JSInterpreter& interpreter)
+    {
+      // A fresh context for each request, so that nothing one request leaves
+      // in the JS globals or module state is visible to the next
+      js::Context ctx(interpreter.rt);
+      js::TxContext txctx{&target_tx, js::TxAccess::APP};
       js::register_request_body_class(ctx);
       js::populate_global_console(ctx);
       js::populate_global_ccf(
@@ -32,6 +32,7 @@
 #include "impl/state.h"
 #include "impl/view_change_tracker.h"
 #include "kv/kv_types.h"
+#include "node/commit_waiters.h"
 #include "node/node_to_node.h"
 #include "node/node_types.h"
 #include "node/progress_tracker.h"
@@ -165,6 +166,10 @@ namespace aft
     // append entries
     bool public_only = false;
 
+    // Requests waiting for transactions to be committed, notified whenever
+    // commit_idx advances
+    std::shared_ptr<ccf::CommitWaiters> commit_waiters = nullptr;
+
     // Randomness
     std::uniform_int_distribution<int> distrib;
     std::default_random_engine rand;
@@ -352,6 +357,12 @@ namespace aft
                                            committable_indices.back();
     }
 
+    void set_commit_waiters(std::shared_ptr<ccf::CommitWaiters> waiters)
+    {
+      std::lock_guard<std::mutex> guard(state->lock);
+      commit_waiters = waiters;
+    }
+
     void enable_all_domains()
     {
       // When receiving append entries as a follower, all security domains will
@@ -1352,6 +1363,10 @@ namespace aft
       uint64_t next_append_entry_index;
     };
 
+    // Smallest batch of append entries whose entries are prepared in parallel
+    // before being applied
+    static constexpr size_t min_entries_to_prepare_in_parallel = 2;
+
     void recv_append_entries(
       const ccf::NodeId& from,
       AppendEntries r,
@@ -1621,6 +1636,25 @@ namespace aft
         std::move(r),
         confirm_evidence);
 
+      // Entries are decrypted in parallel across the execution threads before
+      // being applied in order. There is no gain unless there are several
+      // entries and several execution threads to share them.
+      if (
+        consensus_type == ConsensusType::CFT && !public_only &&
+        threading::ThreadMessaging::thread_count > 2 &&
+        msg->data.append_entries.size() >= min_entries_to_prepare_in_parallel)
+      {
+        prepare_append_entries(std::move(msg));
+      }
+      else
+      {
+        dispatch_append_entries(std::move(msg));
+      }
+    }
+
+    void dispatch_append_entries(
+      std::unique_ptr<threading::Tmsg<AsyncExecution>> msg)
+    {
       if (threading::ThreadMessaging::thread_count > 1)
       {
         threading::ThreadMessaging::thread_messaging.add_task(
@@ -1634,6 +1668,77 @@ namespace aft
       }
     }
 
+    struct AsyncPrepare
+    {
+      AsyncPrepare(std::unique_ptr<threading::Tmsg<AsyncExecution>> msg_) :
+        msg(std::move(msg_)),
+        count(msg->data.append_entries.size()),
+        remaining(count)
+      {}
+
+      std::unique_ptr<threading::Tmsg<AsyncExecution>> msg;
+      const size_t count;
+      std::atomic<size_t> next_entry = 0;
+      std::atomic<size_t> remaining;
+    };
+
+    struct AsyncPrepareMsg
+    {
+      AsyncPrepareMsg(std::shared_ptr<AsyncPrepare> prepare_) :
+        prepare(std::move(prepare_))
+      {}
+
+      std::shared_ptr<AsyncPrepare> prepare;
+    };
+
+    void prepare_append_entries(
+      std::unique_ptr<threading::Tmsg<AsyncExecution>> msg)
+    {
+      auto prepare = std::make_shared<AsyncPrepare>(std::move(msg));
+
+      // Each task claims entries until none remain, and whichever prepares
+      // the last entry hands the batch on to be applied
+      const size_t tasks = std::min<size_t>(
+        prepare->count, threading::ThreadMessaging::thread_count - 1);
+      for (size_t i = 0; i < tasks; ++i)
+      {
+        auto tmsg = std::make_unique<threading::Tmsg<AsyncPrepareMsg>>(
+          prepare_append_entries_cb, prepare);
+        threading::ThreadMessaging::thread_messaging.add_task(
+          threading::ThreadMessaging::get_execution_thread(i),
+          std::move(tmsg));
+      }
+    }
+
+    static void prepare_append_entries_cb(
+      std::unique_ptr<threading::Tmsg<AsyncPrepareMsg>> msg)
+    {
+      auto& prepare = *msg->data.prepare;
+      bool completed = false;
+      while (true)
+      {
+        // Once every entry has been claimed, the batch may already have been
+        // applied and freed, so only count is safe to read
+        const auto i = prepare.next_entry.fetch_add(1);
+        if (i >= prepare.count)
+        {
+          break;
+        }
+
+        std::get<0>(prepare.msg->data.append_entries[i])->prepare();
+        if (prepare.remaining.fetch_sub(1) == 1)
+        {
+          completed = true;
+        }
+      }
+
+      if (completed)
+      {
+        auto self = prepare.msg->data.self;
+        self->dispatch_append_entries(std::move(prepare.msg));
+      }
+    }
+
     struct AsyncExecutionRet
     {
       AsyncExecutionRet(
@@ -3002,6 +3107,25 @@ namespace aft
       return have_quorum(num_trusted(c), c);
     }
 
+    struct CommitWaitersMsg
+    {
+      CommitWaitersMsg(
+        std::shared_ptr<ccf::CommitWaiters> waiters_,
+        ccf::CommitWaiters::Completions&& completed_) :
+        waiters(std::move(waiters_)),
+        completed(std::move(completed_))
+      {}
+
+      std::shared_ptr<ccf::CommitWaiters> waiters;
+      ccf::CommitWaiters::Completions completed;
+    };
+
+    static void complete_commit_waiters_cb(
+      std::unique_ptr<threading::Tmsg<CommitWaitersMsg>> msg)
+    {
+      msg->data.waiters->complete(std::move(msg->data.completed));
+    }
+
     void commit(Index idx)
     {
       if (idx > state->last_idx)
@@ -3036,6 +3160,21 @@ namespace aft
       store->compact(idx);
       ledger->commit(idx);
 
+      if (commit_waiters != nullptr)
+      {
+        // Producing and sending the responses is left to a separate task,
+        // which runs once this thread has released the raft lock
+        auto completed = commit_waiters->collect_committed(
+          idx, [this](Index i) { return get_term_internal(i); });
+        if (!completed.empty())
+        {
+          auto msg = std::make_unique<threading::Tmsg<CommitWaitersMsg>>(
+            complete_commit_waiters_cb, commit_waiters, std::move(completed));
+          threading::ThreadMessaging::thread_messaging.add_task(
+            threading::get_current_thread_id(), std::move(msg));
+        }
+      }
+
       LOG_DEBUG_FMT("Commit on {}: {}", state->my_node_id.trim(), idx);
 
       // Examine all configurations that are followed by a globally committed
@@ -24,13 +24,25 @@ namespace consensus
     DEFINE_RINGBUFFER_MSG_TYPE(ledger_entry),
     DEFINE_RINGBUFFER_MSG_TYPE(ledger_no_entry),
 
+    /// Request a range of adjacent ledger entries. Enclave -> Host
+    DEFINE_RINGBUFFER_MSG_TYPE(ledger_get_range),
+
+    /// Respond to ledger_get_range, with the framed entries of one or more
+    /// consecutive sub-ranges. Host -> Enclave
+    DEFINE_RINGBUFFER_MSG_TYPE(ledger_entry_range),
+    DEFINE_RINGBUFFER_MSG_TYPE(ledger_no_entry_range),
+
     /// Modify the local ledger. Enclave -> Host
     DEFINE_RINGBUFFER_MSG_TYPE(ledger_append),
     DEFINE_RINGBUFFER_MSG_TYPE(ledger_truncate),
     DEFINE_RINGBUFFER_MSG_TYPE(ledger_commit),
     DEFINE_RINGBUFFER_MSG_TYPE(ledger_init),
 
-    /// Create and commit a snapshot. Enclave -> Host
+    /// Create and commit a snapshot. Large snapshots are sent as a sequence
+    /// of snapshot_chunk messages followed by a final snapshot message. A
+    /// delta snapshot records the index of the snapshot it applies to.
+    /// Enclave -> Host
+    DEFINE_RINGBUFFER_MSG_TYPE(snapshot_chunk),
     DEFINE_RINGBUFFER_MSG_TYPE(snapshot),
     DEFINE_RINGBUFFER_MSG_TYPE(snapshot_commit),
   };
@@ -47,6 +59,22 @@ DECLARE_RINGBUFFER_MESSAGE_PAYLOAD(
   consensus::ledger_no_entry,
   consensus::Index,
   consensus::LedgerRequestPurpose);
+DECLARE_RINGBUFFER_MESSAGE_PAYLOAD(
+  consensus::ledger_get_range,
+  consensus::Index /* from */,
+  consensus::Index /* to */,
+  consensus::LedgerRequestPurpose);
+DECLARE_RINGBUFFER_MESSAGE_PAYLOAD(
+  consensus::ledger_entry_range,
+  consensus::Index /* from */,
+  consensus::Index /* to */,
+  consensus::LedgerRequestPurpose,
+  std::vector<uint8_t> /* framed entries */);
+DECLARE_RINGBUFFER_MESSAGE_PAYLOAD(
+  consensus::ledger_no_entry_range,
+  consensus::Index /* from */,
+  consensus::Index /* to */,
+  consensus::LedgerRequestPurpose);
 DECLARE_RINGBUFFER_MESSAGE_PAYLOAD(consensus::ledger_init, consensus::Index);
 DECLARE_RINGBUFFER_MESSAGE_PAYLOAD(
   consensus::ledger_append,
@@ -56,10 +84,17 @@ DECLARE_RINGBUFFER_MESSAGE_PAYLOAD(
 DECLARE_RINGBUFFER_MESSAGE_PAYLOAD(
   consensus::ledger_truncate, consensus::Index);
 DECLARE_RINGBUFFER_MESSAGE_PAYLOAD(consensus::ledger_commit, consensus::Index);
+DECLARE_RINGBUFFER_MESSAGE_PAYLOAD(
+  consensus::snapshot_chunk,
+  consensus::Index /* snapshot idx */,
+  consensus::Index /* evidence idx */,
+  consensus::Index /* base snapshot idx, 0 if not a delta */,
+  std::vector<uint8_t>);
 DECLARE_RINGBUFFER_MESSAGE_PAYLOAD(
   consensus::snapshot,
   consensus::Index /* snapshot idx */,
   consensus::Index /* evidence idx */,
+  consensus::Index /* base snapshot idx, 0 if not a delta */,
   std::vector<uint8_t>);
 DECLARE_RINGBUFFER_MESSAGE_PAYLOAD(
   consensus::snapshot_commit,
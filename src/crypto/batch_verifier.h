@@ -0,0 +1,231 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+#pragma once
+
+#include "crypto/verifier.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace crypto
+{
+  /** Collects pending signature verifications so that they can be verified
+   * together, and their results dispatched once all are known.
+   *
+   * Once every verification has been added, any number of threads may call
+   * run() concurrently. Each claims pending verifications one at a time until
+   * none remain, so the work is spread across however many threads take
+   * part. The call which completes the last verification invokes the
+   * callbacks, in the order in which verifications were added, and returns
+   * true. A call which returns false may do so while other threads are still
+   * verifying the items they claimed, until is_complete().
+   */
+  class BatchVerifier
+  {
+  public:
+    using Callback = std::function<void(bool)>;
+
+  protected:
+    struct Item
+    {
+      VerifierPtr verifier;
+      std::vector<uint8_t> data;
+      std::vector<uint8_t> signature;
+      MDType md_type;
+      // If true, data is already a digest of the signed contents
+      bool is_hash;
+      Callback callback;
+    };
+
+    std::vector<Item> items;
+
+    // Written by each verification, one byte per item so that concurrent
+    // writes to different items do not race
+    std::vector<uint8_t> results;
+
+    std::atomic<size_t> next_item = 0;
+    std::atomic<size_t> remaining = 0;
+    std::atomic<bool> started = false;
+    std::atomic<bool> complete = false;
+    std::once_flag start_flag;
+
+    size_t add(Item&& item)
+    {
+      if (started)
+      {
+        throw std::logic_error(
+          "Cannot add to a batch of verifications which has been started");
+      }
+      if (item.verifier == nullptr)
+      {
+        throw std::logic_error("Cannot add verification without verifier");
+      }
+
+      items.push_back(std::move(item));
+      return items.size() - 1;
+    }
+
+    bool verify_item(Item& item)
+    {
+      if (item.is_hash)
+      {
+        return item.verifier->verify_hash(
+          item.data.data(),
+          item.data.size(),
+          item.signature.data(),
+          item.signature.size(),
+          item.md_type);
+      }
+
+      return item.verifier->verify(
+        item.data.data(),
+        item.data.size(),
+        item.signature.data(),
+        item.signature.size(),
+        item.md_type);
+    }
+
+  public:
+    BatchVerifier() = default;
+    BatchVerifier(const BatchVerifier&) = delete;
+    BatchVerifier& operator=(const BatchVerifier&) = delete;
+
+    /** Add a signature over contents, to be verified with verifier
+     * @return Index of the verification's result
+     */
+    size_t add_verify(
+      const VerifierPtr& verifier,
+      std::vector<uint8_t> contents,
+      std::vector<uint8_t> signature,
+      MDType md_type = MDType::NONE,
+      Callback callback = nullptr)
+    {
+      return add({verifier,
+                  std::move(contents),
+                  std::move(signature),
+                  md_type,
+                  false,
+                  std::move(callback)});
+    }
+
+    /** Add a signature over the given hash, to be verified with verifier
+     * @return Index of the verification's result
+     */
+    size_t add_verify_hash(
+      const VerifierPtr& verifier,
+      std::vector<uint8_t> hash,
+      std::vector<uint8_t> signature,
+      MDType md_type = MDType::NONE,
+      Callback callback = nullptr)
+    {
+      return add({verifier,
+                  std::move(hash),
+                  std::move(signature),
+                  md_type,
+                  true,
+                  std::move(callback)});
+    }
+
+    size_t size() const
+    {
+      return items.size();
+    }
+
+    /** Verify pending signatures until none remain unclaimed. May be called
+     * concurrently from several threads once all verifications have been
+     * added.
+     * @return true if this call completed the batch, in which case all
+     *  callbacks have been invoked
+     */
+    bool run()
+    {
+      // Concurrent callers wait here until the results have been sized
+      bool first = false;
+      std::call_once(start_flag, [this, &first]() {
+        results.resize(items.size());
+        remaining = items.size();
+        started = true;
+        first = true;
+      });
+
+      if (items.empty())
+      {
+        if (first)
+        {
+          complete = true;
+        }
+        return first;
+      }
+
+      bool completed = false;
+      while (true)
+      {
+        const auto i = next_item.fetch_add(1);
+        if (i >= items.size())
+        {
+          break;
+        }
+
+        results[i] = verify_item(items[i]) ? 1 : 0;
+        if (remaining.fetch_sub(1) == 1)
+        {
+          completed = true;
+        }
+      }
+
+      if (completed)
+      {
+        for (size_t i = 0; i < items.size(); ++i)
+        {
+          if (items[i].callback)
+          {
+            items[i].callback(results[i] != 0);
+          }
+        }
+        complete = true;
+      }
+
+      return completed;
+    }
+
+    /** True once every verification has completed, and its callback (if
+     * any) has been invoked.
+     */
+    bool is_complete() const
+    {
+      return complete;
+    }
+
+    /** Verify all signatures on the calling thread.
+     * @return Result of each verification, in the order they were added
+     */
+    std::vector<bool> verify_all()
+    {
+      run();
+      return get_results();
+    }
+
+    /** Result of each verification, in the order they were added. Only valid
+     * once the batch has completed.
+     */
+    std::vector<bool> get_results() const
+    {
+      if (!complete)
+      {
+        throw std::logic_error("Batch of verifications has not completed");
+      }
+
+      return std::vector<bool>(results.begin(), results.end());
+    }
+
+    bool all_valid() const
+    {
+      const auto r = get_results();
+      return std::all_of(r.begin(), r.end(), [](bool b) { return b; });
+    }
+  };
+}
@@ -1,6 +1,7 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the Apache 2.0 License.
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "crypto/batch_verifier.h"
 #include "crypto/entropy.h"
 #include "crypto/key_pair.h"
 #include "crypto/key_wrap.h"
@@ -21,6 +22,7 @@
 #include <chrono>
 #include <cstring>
 #include <doctest/doctest.h>
+#include <thread>
 
 using namespace std;
 using namespace tls;
@@ -261,6 +263,113 @@ TEST_CASE("Manually hash, sign, verify, with certificate")
   }
 }
 
+TEST_CASE("Batch verification")
+{
+  constexpr size_t key_count = 4;
+  constexpr size_t sig_count = 50;
+
+  std::vector<KeyPairPtr> kps;
+  std::vector<VerifierPtr> verifiers;
+  for (size_t i = 0; i < key_count; ++i)
+  {
+    kps.push_back(make_key_pair(supported_curves[i % 2]));
+    verifiers.push_back(make_verifier(kps.back()->self_sign("CN=name")));
+  }
+
+  // Every 7th signature is invalid. Alternate signatures are over contents or
+  // over a precomputed hash.
+  auto make_batch = [&](
+                      BatchVerifier& batch,
+                      std::vector<bool>& expected,
+                      std::vector<bool>* dispatched = nullptr) {
+    for (size_t i = 0; i < sig_count; ++i)
+    {
+      auto& kp = kps[i % key_count];
+      const bool valid = i % 7 != 0;
+      expected.push_back(valid);
+
+      BatchVerifier::Callback cb = nullptr;
+      if (dispatched != nullptr)
+      {
+        cb = [dispatched](bool result) { dispatched->push_back(result); };
+      }
+
+      if (i % 2 == 0)
+      {
+        auto signature = kp->sign(contents);
+        if (!valid)
+        {
+          corrupt(signature);
+        }
+        batch.add_verify(
+          verifiers[i % key_count], contents, signature, MDType::NONE, cb);
+      }
+      else
+      {
+        crypto::HashBytes hash = bad_manual_hash(contents);
+        auto signature = kp->sign_hash(hash.data(), hash.size());
+        if (!valid)
+        {
+          corrupt(hash);
+        }
+        batch.add_verify_hash(
+          verifiers[i % key_count], hash, signature, MDType::NONE, cb);
+      }
+    }
+  };
+
+  {
+    INFO("Verify on a single thread");
+    BatchVerifier batch;
+    std::vector<bool> expected;
+    make_batch(batch, expected);
+    REQUIRE(batch.size() == sig_count);
+    REQUIRE(batch.verify_all() == expected);
+    REQUIRE_FALSE(batch.all_valid());
+    REQUIRE_THROWS(batch.add_verify(verifiers[0], contents, contents));
+  }
+
+  {
+    INFO("Verify across threads, dispatching results once");
+    BatchVerifier batch;
+    std::vector<bool> expected;
+    std::vector<bool> dispatched;
+    make_batch(batch, expected, &dispatched);
+
+    REQUIRE_FALSE(batch.is_complete());
+    constexpr size_t thread_count = 4;
+    std::atomic<size_t> completions = 0;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < thread_count; ++i)
+    {
+      threads.emplace_back([&]() {
+        if (batch.run())
+        {
+          ++completions;
+        }
+      });
+    }
+    for (auto& t : threads)
+    {
+      t.join();
+    }
+
+    REQUIRE(completions == 1);
+    REQUIRE(batch.is_complete());
+    REQUIRE(batch.get_results() == expected);
+    REQUIRE(dispatched == expected);
+  }
+
+  {
+    INFO("Empty batches complete immediately");
+    BatchVerifier batch;
+    REQUIRE(batch.run());
+    REQUIRE(batch.is_complete());
+    REQUIRE_FALSE(batch.run());
+    REQUIRE(batch.all_valid());
+  }
+}
+
 TEST_CASE("base64")
 {
   for (size_t length = 1; length < 20; ++length)
@@ -303,6 +303,26 @@ namespace champ
       return 0;
     }
 
+    // As put_mut, but modifies existing sub-nodes in place rather than
+    // copying them. Only valid if this node and all of its sub-nodes are
+    // uniquely owned, eg - while building a new map
+    size_t put_in_place(SmallIndex depth, Hash hash, const K& k, const V& v)
+    {
+      const auto idx = mask(hash, depth);
+      if (!node_map.check(idx))
+      {
+        return put_mut(depth, hash, k, v);
+      }
+
+      const auto c_idx = compressed_idx(idx);
+      if (depth < (collision_depth - 1))
+      {
+        return node_as<SubNodes<K, V, H>>(c_idx)->put_in_place(
+          depth + 1, hash, k, v);
+      }
+      return node_as<Collisions<K, V, H>>(c_idx)->put_mut(hash, k, v);
+    }
+
     std::pair<std::shared_ptr<SubNodes<K, V, H>>, size_t> put(
       SmallIndex depth, Hash hash, const K& k, const V& v) const
     {
@@ -382,6 +402,55 @@ namespace champ
       return true;
     }
 
+    // As foreach, but skips any entries and sub-trees which are shared with
+    // base, the node at the same position in another version of the map
+    template <class F>
+    bool foreach_changed(
+      SmallIndex depth, const SubNodes<K, V, H>* base, F&& f) const
+    {
+      for (SmallIndex idx = 0; idx <= index_mask; ++idx)
+      {
+        const auto c_idx = compressed_idx(idx);
+        if (c_idx == (SmallIndex)-1)
+          continue;
+
+        const SubNodes<K, V, H>* base_node = nullptr;
+        if (base != nullptr)
+        {
+          const auto base_c_idx = base->compressed_idx(idx);
+          if (base_c_idx != (SmallIndex)-1)
+          {
+            if (base->nodes[base_c_idx] == nodes[c_idx])
+              continue;
+
+            if (
+              depth < (collision_depth - 1) && base->node_map.check(idx))
+              base_node = base->node_as<SubNodes<K, V, H>>(base_c_idx).get();
+          }
+        }
+
+        if (data_map.check(idx))
+        {
+          const auto& entry = node_as<Entry<K, V>>(c_idx);
+          if (!f(entry->key, entry->value))
+            return false;
+        }
+        else if (depth == (collision_depth - 1))
+        {
+          if (!node_as<Collisions<K, V, H>>(c_idx)->foreach(
+                std::forward<F>(f)))
+            return false;
+        }
+        else
+        {
+          if (!node_as<SubNodes<K, V, H>>(c_idx)->foreach_changed(
+                depth + 1, base_node, std::forward<F>(f)))
+            return false;
+        }
+      }
+      return true;
+    }
+
   private:
     template <class A>
     const std::shared_ptr<A>& node_as(SmallIndex c_idx) const
@@ -408,11 +477,50 @@ namespace champ
     {}
 
   public:
+    // Transient, mutable map which is only used to construct a new Map. Each
+    // insertion modifies the trie in place, rather than copying the path to
+    // the modified node as Map::put does.
+    class Builder
+    {
+    private:
+      std::shared_ptr<SubNodes<K, V, H>> root;
+      size_t map_size = 0;
+      size_t serialized_size = 0;
+
+    public:
+      Builder() : root(std::make_shared<SubNodes<K, V, H>>()) {}
+
+      void put(const K& key, const V& value)
+      {
+        const auto r = root->put_in_place(0, H()(key), key, value);
+        if (r == 0)
+          map_size++;
+
+        serialized_size += get_size_with_padding<K, V>(key, value) - r;
+      }
+
+      size_t size() const
+      {
+        return map_size;
+      }
+
+      // Freeze the inserted entries into an immutable Map. The builder is
+      // left empty, and can be reused.
+      Map<K, V, H> build()
+      {
+        Map<K, V, H> map(std::move(root), map_size, serialized_size);
+        root = std::make_shared<SubNodes<K, V, H>>();
+        map_size = 0;
+        serialized_size = 0;
+        return map;
+      }
+    };
+
     Map() : root(std::make_shared<SubNodes<K, V, H>>()) {}
 
-    static Map<K, V, H> deserialize_map(CBuffer serialized_state)
+    template <class F>
+    static void deserialize_each(CBuffer serialized_state, F&& f)
     {
-      Map<K, V, H> map;
       const uint8_t* data = serialized_state.p;
       size_t size = serialized_state.rawSize();
 
@@ -429,8 +537,28 @@ namespace champ
         V value = champ::deserialize<V>(data, size);
         value_size -= size;
         serialized::skip(data, size, get_padding(value_size));
-        map = map.put(key, value);
+        f(key, value);
       }
+    }
+
+    static Map<K, V, H> deserialize_map(CBuffer serialized_state)
+    {
+      Builder builder;
+      deserialize_each(
+        serialized_state,
+        [&builder](const K& key, const V& value) { builder.put(key, value); });
+      return builder.build();
+    }
+
+    // Deserialize entries produced by a delta Snapshot, and apply them on top
+    // of base
+    static Map<K, V, H> deserialize_map(
+      CBuffer serialized_delta, const Map<K, V, H>& base)
+    {
+      auto map = base;
+      deserialize_each(
+        serialized_delta,
+        [&map](const K& key, const V& value) { map = map.put(key, value); });
       return map;
     }
 
@@ -490,6 +618,16 @@ namespace champ
     {
       return root->foreach(0, std::forward<F>(f));
     }
+
+    // Iterate over the entries which may have been added or modified since
+    // base. Sub-trees shared with base are skipped, so this is proportional
+    // to the number of changes rather than to the size of the map. Entries
+    // which have been removed since base are not visited.
+    template <class F>
+    bool foreach_changed(const Map<K, V, H>& base, F&& f) const
+    {
+      return root->foreach_changed(0, base.root.get(), std::forward<F>(f));
+    }
   };
 
   template <class K, class V, class H = std::hash<K>>
@@ -499,6 +637,9 @@ namespace champ
     Map<K, V, H> map;
     CBuffer serialized_buffer;
 
+    // If set, only the entries which changed since this map are serialized
+    std::optional<Map<K, V, H>> base = std::nullopt;
+
     struct KVTuple
     {
       K* k;
@@ -509,6 +650,9 @@ namespace champ
     };
     const uintptr_t padding = 0;
 
+    std::optional<std::vector<KVTuple>> ordered_state = std::nullopt;
+    size_t ordered_state_size = 0;
+
     uint32_t add_padding(uint32_t data_size, uint8_t*& data, size_t& size) const
     {
       uint32_t padding_size = get_padding(data_size);
@@ -520,15 +664,91 @@ namespace champ
       return padding_size;
     }
 
+    void collect()
+    {
+      if (ordered_state.has_value())
+      {
+        return;
+      }
+
+      std::vector<KVTuple> state;
+      size_t size = 0;
+
+      auto add = [&](auto& key, auto& value) {
+        K* k = &key;
+        V* v = &value;
+        uint32_t ks = champ::get_size(key);
+        uint32_t vs = champ::get_size(value);
+        uint32_t key_size = ks + get_padding(ks);
+        uint32_t value_size = vs + get_padding(vs);
+
+        size += (key_size + value_size);
+
+        state.emplace_back(k, static_cast<Hash>(H()(key)), v);
+
+        return true;
+      };
+
+      if (base.has_value())
+      {
+        map.foreach_changed(base.value(), add);
+      }
+      else
+      {
+        state.reserve(map.size());
+        map.foreach(add);
+
+        CCF_ASSERT_FMT(
+          size == map.get_serialized_size(),
+          "size:{}, map->size:{} ==> count:{}, vect:{}",
+          size,
+          map.get_serialized_size(),
+          map.size(),
+          state.size());
+      }
+
+      // Sort keys to be able to generate byte-for-byte serialised snapshot from
+      // the same state
+      std::sort(state.begin(), state.end(), [](KVTuple& i, KVTuple& j) {
+        return i.h_k < j.h_k;
+      });
+
+      ordered_state = std::move(state);
+      ordered_state_size = size;
+    }
+
   public:
     Snapshot(Map<K, V, H>& map_)
     {
       map = map_;
     }
 
+    // Snapshot of only the entries of map_ which were added or modified since
+    // base_, to be applied on top of base_ when deserialized
+    Snapshot(Map<K, V, H>& map_, const Map<K, V, H>& base_) : base(base_)
+    {
+      map = map_;
+    }
+
+    const Map<K, V, H>& get_map() const
+    {
+      return map;
+    }
+
+    bool is_delta() const
+    {
+      return base.has_value();
+    }
+
     size_t get_serialized_size()
     {
-      return map.get_serialized_size();
+      if (!base.has_value())
+      {
+        return map.get_serialized_size();
+      }
+
+      collect();
+      return ordered_state_size;
     }
 
     CBuffer& get_serialized_buffer()
@@ -538,43 +758,12 @@ namespace champ
 
     void serialize(uint8_t* data)
     {
-      std::vector<KVTuple> ordered_state;
-      ordered_state.reserve(map.size());
-      size_t size = 0;
+      collect();
+      size_t size = ordered_state_size;
 
-      map.foreach([&](auto& key, auto& value) {
-        K* k = &key;
-        V* v = &value;
-        uint32_t ks = champ::get_size(key);
-        uint32_t vs = champ::get_size(value);
-        uint32_t key_size = ks + get_padding(ks);
-        uint32_t value_size = vs + get_padding(vs);
-
-        size += (key_size + value_size);
+      serialized_buffer = CBuffer(data, ordered_state_size);
 
-        ordered_state.emplace_back(k, static_cast<Hash>(H()(key)), v);
-
-        return true;
-      });
-
-      // Sort keys to be able to generate byte-for-byte serialised snapshot from
-      // the same state
-      std::sort(
-        ordered_state.begin(), ordered_state.end(), [](KVTuple& i, KVTuple& j) {
-          return i.h_k < j.h_k;
-        });
-
-      CCF_ASSERT_FMT(
-        size == map.get_serialized_size(),
-        "size:{}, map->size:{} ==> count:{}, vect:{}",
-        size,
-        map.get_serialized_size(),
-        map.size(),
-        ordered_state.size());
-
-      serialized_buffer = CBuffer(data, map.get_serialized_size());
-
-      for (const auto& p : ordered_state)
+      for (const auto& p : ordered_state.value())
       {
         // Serialize the key
         uint32_t key_size = champ::serialize(*p.k, data, size);
@@ -586,6 +775,9 @@ namespace champ
       }
 
       CCF_ASSERT_FMT(size == 0, "buffer not filled, remaining:{}", size);
+
+      // Not needed once serialized
+      ordered_state.reset();
     }
   };
 }
@@ -118,15 +118,18 @@ namespace histogram
 
     size_t underflow = 0;
     size_t overflow = 0;
-    size_t count[BUCKETS];
+    size_t count[BUCKETS] = {};
 
     This* next;
 
   public:
-    Histogram(Global<This>& g) :
+    Histogram() :
       low((std::numeric_limits<V>::max)()),
       high((std::numeric_limits<V>::min)()),
       next(nullptr)
+    {}
+
+    Histogram(Global<This>& g) : Histogram()
     {
       g.add(*this);
     }
@@ -196,7 +199,7 @@ namespace histogram
       return std::make_pair(get_value(index), get_value(index + 1) - 1);
     }
 
-    void add(Histogram<V, LOW, HIGH, SIGNIFICANT_BITS>& that)
+    void add(const Histogram<V, LOW, HIGH, SIGNIFICANT_BITS>& that)
     {
       low = std::min(low, that.low);
       high = std::max(high, that.high);
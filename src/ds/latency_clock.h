@@ -0,0 +1,62 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+
+namespace ds
+{
+  /** Clock used to time the stages of handling a request.
+   *
+   * Stage timing needs finer resolution than the enclave's time, which the
+   * host only updates every millisecond, so it reads steady_clock. Inside an
+   * enclave each read is a call out to the host, so timing is off unless it
+   * has been enabled: until then now() reads no clock and returns nothing,
+   * and no stage durations are produced.
+   */
+  class LatencyClock
+  {
+  public:
+    using time_point = std::chrono::steady_clock::time_point;
+    using duration = std::chrono::steady_clock::duration;
+
+  private:
+    static inline std::atomic<bool> enabled = false;
+
+  public:
+    static void set_enabled(bool v)
+    {
+      enabled.store(v);
+    }
+
+    static bool is_enabled()
+    {
+      return enabled.load(std::memory_order_relaxed);
+    }
+
+    /// The current time, or nothing if stage timing is disabled
+    static std::optional<time_point> now()
+    {
+      if (!is_enabled())
+      {
+        return std::nullopt;
+      }
+
+      return std::chrono::steady_clock::now();
+    }
+
+    /// Time elapsed since start, or nothing if start was not timed
+    static std::optional<duration> since(
+      const std::optional<time_point>& start)
+    {
+      if (!start.has_value())
+      {
+        return std::nullopt;
+      }
+
+      return std::chrono::steady_clock::now() - start.value();
+    }
+  };
+}
@@ -122,4 +122,23 @@ public:
     auto it = insert(std::forward<K>(k), V{});
     return it->second;
   }
+
+  bool erase(const K& k)
+  {
+    const auto it = iter_map.find(k);
+    if (it == iter_map.end())
+    {
+      return false;
+    }
+
+    entries_list.erase(it->second);
+    iter_map.erase(it);
+    return true;
+  }
+
+  void clear()
+  {
+    entries_list.clear();
+    iter_map.clear();
+  }
 };
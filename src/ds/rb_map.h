@@ -98,9 +98,68 @@ public:
     }
   }
 
+  // Visits the entries whose key is in [from, to), in ascending key order, or
+  // in descending key order if reverse is set. A missing bound is unbounded.
+  // f should return false to stop the iteration, in which case this also
+  // returns false.
+  template <class F>
+  bool foreach_in_range(
+    const std::optional<K>& from,
+    const std::optional<K>& to,
+    bool reverse,
+    F&& f) const
+  {
+    return foreach_in_range_internal(from, to, reverse, f);
+  }
+
 private:
   std::shared_ptr<const Node> _root;
 
+  template <class F>
+  bool foreach_in_range_internal(
+    const std::optional<K>& from,
+    const std::optional<K>& to,
+    bool reverse,
+    F& f) const
+  {
+    if (empty())
+      return true;
+
+    auto& y = rootKey();
+
+    // Left subtree may only contain keys in range if from < y, right subtree
+    // only if y < to
+    const bool visit_left = !from.has_value() || *from < y;
+    const bool visit_right = !to.has_value() || y < *to;
+    const bool in_range = (!from.has_value() || !(y < *from)) && visit_right;
+
+    if (!reverse)
+    {
+      if (visit_left && !left().foreach_in_range_internal(from, to, reverse, f))
+        return false;
+
+      if (in_range && !f(y, rootValue()))
+        return false;
+
+      if (visit_right)
+        return right().foreach_in_range_internal(from, to, reverse, f);
+    }
+    else
+    {
+      if (
+        visit_right && !right().foreach_in_range_internal(from, to, reverse, f))
+        return false;
+
+      if (in_range && !f(y, rootValue()))
+        return false;
+
+      if (visit_left)
+        return left().foreach_in_range_internal(from, to, reverse, f);
+    }
+
+    return true;
+  }
+
   Color rootColor() const
   {
     return _root->_c;
@@ -178,4 +178,33 @@ TEST_CASE("LRU" * doctest::test_suite("lru"))
     ++it;
     REQUIRE(it == lru.end());
   }
+
+  {
+    INFO("Inserting an existing key keeps its value");
+    // cc, d, b -> b, cc, d
+    const auto it = lru.insert(key_b, "bb"s);
+    REQUIRE(it == lru.begin());
+    REQUIRE(it->first == key_b);
+    REQUIRE(it->second == "b"s);
+    REQUIRE(lru.size() == 3);
+  }
+
+  {
+    INFO("Entries can be erased");
+    // b, cc, d -> b, cc
+    REQUIRE(lru.erase(key_d));
+    REQUIRE_FALSE(lru.erase(key_d));
+    REQUIRE(lru.size() == 2);
+    REQUIRE_FALSE(lru.contains(key_d));
+
+    // b, cc -> a, b, cc
+    lru[key_a] = "a";
+    REQUIRE(lru.size() == 3);
+    REQUIRE(lru.contains(key_b));
+
+    lru.clear();
+    REQUIRE(lru.size() == 0);
+    REQUIRE(lru.begin() == lru.end());
+    REQUIRE_FALSE(lru.contains(key_a));
+  }
 }
\ No newline at end of file
@@ -208,6 +208,99 @@ static const champ::Map<K, V, H> gen_map(size_t size)
   return map;
 }
 
+template <class Hasher>
+static void check_builder(size_t size)
+{
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<K> dist(0, size);
+
+  champ::Map<K, V, Hasher> expected;
+  typename champ::Map<K, V, Hasher>::Builder builder;
+  for (size_t i = 0; i < size; ++i)
+  {
+    // Some keys are put more than once
+    const auto k = dist(gen);
+    const auto v = dist(gen);
+    expected = expected.put(k, v);
+    builder.put(k, v);
+    REQUIRE(builder.size() == expected.size());
+  }
+
+  auto built = builder.build();
+  REQUIRE(builder.size() == 0);
+  REQUIRE(built.size() == expected.size());
+  REQUIRE(built.get_serialized_size() == expected.get_serialized_size());
+  expected.foreach([&](const auto& k, const auto& v) {
+    REQUIRE(built.get(k) == v);
+    return true;
+  });
+
+  // The built map is not modified by later use of the builder
+  builder.put(size + 1, 0);
+  REQUIRE_FALSE(built.get(size + 1).has_value());
+  REQUIRE(builder.build().size() == 1);
+}
+
+TEST_CASE("map builder")
+{
+  check_builder<H>(1000);
+  check_builder<std::hash<K>>(10000);
+}
+
+template <class Hasher>
+static void check_delta(size_t size)
+{
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<K> dist(0, 2 * size);
+
+  champ::Map<K, V, Hasher> base;
+  for (size_t i = 0; i < size; ++i)
+  {
+    base = base.put(dist(gen), i);
+  }
+
+  auto map = base;
+  std::set<K> written;
+  for (size_t i = 0; i < size / 10; ++i)
+  {
+    const auto k = dist(gen);
+    map = map.put(k, size + i);
+    written.insert(k);
+  }
+
+  // Every written entry is visited, and unchanged parts of the map are
+  // mostly skipped
+  std::set<K> visited;
+  map.foreach_changed(base, [&](const auto& k, const auto& v) {
+    REQUIRE(map.get(k) == v);
+    visited.insert(k);
+    return true;
+  });
+  for (const auto& k : written)
+  {
+    REQUIRE(visited.find(k) != visited.end());
+  }
+  REQUIRE(visited.size() < map.size());
+
+  champ::Snapshot<K, V, Hasher> snapshot(map, base);
+  REQUIRE(snapshot.is_delta());
+  std::vector<uint8_t> s(snapshot.get_serialized_size());
+  snapshot.serialize(s.data());
+
+  auto applied = champ::Map<K, V, Hasher>::deserialize_map(s, base);
+  REQUIRE(applied.size() == map.size());
+  map.foreach([&](const auto& k, const auto& v) {
+    REQUIRE(applied.get(k) == v);
+    return true;
+  });
+}
+
+TEST_CASE("map delta")
+{
+  check_delta<H>(1000);
+  check_delta<std::hash<K>>(10000);
+}
+
 TEST_CASE("serialize map")
 {
   struct pair
@@ -59,4 +59,308 @@ TEST_CASE("Unpopped messages are freed")
   CHECK(Foo::count == 0);
 
   CHECK(happened);
-}
\ No newline at end of file
+}
+
+static void noop(std::unique_ptr<threading::Tmsg<Foo>> msg) {}
+
+TEST_CASE("Least loaded execution thread")
+{
+  const auto original_thread_count =
+    threading::ThreadMessaging::thread_count.load();
+  threading::ThreadMessaging::thread_count = 4;
+
+  {
+    threading::ThreadMessaging tm(4);
+
+    INFO("Ties are broken by assigned sessions, then by thread ID");
+    REQUIRE(tm.get_least_loaded_execution_thread() == 1);
+    tm.assign_session(1);
+    REQUIRE(tm.get_least_loaded_execution_thread() == 2);
+    tm.assign_session(2);
+    tm.assign_session(3);
+    REQUIRE(tm.get_least_loaded_execution_thread() == 1);
+
+    INFO("Pending tasks take precedence over assigned sessions");
+    tm.add_task<Foo>(1, std::make_unique<threading::Tmsg<Foo>>(&noop));
+    tm.add_task<Foo>(2, std::make_unique<threading::Tmsg<Foo>>(&noop));
+    tm.assign_session(3);
+    REQUIRE(tm.get_pending_tasks(1) == 1);
+    REQUIRE(tm.get_least_loaded_execution_thread() == 3);
+
+    tm.unassign_session(1);
+    tm.get_task(2).run_next_task();
+    REQUIRE(tm.get_pending_tasks(2) == 0);
+    REQUIRE(tm.get_least_loaded_execution_thread() == 2);
+
+    tm.drop_tasks();
+    REQUIRE(tm.get_pending_tasks(1) == 0);
+  }
+
+  threading::ThreadMessaging::thread_count = original_thread_count;
+}
+
+struct SessionMsg
+{
+  std::vector<size_t>* order;
+  size_t index;
+  threading::SessionPlacement::SessionTask session_task;
+};
+
+static void record_order(std::unique_ptr<threading::Tmsg<SessionMsg>> msg)
+{
+  msg->data.order->push_back(msg->data.index);
+}
+
+TEST_CASE("Session tasks stay in order across a thread migration")
+{
+  const auto original_thread_count =
+    threading::ThreadMessaging::thread_count.load();
+  threading::ThreadMessaging::thread_count = 3;
+
+  {
+    threading::ThreadMessaging tm(3);
+    threading::SessionPlacement session(tm);
+    REQUIRE(session.get_execution_thread() == 1);
+
+    std::vector<size_t> order;
+    auto add_session_task = [&](size_t index) {
+      auto msg = std::make_unique<threading::Tmsg<SessionMsg>>(&record_order);
+      msg->data.order = &order;
+      msg->data.index = index;
+      return session.add_task(std::move(msg));
+    };
+    auto load_thread = [&](uint16_t tid) {
+      constexpr auto load =
+        2 * threading::SessionPlacement::rebalance_threshold;
+      for (size_t i = 0; i < load; ++i)
+      {
+        tm.add_task<Foo>(tid, std::make_unique<threading::Tmsg<Foo>>(&noop));
+      }
+    };
+    auto run_all = [&](uint16_t tid) {
+      while (tm.get_task(tid).run_next_task())
+      {
+      }
+    };
+
+    INFO("A session with pending tasks stays on an overloaded thread");
+    REQUIRE(add_session_task(0) == 1);
+    load_thread(1);
+    REQUIRE(add_session_task(1) == 1);
+    REQUIRE(session.get_execution_thread() == 1);
+    run_all(1);
+    REQUIRE(order == std::vector<size_t>{0, 1});
+
+    INFO("An idle session moves away from an overloaded thread");
+    load_thread(1);
+    REQUIRE(add_session_task(2) == 2);
+    REQUIRE(add_session_task(3) == 2);
+    REQUIRE(session.get_execution_thread() == 2);
+    REQUIRE(tm.get_task(1).get_assigned_sessions() == 0);
+    REQUIRE(tm.get_task(2).get_assigned_sessions() == 1);
+
+    INFO("Tasks queued after the move run after those queued before it");
+    run_all(2);
+    REQUIRE(order == std::vector<size_t>{0, 1, 2, 3});
+
+    tm.drop_tasks();
+  }
+
+  threading::ThreadMessaging::thread_count = original_thread_count;
+}
+
+static std::chrono::microseconds fake_time = std::chrono::microseconds(0);
+
+static std::chrono::microseconds get_fake_time()
+{
+  return fake_time;
+}
+
+TEST_CASE("Task queue stats")
+{
+  threading::ThreadMessaging tm(1);
+  auto& task = tm.get_task(0);
+
+  {
+    INFO("Latencies are not recorded without a clock");
+    tm.add_task<Foo>(0, std::make_unique<threading::Tmsg<Foo>>(&noop));
+    REQUIRE(tm.run_one());
+    const auto stats = task.get_stats();
+    REQUIRE(stats.tasks_run == 1);
+    REQUIRE(stats.batches == 1);
+    REQUIRE(stats.pending_tasks == 0);
+    for (const auto& bucket : stats.latency_histogram)
+    {
+      REQUIRE(bucket == 0);
+    }
+  }
+
+  threading::ThreadMessaging::set_clock(&get_fake_time);
+  fake_time = std::chrono::microseconds(1000);
+
+  {
+    INFO("Tasks queued together are taken from the queue in one batch");
+    for (size_t i = 0; i < 3; ++i)
+    {
+      tm.add_task<Foo>(0, std::make_unique<threading::Tmsg<Foo>>(&noop));
+    }
+    REQUIRE(task.get_stats().pending_tasks == 3);
+
+    // Waited 0ms, then 1.5ms, then 100ms
+    REQUIRE(tm.run_one());
+    fake_time += std::chrono::microseconds(1500);
+    REQUIRE(tm.run_one());
+    fake_time += std::chrono::microseconds(98500);
+    REQUIRE(tm.run_one());
+    REQUIRE_FALSE(tm.run_one());
+
+    const auto stats = task.get_stats();
+    REQUIRE(stats.tasks_run == 4);
+    REQUIRE(stats.batches == 2);
+    REQUIRE(stats.pending_tasks == 0);
+    REQUIRE(
+      stats.latency_histogram.size() ==
+      threading::TaskStats::latency_bucket_count);
+    REQUIRE(stats.latency_histogram[0] == 1);
+    REQUIRE(stats.latency_histogram[1] == 1);
+    REQUIRE(stats.latency_histogram[7] == 1);
+  }
+
+  {
+    INFO("Tasks run since the previous tick are reported");
+    task.tick(std::chrono::milliseconds(1));
+    REQUIRE(task.get_stats().tasks_run_last_tick == 4);
+    tm.add_task<Foo>(0, std::make_unique<threading::Tmsg<Foo>>(&noop));
+    REQUIRE(tm.run_one());
+    task.tick(std::chrono::milliseconds(1));
+    REQUIRE(task.get_stats().tasks_run_last_tick == 1);
+  }
+
+  threading::ThreadMessaging::set_clock(nullptr);
+}
+
+TEST_CASE("Work beacon")
+{
+  threading::WorkBeacon beacon;
+
+  INFO("Waiting without a notification times out");
+  auto seen = beacon.get_generation();
+  REQUIRE_FALSE(beacon.wait_for_work(seen, std::chrono::milliseconds(1)));
+
+  INFO("A notification before the wait is not lost");
+  seen = beacon.get_generation();
+  beacon.notify_work_available();
+  REQUIRE(beacon.wait_for_work(seen, std::chrono::seconds(10)));
+
+  INFO("A notification wakes a waiting thread");
+  seen = beacon.get_generation();
+  std::atomic<bool> woken = false;
+  std::thread waiter([&]() {
+    woken = beacon.wait_for_work(seen, std::chrono::seconds(10));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  beacon.notify_work_available();
+  waiter.join();
+  REQUIRE(woken);
+}
+
+static std::atomic<size_t> woken_tasks = 0;
+
+static void count_woken(std::unique_ptr<threading::Tmsg<Foo>> msg)
+{
+  ++woken_tasks;
+}
+
+TEST_CASE("Idle thread runs newly added tasks")
+{
+  threading::ThreadMessaging tm(1);
+
+  std::thread worker([&tm]() { tm.run(); });
+
+  // Let the worker run out of idle polls and wait for work
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  constexpr size_t task_count = 10;
+  for (size_t i = 0; i < task_count; ++i)
+  {
+    tm.add_task<Foo>(0, std::make_unique<threading::Tmsg<Foo>>(&count_woken));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  const auto deadline =
+    std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (woken_tasks < task_count &&
+         std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::yield();
+  }
+
+  tm.set_finished();
+  worker.join();
+  REQUIRE(woken_tasks == task_count);
+}
+
+struct Large
+{
+  std::array<uint8_t, 1024> data;
+};
+
+static std::atomic<size_t> pooled_tasks_run = 0;
+
+static void count_pooled(std::unique_ptr<threading::Tmsg<Foo>> msg)
+{
+  ++pooled_tasks_run;
+}
+
+TEST_CASE("Thread messages are allocated from a pool")
+{
+  using Pool = threading::ThreadMsgPool;
+
+  {
+    INFO("Freed slots are reused by the same thread");
+    auto m = std::make_unique<threading::Tmsg<Foo>>(&noop);
+    const void* slot = m.get();
+    m.reset();
+    REQUIRE(Pool::get_cached_slots()[0] > 0);
+    m = std::make_unique<threading::Tmsg<Foo>>(&noop);
+    REQUIRE(m.get() == slot);
+  }
+
+  {
+    INFO("Messages too large for any slot are allocated from the heap");
+    const auto cached = Pool::get_cached_slots();
+    auto m = std::make_unique<threading::Tmsg<Large>>(
+      [](std::unique_ptr<threading::Tmsg<Large>>) {});
+    m.reset();
+    REQUIRE(Pool::get_cached_slots() == cached);
+  }
+
+  {
+    INFO("Slots are freed on the running thread and reused by the adding one");
+    threading::ThreadMessaging tm(1);
+    std::thread worker([&tm]() { tm.run(); });
+
+    constexpr size_t rounds = 20;
+    constexpr size_t tasks_per_round = 4 * Pool::batch_size;
+    for (size_t round = 0; round < rounds; ++round)
+    {
+      for (size_t i = 0; i < tasks_per_round; ++i)
+      {
+        tm.add_task<Foo>(
+          0, std::make_unique<threading::Tmsg<Foo>>(&count_pooled));
+      }
+
+      const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+      while (pooled_tasks_run < (round + 1) * tasks_per_round &&
+             std::chrono::steady_clock::now() < deadline)
+      {
+        std::this_thread::yield();
+      }
+      REQUIRE(pooled_tasks_run == (round + 1) * tasks_per_round);
+    }
+
+    tm.set_finished();
+    worker.join();
+  }
+}
@@ -4,11 +4,17 @@
 
 #include "ds/ccf_assert.h"
 #include "ds/logger.h"
+#include "ds/ring_buffer.h"
 #include "ds/thread_ids.h"
+#include "ds/thread_msg_pool.h"
+#include "ds/work_beacon.h"
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <cstddef>
+#include <vector>
 
 namespace threading
 {
@@ -16,10 +22,35 @@ namespace threading
   {
     void (*cb)(std::unique_ptr<ThreadMsg>);
     std::atomic<ThreadMsg*> next = nullptr;
+    // Set when added to a task queue, if a clock is available
+    std::chrono::microseconds enqueue_time = std::chrono::microseconds(0);
 
     ThreadMsg(void (*_cb)(std::unique_ptr<ThreadMsg>)) : cb(_cb) {}
 
     virtual ~ThreadMsg() = default;
+
+    // Messages are allocated from a pool of pre-sized slots where they fit
+    static void* operator new(size_t size)
+    {
+      return ThreadMsgPool::allocate(size);
+    }
+
+    static void operator delete(void* p, size_t size)
+    {
+      ThreadMsgPool::deallocate(p, size);
+    }
+
+    // Over-aligned messages do not fit the pool's slots
+    static void* operator new(size_t size, std::align_val_t alignment)
+    {
+      return ::operator new(size, alignment);
+    }
+
+    static void operator delete(
+      void* p, size_t size, std::align_val_t alignment)
+    {
+      ::operator delete(p, size, alignment);
+    }
   };
 
   template <typename Payload>
@@ -43,12 +74,82 @@ namespace threading
 
   class ThreadMessaging;
 
+  /** Snapshot of the activity of a single task queue.
+   */
+  struct TaskStats
+  {
+    // Bucket i of the latency histogram counts tasks which waited less than
+    // 2^i milliseconds between being queued and run. The last bucket also
+    // counts all longer waits. The enclave's clock is only updated by the
+    // host every millisecond or so, so finer buckets would be meaningless:
+    // bucket 0 counts tasks run within the same tick they were queued in.
+    static constexpr size_t latency_bucket_count = 16;
+
+    size_t pending_tasks = 0;
+    size_t assigned_sessions = 0;
+    uint64_t tasks_run = 0;
+    // Number of times queued tasks were taken from the queue together
+    uint64_t batches = 0;
+    uint64_t tasks_run_last_tick = 0;
+    std::vector<uint64_t> latency_histogram;
+  };
+
   class Task
   {
+  public:
+    using Clock = std::chrono::microseconds (*)();
+
+  private:
     std::atomic<ThreadMsg*> item_head = nullptr;
     ThreadMsg* local_msg = nullptr;
 
+    // Number of tasks added but not yet run, used as a measure of load
+    std::atomic<size_t> pending_tasks = 0;
+    // Number of sessions whose work is currently placed on this task
+    std::atomic<size_t> assigned_sessions = 0;
+
+    // Only written by the thread running this task, but read by others
+    std::atomic<uint64_t> tasks_run = 0;
+    std::atomic<uint64_t> batches = 0;
+    std::atomic<uint64_t> tasks_run_since_tick = 0;
+    std::atomic<uint64_t> tasks_run_last_tick = 0;
+    std::array<std::atomic<uint64_t>, TaskStats::latency_bucket_count>
+      latency_histogram = {};
+
+    // Signalled whenever a task is added, to wake the thread running this
+    // task if it is waiting for work
+    WorkBeacon beacon;
+
+    void record_latency(const ThreadMsg* msg)
+    {
+      const auto c = clock.load();
+      if (c == nullptr || msg->enqueue_time.count() == 0)
+      {
+        return;
+      }
+
+      const auto now = c();
+      const uint64_t latency = now > msg->enqueue_time ?
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+          now - msg->enqueue_time)
+          .count() :
+        0;
+      size_t bucket = 0;
+      while (bucket < TaskStats::latency_bucket_count - 1 &&
+             latency >= (1ull << bucket))
+      {
+        ++bucket;
+      }
+      latency_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
   public:
+    // Used to timestamp queued tasks. Latencies are not recorded while this
+    // is unset, or while it returns 0. This is called for every queued and
+    // every run task, so must be cheap (eg- an atomic load of the host's
+    // time, not a call out of the enclave).
+    static inline std::atomic<Clock> clock = nullptr;
+
     Task() = default;
 
     bool run_next_task()
@@ -57,6 +158,10 @@ namespace threading
       {
         local_msg = item_head.exchange(nullptr);
         reverse_local_messages();
+        if (local_msg != nullptr)
+        {
+          batches.fetch_add(1, std::memory_order_relaxed);
+        }
       }
 
       if (local_msg == nullptr)
@@ -66,6 +171,11 @@ namespace threading
 
       ThreadMsg* current = local_msg;
       local_msg = local_msg->next;
+      --pending_tasks;
+
+      record_latency(current);
+      tasks_run.fetch_add(1, std::memory_order_relaxed);
+      tasks_run_since_tick.fetch_add(1, std::memory_order_relaxed);
 
       current->cb(std::unique_ptr<ThreadMsg>(current));
       return true;
@@ -73,12 +183,49 @@ namespace threading
 
     void add_task(ThreadMsg* item)
     {
+      ++pending_tasks;
+      const auto c = clock.load();
+      if (c != nullptr)
+      {
+        item->enqueue_time = c();
+      }
+
       ThreadMsg* tmp_head;
       do
       {
         tmp_head = item_head.load();
         item->next = tmp_head;
       } while (!item_head.compare_exchange_strong(tmp_head, item));
+
+      beacon.notify_work_available();
+    }
+
+    size_t get_pending_tasks() const
+    {
+      return pending_tasks.load();
+    }
+
+    size_t get_assigned_sessions() const
+    {
+      return assigned_sessions.load();
+    }
+
+    TaskStats get_stats() const
+    {
+      TaskStats stats;
+      stats.pending_tasks = pending_tasks.load();
+      stats.assigned_sessions = assigned_sessions.load();
+      stats.tasks_run = tasks_run.load(std::memory_order_relaxed);
+      stats.batches = batches.load(std::memory_order_relaxed);
+      stats.tasks_run_last_tick =
+        tasks_run_last_tick.load(std::memory_order_relaxed);
+      stats.latency_histogram.reserve(latency_histogram.size());
+      for (const auto& bucket : latency_histogram)
+      {
+        stats.latency_histogram.push_back(
+          bucket.load(std::memory_order_relaxed));
+      }
+      return stats;
     }
 
     struct TimerEntry
@@ -133,6 +280,9 @@ namespace threading
     void tick(std::chrono::milliseconds elapsed)
     {
       time_offset += elapsed;
+      tasks_run_last_tick.store(
+        tasks_run_since_tick.exchange(0, std::memory_order_relaxed),
+        std::memory_order_relaxed);
 
       bool updated = false;
 
@@ -201,6 +351,7 @@ namespace threading
 
         ThreadMsg* current = local_msg;
         local_msg = local_msg->next;
+        --pending_tasks;
         delete current;
       }
     }
@@ -236,21 +387,89 @@ namespace threading
       }
     }
 
+    // How long a thread keeps polling an empty task queue before it blocks
+    // until a task is added. Waking a blocked thread is a call out of the
+    // enclave for the thread adding the task, so threads which are only idle
+    // briefly should not block.
+    static constexpr std::chrono::milliseconds idle_spin_time{5};
+
+    // Used instead of idle_spin_time when no clock has been set
+    static constexpr size_t idle_polls_before_wait = 1000;
+
+    // Longest a thread blocks for when waiting for work, as a safety net for
+    // any work which does not signal the thread
+    static constexpr std::chrono::milliseconds max_idle_wait{10};
+
     void set_finished(bool v = true)
     {
       finished.store(v);
+
+      // Wake any threads waiting for work, so that they see they are finished
+      for (auto& t : tasks)
+      {
+        t.beacon.notify_work_available();
+      }
     }
 
     void run()
     {
       Task& task = get_task(get_current_thread_id());
 
+      size_t consecutive_idles = 0;
+      std::chrono::microseconds idle_start{0};
       while (!is_finished())
       {
-        task.run_next_task();
+        const auto seen = task.beacon.get_generation();
+        if (task.run_next_task())
+        {
+          consecutive_idles = 0;
+          continue;
+        }
+
+        // As when recording latencies, a clock returning 0 is not yet set
+        const auto c = Task::clock.load();
+        const auto now = c != nullptr ? c() : std::chrono::microseconds(0);
+        if (consecutive_idles++ == 0)
+        {
+          idle_start = now;
+        }
+
+        const bool spun_enough = now.count() != 0 ?
+          now - idle_start >= idle_spin_time :
+          consecutive_idles >= idle_polls_before_wait;
+        if (spun_enough)
+        {
+          task.beacon.wait_for_work(seen, max_idle_wait);
+        }
+        else
+        {
+          CCF_PAUSE();
+        }
       }
     }
 
+    /** Get the generation of the calling thread's task beacon, which must be
+     * read before checking for work that will be waited on with
+     * wait_for_work().
+     */
+    WorkBeacon::Generation get_work_generation()
+    {
+      return get_task(get_current_thread_id()).beacon.get_generation();
+    }
+
+    /** Block the calling thread until a task is added to its queue after seen
+     * was read, or until timeout expires.
+     * @return true if a task has been added
+     */
+    template <typename Rep, typename Period>
+    bool wait_for_work(
+      WorkBeacon::Generation seen,
+      const std::chrono::duration<Rep, Period>& timeout)
+    {
+      return get_task(get_current_thread_id())
+        .beacon.wait_for_work(seen, timeout);
+    }
+
     inline Task& get_task(uint16_t tid)
     {
       CCF_ASSERT_FMT(
@@ -334,6 +553,71 @@ namespace threading
       return tid;
     }
 
+    /** Returns the execution thread with the fewest pending tasks. Ties are
+     * broken by the number of sessions assigned to each thread, then by
+     * thread ID.
+     */
+    uint16_t get_least_loaded_execution_thread()
+    {
+      if (thread_count <= 1)
+      {
+        return MAIN_THREAD_ID;
+      }
+
+      uint16_t best = 1;
+      for (uint16_t tid = 2; tid < thread_count; ++tid)
+      {
+        const auto& task = get_task(tid);
+        const auto& best_task = get_task(best);
+        const auto pending = task.get_pending_tasks();
+        const auto best_pending = best_task.get_pending_tasks();
+        if (
+          pending < best_pending ||
+          (pending == best_pending &&
+           task.get_assigned_sessions() < best_task.get_assigned_sessions()))
+        {
+          best = tid;
+        }
+      }
+
+      return best;
+    }
+
+    size_t get_pending_tasks(uint16_t tid)
+    {
+      return get_task(tid).get_pending_tasks();
+    }
+
+    /** Returns the stats of each thread's task queue, indexed by thread ID.
+     */
+    std::vector<TaskStats> get_stats()
+    {
+      std::vector<TaskStats> stats;
+      for (uint16_t tid = 0; tid < std::max<uint16_t>(thread_count, 1); ++tid)
+      {
+        stats.push_back(get_task(tid).get_stats());
+      }
+      return stats;
+    }
+
+    static void set_clock(Task::Clock clock)
+    {
+      Task::clock = clock;
+    }
+
+    /** Record that a session's work is placed on (or has been moved away
+     * from) thread tid, so that new sessions are spread across threads.
+     */
+    void assign_session(uint16_t tid)
+    {
+      ++get_task(tid).assigned_sessions;
+    }
+
+    void unassign_session(uint16_t tid)
+    {
+      --get_task(tid).assigned_sessions;
+    }
+
     template <typename Payload>
     static void ChangeTmsgCallback(
       std::unique_ptr<Tmsg<Payload>>& msg,
@@ -348,4 +632,126 @@ namespace threading
       return finished.load();
     }
   };
+
+  /** Places the tasks of one session on an execution thread, so that they run
+   * in order and never concurrently. The session starts on the least loaded
+   * execution thread, and is moved to the least loaded one when its own
+   * thread has fallen behind, but only while none of its tasks are pending.
+   */
+  class SessionPlacement
+  {
+  public:
+    // A session is moved to the least loaded execution thread when its own
+    // thread has at least this many more pending tasks
+    static constexpr size_t rebalance_threshold = 4;
+
+    /** Held by each of this session's tasks while queued or running.
+     */
+    class SessionTask
+    {
+      SessionPlacement* placement = nullptr;
+
+    public:
+      SessionTask() = default;
+      SessionTask(SessionPlacement* placement_) : placement(placement_) {}
+      SessionTask(const SessionTask&) = delete;
+      SessionTask(SessionTask&& other) : placement(other.placement)
+      {
+        other.placement = nullptr;
+      }
+
+      SessionTask& operator=(SessionTask&& other)
+      {
+        std::swap(placement, other.placement);
+        return *this;
+      }
+
+      ~SessionTask()
+      {
+        if (placement != nullptr)
+        {
+          placement->state.fetch_sub(1);
+        }
+      }
+    };
+
+  private:
+    ThreadMessaging& tm;
+
+    // Thread on which this session's tasks run (upper 16 bits), and the number
+    // of this session's tasks which are queued or running (lower bits)
+    static constexpr size_t thread_shift = 48;
+    static constexpr uint64_t task_count_mask = (1ull << thread_shift) - 1;
+    std::atomic<uint64_t> state;
+
+    // Counts a new pending task for this session, first moving the session to
+    // a less loaded thread if none of its tasks are pending. Returns the
+    // thread on which the task must run.
+    uint16_t start_task()
+    {
+      auto current = state.load();
+      while (true)
+      {
+        uint16_t tid = current >> thread_shift;
+        const auto task_count = current & task_count_mask;
+        if (task_count == 0 && tid != MAIN_THREAD_ID)
+        {
+          const auto candidate = tm.get_least_loaded_execution_thread();
+          if (
+            tm.get_pending_tasks(tid) >=
+            tm.get_pending_tasks(candidate) + rebalance_threshold)
+          {
+            tid = candidate;
+          }
+        }
+
+        const auto next = ((uint64_t)tid << thread_shift) | (task_count + 1);
+        if (state.compare_exchange_weak(current, next))
+        {
+          const uint16_t previous_tid = current >> thread_shift;
+          if (previous_tid != tid)
+          {
+            tm.unassign_session(previous_tid);
+            tm.assign_session(tid);
+            LOG_TRACE_FMT(
+              "Moved session from thread {} to thread {}", previous_tid, tid);
+          }
+          return tid;
+        }
+      }
+    }
+
+  public:
+    SessionPlacement(ThreadMessaging& tm_ = ThreadMessaging::thread_messaging) :
+      tm(tm_)
+    {
+      const auto tid = tm.get_least_loaded_execution_thread();
+      tm.assign_session(tid);
+      state = (uint64_t)tid << thread_shift;
+    }
+
+    ~SessionPlacement()
+    {
+      tm.unassign_session(get_execution_thread());
+    }
+
+    uint16_t get_execution_thread() const
+    {
+      return state.load() >> thread_shift;
+    }
+
+    /** Queue a task for this session, on its execution thread. The payload
+     * must have a SessionTask session_task member, which is released once the
+     * task has run (or been dropped).
+     * @return The thread on which the task was queued
+     */
+    template <typename Payload>
+    uint16_t add_task(std::unique_ptr<Tmsg<Payload>> msg)
+    {
+      const auto tid = start_task();
+      msg->data.session_task = SessionTask(this);
+      tm.add_task(tid, std::move(msg));
+      return tid;
+    }
+  };
 };
@@ -0,0 +1,242 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <vector>
+
+namespace threading
+{
+  /** Pool of fixed-size slots from which small thread messages are allocated,
+   * so that the hot path of posting a message to another thread does not go
+   * through the heap. Larger messages fall back to the heap.
+   *
+   * Each thread keeps its own cache of free slots for each slot size. Since
+   * messages are usually allocated on one thread and freed on another, a
+   * thread whose cache fills up hands a batch of slots to a shared depot,
+   * from which a thread with an empty cache takes a whole batch, so that the
+   * depot's lock is only taken once per batch. Both caches and depot are
+   * bounded: beyond that, freed slots are returned to the heap.
+   */
+  class ThreadMsgPool
+  {
+  public:
+    static constexpr std::array<size_t, 3> slot_sizes = {64, 128, 256};
+
+    // Number of slots moved between a thread's cache and the depot at once
+    static constexpr size_t batch_size = 32;
+
+    // A thread's cache of each slot size holds at most this many slots
+    static constexpr size_t max_cached_slots = 2 * batch_size;
+
+    // The depot of each slot size holds at most this many batches
+    static constexpr size_t max_depot_batches = 64;
+
+  private:
+    static constexpr size_t slot_size_count = slot_sizes.size();
+
+    struct FreeSlot
+    {
+      FreeSlot* next;
+    };
+
+    struct Cache
+    {
+      FreeSlot* head;
+      size_t count;
+    };
+
+    // Trivially destructible, so that it can still be read while a thread's
+    // other thread_locals are destroyed
+    struct ThreadCaches
+    {
+      std::array<Cache, slot_size_count> caches;
+      bool guarded;
+      bool released;
+    };
+    static inline thread_local ThreadCaches thread_caches = {};
+
+    // Returns the calling thread's cached slots to the heap when it exits
+    struct ThreadCachesGuard
+    {
+      ~ThreadCachesGuard()
+      {
+        for (auto& cache : thread_caches.caches)
+        {
+          free_list(cache.head);
+          cache = {};
+        }
+        thread_caches.released = true;
+      }
+    };
+    static inline thread_local ThreadCachesGuard thread_caches_guard;
+
+    struct Depot
+    {
+      std::mutex lock;
+      // Each entry is a list of batch_size free slots
+      std::vector<FreeSlot*> batches;
+
+      Depot()
+      {
+        batches.reserve(max_depot_batches);
+      }
+
+      ~Depot()
+      {
+        for (auto batch : batches)
+        {
+          free_list(batch);
+        }
+      }
+    };
+
+    static Depot& get_depot(size_t slot_size_idx)
+    {
+      static std::array<Depot, slot_size_count> depots;
+      return depots[slot_size_idx];
+    }
+
+    static std::optional<size_t> get_slot_size_idx(size_t size)
+    {
+      for (size_t i = 0; i < slot_size_count; ++i)
+      {
+        if (size <= slot_sizes[i])
+        {
+          return i;
+        }
+      }
+      return std::nullopt;
+    }
+
+    static void free_list(FreeSlot* slot)
+    {
+      while (slot != nullptr)
+      {
+        auto next = slot->next;
+        ::operator delete(slot);
+        slot = next;
+      }
+    }
+
+    static Cache* get_cache(size_t slot_size_idx)
+    {
+      if (thread_caches.released)
+      {
+        return nullptr;
+      }
+
+      if (!thread_caches.guarded)
+      {
+        // Make sure the cache is released when this thread exits
+        (void)&thread_caches_guard;
+        thread_caches.guarded = true;
+      }
+
+      return &thread_caches.caches[slot_size_idx];
+    }
+
+    static void refill(Cache& cache, size_t slot_size_idx)
+    {
+      auto& depot = get_depot(slot_size_idx);
+      std::lock_guard<std::mutex> guard(depot.lock);
+      if (!depot.batches.empty())
+      {
+        cache.head = depot.batches.back();
+        cache.count = batch_size;
+        depot.batches.pop_back();
+      }
+    }
+
+    static void spill(Cache& cache, size_t slot_size_idx)
+    {
+      auto batch = cache.head;
+      auto last = batch;
+      for (size_t i = 1; i < batch_size; ++i)
+      {
+        last = last->next;
+      }
+      cache.head = last->next;
+      cache.count -= batch_size;
+      last->next = nullptr;
+
+      {
+        auto& depot = get_depot(slot_size_idx);
+        std::lock_guard<std::mutex> guard(depot.lock);
+        if (depot.batches.size() < max_depot_batches)
+        {
+          depot.batches.push_back(batch);
+          return;
+        }
+      }
+
+      free_list(batch);
+    }
+
+  public:
+    static void* allocate(size_t size)
+    {
+      const auto slot_size_idx = get_slot_size_idx(size);
+      if (!slot_size_idx.has_value())
+      {
+        return ::operator new(size);
+      }
+
+      auto cache = get_cache(slot_size_idx.value());
+      if (cache != nullptr)
+      {
+        if (cache->head == nullptr)
+        {
+          refill(*cache, slot_size_idx.value());
+        }
+
+        if (cache->head != nullptr)
+        {
+          auto slot = cache->head;
+          cache->head = slot->next;
+          --cache->count;
+          return slot;
+        }
+      }
+
+      return ::operator new(slot_sizes[slot_size_idx.value()]);
+    }
+
+    static void deallocate(void* p, size_t size)
+    {
+      const auto slot_size_idx = get_slot_size_idx(size);
+      auto cache = slot_size_idx.has_value() ?
+        get_cache(slot_size_idx.value()) :
+        nullptr;
+      if (cache == nullptr)
+      {
+        ::operator delete(p);
+        return;
+      }
+
+      auto slot = static_cast<FreeSlot*>(p);
+      slot->next = cache->head;
+      cache->head = slot;
+      if (++cache->count >= max_cached_slots)
+      {
+        spill(*cache, slot_size_idx.value());
+      }
+    }
+
+    /** Number of free slots of each size cached by the calling thread
+     */
+    static std::array<size_t, slot_size_count> get_cached_slots()
+    {
+      std::array<size_t, slot_size_count> counts = {};
+      for (size_t i = 0; i < slot_size_count; ++i)
+      {
+        counts[i] = thread_caches.caches[i].count;
+      }
+      return counts;
+    }
+  };
+}
@@ -0,0 +1,68 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace threading
+{
+  /** Allows a thread which has run out of work to block until another thread
+   * signals that there may be more, rather than spinning or sleeping for a
+   * fixed period.
+   *
+   * A waiting thread should read the generation before checking for work, and
+   * pass it to wait_for_work(). Any notification after the generation was read
+   * wakes the waiter, so notifications cannot be lost between the check and
+   * the wait. Notifying is a single atomic increment unless a thread is
+   * waiting. Inside an enclave, blocking and waking a blocked thread are
+   * calls out to the host, so callers should poll for a while before waiting.
+   */
+  class WorkBeacon
+  {
+  private:
+    std::mutex lock;
+    std::condition_variable cv;
+    std::atomic<uint64_t> generation = 0;
+    std::atomic<size_t> waiters = 0;
+
+  public:
+    using Generation = uint64_t;
+
+    Generation get_generation() const
+    {
+      return generation.load();
+    }
+
+    void notify_work_available()
+    {
+      generation.fetch_add(1);
+      if (waiters.load() > 0)
+      {
+        // Taking the lock ensures a waiter which has seen the old generation
+        // is already waiting on the condition variable
+        std::lock_guard<std::mutex> guard(lock);
+        cv.notify_all();
+      }
+    }
+
+    /** Block until there has been a notification since seen was read, or
+     * until timeout expires.
+     * @return true if there has been a notification
+     */
+    template <typename Rep, typename Period>
+    bool wait_for_work(
+      Generation seen, const std::chrono::duration<Rep, Period>& timeout)
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      ++waiters;
+      const auto notified = cv.wait_for(
+        guard, timeout, [this, seen]() { return generation.load() != seen; });
+      --waiters;
+      return notified;
+    }
+  };
+}
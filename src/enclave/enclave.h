@@ -6,6 +6,7 @@
 #include "ds/logger.h"
 #include "ds/oversized.h"
 #include "enclave_time.h"
+#include "indexing/indexer.h"
 #include "interface.h"
 #include "node/entities.h"
 #include "node/historical_queries.h"
@@ -45,6 +46,7 @@ namespace enclave
       std::unique_ptr<ccf::historical::StateCache> historical_state_cache =
         nullptr;
       ccf::AbstractNodeState* node_state = nullptr;
+      std::shared_ptr<ccf::indexing::Indexer> indexer = nullptr;
 
       NodeContext() {}
 
@@ -57,6 +59,11 @@ namespace enclave
       {
         return *node_state;
       }
+
+      ccf::indexing::AbstractIndexer& get_indexer() override
+      {
+        return *indexer;
+      }
     };
 
     std::unique_ptr<NodeContext> context = nullptr;
@@ -113,6 +120,8 @@ namespace enclave
           network.ledger_secrets,
           writer_factory.create_writer_to_outside());
       context->node_state = node.get();
+      context->indexer =
+        std::make_shared<ccf::indexing::Indexer>(*network.tables);
 
       rpc_map->register_frontend<ccf::ActorsType::members>(
         std::make_unique<ccf::MemberRpcFrontend>(
@@ -128,6 +137,7 @@ namespace enclave
         consensus_config,
         rpc_map,
         rpcsessions,
+        context->indexer,
         signature_intervals.sig_tx_interval,
         signature_intervals.sig_ms_interval);
     }
@@ -161,6 +171,9 @@ namespace enclave
       rpcsessions->set_max_open_sessions(
         ccf_config_.max_open_sessions_soft, ccf_config_.max_open_sessions_hard);
 
+      context->historical_state_cache->set_soft_cache_limit(
+        ccf_config_.historical_cache_soft_limit);
+
       ccf::NodeCreateInfo r;
       try
       {
@@ -267,30 +280,10 @@ namespace enclave
           bp,
           consensus::ledger_entry,
           [this](const uint8_t* data, size_t size) {
-            const auto [index, purpose, body] =
+            auto [index, purpose, body] =
               ringbuffer::read_message<consensus::ledger_entry>(data, size);
             switch (purpose)
             {
-              case consensus::LedgerRequestPurpose::Recovery:
-              {
-                if (
-                  node->is_reading_public_ledger() ||
-                  node->is_verifying_snapshot())
-                {
-                  node->recover_public_ledger_entry(body);
-                }
-                else if (node->is_reading_private_ledger())
-                {
-                  node->recover_private_ledger_entry(body);
-                }
-                else
-                {
-                  auto [s, _, __] = node->state();
-                  LOG_FAIL_FMT(
-                    "Cannot recover ledger entry: Unexpected node state {}", s);
-                }
-                break;
-              }
               case consensus::LedgerRequestPurpose::HistoricalQuery:
               {
                 context->historical_state_cache->handle_ledger_entry(
@@ -311,22 +304,98 @@ namespace enclave
             const auto [index, purpose] =
               ringbuffer::read_message<consensus::ledger_no_entry>(data, size);
             switch (purpose)
+            {
+              case consensus::LedgerRequestPurpose::HistoricalQuery:
+              {
+                context->historical_state_cache->handle_no_entry(index);
+                break;
+              }
+              default:
+              {
+                LOG_FAIL_FMT("Unhandled purpose: {}", purpose);
+              }
+            }
+          });
+
+        DISPATCHER_SET_MESSAGE_HANDLER(
+          bp,
+          consensus::ledger_entry_range,
+          [this](const uint8_t* data, size_t size) {
+            const auto from = serialized::read<consensus::Index>(data, size);
+            const auto to = serialized::read<consensus::Index>(data, size);
+            const auto purpose =
+              serialized::read<consensus::LedgerRequestPurpose>(data, size);
+            switch (purpose)
             {
               case consensus::LedgerRequestPurpose::Recovery:
               {
-                if (node->is_verifying_snapshot())
+                for (auto index = from; index <= to; ++index)
                 {
-                  node->verify_snapshot_end();
+                  if (size < kv::serialised_entry_header_size)
+                  {
+                    LOG_FAIL_FMT(
+                      "Range of ledger entries {} - {} is truncated at {}",
+                      from,
+                      to,
+                      index);
+                    node->recover_ledger_no_entry(index);
+                    break;
+                  }
+
+                  const auto header =
+                    serialized::peek<kv::SerialisedEntryHeader>(data, size);
+                  const size_t entry_size =
+                    kv::serialised_entry_header_size + header.size;
+                  if (entry_size > size)
+                  {
+                    LOG_FAIL_FMT(
+                      "Range of ledger entries {} - {} is truncated at {}",
+                      from,
+                      to,
+                      index);
+                    node->recover_ledger_no_entry(index);
+                    break;
+                  }
+
+                  std::vector<uint8_t> entry(data, data + entry_size);
+                  serialized::skip(data, size, entry_size);
+                  node->recover_ledger_entry(index, std::move(entry));
                 }
-                else
+                break;
+              }
+              case consensus::LedgerRequestPurpose::HistoricalQuery:
+              {
+                context->historical_state_cache->handle_ledger_entries(
+                  from, to, data, size);
+                break;
+              }
+              default:
+              {
+                LOG_FAIL_FMT("Unhandled purpose: {}", purpose);
+              }
+            }
+          });
+
+        DISPATCHER_SET_MESSAGE_HANDLER(
+          bp,
+          consensus::ledger_no_entry_range,
+          [this](const uint8_t* data, size_t size) {
+            const auto [from, to, purpose] =
+              ringbuffer::read_message<consensus::ledger_no_entry_range>(
+                data, size);
+            switch (purpose)
+            {
+              case consensus::LedgerRequestPurpose::Recovery:
+              {
+                for (auto index = from; index <= to; ++index)
                 {
-                  node->recover_ledger_end();
+                  node->recover_ledger_no_entry(index);
                 }
                 break;
               }
               case consensus::LedgerRequestPurpose::HistoricalQuery:
               {
-                context->historical_state_cache->handle_no_entry(index);
+                context->historical_state_cache->handle_no_entries(from, to);
                 break;
               }
               default:
@@ -360,9 +429,23 @@ namespace enclave
         // processed in a single iteration
         static constexpr size_t max_messages = 256;
 
+        // How long the main thread spins while idle before blocking, as in
+        // ThreadMessaging::run()
+        static constexpr std::chrono::milliseconds idle_spin_time(5);
+
+        // Messages written to the ringbuffer by the host cannot wake the
+        // enclave, so while blocked it still polls the ringbuffer this often.
+        // Thread messages wake it immediately. This matches the host's
+        // default tick period, so an idle node makes about as many timed
+        // waits (each a call out of the enclave) as it receives ticks.
+        static constexpr std::chrono::milliseconds max_idle_wait(10);
+
         size_t consecutive_idles = 0u;
         while (!bp.get_finished())
         {
+          const auto seen =
+            threading::ThreadMessaging::thread_messaging.get_work_generation();
+
           // First, read some messages from the ringbuffer
           auto read = bp.read_n(max_messages, circuit.read_from_outside());
 
@@ -386,11 +469,12 @@ namespace enclave
               idling_start_time = time_now;
             }
 
-            // Handle initial idles by pausing, eventually sleep (in host)
-            constexpr std::chrono::milliseconds timeout(5);
-            if ((time_now - idling_start_time) > timeout)
+            // Handle initial idles by pausing, then block until a thread
+            // message arrives or it is time to poll the ringbuffer again
+            if ((time_now - idling_start_time) > idle_spin_time)
             {
-              std::this_thread::sleep_for(timeout * 10);
+              threading::ThreadMessaging::thread_messaging.wait_for_work(
+                seen, max_idle_wait);
             }
             else
             {
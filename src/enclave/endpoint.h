@@ -2,6 +2,8 @@
 // Licensed under the Apache 2.0 License.
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace enclave
@@ -13,5 +15,12 @@ namespace enclave
 
     virtual void recv(const uint8_t* data, size_t size) = 0;
     virtual void send(std::vector<uint8_t>&& data) = 0;
+
+    // Sends a response to a request received on the given stream of a
+    // multiplexed connection. Endpoints without streams send it as is.
+    virtual void send_on_stream(uint32_t, std::vector<uint8_t>&& data)
+    {
+      send(std::move(data));
+    }
   };
 }
@@ -46,11 +46,15 @@ struct CCFConfig
   consensus::Configuration consensus_config = {};
   ccf::NodeInfoNetwork node_info_network = {};
   size_t snapshot_tx_interval;
+  size_t max_snapshot_deltas;
   size_t max_open_sessions_soft;
   size_t max_open_sessions_hard;
+  size_t historical_cache_soft_limit;
 
   // Only if joining or recovering
   std::vector<uint8_t> startup_snapshot;
+  // Delta snapshots, applied in order on top of startup_snapshot
+  std::vector<std::vector<uint8_t>> startup_snapshot_deltas;
   size_t startup_snapshot_evidence_seqno;
 
   struct SignatureIntervals
@@ -81,6 +85,7 @@ struct CCFConfig
   std::vector<crypto::SubjectAltName> subject_alternative_names;
 
   size_t jwt_key_refresh_interval_s;
+  bool request_stage_timing = false;
 
   crypto::CurveID curve_id;
 };
@@ -103,9 +108,12 @@ DECLARE_JSON_REQUIRED_FIELDS(
   consensus_config,
   node_info_network,
   snapshot_tx_interval,
+  max_snapshot_deltas,
   max_open_sessions_soft,
   max_open_sessions_hard,
+  historical_cache_soft_limit,
   startup_snapshot,
+  startup_snapshot_deltas,
   startup_snapshot_evidence_seqno,
   signature_intervals,
   genesis,
@@ -113,6 +121,7 @@ DECLARE_JSON_REQUIRED_FIELDS(
   subject_name,
   subject_alternative_names,
   jwt_key_refresh_interval_s,
+  request_stage_timing,
   curve_id);
 
 /// General administrative messages
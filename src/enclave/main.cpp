@@ -3,6 +3,7 @@
 #include "ccf/version.h"
 #include "common/enclave_interface_types.h"
 #include "ds/json.h"
+#include "ds/latency_clock.h"
 #include "ds/logger.h"
 #include "ds/stacktrace_utils.h"
 #include "enclave.h"
@@ -83,6 +84,11 @@ extern "C"
     enclave::host_time =
       static_cast<decltype(enclave::host_time)>(time_location);
 
+    // Timestamp queued thread messages with the host's time, to measure how
+    // long they wait before being run and how long idle threads have spun
+    threading::ThreadMessaging::set_clock(
+      []() { return enclave::host_time->load(); });
+
     if (!oe_is_outside_enclave(enclave_config, sizeof(EnclaveConfig)))
     {
       return CreateNodeStatus::MemoryNotOutsideEnclave;
@@ -129,6 +135,8 @@ extern "C"
     CCFConfig cc =
       nlohmann::json::parse(ccf_config, ccf_config + ccf_config_size);
 
+    ds::LatencyClock::set_enabled(cc.request_stage_timing);
+
 #ifndef ENABLE_BFT
     // As BFT consensus is currently experimental, disable it in release
     // enclaves
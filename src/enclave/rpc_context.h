@@ -3,13 +3,18 @@
 #pragma once
 
 #include "ccf/tx_id.h"
+#include "crypto/hash.h"
+#include "ds/latency_clock.h"
 #include "http/http_builder.h"
 #include "http/http_consts.h"
 #include "node/client_signatures.h"
 #include "node/entities.h"
 #include "node/rpc/error.h"
 
+#include <chrono>
 #include <llhttp/llhttp.h>
+#include <optional>
+#include <string>
 #include <variant>
 #include <vector>
 
@@ -112,11 +117,27 @@ namespace enclave
     //
     bool is_forwarded = false;
 
+    //
+    // Derived from caller_cert, and reused by later requests on the same
+    // session
+    //
+    std::optional<std::string> caller_cert_digest = std::nullopt;
+
     SessionContext(
       size_t client_session_id_, const std::vector<uint8_t>& caller_cert_) :
       client_session_id(client_session_id_),
       caller_cert(caller_cert_)
     {}
+
+    /// Hex-encoded SHA-256 digest of caller_cert
+    const std::string& get_caller_cert_digest()
+    {
+      if (!caller_cert_digest.has_value())
+      {
+        caller_cert_digest = crypto::Sha256Hash(caller_cert).hex_str();
+      }
+      return caller_cert_digest.value();
+    }
   };
 
   using PathParams = std::map<std::string, std::string>;
@@ -134,6 +155,14 @@ namespace enclave
     bool is_create_request = false;
     bool execute_on_node = false;
 
+    // Set by endpoints which will send their response to the session later,
+    // rather than when they return
+    bool response_is_pending = false;
+
+    // Time from the first byte of the request being parsed until it was
+    // dispatched, if known
+    std::optional<ds::LatencyClock::duration> parse_duration = std::nullopt;
+
     RpcContext(std::shared_ptr<SessionContext> s) : session(s) {}
 
     RpcContext(
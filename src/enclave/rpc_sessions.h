@@ -62,8 +62,7 @@ namespace enclave
         msg->data.self = this->shared_from_this();
         msg->data.data.assign(data, data + size);
 
-        threading::ThreadMessaging::thread_messaging.add_task(
-          execution_thread, std::move(msg));
+        add_session_task(std::move(msg));
       }
 
       void recv_(const uint8_t* data, size_t size)
@@ -172,6 +171,7 @@ namespace enclave
       {
         LOG_DEBUG_FMT("Accepting a session inside the enclave: {}", id);
         auto ctx = std::make_unique<tls::Server>(cert);
+        ctx->set_alpn_protocols(ServerEndpointImpl::alpn_protocols);
 
         auto session = std::make_shared<ServerEndpointImpl>(
           rpc_map, id, writer_factory, std::move(ctx));
@@ -186,6 +186,19 @@ namespace enclave
       std::lock_guard<std::mutex> guard(lock);
 
       auto search = sessions.find(id);
+      std::optional<uint32_t> stream_id = std::nullopt;
+      if (search == sessions.end())
+      {
+        // Requests received on a stream of a multiplexed session are answered
+        // through an id which identifies both the session and the stream
+        const auto stream = http2::parse_stream_session_id(id);
+        if (stream.has_value())
+        {
+          search = sessions.find(stream->first);
+          stream_id = stream->second;
+        }
+      }
+
       if (search == sessions.end())
       {
         LOG_DEBUG_FMT("Refusing to reply to unknown session {}", id);
@@ -194,7 +207,14 @@ namespace enclave
 
       LOG_DEBUG_FMT("Replying to session {}", id);
 
-      search->second->send(std::move(data));
+      if (stream_id.has_value())
+      {
+        search->second->send_on_stream(stream_id.value(), std::move(data));
+      }
+      else
+      {
+        search->second->send(std::move(data));
+      }
       return true;
     }
 
@@ -19,7 +19,22 @@ namespace enclave
   protected:
     ringbuffer::WriterPtr to_host;
     size_t session_id;
-    size_t execution_thread;
+
+    threading::SessionPlacement placement;
+    using SessionTask = threading::SessionPlacement::SessionTask;
+
+    uint16_t get_execution_thread() const
+    {
+      return placement.get_execution_thread();
+    }
+
+    /** Queue a task for this session, on its execution thread.
+     */
+    template <typename Payload>
+    void add_session_task(std::unique_ptr<threading::Tmsg<Payload>> msg)
+    {
+      placement.add_task(std::move(msg));
+    }
 
     enum Status
     {
@@ -66,15 +81,6 @@ namespace enclave
       ctx(move(ctx_)),
       status(handshake)
     {
-      if (threading::ThreadMessaging::thread_count > 1)
-      {
-        execution_thread =
-          (session_id_ % (threading::ThreadMessaging::thread_count - 1)) + 1;
-      }
-      else
-      {
-        execution_thread = threading::MAIN_THREAD_ID;
-      }
       ctx->set_bio(this, send_callback, recv_callback, dbg_callback);
     }
 
@@ -218,7 +224,7 @@ namespace enclave
 
     void recv_buffered(const uint8_t* data, size_t size)
     {
-      if (threading::get_current_thread_id() != execution_thread)
+      if (threading::get_current_thread_id() != get_execution_thread())
       {
         throw std::runtime_error("Called recv_buffered from incorrect thread");
       }
@@ -230,6 +236,8 @@ namespace enclave
     {
       std::vector<uint8_t> data;
       std::shared_ptr<Endpoint> self;
+      // Declared after self, so that it is released while self is alive
+      SessionTask session_task;
     };
 
     static void send_raw_cb(std::unique_ptr<threading::Tmsg<SendRecvMsg>> msg)
@@ -244,13 +252,12 @@ namespace enclave
       msg->data.self = this->shared_from_this();
       msg->data.data = std::move(data);
 
-      threading::ThreadMessaging::thread_messaging.add_task(
-        execution_thread, std::move(msg));
+      add_session_task(std::move(msg));
     }
 
     void send_raw_thread(const std::vector<uint8_t>& data)
     {
-      if (threading::get_current_thread_id() != execution_thread)
+      if (threading::get_current_thread_id() != get_execution_thread())
       {
         throw std::runtime_error(
           "Called send_raw_thread from incorrect thread");
@@ -276,7 +283,7 @@ namespace enclave
 
     void send_buffered(const std::vector<uint8_t>& data)
     {
-      if (threading::get_current_thread_id() != execution_thread)
+      if (threading::get_current_thread_id() != get_execution_thread())
       {
         throw std::runtime_error("Called send_buffered from incorrect thread");
       }
@@ -286,7 +293,7 @@ namespace enclave
 
     void flush()
     {
-      if (threading::get_current_thread_id() != execution_thread)
+      if (threading::get_current_thread_id() != get_execution_thread())
       {
         throw std::runtime_error("Called flush from incorrect thread");
       }
@@ -320,6 +327,7 @@ namespace enclave
     struct EmptyMsg
     {
       std::shared_ptr<Endpoint> self;
+      SessionTask session_task;
     };
 
     static void close_cb(std::unique_ptr<threading::Tmsg<EmptyMsg>> msg)
@@ -332,13 +340,12 @@ namespace enclave
       auto msg = std::make_unique<threading::Tmsg<EmptyMsg>>(&close_cb);
       msg->data.self = this->shared_from_this();
 
-      threading::ThreadMessaging::thread_messaging.add_task(
-        execution_thread, std::move(msg));
+      add_session_task(std::move(msg));
     }
 
     void close_thread()
     {
-      if (threading::get_current_thread_id() != execution_thread)
+      if (threading::get_current_thread_id() != get_execution_thread())
       {
         throw std::runtime_error("Called close_thread from incorrect thread");
       }
@@ -537,7 +544,7 @@ namespace enclave
 
     int handle_recv(uint8_t* buf, size_t len)
     {
-      if (threading::get_current_thread_id() != execution_thread)
+      if (threading::get_current_thread_id() != get_execution_thread())
       {
         throw std::runtime_error("Called handle_recv from incorrect thread");
       }
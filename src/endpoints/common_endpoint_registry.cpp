@@ -11,10 +11,14 @@
 #include "enclave/node_context.h"
 #include "http/http_consts.h"
 #include "node/code_id.h"
+#include "node/commit_waiters.h"
 
 namespace ccf
 {
   static constexpr auto tx_id_param_key = "transaction_id";
+  static constexpr auto wait_param_key = "wait_ms";
+  static constexpr size_t max_tx_status_wait_ms = 30000;
+  static constexpr auto prometheus_content_type = "text/plain; version=0.0.4";
 
   namespace
   {
@@ -53,6 +57,135 @@ namespace ccf
 
       return tx_id_opt;
     }
+
+    std::vector<EndpointMetrics::StageLatency> to_stage_latencies(
+      const std::vector<endpoints::StageLatencySummary>& summaries)
+    {
+      std::vector<EndpointMetrics::StageLatency> latencies;
+      for (const auto& summary : summaries)
+      {
+        EndpointMetrics::StageLatency latency;
+        latency.stage = endpoints::latency_stage_name(summary.stage);
+        latency.count = summary.count;
+        latency.sum_us = summary.sum;
+        latency.min_us = summary.min;
+        latency.max_us = summary.max;
+        for (const auto& bucket : summary.buckets)
+        {
+          latency.buckets.push_back({bucket.lower, bucket.upper, bucket.count});
+        }
+        latencies.push_back(std::move(latency));
+      }
+      return latencies;
+    }
+
+    // See https://prometheus.io/docs/instrumenting/exposition_formats/
+    std::string escape_prometheus_label(const std::string& value)
+    {
+      std::string escaped;
+      escaped.reserve(value.size());
+      for (const auto c : value)
+      {
+        switch (c)
+        {
+          case '\\':
+            escaped += "\\\\";
+            break;
+          case '"':
+            escaped += "\\\"";
+            break;
+          case '\n':
+            escaped += "\\n";
+            break;
+          default:
+            escaped += c;
+        }
+      }
+      return escaped;
+    }
+
+    std::string to_prometheus_text(
+      const std::vector<EndpointMetrics::Entry>& entries)
+    {
+      std::string text;
+
+      const auto labels = [](const EndpointMetrics::Entry& entry) {
+        return fmt::format(
+          "path=\"{}\",method=\"{}\"",
+          escape_prometheus_label(entry.path),
+          escape_prometheus_label(entry.method));
+      };
+
+      const auto add_counter = [&](
+                                 const std::string& name,
+                                 const std::string& help,
+                                 size_t EndpointMetrics::Entry::*field) {
+        text += fmt::format(
+          "# HELP {} {}\n# TYPE {} counter\n", name, help, name);
+        for (const auto& entry : entries)
+        {
+          text += fmt::format(
+            "{}{{{}}} {}\n", name, labels(entry), entry.*field);
+        }
+      };
+
+      add_counter(
+        "ccf_endpoint_calls_total",
+        "Requests dispatched to the endpoint",
+        &EndpointMetrics::Entry::calls);
+      add_counter(
+        "ccf_endpoint_errors_total",
+        "Requests to the endpoint which failed with a 4xx status",
+        &EndpointMetrics::Entry::errors);
+      add_counter(
+        "ccf_endpoint_failures_total",
+        "Requests to the endpoint which failed with a 5xx status",
+        &EndpointMetrics::Entry::failures);
+      add_counter(
+        "ccf_endpoint_retries_total",
+        "Executions of the endpoint retried after a conflict",
+        &EndpointMetrics::Entry::retries);
+
+      constexpr auto histogram_name = "ccf_endpoint_latency_microseconds";
+      text += fmt::format(
+        "# HELP {} Time spent in each stage of handling requests to the "
+        "endpoint\n# TYPE {} histogram\n",
+        histogram_name,
+        histogram_name);
+      for (const auto& entry : entries)
+      {
+        for (const auto& latency : entry.latencies)
+        {
+          const auto stage_labels = fmt::format(
+            "{},stage=\"{}\"", labels(entry), latency.stage);
+
+          // Prometheus buckets are cumulative, and only those containing
+          // samples are reported
+          size_t cumulative = 0;
+          for (const auto& bucket : latency.buckets)
+          {
+            cumulative += bucket.count;
+            text += fmt::format(
+              "{}_bucket{{{},le=\"{}\"}} {}\n",
+              histogram_name,
+              stage_labels,
+              bucket.upper_us,
+              cumulative);
+          }
+          text += fmt::format(
+            "{}_bucket{{{},le=\"+Inf\"}} {}\n",
+            histogram_name,
+            stage_labels,
+            latency.count);
+          text += fmt::format(
+            "{}_sum{{{}}} {}\n", histogram_name, stage_labels, latency.sum_us);
+          text += fmt::format(
+            "{}_count{{{}}} {}\n", histogram_name, stage_labels, latency.count);
+        }
+      }
+
+      return text;
+    }
   }
 
   CommonEndpointRegistry::CommonEndpointRegistry(
@@ -120,26 +253,112 @@ namespace ccf
             tx_id_param_key));
       }
 
-      GetTxStatus::Out out;
-      const auto result =
-        get_status_for_txid_v1(tx_id->view, tx_id->seqno, out.status);
-      if (result == ccf::ApiResult::OK)
+      size_t wait_ms = 0;
+      if (
+        parsed_query.find(wait_param_key) != parsed_query.end() &&
+        !http::get_query_value(
+          parsed_query, wait_param_key, wait_ms, error_reason))
       {
-        out.transaction_id = tx_id.value();
+        return make_error(
+          HTTP_STATUS_BAD_REQUEST,
+          ccf::errors::InvalidQueryParameterValue,
+          std::move(error_reason));
+      }
+
+      auto get_status = [this, tx_id = tx_id.value()]() {
+        GetTxStatus::Out out;
+        const auto result =
+          get_status_for_txid_v1(tx_id.view, tx_id.seqno, out.status);
+        if (result != ccf::ApiResult::OK)
+        {
+          return make_error(
+            HTTP_STATUS_INTERNAL_SERVER_ERROR,
+            ccf::errors::InternalError,
+            fmt::format("Error code: {}", ccf::api_result_to_str(result)));
+        }
+
+        out.transaction_id = tx_id;
         return make_success(out);
+      };
+
+      auto response = get_status();
+      const auto body = std::get_if<nlohmann::json>(&response);
+      if (body == nullptr || wait_ms == 0)
+      {
+        return response;
       }
-      else
+
+      // If requested, hold the response until the transaction is committed
+      // or invalidated, rather than have the caller poll for it. This is only
+      // possible for requests received directly from a client, on CFT nodes
+      // where commit is driven locally.
+      const auto status = body->at("status").template get<TxStatus>();
+      const bool can_wait = consensus != nullptr &&
+        consensus->type() == ConsensusType::CFT &&
+        !ctx.rpc_ctx->session->is_forwarded &&
+        ctx.rpc_ctx->session->client_session_id != enclave::InvalidSessionId;
+      if (
+        !can_wait ||
+        (status != TxStatus::Pending && status != TxStatus::Unknown))
       {
-        return make_error(
-          HTTP_STATUS_INTERNAL_SERVER_ERROR,
-          ccf::errors::InternalError,
-          fmt::format("Error code: {}", ccf::api_result_to_str(result)));
+        return response;
+      }
+
+      auto rpc_ctx = ctx.rpc_ctx;
+      auto respond = [rpc_ctx, tx_id = tx_id.value(), get_status](
+                       std::optional<TxStatus> final_status) mutable {
+        rpc_ctx->reset_response();
+        if (final_status.has_value())
+        {
+          // Called by consensus, so must not query it for the status
+          GetTxStatus::Out out;
+          out.transaction_id = tx_id;
+          out.status = final_status.value();
+          jsonhandler::set_response(
+            make_success(out), rpc_ctx, serdes::Pack::Text);
+        }
+        else
+        {
+          // Timed out, so report the current status
+          jsonhandler::set_response(get_status(), rpc_ctx, serdes::Pack::Text);
+        }
+        return rpc_ctx->serialise_response();
+      };
+
+      const auto add_result =
+        context.get_node_state().get_commit_waiters().add(
+          tx_id.value(),
+          rpc_ctx->session->client_session_id,
+          std::chrono::milliseconds(std::min(wait_ms, max_tx_status_wait_ms)),
+          std::move(respond));
+      switch (add_result)
+      {
+        case CommitWaiters::AddResult::Added:
+        {
+          rpc_ctx->response_is_pending = true;
+          return response;
+        }
+
+        case CommitWaiters::AddResult::AlreadyFinal:
+        {
+          // Committed since the status was read
+          return get_status();
+        }
+
+        case CommitWaiters::AddResult::TooManyWaiters:
+        default:
+        {
+          // Report the current status, and leave the caller to poll
+          return response;
+        }
       }
     };
     make_command_endpoint(
       "/tx", HTTP_GET, json_command_adapter(get_tx_status), no_auth_required)
       .set_auto_schema<void, GetTxStatus::Out>()
       .add_query_parameter<ccf::TxID>(tx_id_param_key)
+      .add_query_parameter<size_t>(
+        wait_param_key, ccf::endpoints::QueryParamPresence::OptionalParameter)
       .install();
 
     make_command_endpoint(
@@ -196,23 +415,33 @@ namespace ccf
       .set_auto_schema<void, GetAPI::Out>()
       .install();
 
-    auto endpoint_metrics_fn = [this](auto&, nlohmann::json&&) {
+    auto get_endpoint_metrics = [this]() {
+      auto latencies = latency_metrics.get_summaries();
+
       std::lock_guard<std::mutex> guard(metrics_lock);
-      EndpointMetrics::Out out;
+      std::vector<EndpointMetrics::Entry> entries;
       for (const auto& [path, verb_metrics] : metrics)
       {
         for (const auto& [verb, metric] : verb_metrics)
         {
-          out.metrics.push_back({path,
-                                 verb,
-                                 metric.calls,
-                                 metric.errors,
-                                 metric.failures,
-                                 metric.retries});
+          entries.push_back({path,
+                             verb,
+                             metric.calls,
+                             metric.errors,
+                             metric.failures,
+                             metric.retries,
+                             to_stage_latencies(latencies[path][verb])});
         }
       }
-      return make_success(out);
+      return entries;
     };
+
+    auto endpoint_metrics_fn =
+      [get_endpoint_metrics](auto&, nlohmann::json&&) {
+        EndpointMetrics::Out out;
+        out.metrics = get_endpoint_metrics();
+        return make_success(out);
+      };
     make_command_endpoint(
       "/api/metrics",
       HTTP_GET,
@@ -223,6 +452,23 @@ namespace ccf
         ccf::endpoints::ExecuteOutsideConsensus::Locally)
       .install();
 
+    auto endpoint_metrics_prometheus_fn =
+      [get_endpoint_metrics](auto& ctx) {
+        ctx.rpc_ctx->set_response_status(HTTP_STATUS_OK);
+        ctx.rpc_ctx->set_response_header(
+          http::headers::CONTENT_TYPE, prometheus_content_type);
+        ctx.rpc_ctx->set_response_body(
+          to_prometheus_text(get_endpoint_metrics()));
+      };
+    make_command_endpoint(
+      "/api/metrics/prometheus",
+      HTTP_GET,
+      endpoint_metrics_prometheus_fn,
+      no_auth_required)
+      .set_execute_outside_consensus(
+        ccf::endpoints::ExecuteOutsideConsensus::Locally)
+      .install();
+
     auto is_tx_committed =
       [this](ccf::View view, ccf::SeqNo seqno, std::string& error_reason) {
         if (consensus == nullptr)
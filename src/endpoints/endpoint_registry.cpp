@@ -69,12 +69,16 @@ namespace ccf::endpoints
     }
   }
 
+  static std::string get_metrics_path(const EndpointDefinitionPtr& e)
+  {
+    const auto& method = e->dispatch.uri_path;
+    return method.substr(method.find_first_not_of('/'));
+  }
+
   EndpointRegistry::Metrics& EndpointRegistry::get_metrics_for_endpoint(
     const EndpointDefinitionPtr& e)
   {
-    auto method = e->dispatch.uri_path;
-    method = method.substr(method.find_first_not_of('/'));
-    return metrics[method][e->dispatch.verb.c_str()];
+    return metrics[get_metrics_path(e)][e->dispatch.verb.c_str()];
   }
 
   Endpoint EndpointRegistry::make_endpoint(
@@ -149,6 +153,10 @@ namespace ccf::endpoints
       auto templated_endpoint =
         std::make_shared<PathTemplatedEndpoint>(endpoint);
       templated_endpoint->spec = std::move(template_spec.value());
+      templated_endpoints_trie.insert(
+        endpoint.dispatch.uri_path,
+        endpoint.dispatch.verb,
+        templated_endpoint);
       templated_endpoints[endpoint.dispatch.uri_path][endpoint.dispatch.verb] =
         templated_endpoint;
     }
@@ -224,52 +232,13 @@ namespace ccf::endpoints
       }
     }
 
-    // If that doesn't exist, look through the templated endpoints to find
-    // templated matches. Exactly one is a returnable match, more is an error,
-    // fewer is fallthrough.
+    // If that doesn't exist, look for a templated match. Ambiguous templates
+    // are rejected by install(), so there is at most one.
+    const auto templated_endpoint = templated_endpoints_trie.find(
+      method, rpc_ctx.get_request_verb(), rpc_ctx.get_request_path_params());
+    if (templated_endpoint.has_value())
     {
-      std::vector<EndpointDefinitionPtr> matches;
-
-      std::smatch match;
-      for (auto& [original_method, verb_endpoints] : templated_endpoints)
-      {
-        auto templated_endpoints_for_verb =
-          verb_endpoints.find(rpc_ctx.get_request_verb());
-        if (templated_endpoints_for_verb != verb_endpoints.end())
-        {
-          auto& endpoint = templated_endpoints_for_verb->second;
-          if (std::regex_match(method, match, endpoint->spec.template_regex))
-          {
-            // Populate the request_path_params the first-time through. If we
-            // get a second match, we're just building up a list for
-            // error-reporting
-            if (matches.size() == 0)
-            {
-              auto& path_params = rpc_ctx.get_request_path_params();
-              for (size_t i = 0;
-                   i < endpoint->spec.template_component_names.size();
-                   ++i)
-              {
-                const auto& template_name =
-                  endpoint->spec.template_component_names[i];
-                const auto& template_value = match[i + 1].str();
-                path_params[template_name] = template_value;
-              }
-            }
-
-            matches.push_back(endpoint);
-          }
-        }
-      }
-
-      if (matches.size() > 1)
-      {
-        report_ambiguous_templated_path(method, matches);
-      }
-      else if (matches.size() == 1)
-      {
-        return matches[0];
-      }
+      return templated_endpoint.value();
     }
 
     if (default_endpoint != nullptr)
@@ -310,17 +279,7 @@ namespace ccf::endpoints
       }
     }
 
-    std::smatch match;
-    for (const auto& [original_method, verb_endpoints] : templated_endpoints)
-    {
-      for (const auto& [verb, endpoint] : verb_endpoints)
-      {
-        if (std::regex_match(method, match, endpoint->spec.template_regex))
-        {
-          verbs.insert(verb);
-        }
-      }
-    }
+    verbs.merge(templated_endpoints_trie.get_verbs(method));
 
     return verbs;
   }
@@ -384,4 +343,39 @@ namespace ccf::endpoints
     std::lock_guard<std::mutex> guard(metrics_lock);
     get_metrics_for_endpoint(e).retries++;
   }
+
+  void EndpointRegistry::record_latencies(
+    const EndpointDefinitionPtr& e,
+    const endpoints::RequestLatencies& latencies)
+  {
+    latency_metrics.record(
+      get_metrics_path(e), e->dispatch.verb.c_str(), latencies);
+  }
+
+  void EndpointRegistry::record_pending_global_commit(
+    const EndpointDefinitionPtr& e, const ccf::TxID& tx_id)
+  {
+    const auto now = ds::LatencyClock::now();
+    if (!now.has_value())
+    {
+      return;
+    }
+
+    latency_metrics.add_pending_global_commit(
+      get_metrics_path(e), e->dispatch.verb.c_str(), tx_id, now.value());
+  }
+
+  void EndpointRegistry::record_global_commit_latencies()
+  {
+    const auto now = ds::LatencyClock::now();
+    if (consensus == nullptr || !now.has_value())
+    {
+      return;
+    }
+
+    latency_metrics.record_global_commits(
+      consensus->get_committed_seqno(),
+      [this](ccf::SeqNo seqno) { return consensus->get_view(seqno); },
+      now.value());
+  }
 }
\ No newline at end of file
@@ -0,0 +1,378 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+#pragma once
+
+#include "ccf/tx_id.h"
+#include "ds/histogram.h"
+#include "ds/latency_clock.h"
+#include "ds/thread_messaging.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ccf::endpoints
+{
+  enum class LatencyStage : size_t
+  {
+    // From the first byte of the request being parsed to its dispatch
+    Parse = 0,
+    Authenticate,
+    Execute,
+    // Local commit of the transaction's writes, including serialisation
+    Commit,
+    // Handing the committed transaction to the store for replication
+    ReplicationHandoff,
+    // From local commit to the transaction being globally committed
+    GlobalCommit
+  };
+
+  static constexpr size_t latency_stage_count = 6;
+
+  inline const char* latency_stage_name(LatencyStage stage)
+  {
+    switch (stage)
+    {
+      case LatencyStage::Parse:
+        return "parse";
+      case LatencyStage::Authenticate:
+        return "authenticate";
+      case LatencyStage::Execute:
+        return "execute";
+      case LatencyStage::Commit:
+        return "commit";
+      case LatencyStage::ReplicationHandoff:
+        return "replication_handoff";
+      case LatencyStage::GlobalCommit:
+        return "global_commit";
+      default:
+        return "unknown";
+    }
+  }
+
+  /** Time spent in each stage while handling a single request. Stages which
+   * were not reached are left unset.
+   */
+  struct RequestLatencies
+  {
+    std::array<std::optional<std::chrono::microseconds>, latency_stage_count>
+      stages = {};
+
+    /// Add d to the time spent in stage, e.g. once for each execution
+    /// attempt. Does nothing if d was not timed.
+    void add(LatencyStage stage, std::optional<ds::LatencyClock::duration> d)
+    {
+      if (!d.has_value())
+      {
+        return;
+      }
+
+      auto& s = stages[static_cast<size_t>(stage)];
+      s = s.value_or(std::chrono::microseconds(0)) +
+        std::chrono::duration_cast<std::chrono::microseconds>(d.value());
+    }
+  };
+
+  /** Latencies recorded for one stage of one endpoint, all in microseconds.
+   */
+  struct StageLatencySummary
+  {
+    struct Bucket
+    {
+      // Inclusive bounds of samples counted in this bucket
+      uint64_t lower;
+      uint64_t upper;
+      size_t count;
+    };
+
+    LatencyStage stage;
+    size_t count = 0;
+    uint64_t sum = 0;
+    uint64_t min = 0;
+    uint64_t max = 0;
+    // Only buckets containing at least one sample, in increasing order
+    std::vector<Bucket> buckets;
+  };
+
+  /** Per-endpoint histograms of the latency of each stage of request handling.
+   *
+   * Each thread records samples into its own histograms, under a lock which
+   * is only contended while the histograms are being read. Readers merge the
+   * histograms of all threads.
+   */
+  class LatencyMetrics
+  {
+  public:
+    // Samples are in microseconds. Those of 0us are counted as underflow, and
+    // those of 2^24us (~16.8s) or more as overflow.
+    using Histogram = histogram::Histogram<uint64_t, 1, 1 << 24, 4>;
+
+    // Transactions awaiting global commit are tracked per thread, up to this
+    // many. Further transactions are not tracked until some have committed.
+    static constexpr size_t max_pending_commits = 4096;
+
+    using Summaries = std::map<
+      std::string,
+      std::map<std::string, std::vector<StageLatencySummary>>>;
+
+  private:
+    struct StageHistogram
+    {
+      Histogram histogram;
+      uint64_t sum = 0;
+
+      void record(std::chrono::microseconds d)
+      {
+        const uint64_t us = d.count() > 0 ? d.count() : 0;
+        histogram.record(us);
+        sum += us;
+      }
+
+      void add(const StageHistogram& that)
+      {
+        histogram.add(that.histogram);
+        sum += that.sum;
+      }
+    };
+
+    using EndpointHistograms =
+      std::array<StageHistogram, latency_stage_count>;
+
+    // Keyed by path, then by verb
+    using Endpoints = std::map<
+      std::string,
+      std::map<std::string, std::unique_ptr<EndpointHistograms>, std::less<>>,
+      std::less<>>;
+
+    struct PendingCommit
+    {
+      std::string path;
+      std::string verb;
+      ccf::TxID tx_id;
+      ds::LatencyClock::time_point committed_at;
+    };
+
+    struct ThreadLatencies
+    {
+      // Only the owning thread inserts into endpoints, so it may look
+      // endpoints up without the lock. Inserting, recording samples and
+      // reading from other threads must hold the lock.
+      std::mutex lock;
+      Endpoints endpoints;
+
+      std::mutex pending_lock;
+      std::vector<PendingCommit> pending_commits;
+    };
+
+    std::array<ThreadLatencies, threading::ThreadMessaging::max_num_threads>
+      threads;
+
+    ThreadLatencies& get_thread_latencies()
+    {
+      return threads.at(threading::get_current_thread_id());
+    }
+
+    EndpointHistograms& get_histograms(
+      const std::string& path, const std::string& verb)
+    {
+      auto& t = get_thread_latencies();
+
+      const auto path_it = t.endpoints.find(path);
+      if (path_it != t.endpoints.end())
+      {
+        const auto verb_it = path_it->second.find(verb);
+        if (verb_it != path_it->second.end())
+        {
+          return *verb_it->second;
+        }
+      }
+
+      std::lock_guard<std::mutex> guard(t.lock);
+      auto& histograms = t.endpoints[path][verb];
+      histograms = std::make_unique<EndpointHistograms>();
+      return *histograms;
+    }
+
+    static StageLatencySummary summarise(
+      LatencyStage stage, StageHistogram& s)
+    {
+      auto& h = s.histogram;
+
+      StageLatencySummary summary;
+      summary.stage = stage;
+      summary.sum = s.sum;
+
+      if (h.get_underflow() > 0)
+      {
+        summary.buckets.push_back({0, 0, h.get_underflow()});
+      }
+
+      for (size_t i = 0; i < h.get_buckets(); ++i)
+      {
+        const auto count = h.get_count(i);
+        if (count > 0)
+        {
+          const auto [lower, upper] = h.get_range(i);
+          summary.buckets.push_back({lower, upper, count});
+        }
+      }
+
+      if (h.get_overflow() > 0)
+      {
+        summary.buckets.push_back(
+          {h.get_range(h.get_buckets()).first, h.get_high(), h.get_overflow()});
+      }
+
+      for (const auto& bucket : summary.buckets)
+      {
+        summary.count += bucket.count;
+      }
+
+      if (summary.count > 0)
+      {
+        summary.min = h.get_low();
+        summary.max = h.get_high();
+      }
+
+      return summary;
+    }
+
+  public:
+    /** Record the latencies of a request handled by the calling thread. Does
+     * nothing while stage timing is disabled, or if no stage was timed.
+     */
+    void record(
+      const std::string& path,
+      const std::string& verb,
+      const RequestLatencies& latencies)
+    {
+      if (
+        !ds::LatencyClock::is_enabled() ||
+        std::none_of(
+          latencies.stages.begin(),
+          latencies.stages.end(),
+          [](const auto& latency) { return latency.has_value(); }))
+      {
+        return;
+      }
+
+      auto& histograms = get_histograms(path, verb);
+
+      std::lock_guard<std::mutex> guard(get_thread_latencies().lock);
+      for (size_t i = 0; i < latency_stage_count; ++i)
+      {
+        const auto& latency = latencies.stages[i];
+        if (latency.has_value())
+        {
+          histograms[i].record(latency.value());
+        }
+      }
+    }
+
+    /** Track a transaction committed locally at committed_at, so that its time
+     * to global commit is recorded by a later call to record_global_commits().
+     */
+    void add_pending_global_commit(
+      const std::string& path,
+      const std::string& verb,
+      const ccf::TxID& tx_id,
+      ds::LatencyClock::time_point committed_at)
+    {
+      auto& t = get_thread_latencies();
+      std::lock_guard<std::mutex> guard(t.pending_lock);
+      if (t.pending_commits.size() < max_pending_commits)
+      {
+        t.pending_commits.push_back({path, verb, tx_id, committed_at});
+      }
+    }
+
+    /** Record the time to global commit of tracked transactions which are
+     * now committed, and stop tracking those which have been rolled back.
+     *
+     * @param committed_seqno Highest globally committed seqno
+     * @param get_view Returns the view in which the given seqno was committed
+     * @param now Time at which the commit was observed
+     */
+    void record_global_commits(
+      ccf::SeqNo committed_seqno,
+      const std::function<ccf::View(ccf::SeqNo)>& get_view,
+      ds::LatencyClock::time_point now)
+    {
+      std::vector<PendingCommit> completed;
+      for (auto& t : threads)
+      {
+        std::lock_guard<std::mutex> guard(t.pending_lock);
+        auto it = std::partition(
+          t.pending_commits.begin(),
+          t.pending_commits.end(),
+          [committed_seqno](const PendingCommit& pending) {
+            return pending.tx_id.seqno > committed_seqno;
+          });
+        std::move(it, t.pending_commits.end(), std::back_inserter(completed));
+        t.pending_commits.erase(it, t.pending_commits.end());
+      }
+
+      for (const auto& pending : completed)
+      {
+        if (get_view(pending.tx_id.seqno) != pending.tx_id.view)
+        {
+          // Rolled back, and replaced by another transaction
+          continue;
+        }
+
+        RequestLatencies latencies;
+        latencies.add(LatencyStage::GlobalCommit, now - pending.committed_at);
+        record(pending.path, pending.verb, latencies);
+      }
+    }
+
+    /** Merge the histograms recorded by all threads.
+     *
+     * @return Summary of each stage with at least one sample, by path and verb
+     */
+    Summaries get_summaries()
+    {
+      std::map<std::pair<std::string, std::string>, EndpointHistograms>
+        merged;
+      for (auto& t : threads)
+      {
+        std::lock_guard<std::mutex> guard(t.lock);
+        for (const auto& [path, verbs] : t.endpoints)
+        {
+          for (const auto& [verb, histograms] : verbs)
+          {
+            auto& m = merged[std::make_pair(path, verb)];
+            for (size_t i = 0; i < latency_stage_count; ++i)
+            {
+              m[i].add((*histograms)[i]);
+            }
+          }
+        }
+      }
+
+      Summaries summaries;
+      for (auto& [key, histograms] : merged)
+      {
+        auto& stages = summaries[key.first][key.second];
+        for (size_t i = 0; i < latency_stage_count; ++i)
+        {
+          auto summary =
+            summarise(static_cast<LatencyStage>(i), histograms[i]);
+          if (summary.count > 0)
+          {
+            stages.push_back(std::move(summary));
+          }
+        }
+      }
+      return summaries;
+    }
+  };
+}
@@ -0,0 +1,418 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+#pragma once
+
+#include "enclave/rpc_context.h"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ccf::endpoints
+{
+  /** A single '/'-delimited segment of a templated path. This is either a
+   * literal, or a sequence of literal parts separated by named parameters (eg
+   * "{id}" or "{id}.json"). Each parameter matches a non-empty run of
+   * characters, with the same greedy semantics as the regex "([^/]+)".
+   */
+  class PathTemplateSegment
+  {
+  private:
+    // Always holds one more entry than param_names
+    std::vector<std::string> literals;
+    std::vector<std::string> param_names;
+
+    // Match s against parameter param_idx and everything after it, where s
+    // starts immediately after the literal preceding that parameter
+    bool match_from(
+      size_t param_idx,
+      std::string_view s,
+      std::vector<std::string_view>& values) const
+    {
+      if (param_idx == param_names.size())
+      {
+        return s.empty();
+      }
+
+      const auto& next_literal = literals[param_idx + 1];
+      if (s.size() <= next_literal.size())
+      {
+        return false;
+      }
+
+      // Longest first, to match the greedy regex this replaces
+      for (auto n = s.size() - next_literal.size(); n > 0; --n)
+      {
+        const auto rest = s.substr(n);
+        if (rest.substr(0, next_literal.size()) != next_literal)
+        {
+          continue;
+        }
+
+        values.push_back(s.substr(0, n));
+        if (match_from(param_idx + 1, rest.substr(next_literal.size()), values))
+        {
+          return true;
+        }
+        values.pop_back();
+      }
+
+      return false;
+    }
+
+  public:
+    PathTemplateSegment(std::string_view segment, const std::string& uri)
+    {
+      auto template_start = segment.find_first_of('{');
+      while (template_start != std::string::npos)
+      {
+        const auto template_end = segment.find_first_of('}', template_start);
+        if (template_end == std::string::npos)
+        {
+          throw std::logic_error(fmt::format(
+            "Invalid templated path - missing closing '}': {}", uri));
+        }
+
+        literals.emplace_back(segment.substr(0, template_start));
+        param_names.emplace_back(segment.substr(
+          template_start + 1, template_end - template_start - 1));
+        segment.remove_prefix(template_end + 1);
+        template_start = segment.find_first_of('{');
+      }
+      literals.emplace_back(segment);
+    }
+
+    bool is_literal() const
+    {
+      return param_names.empty();
+    }
+
+    const std::string& literal() const
+    {
+      return literals[0];
+    }
+
+    const std::vector<std::string>& get_param_names() const
+    {
+      return param_names;
+    }
+
+    bool operator==(const PathTemplateSegment& other) const
+    {
+      return literals == other.literals && param_names == other.param_names;
+    }
+
+    /** Match a segment of a request path, appending the value of each
+     * parameter to values on success.
+     */
+    bool match(std::string_view s, std::vector<std::string_view>& values) const
+    {
+      const auto& prefix = literals[0];
+      if (s.substr(0, prefix.size()) != prefix)
+      {
+        return false;
+      }
+
+      const auto initial_size = values.size();
+      if (match_from(0, s.substr(prefix.size()), values))
+      {
+        return true;
+      }
+      values.resize(initial_size);
+      return false;
+    }
+
+    /** Conservatively decide whether some request segment could match both
+     * this and other. May report an overlap which does not exist for unusual
+     * combinations of literals within a segment, but never misses one.
+     */
+    bool may_overlap(const PathTemplateSegment& other) const
+    {
+      std::vector<std::string_view> ignored;
+      if (is_literal())
+      {
+        return other.match(literal(), ignored);
+      }
+      if (other.is_literal())
+      {
+        return match(other.literal(), ignored);
+      }
+
+      // Two templated segments can only both match some string if one's
+      // leading literal is a prefix of the other's, and likewise for the
+      // trailing literals
+      const auto& a_front = literals.front();
+      const auto& b_front = other.literals.front();
+      const auto n_front = std::min(a_front.size(), b_front.size());
+      if (a_front.compare(0, n_front, b_front, 0, n_front) != 0)
+      {
+        return false;
+      }
+
+      const auto& a_back = literals.back();
+      const auto& b_back = other.literals.back();
+      const auto n_back = std::min(a_back.size(), b_back.size());
+      return a_back.compare(
+               a_back.size() - n_back,
+               n_back,
+               b_back,
+               b_back.size() - n_back,
+               n_back) == 0;
+    }
+  };
+
+  /** Dispatch table for templated paths, mapping each '/'-delimited segment to
+   * a node of the trie. Literal segments are found by lookup, so the cost of
+   * a match depends on the depth of the path and the number of templated
+   * segments at each level, rather than the total number of templates.
+   *
+   * Ambiguity (a request path which could match several templates for the
+   * same verb) is rejected when templates are inserted, so at most one value
+   * can match any request.
+   */
+  template <typename T>
+  class PathTemplateTrie
+  {
+  private:
+    struct Node
+    {
+      std::map<std::string, std::unique_ptr<Node>, std::less<>> literals;
+      std::vector<std::pair<PathTemplateSegment, std::unique_ptr<Node>>>
+        templates;
+
+      // Set if some template ends at this node
+      std::string uri;
+      std::vector<std::string> param_names;
+      std::map<RESTVerb, T> values;
+    };
+
+    Node root;
+
+    static std::vector<std::string_view> split(std::string_view path)
+    {
+      std::vector<std::string_view> segments;
+      if (!path.empty() && path[0] == '/')
+      {
+        path.remove_prefix(1);
+      }
+
+      while (true)
+      {
+        const auto next = path.find('/');
+        segments.push_back(path.substr(0, next));
+        if (next == std::string::npos)
+        {
+          break;
+        }
+        path.remove_prefix(next + 1);
+      }
+
+      return segments;
+    }
+
+    static void find_overlaps(
+      const Node& node,
+      const std::vector<PathTemplateSegment>& segments,
+      size_t i,
+      const RESTVerb& verb,
+      std::set<std::string>& overlaps)
+    {
+      if (i == segments.size())
+      {
+        if (node.values.find(verb) != node.values.end())
+        {
+          overlaps.insert(node.uri);
+        }
+        return;
+      }
+
+      const auto& segment = segments[i];
+      if (segment.is_literal())
+      {
+        const auto it = node.literals.find(segment.literal());
+        if (it != node.literals.end())
+        {
+          find_overlaps(*it->second, segments, i + 1, verb, overlaps);
+        }
+      }
+      else
+      {
+        std::vector<std::string_view> ignored;
+        for (const auto& [literal, child] : node.literals)
+        {
+          if (segment.match(literal, ignored))
+          {
+            find_overlaps(*child, segments, i + 1, verb, overlaps);
+          }
+        }
+      }
+
+      for (const auto& [child_segment, child] : node.templates)
+      {
+        if (child_segment.may_overlap(segment))
+        {
+          find_overlaps(*child, segments, i + 1, verb, overlaps);
+        }
+      }
+    }
+
+    template <typename F>
+    static bool visit_matches(
+      const Node& node,
+      const std::vector<std::string_view>& segments,
+      size_t i,
+      std::vector<std::string_view>& values,
+      F&& f)
+    {
+      if (i == segments.size())
+      {
+        return node.values.empty() || f(node, values);
+      }
+
+      const auto it = node.literals.find(segments[i]);
+      if (
+        it != node.literals.end() &&
+        !visit_matches(*it->second, segments, i + 1, values, f))
+      {
+        return false;
+      }
+
+      for (const auto& [child_segment, child] : node.templates)
+      {
+        const auto initial_size = values.size();
+        if (child_segment.match(segments[i], values))
+        {
+          const auto keep_going =
+            visit_matches(*child, segments, i + 1, values, f);
+          values.resize(initial_size);
+          if (!keep_going)
+          {
+            return false;
+          }
+        }
+      }
+
+      return true;
+    }
+
+  public:
+    /** Insert a value for the given templated uri and verb, replacing any
+     * existing value for the same uri and verb. Throws if any request path
+     * could then match more than one template for this verb.
+     */
+    void insert(const std::string& uri, const RESTVerb& verb, T value)
+    {
+      std::vector<PathTemplateSegment> segments;
+      for (const auto& s : split(uri))
+      {
+        segments.emplace_back(s, uri);
+      }
+
+      std::set<std::string> overlaps;
+      find_overlaps(root, segments, 0, verb, overlaps);
+      overlaps.erase(uri);
+      if (!overlaps.empty())
+      {
+        throw std::logic_error(fmt::format(
+          "Templated path {} {} is ambiguous with: {}",
+          verb.c_str(),
+          uri,
+          fmt::join(overlaps, ", ")));
+      }
+
+      Node* node = &root;
+      std::vector<std::string> param_names;
+      for (auto& segment : segments)
+      {
+        if (segment.is_literal())
+        {
+          auto& child = node->literals[segment.literal()];
+          if (child == nullptr)
+          {
+            child = std::make_unique<Node>();
+          }
+          node = child.get();
+          continue;
+        }
+
+        const auto& names = segment.get_param_names();
+        param_names.insert(param_names.end(), names.begin(), names.end());
+
+        auto it = std::find_if(
+          node->templates.begin(),
+          node->templates.end(),
+          [&segment](const auto& entry) { return entry.first == segment; });
+        if (it == node->templates.end())
+        {
+          node->templates.emplace_back(
+            std::move(segment), std::make_unique<Node>());
+          it = std::prev(node->templates.end());
+        }
+        node = it->second.get();
+      }
+
+      node->uri = uri;
+      node->param_names = std::move(param_names);
+      node->values[verb] = std::move(value);
+    }
+
+    /** Find the value whose template matches path for the given verb, and
+     * populate params from the templated segments.
+     */
+    std::optional<T> find(
+      std::string_view path,
+      const RESTVerb& verb,
+      enclave::PathParams& params) const
+    {
+      std::optional<T> result = std::nullopt;
+      std::vector<std::string_view> values;
+      visit_matches(
+        root,
+        split(path),
+        0,
+        values,
+        [&](const Node& node, const std::vector<std::string_view>& matched) {
+          const auto it = node.values.find(verb);
+          if (it == node.values.end())
+          {
+            return true;
+          }
+
+          for (size_t i = 0; i < node.param_names.size(); ++i)
+          {
+            params[node.param_names[i]] = std::string(matched[i]);
+          }
+          result = it->second;
+          return false;
+        });
+      return result;
+    }
+
+    /** Return the verbs for which some template matches path.
+     */
+    std::set<RESTVerb> get_verbs(std::string_view path) const
+    {
+      std::set<RESTVerb> verbs;
+      std::vector<std::string_view> values;
+      visit_matches(
+        root,
+        split(path),
+        0,
+        values,
+        [&](const Node& node, const std::vector<std::string_view>&) {
+          for (const auto& [verb, _] : node.values)
+          {
+            verbs.insert(verb);
+          }
+          return true;
+        });
+      return verbs;
+    }
+  };
+}
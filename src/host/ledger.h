@@ -6,14 +6,17 @@
 #include "ds/logger.h"
 #include "ds/messaging.h"
 #include "ds/nonstd.h"
+#include "ds/serializer.h"
 #include "kv/serialised_entry_format.h"
 
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <filesystem>
 #include <list>
 #include <map>
 #include <string>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <vector>
@@ -107,6 +110,74 @@ namespace asynchost
     return match;
   }
 
+  // A range of framed ledger entries, made of one or more (non-contiguous)
+  // pieces. Pieces read from committed ledger files refer directly to the
+  // read-only mapping of that file, which is kept alive by this object, so
+  // that they can be written out without copying.
+  class FramedEntries
+  {
+  private:
+    std::vector<std::shared_ptr<const uint8_t>> mappings;
+    std::vector<std::vector<uint8_t>> copies;
+    std::vector<serializer::ByteRange> pieces;
+    size_t total_size = 0;
+
+  public:
+    void add(
+      const std::shared_ptr<const uint8_t>& mapping,
+      const uint8_t* data,
+      size_t size)
+    {
+      if (mappings.empty() || mappings.back() != mapping)
+      {
+        mappings.push_back(mapping);
+      }
+      pieces.push_back({data, size});
+      total_size += size;
+    }
+
+    void add(std::vector<uint8_t>&& copy)
+    {
+      const auto& c = copies.emplace_back(std::move(copy));
+      pieces.push_back({c.data(), c.size()});
+      total_size += c.size();
+    }
+
+    const std::vector<serializer::ByteRange>& get_pieces() const
+    {
+      return pieces;
+    }
+
+    size_t size() const
+    {
+      return total_size;
+    }
+
+    // Touch every page of the mapped pieces, so that the reads from disk
+    // happen on the calling thread rather than when the pieces are written
+    void prefault() const
+    {
+      if (mappings.empty())
+      {
+        return;
+      }
+
+      static const size_t page_size = sysconf(_SC_PAGESIZE);
+      volatile uint8_t sink = 0;
+      for (const auto& piece : pieces)
+      {
+        for (size_t i = 0; i < piece.size; i += page_size)
+        {
+          sink = sink + piece.data[i];
+        }
+        if (piece.size > 0)
+        {
+          sink = sink + piece.data[piece.size - 1];
+        }
+      }
+    }
+  };
+
   class LedgerFile
   {
   private:
@@ -127,6 +198,77 @@ namespace asynchost
     bool completed = false;
     bool committed = false;
 
+    // Set when entries have been written to the stdio buffer but not yet
+    // flushed to the file
+    mutable bool unflushed = false;
+
+    // Read-only mapping of the entries of committed files, which are never
+    // modified. Entries are read from the mapping rather than from the file,
+    // and may be handed out without copying (see FramedEntries).
+    std::shared_ptr<const uint8_t> mapping = nullptr;
+    size_t mapping_size = 0;
+
+    void map_file(size_t size)
+    {
+      auto data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fileno(file), 0);
+      if (data == MAP_FAILED)
+      {
+        LOG_FAIL_FMT(
+          "Unable to map ledger file {} (falling back to reads): {}",
+          file_name,
+          strerror(errno));
+        return;
+      }
+
+      mapping = std::shared_ptr<const uint8_t>(
+        static_cast<const uint8_t*>(data),
+        [size](const uint8_t* d) { munmap(const_cast<uint8_t*>(d), size); });
+      mapping_size = size;
+    }
+
+    // Reads use pread() on the underlying file descriptor rather than the
+    // stdio stream, so that committed files (which are never written to) can
+    // be read concurrently from several threads
+    bool read_at(uint8_t* data, size_t size, size_t offset) const
+    {
+      if (mapping != nullptr)
+      {
+        if (offset + size > mapping_size)
+        {
+          return false;
+        }
+        std::memcpy(data, mapping.get() + offset, size);
+        return true;
+      }
+
+      if (unflushed)
+      {
+        if (fflush(file) != 0)
+        {
+          throw std::logic_error(fmt::format(
+            "Failed to flush ledger file: {}", strerror(errno)));
+        }
+        unflushed = false;
+      }
+
+      const auto fd = fileno(file);
+      size_t read = 0;
+      while (read < size)
+      {
+        auto rc = pread(fd, data + read, size - read, offset + read);
+        if (rc < 0 && errno == EINTR)
+        {
+          continue;
+        }
+        if (rc <= 0)
+        {
+          return false;
+        }
+        read += rc;
+      }
+      return true;
+    }
+
   public:
     // Used when creating a new (empty) ledger file
     LedgerFile(const std::string& dir, size_t start_idx) :
@@ -167,33 +309,62 @@ namespace asynchost
       fseeko(file, 0, SEEK_END);
       size_t total_file_size = ftello(file);
 
+      if (committed && total_file_size > sizeof(positions_offset_header_t))
+      {
+        map_file(total_file_size);
+      }
+
       // Second, read offset to header table
-      fseeko(file, 0, SEEK_SET);
       positions_offset_header_t table_offset;
-      if (fread(&table_offset, sizeof(positions_offset_header_t), 1, file) != 1)
+      if (mapping != nullptr)
       {
-        throw std::logic_error(fmt::format(
-          "Failed to read positions offset from ledger file {}", file_path));
+        std::memcpy(&table_offset, mapping.get(), sizeof(table_offset));
+      }
+      else
+      {
+        fseeko(file, 0, SEEK_SET);
+        if (
+          fread(&table_offset, sizeof(positions_offset_header_t), 1, file) != 1)
+        {
+          throw std::logic_error(fmt::format(
+            "Failed to read positions offset from ledger file {}", file_path));
+        }
       }
 
       if (table_offset != 0)
       {
+        if (table_offset > total_file_size)
+        {
+          throw std::logic_error(fmt::format(
+            "Invalid positions table offset in ledger file {}", file_path));
+        }
+
         // If the chunk was completed, read positions table from file directly
         total_len = table_offset;
-        fseeko(file, table_offset, SEEK_SET);
-
         positions.resize(
           (total_file_size - table_offset) / sizeof(positions.at(0)));
 
-        if (
-          fread(
+        if (mapping != nullptr)
+        {
+          std::memcpy(
             positions.data(),
-            sizeof(positions.at(0)),
-            positions.size(),
-            file) != positions.size())
+            mapping.get() + table_offset,
+            positions.size() * sizeof(positions.at(0)));
+        }
+        else
         {
-          throw std::logic_error(fmt::format(
-            "Failed to read positions table from ledger file {}", file_path));
+          fseeko(file, table_offset, SEEK_SET);
+          if (
+            fread(
+              positions.data(),
+              sizeof(positions.at(0)),
+              positions.size(),
+              file) != positions.size())
+          {
+            throw std::logic_error(fmt::format(
+              "Failed to read positions table from ledger file {}",
+              file_path));
+          }
         }
         completed = true;
       }
@@ -202,6 +373,7 @@ namespace asynchost
         // If the chunk was not completed, read all entries to reconstruct
         // positions table
         total_len = total_file_size;
+        fseeko(file, sizeof(positions_offset_header_t), SEEK_SET);
 
         auto len = total_len - sizeof(positions_offset_header_t);
         size_t pos = sizeof(positions_offset_header_t);
@@ -285,10 +457,18 @@ namespace asynchost
       }
 
       // Committable entries get flushed straight away
-      if (committable && fflush(file) != 0)
+      if (committable)
       {
-        throw std::logic_error(
-          fmt::format("Failed to flush entry to ledger: {}", strerror(errno)));
+        if (fflush(file) != 0)
+        {
+          throw std::logic_error(fmt::format(
+            "Failed to flush entry to ledger: {}", strerror(errno)));
+        }
+        unflushed = false;
+      }
+      else
+      {
+        unflushed = true;
       }
 
       total_len += size;
@@ -323,9 +503,7 @@ namespace asynchost
 
       auto len = framed_entries_size(idx, idx);
       std::vector<uint8_t> entry(len);
-      fseeko(file, positions.at(idx - start_idx), SEEK_SET);
-
-      if (fread(entry.data(), entry.size(), 1, file) != 1)
+      if (!read_at(entry.data(), len, positions.at(idx - start_idx)))
       {
         throw std::logic_error(
           fmt::format("Failed to read entry {} from file", idx));
@@ -345,9 +523,8 @@ namespace asynchost
 
       auto framed_size = framed_entries_size(from, to);
       std::vector<uint8_t> framed_entries(framed_size);
-      fseeko(file, positions.at(from - start_idx), SEEK_SET);
-
-      if (fread(framed_entries.data(), framed_size, 1, file) != 1)
+      if (!read_at(
+            framed_entries.data(), framed_size, positions.at(from - start_idx)))
       {
         throw std::logic_error(fmt::format(
           "Failed to read entry range {} - {} from file", from, to));
@@ -356,6 +533,46 @@ namespace asynchost
       return framed_entries;
     }
 
+    bool is_mapped() const
+    {
+      return mapping != nullptr;
+    }
+
+    // Adds the range of entries to framed_entries as a single piece, referring
+    // to the mapping of the file if there is one, or to a copy otherwise
+    bool add_framed_entries(
+      size_t from, size_t to, FramedEntries& framed_entries) const
+    {
+      if ((from < start_idx) || (to > get_last_idx()) || (to < from))
+      {
+        return false;
+      }
+
+      if (mapping != nullptr)
+      {
+        const auto offset = positions.at(from - start_idx);
+        const auto size = framed_entries_size(from, to);
+        if (offset + size > mapping_size)
+        {
+          throw std::logic_error(fmt::format(
+            "Entry range {} - {} is beyond the end of ledger file {}",
+            from,
+            to,
+            file_name));
+        }
+        framed_entries.add(mapping, mapping.get() + offset, size);
+        return true;
+      }
+
+      auto entries = read_framed_entries(from, to);
+      if (!entries.has_value())
+      {
+        return false;
+      }
+      framed_entries.add(std::move(entries.value()));
+      return true;
+    }
+
     bool truncate(size_t idx)
     {
       if (committed || (idx < start_idx - 1) || (idx >= get_last_idx()))
@@ -391,6 +608,7 @@ namespace asynchost
         throw std::logic_error(
           fmt::format("Failed to flush ledger file: {}", strerror(errno)));
       }
+      unflushed = false;
 
       if (ftruncate(fileno(file), total_len))
       {
@@ -438,6 +656,7 @@ namespace asynchost
         throw std::logic_error(
           fmt::format("Failed to flush ledger file: {}", strerror(errno)));
       }
+      unflushed = false;
 
       completed = true;
     }
@@ -455,6 +674,7 @@ namespace asynchost
         throw std::logic_error(
           fmt::format("Failed to flush ledger file: {}", strerror(errno)));
       }
+      unflushed = false;
 
       const auto committed_file_name = fmt::format(
         "{}_{}-{}.{}",
@@ -872,6 +1092,84 @@ namespace asynchost
       return entries;
     }
 
+    // Like read_framed_entries(), but entries from committed files are not
+    // copied
+    std::optional<FramedEntries> get_framed_entries(size_t from, size_t to)
+    {
+      if ((from <= 0) || (to > last_idx) || (to < from))
+      {
+        return std::nullopt;
+      }
+
+      FramedEntries entries;
+      size_t idx = from;
+      while (idx <= to)
+      {
+        auto f_from = get_file_from_idx(idx);
+        if (f_from == nullptr)
+        {
+          return std::nullopt;
+        }
+        auto to_ = std::min(f_from->get_last_idx(), to);
+        if (!f_from->add_framed_entries(idx, to_, entries))
+        {
+          return std::nullopt;
+        }
+        idx = to_ + 1;
+      }
+
+      return entries;
+    }
+
+    // Returns the files containing the range of entries, only if they are all
+    // committed. Committed files are never modified, so these can safely be
+    // read from another thread.
+    std::optional<std::vector<std::shared_ptr<LedgerFile>>> get_committed_files(
+      size_t from, size_t to)
+    {
+      if ((from <= 0) || (to > committed_idx) || (to < from))
+      {
+        return std::nullopt;
+      }
+
+      std::vector<std::shared_ptr<LedgerFile>> range_files;
+      size_t idx = from;
+      while (idx <= to)
+      {
+        auto f = get_file_from_idx(idx);
+        if (f == nullptr || !f->is_committed())
+        {
+          return std::nullopt;
+        }
+        range_files.push_back(f);
+        idx = f->get_last_idx() + 1;
+      }
+
+      return range_files;
+    }
+
+    // Synchronously reads the entry at idx and sends it to the enclave
+    void send_entry(size_t idx, consensus::LedgerRequestPurpose purpose)
+    {
+      auto entry = get_framed_entries(idx, idx);
+
+      if (entry.has_value())
+      {
+        // A single entry is always read from a single file, i.e. one piece
+        RINGBUFFER_WRITE_MESSAGE(
+          consensus::ledger_entry,
+          to_enclave,
+          idx,
+          purpose,
+          entry->get_pieces().front());
+      }
+      else
+      {
+        RINGBUFFER_WRITE_MESSAGE(
+          consensus::ledger_no_entry, to_enclave, idx, purpose);
+      }
+    }
+
     size_t write_entry(
       const uint8_t* data, size_t size, bool committable, bool force_chunk)
     {
@@ -1008,25 +1306,6 @@ namespace asynchost
           auto idx = serialized::read<consensus::Index>(data, size);
           commit(idx);
         });
-
-      DISPATCHER_SET_MESSAGE_HANDLER(
-        disp, consensus::ledger_get, [&](const uint8_t* data, size_t size) {
-          auto [idx, purpose] =
-            ringbuffer::read_message<consensus::ledger_get>(data, size);
-
-          auto entry = read_entry(idx);
-
-          if (entry.has_value())
-          {
-            RINGBUFFER_WRITE_MESSAGE(
-              consensus::ledger_entry, to_enclave, idx, purpose, entry.value());
-          }
-          else
-          {
-            RINGBUFFER_WRITE_MESSAGE(
-              consensus::ledger_no_entry, to_enclave, idx, purpose);
-          }
-        });
     }
   };
 }
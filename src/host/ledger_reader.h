@@ -0,0 +1,419 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+#pragma once
+
+#include "after_io.h"
+#include "consensus/ledger_enclave_types.h"
+#include "ds/serialized.h"
+#include "ledger.h"
+
+#include <map>
+
+namespace asynchost
+{
+  /** Serves ledger_get and ledger_get_range requests from the enclave.
+   * Requests received during a loop iteration are batched, and runs of
+   * adjacent indices are coalesced into a single read. Every request is still
+   * answered, so an index requested twice is read once and sent twice.
+   *
+   * Entries in committed ledger files are read on the libuv threadpool, so
+   * that cold reads from old chunks (e.g. for historical queries) do not stall
+   * the host loop. Other entries are read synchronously.
+   *
+   * Ranges are answered with ledger_entry_range messages, each holding as
+   * many adjacent framed entries as fit in max_range_fragment_size.
+   *
+   * Responses are not necessarily sent in the order requests were received.
+   */
+  class LedgerReaderImpl
+  {
+  private:
+    // Upper bound on the number of adjacent entries read in a single job
+    static constexpr size_t max_entries_per_read = 64;
+    static constexpr size_t max_entries_per_range_read = 1024;
+
+    // Entries are added to a ledger_entry_range message until it reaches this
+    // size. A single larger entry is sent on its own.
+    static constexpr size_t max_range_fragment_size = 1 << 20;
+
+    struct ReadJob
+    {
+      uv_work_t req;
+      ringbuffer::WriterPtr to_enclave;
+      consensus::LedgerRequestPurpose purpose;
+      consensus::Index from;
+      consensus::Index to;
+      bool as_range;
+      // Number of requests for each index in [from, to], if !as_range
+      std::vector<size_t> counts;
+      std::vector<std::shared_ptr<LedgerFile>> files;
+
+      // Populated on the threadpool, one per file
+      std::vector<std::optional<FramedEntries>> ranges;
+      std::optional<std::string> error = std::nullopt;
+    };
+
+    Ledger& ledger;
+    ringbuffer::WriterPtr to_enclave;
+
+    // Number of outstanding requests for each index
+    std::map<
+      consensus::LedgerRequestPurpose,
+      std::map<consensus::Index, size_t>>
+      pending;
+    std::map<
+      consensus::LedgerRequestPurpose,
+      std::vector<std::pair<consensus::Index, consensus::Index>>>
+      pending_ranges;
+
+    size_t reads = 0;
+
+    // Sends the framed entries in data, starting at index from, in as few
+    // ledger_entry_range messages as possible. Returns the index following the
+    // last entry sent.
+    static consensus::Index send_entry_range(
+      const ringbuffer::WriterPtr& to_enclave,
+      consensus::LedgerRequestPurpose purpose,
+      consensus::Index from,
+      const uint8_t* data,
+      size_t size)
+    {
+      auto idx = from;
+      while (size > 0)
+      {
+        const auto fragment_from = idx;
+        size_t fragment_size = 0;
+        bool truncated = false;
+        while (fragment_size < size)
+        {
+          const uint8_t* entry = data + fragment_size;
+          size_t remaining = size - fragment_size;
+          const auto header =
+            serialized::peek<kv::SerialisedEntryHeader>(entry, remaining);
+          const auto entry_size =
+            kv::serialised_entry_header_size + header.size;
+          if (entry_size > remaining)
+          {
+            LOG_FAIL_FMT("Ledger entry {} is truncated", idx);
+            truncated = true;
+            break;
+          }
+          if (
+            fragment_size > 0 &&
+            fragment_size + entry_size > max_range_fragment_size)
+          {
+            break;
+          }
+          fragment_size += entry_size;
+          ++idx;
+        }
+
+        if (fragment_size == 0)
+        {
+          break;
+        }
+
+        RINGBUFFER_WRITE_MESSAGE(
+          consensus::ledger_entry_range,
+          to_enclave,
+          fragment_from,
+          idx - 1,
+          purpose,
+          serializer::ByteRange{data, fragment_size});
+        data += fragment_size;
+        size -= fragment_size;
+
+        if (truncated)
+        {
+          break;
+        }
+      }
+      return idx;
+    }
+
+    static void on_read(uv_work_t* req)
+    {
+      auto job = static_cast<ReadJob*>(req->data);
+      job->ranges.resize(job->files.size());
+
+      try
+      {
+        for (size_t i = 0; i < job->files.size(); ++i)
+        {
+          const auto& f = job->files[i];
+          const auto from = std::max<size_t>(job->from, f->get_start_idx());
+          const auto to = std::min<size_t>(job->to, f->get_last_idx());
+
+          FramedEntries range;
+          if (f->add_framed_entries(from, to, range))
+          {
+            // Entries in mapped files are only read from disk when they are
+            // first accessed, which should be here rather than on the loop
+            range.prefault();
+            job->ranges[i] = std::move(range);
+          }
+        }
+      }
+      catch (const std::exception& e)
+      {
+        job->error = e.what();
+      }
+    }
+
+    static void on_read_done(uv_work_t* req, int status)
+    {
+      std::unique_ptr<ReadJob> job(static_cast<ReadJob*>(req->data));
+
+      if (status < 0)
+      {
+        LOG_FAIL_FMT(
+          "Ledger read of {} - {} failed: {}",
+          job->from,
+          job->to,
+          uv_strerror(status));
+      }
+      else if (job->error.has_value())
+      {
+        LOG_FAIL_FMT(
+          "Ledger read of {} - {} failed: {}",
+          job->from,
+          job->to,
+          job->error.value());
+      }
+
+      job->ranges.resize(job->files.size());
+      for (size_t i = 0; i < job->files.size(); ++i)
+      {
+        const auto& f = job->files[i];
+        const auto from = std::max<size_t>(job->from, f->get_start_idx());
+        const auto to = std::min<size_t>(job->to, f->get_last_idx());
+        const auto& range = job->ranges[i];
+
+        if (job->as_range)
+        {
+          if (range.has_value())
+          {
+            const auto& piece = range->get_pieces().front();
+            const auto next = send_entry_range(
+              job->to_enclave, job->purpose, from, piece.data, piece.size);
+            if (next <= to)
+            {
+              RINGBUFFER_WRITE_MESSAGE(
+                consensus::ledger_no_entry_range,
+                job->to_enclave,
+                next,
+                to,
+                job->purpose);
+            }
+          }
+          else
+          {
+            RINGBUFFER_WRITE_MESSAGE(
+              consensus::ledger_no_entry_range,
+              job->to_enclave,
+              from,
+              to,
+              job->purpose);
+          }
+          continue;
+        }
+
+        // Each range is a single piece, holding entries [from, to] in order
+        size_t offset = 0;
+        for (auto idx = from; idx <= to; ++idx)
+        {
+          const auto count = job->counts.at(idx - job->from);
+          if (range.has_value())
+          {
+            const auto& piece = range->get_pieces().front();
+            const auto size = f->framed_entries_size(idx, idx);
+            for (size_t i = 0; i < count; ++i)
+            {
+              RINGBUFFER_WRITE_MESSAGE(
+                consensus::ledger_entry,
+                job->to_enclave,
+                idx,
+                job->purpose,
+                serializer::ByteRange{piece.data + offset, size});
+            }
+            offset += size;
+          }
+          else
+          {
+            for (size_t i = 0; i < count; ++i)
+            {
+              RINGBUFFER_WRITE_MESSAGE(
+                consensus::ledger_no_entry,
+                job->to_enclave,
+                idx,
+                job->purpose);
+            }
+          }
+        }
+      }
+    }
+
+    // Synchronously reads entries [from, to] and sends them to the enclave
+    void send_entries(
+      consensus::LedgerRequestPurpose purpose,
+      consensus::Index from,
+      consensus::Index to,
+      bool as_range,
+      const std::vector<size_t>& counts)
+    {
+      if (!as_range)
+      {
+        for (auto idx = from; idx <= to; ++idx)
+        {
+          for (size_t i = 0; i < counts.at(idx - from); ++i)
+          {
+            ledger.send_entry(idx, purpose);
+          }
+        }
+        return;
+      }
+
+      auto entries = ledger.get_framed_entries(from, to);
+      if (!entries.has_value())
+      {
+        RINGBUFFER_WRITE_MESSAGE(
+          consensus::ledger_no_entry_range, to_enclave, from, to, purpose);
+        return;
+      }
+
+      auto idx = from;
+      for (const auto& piece : entries->get_pieces())
+      {
+        idx =
+          send_entry_range(to_enclave, purpose, idx, piece.data, piece.size);
+      }
+
+      if (idx <= to)
+      {
+        RINGBUFFER_WRITE_MESSAGE(
+          consensus::ledger_no_entry_range, to_enclave, idx, to, purpose);
+      }
+    }
+
+    void read_range(
+      consensus::LedgerRequestPurpose purpose,
+      consensus::Index from,
+      consensus::Index to,
+      bool as_range,
+      std::vector<size_t>&& counts = {})
+    {
+      ++reads;
+
+      auto files = ledger.get_committed_files(from, to);
+      if (!files.has_value())
+      {
+        send_entries(purpose, from, to, as_range, counts);
+        return;
+      }
+
+      auto job = new ReadJob;
+      job->req.data = job;
+      job->to_enclave = to_enclave;
+      job->purpose = purpose;
+      job->from = from;
+      job->to = to;
+      job->as_range = as_range;
+      job->counts = std::move(counts);
+      job->files = std::move(files.value());
+
+      int rc = uv_queue_work(
+        uv_default_loop(), &job->req, on_read, on_read_done);
+      if (rc < 0)
+      {
+        LOG_FAIL_FMT("uv_queue_work failed: {}", uv_strerror(rc));
+        send_entries(purpose, from, to, as_range, job->counts);
+        delete job;
+      }
+    }
+
+  public:
+    LedgerReaderImpl(
+      messaging::Dispatcher<ringbuffer::Message>& disp,
+      Ledger& ledger,
+      ringbuffer::AbstractWriterFactory& writer_factory) :
+      ledger(ledger),
+      to_enclave(writer_factory.create_writer_to_inside())
+    {
+      DISPATCHER_SET_MESSAGE_HANDLER(
+        disp, consensus::ledger_get, [this](const uint8_t* data, size_t size) {
+          auto [idx, purpose] =
+            ringbuffer::read_message<consensus::ledger_get>(data, size);
+          // Identical requests are read once, but each is answered
+          ++pending[purpose][idx];
+        });
+
+      DISPATCHER_SET_MESSAGE_HANDLER(
+        disp,
+        consensus::ledger_get_range,
+        [this](const uint8_t* data, size_t size) {
+          auto [from, to, purpose] =
+            ringbuffer::read_message<consensus::ledger_get_range>(data, size);
+          if (to < from)
+          {
+            LOG_FAIL_FMT("Ignoring invalid ledger range {} - {}", from, to);
+            return;
+          }
+          pending_ranges[purpose].emplace_back(from, to);
+        });
+    }
+
+    void after_io()
+    {
+      auto ranges = std::move(pending_ranges);
+      pending_ranges.clear();
+
+      for (const auto& [purpose, purpose_ranges] : ranges)
+      {
+        for (const auto& [from, to] : purpose_ranges)
+        {
+          for (auto start = from; start <= to;
+               start += max_entries_per_range_read)
+          {
+            const auto end = std::min<consensus::Index>(
+              to, start + max_entries_per_range_read - 1);
+            read_range(purpose, start, end, true);
+          }
+        }
+      }
+
+      if (pending.empty())
+      {
+        return;
+      }
+
+      auto batch = std::move(pending);
+      pending.clear();
+
+      for (const auto& [purpose, indices] : batch)
+      {
+        auto it = indices.begin();
+        while (it != indices.end())
+        {
+          const auto from = it->first;
+          auto to = from;
+          std::vector<size_t> counts = {it->second};
+          while (++it != indices.end() && it->first == to + 1 &&
+                 counts.size() < max_entries_per_read)
+          {
+            to = it->first;
+            counts.push_back(it->second);
+          }
+          read_range(purpose, from, to, false, std::move(counts));
+        }
+      }
+    }
+
+    // Number of reads issued so far, after coalescing
+    size_t get_reads() const
+    {
+      return reads;
+    }
+  };
+
+  using LedgerReader = proxy_ptr<AfterIO<LedgerReaderImpl>>;
+}
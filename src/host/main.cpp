@@ -10,6 +10,7 @@
 #include "ds/stacktrace_utils.h"
 #include "enclave.h"
 #include "handle_ring_buffer.h"
+#include "ledger_reader.h"
 #include "load_monitor.h"
 #include "node_connections.h"
 #include "process_launcher.h"
@@ -174,6 +175,26 @@ int main(int argc, char** argv)
       "Number of transactions between snapshots")
     ->capture_default_str();
 
+  size_t max_snapshot_deltas = 0;
+  app
+    .add_option(
+      "--max-snapshot-deltas",
+      max_snapshot_deltas,
+      "Number of delta snapshots, only recording the state changed since the "
+      "previous snapshot, generated between full snapshots")
+    ->capture_default_str();
+
+  size_t historical_cache_soft_limit = 512 * 1024 * 1024;
+  app
+    .add_option(
+      "--historical-cache-soft-limit",
+      historical_cache_soft_limit,
+      "Soft limit (bytes) on the total size of the ledger entries held in "
+      "memory to serve historical queries. Once exceeded, the least recently "
+      "used historical query requests are dropped")
+    ->capture_default_str()
+    ->transform(CLI::AsSizeValue(true)); // 1000 is kb
+
   size_t max_open_sessions = 1'000;
   app
     .add_option(
@@ -358,6 +379,14 @@ int main(int argc, char** argv)
       "Interval in seconds for JWT public signing key refresh.")
     ->capture_default_str();
 
+  bool request_stage_timing = false;
+  app.add_flag(
+    "--request-stage-timing",
+    request_stage_timing,
+    "Record the latency of each stage of request handling, reported by "
+    "/api/metrics. This reads a precise clock several times per request, "
+    "which is slow inside an SGX enclave.");
+
   size_t memory_reserve_startup = 0;
   app
     .add_option(
@@ -638,6 +667,11 @@ int main(int argc, char** argv)
       read_only_ledger_dirs);
     ledger.register_message_handlers(bp.get_dispatcher());
 
+    // serve ledger entries requested by the enclave, reading committed
+    // entries off the main thread
+    asynchost::LedgerReader ledger_reader(
+      bp.get_dispatcher(), ledger, writer_factory);
+
     asynchost::SnapshotManager snapshots(snapshot_dir, ledger);
     snapshots.register_message_handlers(bp.get_dispatcher());
 
@@ -709,13 +743,16 @@ int main(int argc, char** argv)
                                     rpc_address.port,
                                     public_rpc_address.port};
     ccf_config.snapshot_tx_interval = snapshot_tx_interval;
+    ccf_config.max_snapshot_deltas = max_snapshot_deltas;
     ccf_config.max_open_sessions_soft = max_open_sessions;
     ccf_config.max_open_sessions_hard = max_open_sessions_hard;
+    ccf_config.historical_cache_soft_limit = historical_cache_soft_limit;
 
     ccf_config.subject_name = subject_name;
     ccf_config.subject_alternative_names = subject_alternative_names;
 
     ccf_config.jwt_key_refresh_interval_s = jwt_key_refresh_interval_s;
+    ccf_config.request_stage_timing = request_stage_timing;
 
     ccf_config.curve_id = curve_id;
 
@@ -787,10 +824,11 @@ int main(int argc, char** argv)
 
     if (*join || *recover)
     {
-      auto snapshot_file = snapshots.find_latest_committed_snapshot();
-      if (snapshot_file.has_value())
+      auto snapshot_chain = snapshots.find_latest_committed_snapshot_chain();
+      if (snapshot_chain.has_value())
       {
-        auto& snapshot = snapshot_file.value();
+        // The evidence for the last snapshot in the chain covers the others
+        auto& snapshot = snapshot_chain->back();
         auto snapshot_evidence_idx =
           asynchost::get_snapshot_evidence_idx_from_file_name(snapshot);
         if (!snapshot_evidence_idx.has_value())
@@ -800,14 +838,22 @@ int main(int argc, char** argv)
             snapshot));
         }
 
-        ccf_config.startup_snapshot = snapshots.read_snapshot(snapshot);
+        ccf_config.startup_snapshot =
+          snapshots.read_snapshot(snapshot_chain->front());
+        for (size_t i = 1; i < snapshot_chain->size(); ++i)
+        {
+          ccf_config.startup_snapshot_deltas.push_back(
+            snapshots.read_snapshot(snapshot_chain->at(i)));
+        }
         ccf_config.startup_snapshot_evidence_seqno =
           snapshot_evidence_idx->first;
 
         LOG_INFO_FMT(
-          "Found latest snapshot file: {} (size: {}, evidence seqno: {})",
+          "Found latest snapshot file: {} (size: {}, deltas: {}, evidence "
+          "seqno: {})",
           snapshot,
           ccf_config.startup_snapshot.size(),
+          ccf_config.startup_snapshot_deltas.size(),
           ccf_config.startup_snapshot_evidence_seqno);
       }
       else
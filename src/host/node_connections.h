@@ -17,6 +17,13 @@ namespace asynchost
   class NodeConnections
   {
   private:
+    // Contents of an append entries message, held until it has been written
+    struct AppendEntriesWrite
+    {
+      std::vector<uint8_t> header;
+      FramedEntries entries;
+    };
+
     class ConnectionBehaviour : public TCPBehaviour
     {
     private:
@@ -293,18 +300,37 @@ namespace asynchost
 
             // Find the total frame size, and write it along with the header.
             uint32_t frame = (uint32_t)size_to_send;
-            std::optional<std::vector<uint8_t>> framed_entries = std::nullopt;
-
-            framed_entries =
-              ledger.read_framed_entries(ae.prev_idx + 1, ae.idx);
+            auto framed_entries =
+              ledger.get_framed_entries(ae.prev_idx + 1, ae.idx);
             if (framed_entries.has_value())
             {
               frame += (uint32_t)framed_entries->size();
-              node.value()->write(sizeof(uint32_t), (uint8_t*)&frame);
-              node.value()->write(size_to_send, data_to_send);
 
-              frame = (uint32_t)framed_entries->size();
-              node.value()->write(frame, framed_entries->data());
+              // Only the frame and header are copied. The entries are written
+              // straight from the ledger, and kept alive until the write
+              // completes.
+              auto ae_write = std::make_shared<AppendEntriesWrite>();
+              ae_write->header.resize(sizeof(uint32_t) + size_to_send);
+              std::memcpy(ae_write->header.data(), &frame, sizeof(uint32_t));
+              std::memcpy(
+                ae_write->header.data() + sizeof(uint32_t),
+                data_to_send,
+                size_to_send);
+              ae_write->entries = std::move(framed_entries.value());
+
+              std::vector<uv_buf_t> bufs;
+              bufs.reserve(1 + ae_write->entries.get_pieces().size());
+              bufs.push_back(uv_buf_init(
+                reinterpret_cast<char*>(ae_write->header.data()),
+                ae_write->header.size()));
+              for (const auto& piece : ae_write->entries.get_pieces())
+              {
+                bufs.push_back(uv_buf_init(
+                  reinterpret_cast<char*>(const_cast<uint8_t*>(piece.data)),
+                  piece.size));
+              }
+
+              node.value()->write(std::move(bufs), std::move(ae_write));
             }
             else
             {
@@ -6,10 +6,12 @@
 #include "ds/files.h"
 #include "host/ledger.h"
 
+#include <algorithm>
 #include <charconv>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <optional>
 
 namespace fs = std::filesystem;
@@ -19,6 +21,35 @@ namespace asynchost
   static constexpr auto snapshot_file_prefix = "snapshot";
   static constexpr auto snapshot_idx_delimiter = "_";
   static constexpr auto snapshot_committed_suffix = "committed";
+  static constexpr auto snapshot_delta_suffix = "delta";
+
+  std::optional<size_t> get_snapshot_base_idx_from_file_name(
+    const std::string& file_name)
+  {
+    // Returns the index of the snapshot that a delta snapshot applies to
+    const auto delta_tag =
+      fmt::format(".{}{}", snapshot_delta_suffix, snapshot_idx_delimiter);
+    auto delta_pos = file_name.find(delta_tag);
+    if (delta_pos == std::string::npos)
+    {
+      // Full snapshot
+      return std::nullopt;
+    }
+
+    size_t base_idx;
+    const auto base_start = delta_pos + delta_tag.size();
+    if (
+      std::from_chars(
+        file_name.data() + base_start,
+        file_name.data() + file_name.size(),
+        base_idx)
+        .ec != std::errc())
+    {
+      return std::nullopt;
+    }
+
+    return base_idx;
+  }
 
   std::optional<std::pair<size_t, size_t>>
   get_snapshot_evidence_idx_from_file_name(const std::string& file_name)
@@ -56,8 +87,9 @@ namespace asynchost
 
     size_t evidence_idx;
     const auto evidence_start = evidence_pos + 1;
+    const auto evidence_end = file_name.find('.', evidence_start);
     const auto str_evidence_idx =
-      file_name.substr(evidence_start, commit_pos - evidence_start);
+      file_name.substr(evidence_start, evidence_end - evidence_start);
     if (
       std::from_chars(
         str_evidence_idx.data(),
@@ -93,6 +125,18 @@ namespace asynchost
     static constexpr auto snapshot_file_prefix = "snapshot";
     static constexpr auto snapshot_idx_delimiter = "_";
     static constexpr auto snapshot_committed_suffix = "committed";
+    static constexpr auto snapshot_delta_suffix = "delta";
+
+    // Snapshots which are still being received from the enclave, in chunks
+    struct PendingSnapshot
+    {
+      std::string file_name;
+      std::ofstream file;
+
+      // Set if the snapshot is committed before it is fully written
+      std::optional<consensus::Index> evidence_commit_idx = std::nullopt;
+    };
+    std::map<consensus::Index, PendingSnapshot> pending_snapshots;
 
     size_t get_snapshot_idx_from_file_name(const std::string& file_name)
     {
@@ -132,39 +176,78 @@ namespace asynchost
     void write_snapshot(
       consensus::Index idx,
       consensus::Index evidence_idx,
+      consensus::Index base_idx,
       const uint8_t* snapshot_data,
-      size_t snapshot_size)
+      size_t snapshot_size,
+      bool complete = true)
     {
-      auto snapshot_file_name = fmt::format(
-        "{}{}{}{}{}",
-        snapshot_file_prefix,
-        snapshot_idx_delimiter,
-        idx,
-        snapshot_idx_delimiter,
-        evidence_idx);
-      auto full_snapshot_path =
-        fs::path(snapshot_dir) / fs::path(snapshot_file_name);
-
-      if (fs::exists(full_snapshot_path))
+      auto it = pending_snapshots.find(idx);
+      if (it == pending_snapshots.end())
       {
-        throw std::logic_error(fmt::format(
-          "Cannot write snapshot at {} since file already exists: {}",
+        auto snapshot_file_name = fmt::format(
+          "{}{}{}{}{}",
+          snapshot_file_prefix,
+          snapshot_idx_delimiter,
           idx,
-          full_snapshot_path));
-      }
+          snapshot_idx_delimiter,
+          evidence_idx);
+        if (base_idx != 0)
+        {
+          snapshot_file_name += fmt::format(
+            ".{}{}{}", snapshot_delta_suffix, snapshot_idx_delimiter, base_idx);
+        }
+        auto full_snapshot_path =
+          fs::path(snapshot_dir) / fs::path(snapshot_file_name);
+
+        if (fs::exists(full_snapshot_path))
+        {
+          throw std::logic_error(fmt::format(
+            "Cannot write snapshot at {} since file already exists: {}",
+            idx,
+            full_snapshot_path));
+        }
 
-      LOG_INFO_FMT(
-        "Writing new snapshot to {} [{}]", snapshot_file_name, snapshot_size);
+        LOG_INFO_FMT("Writing new snapshot to {}", snapshot_file_name);
 
-      std::ofstream snapshot_file(
-        full_snapshot_path, std::ios::out | std::ios::binary);
-      snapshot_file.write(
+        PendingSnapshot pending;
+        pending.file_name = snapshot_file_name;
+        pending.file.open(full_snapshot_path, std::ios::out | std::ios::binary);
+        it = pending_snapshots.emplace(idx, std::move(pending)).first;
+      }
+
+      auto& pending = it->second;
+      pending.file.write(
         reinterpret_cast<const char*>(snapshot_data), snapshot_size);
+
+      if (complete)
+      {
+        LOG_INFO_FMT(
+          "Wrote new snapshot to {} [{}]",
+          pending.file_name,
+          static_cast<size_t>(pending.file.tellp()));
+
+        pending.file.close();
+        auto evidence_commit_idx = pending.evidence_commit_idx;
+        pending_snapshots.erase(it);
+
+        if (evidence_commit_idx.has_value())
+        {
+          commit_snapshot(idx, evidence_commit_idx.value());
+        }
+      }
     }
 
     void commit_snapshot(
       consensus::Index snapshot_idx, consensus::Index evidence_commit_idx)
     {
+      auto pending = pending_snapshots.find(snapshot_idx);
+      if (pending != pending_snapshots.end())
+      {
+        // Committed once all of it has been written
+        pending->second.evidence_commit_idx = evidence_commit_idx;
+        return;
+      }
+
       try
       {
         // Find previously-generated snapshot for snapshot_idx and rename file,
@@ -209,10 +292,16 @@ namespace asynchost
       }
     }
 
-    std::optional<std::string> find_latest_committed_snapshot()
+    /** Return the latest committed snapshot which can be applied, with the
+     * full snapshot first, followed by the delta snapshots to apply on top of
+     * it, in order. Delta snapshots whose chain does not lead to a committed
+     * full snapshot are ignored.
+     */
+    std::optional<std::vector<std::string>>
+    find_latest_committed_snapshot_chain()
     {
-      std::optional<std::string> snapshot_file = std::nullopt;
-      size_t latest_idx = 0;
+      // Usable committed snapshots, by snapshot idx
+      std::map<size_t, std::string> committed;
 
       size_t ledger_last_idx = ledger.get_last_idx();
 
@@ -249,24 +338,69 @@ namespace asynchost
 
         auto pos = file_name.find(snapshot_idx_delimiter);
         size_t snapshot_idx = std::stol(file_name.substr(pos + 1));
-        if (snapshot_idx > latest_idx)
+        committed[snapshot_idx] = file_name;
+      }
+
+      for (auto it = committed.rbegin(); it != committed.rend(); ++it)
+      {
+        std::vector<std::string> chain = {it->second};
+        auto base_idx = get_snapshot_base_idx_from_file_name(it->second);
+        while (base_idx.has_value())
+        {
+          auto base = committed.find(base_idx.value());
+          if (base == committed.end())
+          {
+            break;
+          }
+          chain.push_back(base->second);
+          base_idx = get_snapshot_base_idx_from_file_name(base->second);
+        }
+
+        if (base_idx.has_value())
         {
-          snapshot_file = file_name;
-          latest_idx = snapshot_idx;
+          LOG_INFO_FMT(
+            "Ignoring \"{}\" because base snapshot {} is not available",
+            chain.back(),
+            base_idx.value());
+          continue;
         }
+
+        std::reverse(chain.begin(), chain.end());
+        return chain;
       }
 
-      return snapshot_file;
+      return std::nullopt;
+    }
+
+    std::optional<std::string> find_latest_committed_snapshot()
+    {
+      auto chain = find_latest_committed_snapshot_chain();
+      if (!chain.has_value())
+      {
+        return std::nullopt;
+      }
+      return chain->back();
     }
 
     void register_message_handlers(
       messaging::Dispatcher<ringbuffer::Message>& disp)
     {
+      DISPATCHER_SET_MESSAGE_HANDLER(
+        disp,
+        consensus::snapshot_chunk,
+        [this](const uint8_t* data, size_t size) {
+          auto idx = serialized::read<consensus::Index>(data, size);
+          auto evidence_idx = serialized::read<consensus::Index>(data, size);
+          auto base_idx = serialized::read<consensus::Index>(data, size);
+          write_snapshot(idx, evidence_idx, base_idx, data, size, false);
+        });
+
       DISPATCHER_SET_MESSAGE_HANDLER(
         disp, consensus::snapshot, [this](const uint8_t* data, size_t size) {
           auto idx = serialized::read<consensus::Index>(data, size);
           auto evidence_idx = serialized::read<consensus::Index>(data, size);
-          write_snapshot(idx, evidence_idx, data, size);
+          auto base_idx = serialized::read<consensus::Index>(data, size);
+          write_snapshot(idx, evidence_idx, base_idx, data, size);
         });
 
       DISPATCHER_SET_MESSAGE_HANDLER(
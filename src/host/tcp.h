@@ -7,7 +7,9 @@
 #include "dns.h"
 #include "proxy.h"
 
+#include <memory>
 #include <optional>
+#include <vector>
 
 namespace asynchost
 {
@@ -77,12 +79,22 @@ namespace asynchost
       RECONNECTING
     };
 
+    // A single write of one or more buffers. The buffers either point into
+    // copy, or into memory kept alive by owner until the write completes.
+    struct WriteRequest
+    {
+      uv_write_t req;
+      std::vector<uint8_t> copy;
+      std::vector<uv_buf_t> bufs;
+      std::shared_ptr<void> owner = nullptr;
+    };
+
     struct PendingWrite
     {
-      uv_write_t* req;
+      WriteRequest* req;
       size_t len;
 
-      PendingWrite(uv_write_t* req, size_t len) : req(req), len(len) {}
+      PendingWrite(WriteRequest* req, size_t len) : req(req), len(len) {}
 
       PendingWrite(PendingWrite&& that) : req(that.req), len(that.len)
       {
@@ -313,11 +325,44 @@ namespace asynchost
 
     bool write(size_t len, const uint8_t* data)
     {
-      auto req = new uv_write_t;
-      char* copy = new char[len];
+      auto req = new WriteRequest;
       if (data)
-        memcpy(copy, data, len);
-      req->data = copy;
+      {
+        req->copy.assign(data, data + len);
+      }
+      else
+      {
+        req->copy.resize(len);
+      }
+      req->bufs.push_back(
+        uv_buf_init(reinterpret_cast<char*>(req->copy.data()), len));
+
+      return write_request(req, len);
+    }
+
+    /** Write the buffers, in order, with a single write. The buffers are not
+     * copied: owner must keep them alive, and is held until the write has
+     * completed.
+     */
+    bool write(std::vector<uv_buf_t>&& bufs, std::shared_ptr<void> owner)
+    {
+      auto req = new WriteRequest;
+      req->bufs = std::move(bufs);
+      req->owner = std::move(owner);
+
+      size_t len = 0;
+      for (const auto& buf : req->bufs)
+      {
+        len += buf.len;
+      }
+
+      return write_request(req, len);
+    }
+
+  private:
+    bool write_request(WriteRequest* req, size_t len)
+    {
+      req->req.data = req;
 
       switch (status)
       {
@@ -335,7 +380,7 @@ namespace asynchost
 
         case CONNECTED:
         {
-          return send_write(req, len);
+          return send_write(req);
         }
 
         case DISCONNECTED:
@@ -356,7 +401,6 @@ namespace asynchost
       return true;
     }
 
-  private:
     bool init()
     {
       assert_status(FRESH, FRESH);
@@ -401,17 +445,17 @@ namespace asynchost
       return true;
     }
 
-    bool send_write(uv_write_t* req, size_t len)
+    bool send_write(WriteRequest* req)
     {
-      char* copy = (char*)req->data;
-
-      uv_buf_t buf;
-      buf.base = copy;
-      buf.len = len;
-
       int rc;
 
-      if ((rc = uv_write(req, (uv_stream_t*)&uv_handle, &buf, 1, on_write)) < 0)
+      if (
+        (rc = uv_write(
+           &req->req,
+           (uv_stream_t*)&uv_handle,
+           req->bufs.data(),
+           req->bufs.size(),
+           on_write)) < 0)
       {
         free_write(req);
         LOG_FAIL_FMT("uv_write failed: {}", uv_strerror(rc));
@@ -693,7 +737,7 @@ namespace asynchost
 
         for (auto& w : pending_writes)
         {
-          send_write(w.req, w.len);
+          send_write(w.req);
           w.req = nullptr;
         }
 
@@ -788,16 +832,11 @@ namespace asynchost
 
     static void on_write(uv_write_t* req, int)
     {
-      free_write(req);
+      free_write(static_cast<WriteRequest*>(req->data));
     }
 
-    static void free_write(uv_write_t* req)
+    static void free_write(WriteRequest* req)
     {
-      if (req == nullptr)
-        return;
-
-      char* copy = (char*)req->data;
-      delete[] copy;
       delete req;
     }
 
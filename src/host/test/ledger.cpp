@@ -4,11 +4,13 @@
 #include "host/ledger.h"
 
 #include "ds/serialized.h"
+#include "host/ledger_reader.h"
 #include "host/snapshot.h"
 #include "kv/serialised_entry_format.h"
 
 #include <doctest/doctest.h>
 #include <string>
+#include <thread>
 
 using namespace asynchost;
 
@@ -1036,6 +1038,224 @@ TEST_CASE("Delete committed file from main directory")
   }
 }
 
+TEST_CASE("Read committed entries from other threads")
+{
+  fs::remove_all(ledger_dir);
+
+  size_t chunk_threshold = 30;
+  size_t chunk_count = 3;
+
+  Ledger ledger(ledger_dir, wf, chunk_threshold);
+  TestEntrySubmitter entry_submitter(ledger);
+
+  size_t entries_per_chunk =
+    initialise_ledger(entry_submitter, chunk_threshold, chunk_count);
+  size_t end_of_first_chunk_idx = entries_per_chunk;
+
+  INFO("Non-committable entries can be read before they are flushed");
+  {
+    entry_submitter.write(false);
+    entry_submitter.write(false);
+    read_entries_range_from_ledger(ledger, 1, entry_submitter.get_last_idx());
+  }
+
+  INFO("Only ranges of committed files are returned");
+  {
+    REQUIRE_FALSE(ledger.get_committed_files(1, 1).has_value());
+
+    ledger.commit(end_of_first_chunk_idx);
+    auto files = ledger.get_committed_files(1, end_of_first_chunk_idx);
+    REQUIRE(files.has_value());
+    REQUIRE(files->size() == 1);
+
+    REQUIRE_FALSE(
+      ledger.get_committed_files(1, end_of_first_chunk_idx + 1).has_value());
+    REQUIRE_FALSE(ledger.get_committed_files(0, 1).has_value());
+  }
+
+  INFO("Committed ranges can be read concurrently");
+  {
+    size_t last_committed_idx = 2 * entries_per_chunk;
+    ledger.commit(last_committed_idx);
+    auto files = ledger.get_committed_files(1, last_committed_idx);
+    REQUIRE(files.has_value());
+    REQUIRE(files->size() == 2);
+
+    std::vector<uint8_t> entries;
+    std::thread reader([&files, &entries, last_committed_idx]() {
+      for (const auto& f : files.value())
+      {
+        auto to = std::min(last_committed_idx, f->get_last_idx());
+        auto range = f->read_framed_entries(f->get_start_idx(), to);
+        if (range.has_value())
+        {
+          entries.insert(entries.end(), range->begin(), range->end());
+        }
+      }
+    });
+
+    // The main thread keeps writing meanwhile
+    for (size_t i = 0; i < entries_per_chunk; i++)
+    {
+      entry_submitter.write(true);
+    }
+    reader.join();
+
+    verify_framed_entries_range(entries, 1, last_committed_idx);
+  }
+}
+
+TEST_CASE("Read committed entries without copying")
+{
+  fs::remove_all(ledger_dir);
+
+  // Only keep a single committed file in the read cache
+  size_t max_read_cache_size = 1;
+  size_t chunk_threshold = 30;
+  size_t chunk_count = 3;
+
+  Ledger ledger(ledger_dir, wf, chunk_threshold, max_read_cache_size);
+  TestEntrySubmitter entry_submitter(ledger);
+
+  size_t entries_per_chunk =
+    initialise_ledger(entry_submitter, chunk_threshold, chunk_count);
+  size_t end_of_first_chunk_idx = entries_per_chunk;
+  size_t last_committed_idx = 2 * entries_per_chunk;
+  ledger.commit(last_committed_idx);
+
+  // Uncommitted entries are still written to the ledger
+  entry_submitter.write(true);
+
+  auto flatten = [](const FramedEntries& entries) {
+    std::vector<uint8_t> flat;
+    for (const auto& piece : entries.get_pieces())
+    {
+      flat.insert(flat.end(), piece.data, piece.data + piece.size);
+    }
+    REQUIRE(flat.size() == entries.size());
+    return flat;
+  };
+
+  INFO("Entries from committed files are read from a mapping");
+  {
+    auto files = ledger.get_committed_files(1, last_committed_idx);
+    REQUIRE(files.has_value());
+    for (const auto& f : files.value())
+    {
+      REQUIRE(f->is_mapped());
+    }
+
+    auto entries = ledger.get_framed_entries(1, last_committed_idx);
+    REQUIRE(entries.has_value());
+    REQUIRE(entries->get_pieces().size() == 2);
+    verify_framed_entries_range(
+      flatten(entries.value()), 1, last_committed_idx);
+  }
+
+  INFO("Mapped entries outlive eviction from the read cache");
+  {
+    auto entries = ledger.get_framed_entries(1, end_of_first_chunk_idx);
+    REQUIRE(entries.has_value());
+
+    // Evicts the first file from the cache
+    read_entry_from_ledger(ledger, last_committed_idx);
+
+    verify_framed_entries_range(
+      flatten(entries.value()), 1, end_of_first_chunk_idx);
+  }
+
+  INFO("Ranges span committed and uncommitted files");
+  {
+    auto last_idx = entry_submitter.get_last_idx();
+    auto entries = ledger.get_framed_entries(1, last_idx);
+    REQUIRE(entries.has_value());
+    REQUIRE(entries->get_pieces().size() == chunk_count + 1);
+    verify_framed_entries_range(flatten(entries.value()), 1, last_idx);
+    read_entries_range_from_ledger(ledger, 1, last_idx);
+
+    REQUIRE_FALSE(ledger.get_framed_entries(1, last_idx + 1).has_value());
+  }
+}
+
+TEST_CASE("Overlapping ledger requests are coalesced")
+{
+  fs::remove_all(ledger_dir);
+
+  size_t chunk_threshold = 30;
+  size_t chunk_count = 3;
+
+  Ledger ledger(ledger_dir, wf, chunk_threshold);
+  TestEntrySubmitter entry_submitter(ledger);
+
+  size_t entries_per_chunk =
+    initialise_ledger(entry_submitter, chunk_threshold, chunk_count);
+  ledger.commit(2 * entries_per_chunk);
+  size_t last_idx = entry_submitter.get_last_idx();
+
+  // Discard messages left over by previous tests
+  auto discard = [](ringbuffer::Message, const uint8_t*, size_t) {};
+  eio.read_from_inside().read(-1, discard);
+  eio.read_from_outside().read(-1, discard);
+
+  messaging::BufferProcessor host_bp("host");
+  LedgerReaderImpl reader(host_bp.get_dispatcher(), ledger, wf);
+
+  const auto purpose = consensus::LedgerRequestPurpose::HistoricalQuery;
+  auto to_host = wf.create_writer_to_outside();
+  for (auto idx : {2, 1, 2, 3})
+  {
+    RINGBUFFER_WRITE_MESSAGE(
+      consensus::ledger_get, to_host, (consensus::Index)idx, purpose);
+  }
+  for (auto idx : {last_idx, last_idx + 1, last_idx})
+  {
+    RINGBUFFER_WRITE_MESSAGE(
+      consensus::ledger_get, to_host, (consensus::Index)idx, purpose);
+  }
+
+  host_bp.read_n(-1, eio.read_from_inside());
+  reader.after_io();
+  uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+  INFO("Adjacent and identical requests are served by a single read");
+  {
+    // One read from committed files, and one from the uncommitted file
+    REQUIRE(reader.get_reads() == 2);
+  }
+
+  INFO("Each request is answered");
+  {
+    std::map<consensus::Index, size_t> entries;
+    std::map<consensus::Index, size_t> no_entries;
+
+    messaging::BufferProcessor enclave_bp("enclave");
+    DISPATCHER_SET_MESSAGE_HANDLER(
+      enclave_bp,
+      consensus::ledger_entry,
+      [&entries](const uint8_t* data, size_t size) {
+        auto [idx, p, entry] =
+          ringbuffer::read_message<consensus::ledger_entry>(data, size);
+        verify_framed_entries_range(entry, idx, idx);
+        entries[idx]++;
+      });
+    DISPATCHER_SET_MESSAGE_HANDLER(
+      enclave_bp,
+      consensus::ledger_no_entry,
+      [&no_entries](const uint8_t* data, size_t size) {
+        auto [idx, p] =
+          ringbuffer::read_message<consensus::ledger_no_entry>(data, size);
+        no_entries[idx]++;
+      });
+    enclave_bp.read_n(-1, eio.read_from_outside());
+
+    const std::map<consensus::Index, size_t> expected_entries = {
+      {1, 1}, {2, 2}, {3, 1}, {last_idx, 2}};
+    REQUIRE(entries == expected_entries);
+    REQUIRE(
+      no_entries == std::map<consensus::Index, size_t>{{last_idx + 1, 1}});
+  }
+}
+
 TEST_CASE("Find latest snapshot with corresponding ledger chunk")
 {
   fs::remove_all(ledger_dir);
@@ -1068,6 +1288,7 @@ TEST_CASE("Find latest snapshot with corresponding ledger chunk")
     snapshots.write_snapshot(
       snapshot_idx,
       snapshot_evidence_idx,
+      0,
       dummy_snapshot.data(),
       dummy_snapshot.size());
 
@@ -1089,6 +1310,96 @@ TEST_CASE("Find latest snapshot with corresponding ledger chunk")
     fs::remove(snapshot_file_name);
   }
 
+  INFO("Snapshot written in chunks and committed before it is complete");
+  {
+    size_t snapshot_idx = last_idx / 2;
+    size_t snapshot_evidence_idx = snapshot_idx + 1;
+    size_t snapshot_evidence_commit_idx = snapshot_evidence_idx + 1;
+    const auto half = dummy_snapshot.size() / 2;
+
+    snapshots.write_snapshot(
+      snapshot_idx,
+      snapshot_evidence_idx,
+      0,
+      dummy_snapshot.data(),
+      half,
+      false);
+
+    // Commit is deferred until the last chunk is written
+    snapshots.commit_snapshot(snapshot_idx, snapshot_evidence_commit_idx);
+    REQUIRE_FALSE(snapshots.find_latest_committed_snapshot().has_value());
+
+    snapshots.write_snapshot(
+      snapshot_idx,
+      snapshot_evidence_idx,
+      0,
+      dummy_snapshot.data() + half,
+      dummy_snapshot.size() - half);
+
+    auto snapshot_file_name = get_snapshot_file_name(
+      snapshot_idx, snapshot_evidence_idx, snapshot_evidence_commit_idx);
+
+    REQUIRE(
+      fmt::format(
+        "{}/{}",
+        snapshot_dir,
+        snapshots.find_latest_committed_snapshot().value()) ==
+      snapshot_file_name);
+    REQUIRE(files::slurp(snapshot_file_name) == dummy_snapshot);
+
+    fs::remove(snapshot_file_name);
+  }
+
+  INFO("Delta snapshots are retrieved with the chain they apply to");
+  {
+    size_t base_idx = last_idx / 4;
+    size_t delta_idx = last_idx / 2;
+    size_t orphan_delta_idx = delta_idx + 2;
+
+    snapshots.write_snapshot(
+      base_idx, base_idx + 1, 0, dummy_snapshot.data(), dummy_snapshot.size());
+    snapshots.write_snapshot(
+      delta_idx,
+      delta_idx + 1,
+      base_idx,
+      dummy_snapshot.data(),
+      dummy_snapshot.size());
+
+    // Delta applies to a snapshot which was never committed
+    snapshots.write_snapshot(
+      orphan_delta_idx,
+      orphan_delta_idx + 1,
+      delta_idx + 1,
+      dummy_snapshot.data(),
+      dummy_snapshot.size());
+
+    snapshots.commit_snapshot(delta_idx, delta_idx + 2);
+    snapshots.commit_snapshot(orphan_delta_idx, orphan_delta_idx + 2);
+
+    // Base is not yet committed
+    REQUIRE_FALSE(snapshots.find_latest_committed_snapshot().has_value());
+
+    snapshots.commit_snapshot(base_idx, base_idx + 2);
+
+    auto chain = snapshots.find_latest_committed_snapshot_chain();
+    REQUIRE(chain.has_value());
+    REQUIRE(chain->size() == 2);
+    REQUIRE(
+      fmt::format("{}/{}", snapshot_dir, chain->at(0)) ==
+      get_snapshot_file_name(base_idx, base_idx + 1, base_idx + 2));
+    REQUIRE(
+      get_snapshot_base_idx_from_file_name(chain->at(1)).value() == base_idx);
+    REQUIRE(
+      get_snapshot_evidence_idx_from_file_name(chain->at(1)).value() ==
+      std::make_pair(delta_idx + 1, delta_idx + 2));
+    REQUIRE(snapshots.find_latest_committed_snapshot() == chain->back());
+
+    for (const auto& f : fs::directory_iterator(snapshot_dir))
+    {
+      fs::remove(f.path());
+    }
+  }
+
   INFO("Snapshot evidence commit past last ledger index");
   {
     // Snapshot evidence commit idx is past last ledger idx
@@ -1099,6 +1410,7 @@ TEST_CASE("Find latest snapshot with corresponding ledger chunk")
     snapshots.write_snapshot(
       snapshot_idx,
       snapshot_evidence_idx,
+      0,
       dummy_snapshot.data(),
       dummy_snapshot.size());
 
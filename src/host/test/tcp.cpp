@@ -0,0 +1,168 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "host/tcp.h"
+
+#include <chrono>
+#include <doctest/doctest.h>
+#include <memory>
+#include <vector>
+
+using namespace asynchost;
+
+size_t asynchost::TCPImpl::remaining_read_quota;
+
+using Buffers = std::vector<std::vector<uint8_t>>;
+
+class ReceiverBehaviour : public TCPBehaviour
+{
+private:
+  std::vector<uint8_t>& received;
+
+public:
+  ReceiverBehaviour(std::vector<uint8_t>& received) : received(received) {}
+
+  void on_read(size_t len, uint8_t*& data) override
+  {
+    received.insert(received.end(), data, data + len);
+  }
+};
+
+class AcceptBehaviour : public TCPServerBehaviour
+{
+private:
+  std::vector<uint8_t>& received;
+  TCP& peer;
+
+public:
+  AcceptBehaviour(std::vector<uint8_t>& received, TCP& peer) :
+    received(received),
+    peer(peer)
+  {}
+
+  void on_accept(TCP& accepted) override
+  {
+    accepted->set_behaviour(std::make_unique<ReceiverBehaviour>(received));
+    peer = accepted;
+  }
+};
+
+// Runs the loop until done() returns true, or a timeout expires
+template <typename F>
+bool run_until(F&& done)
+{
+  const auto timeout = std::chrono::seconds(10);
+  const auto start = std::chrono::steady_clock::now();
+  while (!done())
+  {
+    if (std::chrono::steady_clock::now() - start > timeout)
+    {
+      return false;
+    }
+    TCPImpl::reset_read_quota();
+    uv_run(uv_default_loop(), UV_RUN_NOWAIT);
+  }
+  return true;
+}
+
+std::shared_ptr<Buffers> make_buffers(
+  const std::vector<size_t>& sizes, uint8_t first_value)
+{
+  auto buffers = std::make_shared<Buffers>();
+  auto value = first_value;
+  for (auto size : sizes)
+  {
+    buffers->emplace_back(size, value++);
+  }
+  return buffers;
+}
+
+std::vector<uv_buf_t> to_bufs(Buffers& buffers)
+{
+  std::vector<uv_buf_t> bufs;
+  for (auto& b : buffers)
+  {
+    bufs.push_back(uv_buf_init(reinterpret_cast<char*>(b.data()), b.size()));
+  }
+  return bufs;
+}
+
+void append(std::vector<uint8_t>& to, const Buffers& buffers)
+{
+  for (const auto& b : buffers)
+  {
+    to.insert(to.end(), b.begin(), b.end());
+  }
+}
+
+TEST_CASE("Scatter/gather writes")
+{
+  std::vector<uint8_t> received;
+  std::vector<uint8_t> expected;
+
+  TCP peer = nullptr;
+  TCP server;
+  server->set_behaviour(std::make_unique<AcceptBehaviour>(received, peer));
+  REQUIRE(server->listen("127.0.0.1", "0"));
+
+  TCP client(true);
+  client->set_behaviour(std::make_unique<TCPBehaviour>());
+  REQUIRE(client->connect("127.0.0.1", server->get_service()));
+
+  INFO("Buffers written before connecting are sent in order");
+  {
+    // Large enough to take several reads, and a write that is not immediate
+    auto buffers = make_buffers({4, 1 << 20, 0, 17}, 1);
+    std::weak_ptr<Buffers> owner = buffers;
+    REQUIRE(client->write(to_bufs(*buffers), buffers));
+    append(expected, *buffers);
+
+    // Interleaved with a copying write, which is not reordered
+    const std::vector<uint8_t> copied(32, 42);
+    REQUIRE(client->write(copied.size(), copied.data()));
+    expected.insert(expected.end(), copied.begin(), copied.end());
+
+    // The owner is held by the write alone
+    buffers.reset();
+    REQUIRE_FALSE(owner.expired());
+
+    REQUIRE(run_until(
+      [&]() { return received.size() >= expected.size() && owner.expired(); }));
+    REQUIRE(received == expected);
+  }
+
+  INFO("Buffers written once connected are sent in order");
+  {
+    auto buffers = make_buffers({8, 1000, 1 << 16}, 10);
+    std::weak_ptr<Buffers> owner = buffers;
+    append(expected, *buffers);
+    auto bufs = to_bufs(*buffers);
+    REQUIRE(client->write(std::move(bufs), std::move(buffers)));
+    REQUIRE_FALSE(owner.expired());
+
+    REQUIRE(run_until(
+      [&]() { return received.size() >= expected.size() && owner.expired(); }));
+    REQUIRE(received == expected);
+  }
+
+  INFO("Buffers of pending writes are released when the connection closes");
+  {
+    TCP other(true);
+    other->set_behaviour(std::make_unique<TCPBehaviour>());
+    REQUIRE(other->connect("127.0.0.1", server->get_service()));
+
+    auto buffers = make_buffers({8, 16}, 20);
+    std::weak_ptr<Buffers> owner = buffers;
+    auto bufs = to_bufs(*buffers);
+    REQUIRE(other->write(std::move(bufs), std::move(buffers)));
+    REQUIRE_FALSE(owner.expired());
+
+    other = nullptr;
+    REQUIRE(run_until([&]() { return owner.expired(); }));
+  }
+
+  peer = nullptr;
+  server = nullptr;
+  client = nullptr;
+  uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+}
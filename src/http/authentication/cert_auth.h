@@ -29,8 +29,8 @@ namespace ccf
       const std::shared_ptr<enclave::RpcContext>& ctx,
       std::string& error_reason) override
     {
-      const auto& caller_cert = ctx->session->caller_cert;
-      auto caller_id = crypto::Sha256Hash(caller_cert).hex_str();
+      // The digest is cached on the session, but the table is always read
+      const auto& caller_id = ctx->session->get_caller_cert_digest();
 
       auto user_certs = tx.ro<UserCerts>(Tables::USER_CERTS);
       if (user_certs->has(caller_id))
@@ -70,8 +70,7 @@ namespace ccf
       const std::shared_ptr<enclave::RpcContext>& ctx,
       std::string& error_reason) override
     {
-      const auto& caller_cert = ctx->session->caller_cert;
-      auto caller_id = crypto::Sha256Hash(caller_cert).hex_str();
+      const auto& caller_id = ctx->session->get_caller_cert_digest();
 
       auto member_certs = tx.ro<MemberCerts>(Tables::MEMBER_CERTS);
       if (member_certs->has(caller_id))
@@ -3,9 +3,16 @@
 #pragma once
 
 #include "authentication_types.h"
+#include "crypto/hash.h"
+#include "crypto/verifier.h"
+#include "ds/lru.h"
+#include "enclave/enclave_time.h"
 #include "http/http_jwt.h"
 #include "node/jwt.h"
 
+#include <chrono>
+#include <mutex>
+
 namespace ccf
 {
   struct JwtAuthnIdentity : public AuthnIdentity
@@ -19,14 +26,167 @@ namespace ccf
     nlohmann::json payload;
   };
 
+  /** Authenticates requests carrying a JWT bearer token, signed by one of the
+   * keys in @c public:ccf.gov.jwt_public_signing_keys.
+   *
+   * Parsed verifiers are cached by key ID, and the digests of tokens whose
+   * signature was recently validated are cached for a short TTL (never beyond
+   * the token's own "exp" claim), so that repeated requests with the same
+   * token skip signature verification. The token's signing key must still be
+   * present in the table for either cache to be consulted. Both caches are
+   * discarded whenever the signing keys table changes, so rotated or removed
+   * keys take effect immediately, and are bypassed by transactions reading an
+   * older version of the table.
+   */
   class JwtAuthnPolicy : public AuthnPolicy
   {
   protected:
     static const OpenAPISecuritySchema security_schema;
 
+    using TokenDigest = decltype(crypto::Sha256Hash::h);
+
+    const std::chrono::microseconds token_cache_ttl;
+
+    // Guards the caches below, since a single policy instance is shared by
+    // all endpoints and worker threads
+    std::mutex cache_lock;
+    // Version of the signing keys table from which the caches were populated
+    std::optional<kv::MapVersion> keys_version = std::nullopt;
+    LRU<JwtKeyId, crypto::VerifierPtr> verifiers;
+    // Expiry time of cache entry, in enclave time
+    LRU<TokenDigest, std::chrono::microseconds> validated_tokens;
+
+    // Must be called with cache_lock held. Returns true if the caches reflect
+    // this version of the signing keys table, and so may be used.
+    bool reset_caches_if_stale(const kv::MapVersion& version)
+    {
+      if (!keys_version.has_value() || keys_version.value() < version)
+      {
+        verifiers.clear();
+        validated_tokens.clear();
+        keys_version = version;
+      }
+      return keys_version.value() == version;
+    }
+
+    std::chrono::microseconds get_token_cache_expiry(
+      const http::JwtVerifier::Token& token, std::chrono::microseconds now)
+    {
+      auto expiry = now + token_cache_ttl;
+      const auto exp_it = token.payload.find("exp");
+      if (exp_it != token.payload.end() && exp_it->is_number())
+      {
+        const auto exp = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::duration<double>(exp_it->get<double>()));
+        expiry = std::min(expiry, exp);
+      }
+      return expiry;
+    }
+
+    bool validate_token(
+      const JwtPublicSigningKeys::ReadOnlyHandle& keys,
+      const http::JwtVerifier::Token& token,
+      std::string& error_reason)
+    {
+      const auto& key_id = token.header_typed.kid;
+      const auto token_key = keys.get(key_id);
+      if (!token_key.has_value())
+      {
+        error_reason = "JWT signing key not found";
+        return false;
+      }
+      const auto version = keys.get_map_version();
+
+      // Without a clock (eg- before the host has started ticking), no token
+      // can be safely cached
+      const auto now = enclave::get_enclave_time();
+      const auto use_token_cache =
+        token_cache_ttl.count() > 0 && now.count() != 0;
+      TokenDigest digest;
+      if (use_token_cache)
+      {
+        digest = crypto::Sha256Hash(
+                   {(const uint8_t*)token.raw.data(), token.raw.size()})
+                   .h;
+      }
+
+      crypto::VerifierPtr verifier = nullptr;
+      {
+        std::lock_guard<std::mutex> guard(cache_lock);
+        // Caches built from a newer version of the keys than this transaction
+        // reads cannot be trusted
+        const auto use_caches = reset_caches_if_stale(version);
+
+        if (use_caches && use_token_cache)
+        {
+          const auto it = validated_tokens.find(digest);
+          if (it != validated_tokens.end())
+          {
+            if (now < it->second)
+            {
+              return true;
+            }
+            validated_tokens.erase(digest);
+          }
+        }
+
+        if (use_caches)
+        {
+          const auto it = verifiers.find(key_id);
+          if (it != verifiers.end())
+          {
+            verifier = it->second;
+          }
+        }
+      }
+
+      if (verifier == nullptr)
+      {
+        verifier = crypto::make_verifier(token_key.value());
+      }
+
+      if (!http::JwtVerifier::validate_token_signature(token, *verifier))
+      {
+        error_reason = "JWT signature is invalid";
+        return false;
+      }
+
+      std::lock_guard<std::mutex> guard(cache_lock);
+      // Do not populate the caches from a stale view of the keys
+      if (keys_version == version)
+      {
+        verifiers.insert(key_id, std::move(verifier));
+        if (use_token_cache)
+        {
+          auto expiry = get_token_cache_expiry(token, now);
+          if (now < expiry)
+          {
+            validated_tokens.insert(digest, std::move(expiry));
+          }
+        }
+      }
+      return true;
+    }
+
   public:
     static constexpr auto SECURITY_SCHEME_NAME = "jwt";
 
+    static constexpr size_t DEFAULT_MAX_VERIFIERS = 50;
+    static constexpr size_t DEFAULT_MAX_VALIDATED_TOKENS = 1000;
+    static constexpr std::chrono::seconds DEFAULT_TOKEN_CACHE_TTL{30};
+
+    /** A @c token_cache_ttl of zero disables the cache of validated tokens,
+     * so that every request's signature is verified.
+     */
+    JwtAuthnPolicy(
+      std::chrono::microseconds token_cache_ttl_ = DEFAULT_TOKEN_CACHE_TTL,
+      size_t max_verifiers = DEFAULT_MAX_VERIFIERS,
+      size_t max_validated_tokens = DEFAULT_MAX_VALIDATED_TOKENS) :
+      token_cache_ttl(token_cache_ttl_),
+      verifiers(max_verifiers),
+      validated_tokens(max_validated_tokens)
+    {}
+
     std::unique_ptr<AuthnIdentity> authenticate(
       kv::ReadOnlyTx& tx,
       const std::shared_ptr<enclave::RpcContext>& ctx,
@@ -34,30 +194,25 @@ namespace ccf
     {
       const auto& headers = ctx->get_request_headers();
 
-      const auto token =
-        http::JwtVerifier::extract_token(headers, error_reason);
+      auto token = http::JwtVerifier::extract_token(headers, error_reason);
 
       if (token.has_value())
       {
         auto keys =
           tx.ro<JwtPublicSigningKeys>(ccf::Tables::JWT_PUBLIC_SIGNING_KEYS);
-        auto key_issuers = tx.ro<JwtPublicSigningKeyIssuer>(
-          ccf::Tables::JWT_PUBLIC_SIGNING_KEY_ISSUER);
-        const auto key_id = token.value().header_typed.kid;
-        const auto token_key = keys->get(key_id);
-        if (!token_key.has_value())
-        {
-          error_reason = "JWT signing key not found";
-        }
-        else if (!http::JwtVerifier::validate_token_signature(
-                   token.value(), token_key.value()))
-        {
-          error_reason = "JWT signature is invalid";
-        }
-        else
+        if (validate_token(*keys, token.value(), error_reason))
         {
+          auto key_issuers = tx.ro<JwtPublicSigningKeyIssuer>(
+            ccf::Tables::JWT_PUBLIC_SIGNING_KEY_ISSUER);
+          const auto key_issuer = key_issuers->get(token->header_typed.kid);
+          if (!key_issuer.has_value())
+          {
+            error_reason = "JWT signing key not found";
+            return nullptr;
+          }
+
           auto identity = std::make_unique<JwtAuthnIdentity>();
-          identity->key_issuer = key_issuers->get(key_id).value();
+          identity->key_issuer = key_issuer.value();
           identity->header = std::move(token->header);
           identity->payload = std::move(token->payload);
           return identity;
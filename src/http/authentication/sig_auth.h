@@ -3,9 +3,15 @@
 #pragma once
 
 #include "authentication_types.h"
+#include "crypto/hash.h"
 #include "ds/lru.h"
 #include "http/http_sig.h"
 
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
 namespace ccf
 {
   namespace
@@ -31,30 +37,85 @@ namespace ccf
     SignedReq signed_request;
   };
 
-  struct VerifierCache
+  /** Cache of verifiers, keyed by the digest of their certificate.
+   *
+   * Entries are spread across independently locked shards, each an LRU holding
+   * an equal share of the total capacity, so that concurrent lookups of
+   * different certificates rarely contend. Verifiers are constructed outside
+   * of any lock.
+   */
+  class VerifierCache
   {
-    static constexpr size_t DEFAULT_MAX_VERIFIERS = 50;
+  public:
+    static constexpr size_t DEFAULT_MAX_VERIFIERS = 1024;
+    static constexpr size_t DEFAULT_NUM_SHARDS = 16;
 
-    std::mutex verifiers_lock;
-    LRU<crypto::Pem, crypto::VerifierPtr> verifiers;
+  protected:
+    using CertDigest = decltype(crypto::Sha256Hash::h);
 
-    VerifierCache(size_t max_verifiers = DEFAULT_MAX_VERIFIERS) :
-      verifiers(max_verifiers)
-    {}
+    struct Shard
+    {
+      std::mutex lock;
+      LRU<CertDigest, crypto::VerifierPtr> verifiers;
 
-    crypto::VerifierPtr get_verifier(const crypto::Pem& pem)
+      Shard(size_t max_verifiers) : verifiers(max_verifiers) {}
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    Shard& get_shard(const CertDigest& digest)
+    {
+      // The digest is uniformly distributed, so its leading bytes suffice
+      size_t n = 0;
+      for (size_t i = 0; i < sizeof(size_t); ++i)
+      {
+        n = (n << 8) | digest[i];
+      }
+      return *shards[n % shards.size()];
+    }
+
+  public:
+    VerifierCache(
+      size_t max_verifiers = DEFAULT_MAX_VERIFIERS,
+      size_t num_shards = DEFAULT_NUM_SHARDS)
     {
-      std::lock_guard<std::mutex> guard(verifiers_lock);
+      if (max_verifiers == 0 || num_shards == 0)
+      {
+        throw std::logic_error(
+          "Verifier cache must have at least one shard and one entry");
+      }
+
+      num_shards = std::min(num_shards, max_verifiers);
+      const auto max_per_shard = (max_verifiers + num_shards - 1) / num_shards;
+      shards.reserve(num_shards);
+      for (size_t i = 0; i < num_shards; ++i)
+      {
+        shards.push_back(std::make_unique<Shard>(max_per_shard));
+      }
+    }
 
-      crypto::VerifierPtr verifier = nullptr;
+    crypto::VerifierPtr get_verifier(const crypto::Pem& pem)
+    {
+      const auto digest = crypto::Sha256Hash({pem.data(), pem.size()}).h;
+      auto& shard = get_shard(digest);
 
-      auto it = verifiers.find(pem);
-      if (it == verifiers.end())
       {
-        it = verifiers.insert(pem, crypto::make_verifier(pem));
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto it = shard.verifiers.find(digest);
+        if (it != shard.verifiers.end())
+        {
+          // Re-inserting an existing entry marks it as most recently used
+          return shard.verifiers.insert(digest, crypto::VerifierPtr(it->second))
+            ->second;
+        }
       }
 
-      return it->second;
+      auto verifier = crypto::make_verifier(pem);
+
+      // If another thread inserted a verifier for this certificate in the
+      // meantime, that one is kept and returned
+      std::lock_guard<std::mutex> guard(shard.lock);
+      return shard.verifiers.insert(digest, std::move(verifier))->second;
     }
   };
 
@@ -67,6 +128,11 @@ namespace ccf
   public:
     static constexpr auto SECURITY_SCHEME_NAME = "user_signature";
 
+    UserSignatureAuthnPolicy(
+      size_t max_verifiers = VerifierCache::DEFAULT_MAX_VERIFIERS) :
+      verifiers(max_verifiers)
+    {}
+
     std::unique_ptr<AuthnIdentity> authenticate(
       kv::ReadOnlyTx& tx,
       const std::shared_ptr<enclave::RpcContext>& ctx,
@@ -165,6 +231,11 @@ namespace ccf
   public:
     static constexpr auto SECURITY_SCHEME_NAME = "member_signature";
 
+    MemberSignatureAuthnPolicy(
+      size_t max_verifiers = VerifierCache::DEFAULT_MAX_VERIFIERS) :
+      verifiers(max_verifiers)
+    {}
+
     std::unique_ptr<AuthnIdentity> authenticate(
       kv::ReadOnlyTx& tx,
       const std::shared_ptr<enclave::RpcContext>& ctx,
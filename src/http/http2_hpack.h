@@ -0,0 +1,724 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// HPACK header compression for HTTP/2, as specified in RFC 7541
+namespace http2::hpack
+{
+  /** Raised when a header block cannot be decoded. The decoder's dynamic
+   * table may then no longer match the peer's, so this must be treated as a
+   * connection error (COMPRESSION_ERROR).
+   */
+  class CompressionError : public std::runtime_error
+  {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  struct HeaderField
+  {
+    std::string name;
+    std::string value;
+  };
+
+  using HeaderList = std::vector<HeaderField>;
+
+  // Initial size of the dynamic table, in each direction
+  static constexpr size_t default_table_size = 4096;
+
+  struct HuffmanCode
+  {
+    uint32_t code;
+    uint8_t bits;
+  };
+
+  // RFC 7541, Appendix B, indexed by symbol. The last entry is EOS.
+  static constexpr HuffmanCode huffman_codes[] = {
+      {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},
+      {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+      {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+      {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+      {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+      {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+      {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},
+      {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+      {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12}, {0x1ff9, 13}, {0x15, 6},
+      {0xf8, 8}, {0x7fa, 11}, {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},
+      {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6}, {0x0, 5}, {0x1, 5}, {0x2, 5},
+      {0x19, 6}, {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6}, {0x1e, 6},
+      {0x1f, 6}, {0x5c, 7}, {0xfb, 8}, {0x7ffc, 15}, {0x20, 6}, {0xffb, 12},
+      {0x3fc, 10}, {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7}, {0x5f, 7},
+      {0x60, 7}, {0x61, 7}, {0x62, 7}, {0x63, 7}, {0x64, 7}, {0x65, 7},
+      {0x66, 7}, {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7}, {0x6b, 7},
+      {0x6c, 7}, {0x6d, 7}, {0x6e, 7}, {0x6f, 7}, {0x70, 7}, {0x71, 7},
+      {0x72, 7}, {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13}, {0x7fff0, 19},
+      {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6}, {0x7ffd, 15}, {0x3, 5}, {0x23, 6},
+      {0x4, 5}, {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6}, {0x27, 6}, {0x6, 5},
+      {0x74, 7}, {0x75, 7}, {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},
+      {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5}, {0x9, 5}, {0x2d, 6}, {0x77, 7},
+      {0x78, 7}, {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15}, {0x7fc, 11},
+      {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28}, {0xfffe6, 20},
+      {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20}, {0x3fffd3, 22},
+      {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23}, {0x3fffd6, 22},
+      {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23}, {0x7fffdd, 23},
+      {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23}, {0xffffec, 24},
+      {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23}, {0xffffee, 24},
+      {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23}, {0x7fffe4, 23},
+      {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23}, {0x3fffd9, 22},
+      {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24}, {0x3fffda, 22},
+      {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22}, {0x3fffdc, 22},
+      {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21}, {0x7fffea, 23},
+      {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24}, {0x1fffdf, 21},
+      {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23}, {0x1fffe0, 21},
+      {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21}, {0x7fffed, 23},
+      {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23}, {0xfffea, 20},
+      {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22}, {0x7ffff0, 23},
+      {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23}, {0x3ffffe0, 26},
+      {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19}, {0x3fffe7, 22},
+      {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25}, {0x3ffffe2, 26},
+      {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27}, {0x7ffffdf, 27},
+      {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25}, {0x7fff2, 19},
+      {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27}, {0x7ffffe1, 27},
+      {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24}, {0x1fffe4, 21},
+      {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26}, {0xffffffd, 28},
+      {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27}, {0xfffec, 20},
+      {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21}, {0x3fffe9, 22},
+      {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23}, {0x3fffea, 22},
+      {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25}, {0xfffff4, 24},
+      {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23}, {0x3ffffeb, 26},
+      {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26}, {0x7ffffe7, 27},
+      {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27}, {0x7ffffeb, 27},
+      {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27}, {0x7ffffee, 27},
+      {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26}, {0x3fffffff, 30},
+  };
+
+  static constexpr size_t huffman_eos = 256;
+
+  struct StaticEntry
+  {
+    const char* name;
+    const char* value;
+  };
+
+  // RFC 7541, Appendix A. HPACK indices are 1-based.
+  static constexpr StaticEntry static_table[] = {
+      {":authority", ""},
+      {":method", "GET"},
+      {":method", "POST"},
+      {":path", "/"},
+      {":path", "/index.html"},
+      {":scheme", "http"},
+      {":scheme", "https"},
+      {":status", "200"},
+      {":status", "204"},
+      {":status", "206"},
+      {":status", "304"},
+      {":status", "400"},
+      {":status", "404"},
+      {":status", "500"},
+      {"accept-charset", ""},
+      {"accept-encoding", "gzip, deflate"},
+      {"accept-language", ""},
+      {"accept-ranges", ""},
+      {"accept", ""},
+      {"access-control-allow-origin", ""},
+      {"age", ""},
+      {"allow", ""},
+      {"authorization", ""},
+      {"cache-control", ""},
+      {"content-disposition", ""},
+      {"content-encoding", ""},
+      {"content-language", ""},
+      {"content-length", ""},
+      {"content-location", ""},
+      {"content-range", ""},
+      {"content-type", ""},
+      {"cookie", ""},
+      {"date", ""},
+      {"etag", ""},
+      {"expect", ""},
+      {"expires", ""},
+      {"from", ""},
+      {"host", ""},
+      {"if-match", ""},
+      {"if-modified-since", ""},
+      {"if-none-match", ""},
+      {"if-range", ""},
+      {"if-unmodified-since", ""},
+      {"last-modified", ""},
+      {"link", ""},
+      {"location", ""},
+      {"max-forwards", ""},
+      {"proxy-authenticate", ""},
+      {"proxy-authorization", ""},
+      {"range", ""},
+      {"referer", ""},
+      {"refresh", ""},
+      {"retry-after", ""},
+      {"server", ""},
+      {"set-cookie", ""},
+      {"strict-transport-security", ""},
+      {"transfer-encoding", ""},
+      {"user-agent", ""},
+      {"vary", ""},
+      {"via", ""},
+      {"www-authenticate", ""},
+  };
+
+  static constexpr size_t static_table_size =
+    sizeof(static_table) / sizeof(static_table[0]);
+
+  namespace detail
+  {
+    class HuffmanTree
+    {
+    private:
+      struct Node
+      {
+        std::array<int16_t, 2> next = {-1, -1};
+        int16_t symbol = -1;
+      };
+
+      std::vector<Node> nodes;
+
+    public:
+      HuffmanTree()
+      {
+        nodes.emplace_back();
+        for (size_t symbol = 0; symbol <= huffman_eos; ++symbol)
+        {
+          const auto& code = huffman_codes[symbol];
+          size_t node = 0;
+          for (int i = code.bits - 1; i >= 0; --i)
+          {
+            const auto bit = (code.code >> i) & 1;
+            if (nodes[node].next[bit] < 0)
+            {
+              nodes[node].next[bit] = nodes.size();
+              nodes.emplace_back();
+            }
+            node = nodes[node].next[bit];
+          }
+          nodes[node].symbol = symbol;
+        }
+      }
+
+      std::string decode(const uint8_t* data, size_t size) const
+      {
+        std::string s;
+        s.reserve(size * 8 / 5);
+
+        size_t node = 0;
+        // Bits read since the last complete symbol, which must be a prefix
+        // of EOS shorter than 8 bits at the end of the string
+        size_t pending_bits = 0;
+        bool pending_all_ones = true;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+          for (int shift = 7; shift >= 0; --shift)
+          {
+            const auto bit = (data[i] >> shift) & 1;
+            const auto next = nodes[node].next[bit];
+            if (next < 0)
+            {
+              throw CompressionError("Invalid Huffman code");
+            }
+            node = next;
+            ++pending_bits;
+            pending_all_ones = pending_all_ones && bit == 1;
+
+            const auto symbol = nodes[node].symbol;
+            if (symbol >= 0)
+            {
+              if ((size_t)symbol == huffman_eos)
+              {
+                throw CompressionError("Huffman-encoded string contains EOS");
+              }
+              s.push_back((char)symbol);
+              node = 0;
+              pending_bits = 0;
+              pending_all_ones = true;
+            }
+          }
+        }
+
+        if (pending_bits >= 8 || !pending_all_ones)
+        {
+          throw CompressionError("Invalid Huffman padding");
+        }
+
+        return s;
+      }
+    };
+
+    inline const HuffmanTree& huffman_tree()
+    {
+      static const HuffmanTree tree;
+      return tree;
+    }
+  }
+
+  inline std::string huffman_decode(const uint8_t* data, size_t size)
+  {
+    return detail::huffman_tree().decode(data, size);
+  }
+
+  inline size_t huffman_encoded_size(const std::string_view& s)
+  {
+    size_t bits = 0;
+    for (const auto c : s)
+    {
+      bits += huffman_codes[(uint8_t)c].bits;
+    }
+    return (bits + 7) / 8;
+  }
+
+  inline void huffman_encode(
+    const std::string_view& s, std::vector<uint8_t>& out)
+  {
+    uint64_t acc = 0;
+    size_t acc_bits = 0;
+    for (const auto c : s)
+    {
+      const auto& code = huffman_codes[(uint8_t)c];
+      acc = (acc << code.bits) | code.code;
+      acc_bits += code.bits;
+      while (acc_bits >= 8)
+      {
+        acc_bits -= 8;
+        out.push_back((uint8_t)(acc >> acc_bits));
+      }
+      acc &= ((uint64_t)1 << acc_bits) - 1;
+    }
+
+    if (acc_bits > 0)
+    {
+      // Pad with the most significant bits of EOS, which are all ones
+      out.push_back((uint8_t)((acc << (8 - acc_bits)) | (0xff >> acc_bits)));
+    }
+  }
+
+  /** Encode value with an N-bit prefix (RFC 7541, 5.1), in the low bits of a
+   * first byte whose high bits are set from flags.
+   */
+  inline void encode_integer(
+    uint64_t value,
+    uint8_t prefix_bits,
+    uint8_t flags,
+    std::vector<uint8_t>& out)
+  {
+    const uint64_t max_prefix = (1u << prefix_bits) - 1;
+    if (value < max_prefix)
+    {
+      out.push_back(flags | (uint8_t)value);
+      return;
+    }
+
+    out.push_back(flags | (uint8_t)max_prefix);
+    value -= max_prefix;
+    while (value >= 128)
+    {
+      out.push_back((uint8_t)(value % 128 + 128));
+      value /= 128;
+    }
+    out.push_back((uint8_t)value);
+  }
+
+  inline uint64_t decode_integer(
+    const uint8_t*& data, size_t& size, uint8_t prefix_bits)
+  {
+    if (size == 0)
+    {
+      throw CompressionError("Truncated integer");
+    }
+
+    const uint64_t max_prefix = (1u << prefix_bits) - 1;
+    uint64_t value = *data & max_prefix;
+    ++data;
+    --size;
+    if (value < max_prefix)
+    {
+      return value;
+    }
+
+    // No legitimate value needs more than 32 bits
+    for (size_t shift = 0; shift <= 28; shift += 7)
+    {
+      if (size == 0)
+      {
+        throw CompressionError("Truncated integer");
+      }
+
+      const auto b = *data;
+      ++data;
+      --size;
+      value += (uint64_t)(b & 0x7f) << shift;
+      if ((b & 0x80) == 0)
+      {
+        return value;
+      }
+    }
+
+    throw CompressionError("Integer is too large");
+  }
+
+  /** Encode a string literal (RFC 7541, 5.2), Huffman-encoded if that is
+   * shorter.
+   */
+  inline void encode_string(
+    const std::string_view& s, std::vector<uint8_t>& out)
+  {
+    const auto huffman_size = huffman_encoded_size(s);
+    if (huffman_size < s.size())
+    {
+      encode_integer(huffman_size, 7, 0x80, out);
+      huffman_encode(s, out);
+    }
+    else
+    {
+      encode_integer(s.size(), 7, 0, out);
+      out.insert(out.end(), s.begin(), s.end());
+    }
+  }
+
+  inline std::string decode_string(const uint8_t*& data, size_t& size)
+  {
+    if (size == 0)
+    {
+      throw CompressionError("Truncated string");
+    }
+
+    const bool huffman = (*data & 0x80) != 0;
+    const auto length = decode_integer(data, size, 7);
+    if (length > size)
+    {
+      throw CompressionError("Truncated string");
+    }
+
+    auto s = huffman ? huffman_decode(data, length) :
+                       std::string((const char*)data, length);
+    data += length;
+    size -= length;
+    return s;
+  }
+
+  /** Table of recently used header fields, shared by the encoder and decoder
+   * of each direction of a connection (RFC 7541, 2.3.2). Entries are evicted
+   * oldest first when the table would exceed its maximum size.
+   */
+  class DynamicTable
+  {
+  private:
+    // Newest first, so that entries[i] has HPACK index static_table_size+i+1
+    std::deque<HeaderField> entries;
+    size_t size = 0;
+    size_t max_size;
+
+    void evict_to(size_t target)
+    {
+      while (size > target)
+      {
+        size -= entry_size(entries.back());
+        entries.pop_back();
+      }
+    }
+
+  public:
+    static constexpr size_t entry_overhead = 32;
+
+    static size_t entry_size(const HeaderField& field)
+    {
+      return field.name.size() + field.value.size() + entry_overhead;
+    }
+
+    DynamicTable(size_t max_size_ = default_table_size) : max_size(max_size_)
+    {}
+
+    void add(HeaderField&& field)
+    {
+      const auto s = entry_size(field);
+      if (s > max_size)
+      {
+        // Adding an entry larger than the table empties it
+        entries.clear();
+        size = 0;
+        return;
+      }
+
+      evict_to(max_size - s);
+      entries.push_front(std::move(field));
+      size += s;
+    }
+
+    void set_max_size(size_t max_size_)
+    {
+      max_size = max_size_;
+      evict_to(max_size);
+    }
+
+    size_t get_max_size() const
+    {
+      return max_size;
+    }
+
+    size_t get_size() const
+    {
+      return size;
+    }
+
+    size_t get_count() const
+    {
+      return entries.size();
+    }
+
+    /// Entry i, where 0 is the newest
+    const HeaderField& at(size_t i) const
+    {
+      return entries.at(i);
+    }
+  };
+
+  class Decoder
+  {
+  private:
+    DynamicTable table;
+    const size_t max_header_list_size;
+
+    HeaderField get_indexed(uint64_t index) const
+    {
+      if (index == 0)
+      {
+        throw CompressionError("Invalid header field index 0");
+      }
+
+      if (index <= static_table_size)
+      {
+        const auto& entry = static_table[index - 1];
+        return {entry.name, entry.value};
+      }
+
+      const auto dynamic_index = index - static_table_size - 1;
+      if (dynamic_index >= table.get_count())
+      {
+        throw CompressionError(
+          "Header field index " + std::to_string(index) + " is out of range");
+      }
+      return table.at(dynamic_index);
+    }
+
+    HeaderField decode_literal(
+      const uint8_t*& data, size_t& size, uint8_t prefix_bits)
+    {
+      const auto name_index = decode_integer(data, size, prefix_bits);
+      HeaderField field;
+      field.name = name_index == 0 ? decode_string(data, size) :
+                                     get_indexed(name_index).name;
+      field.value = decode_string(data, size);
+      return field;
+    }
+
+  public:
+    Decoder(size_t max_header_list_size_) :
+      max_header_list_size(max_header_list_size_)
+    {}
+
+    /** Decode a complete header block, updating the dynamic table.
+     */
+    HeaderList decode(const uint8_t* data, size_t size)
+    {
+      HeaderList fields;
+      size_t list_size = 0;
+
+      while (size > 0)
+      {
+        const auto b = *data;
+        if ((b & 0x80) != 0)
+        {
+          // Indexed header field
+          fields.push_back(get_indexed(decode_integer(data, size, 7)));
+        }
+        else if ((b & 0xc0) == 0x40)
+        {
+          // Literal header field with incremental indexing
+          auto field = decode_literal(data, size, 6);
+          table.add(HeaderField(field));
+          fields.push_back(std::move(field));
+        }
+        else if ((b & 0xe0) == 0x20)
+        {
+          // Dynamic table size update, only permitted before any field
+          if (!fields.empty())
+          {
+            throw CompressionError(
+              "Dynamic table size update after a header field");
+          }
+
+          const auto new_size = decode_integer(data, size, 5);
+          if (new_size > default_table_size)
+          {
+            throw CompressionError(
+              "Dynamic table size update exceeds the advertised limit");
+          }
+          table.set_max_size(new_size);
+          continue;
+        }
+        else
+        {
+          // Literal header field without indexing (0000) or never indexed
+          // (0001)
+          fields.push_back(decode_literal(data, size, 4));
+        }
+
+        list_size += DynamicTable::entry_size(fields.back());
+        if (list_size > max_header_list_size)
+        {
+          throw CompressionError("Header list is too large");
+        }
+      }
+
+      return fields;
+    }
+  };
+
+  class Encoder
+  {
+  private:
+    DynamicTable table;
+
+    // Smallest table size set since the last header block, which must be
+    // signalled before the final size if they differ (RFC 7541, 4.2)
+    std::optional<size_t> smallest_size_update = std::nullopt;
+
+    // Values of these headers are unlikely to be repeated, so are not worth
+    // a place in the dynamic table
+    static bool is_indexable(const std::string_view& name)
+    {
+      return name != "content-length" && name != "date" &&
+        name != "x-ms-ccf-transaction-id";
+    }
+
+    // These must not be added to any intermediary's table either
+    static bool is_sensitive(const std::string_view& name)
+    {
+      return name == "authorization" || name == "set-cookie";
+    }
+
+    // Index of an entry with the same name and value, and failing that of an
+    // entry with the same name, or 0 if there is neither
+    std::pair<size_t, bool> find(const HeaderField& field) const
+    {
+      size_t name_index = 0;
+      for (size_t i = 0; i < static_table_size; ++i)
+      {
+        if (field.name == static_table[i].name)
+        {
+          if (field.value == static_table[i].value)
+          {
+            return {i + 1, true};
+          }
+          if (name_index == 0)
+          {
+            name_index = i + 1;
+          }
+        }
+      }
+
+      for (size_t i = 0; i < table.get_count(); ++i)
+      {
+        const auto& entry = table.at(i);
+        if (field.name == entry.name)
+        {
+          const auto index = static_table_size + i + 1;
+          if (field.value == entry.value)
+          {
+            return {index, true};
+          }
+          if (name_index == 0)
+          {
+            name_index = index;
+          }
+        }
+      }
+
+      return {name_index, false};
+    }
+
+  public:
+    /** Apply the peer's SETTINGS_HEADER_TABLE_SIZE. No more than the default
+     * size is used, even if the peer allows more.
+     */
+    void set_max_table_size(size_t max_size)
+    {
+      const auto new_size = std::min(max_size, default_table_size);
+      if (new_size == table.get_max_size())
+      {
+        return;
+      }
+
+      table.set_max_size(new_size);
+      smallest_size_update =
+        std::min(smallest_size_update.value_or(new_size), new_size);
+    }
+
+    /** Encode a complete header block, updating the dynamic table.
+     */
+    void encode(const HeaderList& fields, std::vector<uint8_t>& out)
+    {
+      if (smallest_size_update.has_value())
+      {
+        encode_integer(smallest_size_update.value(), 5, 0x20, out);
+        if (smallest_size_update.value() != table.get_max_size())
+        {
+          encode_integer(table.get_max_size(), 5, 0x20, out);
+        }
+        smallest_size_update = std::nullopt;
+      }
+
+      for (const auto& field : fields)
+      {
+        const auto [index, exact] = find(field);
+        if (exact)
+        {
+          encode_integer(index, 7, 0x80, out);
+          continue;
+        }
+
+        if (is_sensitive(field.name))
+        {
+          encode_integer(index, 4, 0x10, out);
+        }
+        else if (is_indexable(field.name))
+        {
+          encode_integer(index, 6, 0x40, out);
+          table.add(HeaderField(field));
+        }
+        else
+        {
+          encode_integer(index, 4, 0x00, out);
+        }
+
+        if (index == 0)
+        {
+          encode_string(field.name, out);
+        }
+        encode_string(field.value, out);
+      }
+    }
+
+    size_t get_table_size() const
+    {
+      return table.get_size();
+    }
+  };
+}
@@ -0,0 +1,1180 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+#pragma once
+
+#include "ds/latency_clock.h"
+#include "ds/logger.h"
+#include "ds/nonstd.h"
+#include "http_builder.h"
+#include "http2_hpack.h"
+
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <set>
+#include <string_view>
+#include <vector>
+
+// Server side of the HTTP/2 framing layer, as specified in RFC 7540
+namespace http2
+{
+  using StreamId = uint32_t;
+
+  static constexpr std::string_view client_preface =
+    "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+  static constexpr size_t frame_header_size = 9;
+
+  enum class FrameType : uint8_t
+  {
+    Data = 0x0,
+    Headers = 0x1,
+    Priority = 0x2,
+    RstStream = 0x3,
+    Settings = 0x4,
+    PushPromise = 0x5,
+    Ping = 0x6,
+    GoAway = 0x7,
+    WindowUpdate = 0x8,
+    Continuation = 0x9
+  };
+
+  namespace flags
+  {
+    static constexpr uint8_t END_STREAM = 0x1;
+    static constexpr uint8_t ACK = 0x1;
+    static constexpr uint8_t END_HEADERS = 0x4;
+    static constexpr uint8_t PADDED = 0x8;
+    static constexpr uint8_t PRIORITY = 0x20;
+  }
+
+  enum class ErrorCode : uint32_t
+  {
+    NoError = 0x0,
+    ProtocolError = 0x1,
+    InternalError = 0x2,
+    FlowControlError = 0x3,
+    SettingsTimeout = 0x4,
+    StreamClosed = 0x5,
+    FrameSizeError = 0x6,
+    RefusedStream = 0x7,
+    Cancel = 0x8,
+    CompressionError = 0x9,
+    ConnectError = 0xa,
+    EnhanceYourCalm = 0xb,
+    InadequateSecurity = 0xc,
+    Http11Required = 0xd
+  };
+
+  enum class SettingId : uint16_t
+  {
+    HeaderTableSize = 0x1,
+    EnablePush = 0x2,
+    MaxConcurrentStreams = 0x3,
+    InitialWindowSize = 0x4,
+    MaxFrameSize = 0x5,
+    MaxHeaderListSize = 0x6
+  };
+
+  static constexpr uint32_t default_window_size = 65535;
+  static constexpr int64_t max_window_size = 0x7fffffff;
+  static constexpr uint32_t default_max_frame_size = 16384;
+  static constexpr uint32_t max_max_frame_size = 0xffffff;
+
+  class StreamRequestProcessor
+  {
+  public:
+    virtual ~StreamRequestProcessor() = default;
+
+    /** Called once the request on a stream is complete. begin_time is when
+     * its first frame was received.
+     */
+    virtual void handle_stream_request(
+      StreamId stream_id,
+      llhttp_method method,
+      const std::string_view& url,
+      http::HeaderMap&& headers,
+      std::vector<uint8_t>&& body,
+      std::optional<ds::LatencyClock::time_point> begin_time) = 0;
+  };
+
+  /** State of a single HTTP/2 connection, independent of its transport.
+   *
+   * Bytes received from the client are passed to recv(), and complete
+   * requests are passed to the StreamRequestProcessor. Their responses may be
+   * sent in any order with send_response(). Bytes to be sent to the client
+   * accumulate until collected with take_output().
+   *
+   * Response bodies are sent within the client's flow control windows, and
+   * the remainder is queued until the client extends them. Request bodies are
+   * buffered until complete, and the client's windows are only replenished
+   * once they have been passed on or discarded, so the data buffered for a
+   * connection is bounded.
+   */
+  class ServerSession
+  {
+  public:
+    // Streams opened beyond this are refused. Requests whose streams were
+    // reset by the client still count until their response is produced.
+    static constexpr uint32_t max_concurrent_streams = 100;
+    // Advertised for each stream, and also the largest request body
+    // accepted. Stream windows are never extended, since a request's body
+    // is only passed on once it is complete.
+    static constexpr uint32_t initial_window_size = 1 << 20;
+    // Shared by the request bodies of all streams, and extended as they are
+    // passed on or discarded
+    static constexpr uint32_t connection_window_size = 4 << 20;
+    static constexpr size_t max_header_list_size = 64 * 1024;
+
+  private:
+    struct ConnectionError : public std::runtime_error
+    {
+      ErrorCode code;
+
+      ConnectionError(ErrorCode code_, const std::string& what) :
+        std::runtime_error(what),
+        code(code_)
+      {}
+    };
+
+    struct StreamError : public std::runtime_error
+    {
+      ErrorCode code;
+
+      StreamError(ErrorCode code_, const std::string& what) :
+        std::runtime_error(what),
+        code(code_)
+      {}
+    };
+
+    struct FrameHeader
+    {
+      uint32_t length;
+      FrameType type;
+      uint8_t flags;
+      StreamId stream_id;
+    };
+
+    struct Stream
+    {
+      std::optional<ds::LatencyClock::time_point> begin_time;
+
+      llhttp_method method = HTTP_GET;
+      std::string url;
+      http::HeaderMap headers;
+      std::vector<uint8_t> body;
+
+      // Set once END_STREAM is received, when the request is complete
+      bool end_stream_received = false;
+
+      int64_t recv_window;
+      int64_t send_window;
+
+      // Response body not yet sent, once the response headers have been sent
+      std::optional<std::vector<uint8_t>> response_body = std::nullopt;
+      size_t response_body_sent = 0;
+    };
+
+    StreamRequestProcessor& proc;
+
+    std::vector<uint8_t> input;
+    std::vector<uint8_t> output;
+
+    bool preface_received = false;
+    bool settings_received = false;
+    bool goaway_sent = false;
+
+    std::map<StreamId, Stream> streams;
+    StreamId last_stream_id = 0;
+
+    // Streams reset by the client after their request was passed on, but
+    // before its response was produced. The request is still being processed,
+    // so counts towards the concurrency limit until send_response() is called.
+    std::set<StreamId> abandoned_requests;
+
+    // Header block fragments, while awaiting CONTINUATION frames
+    std::optional<StreamId> continuation_stream_id = std::nullopt;
+    bool continuation_end_stream = false;
+    std::vector<uint8_t> header_block;
+
+    hpack::Decoder decoder{max_header_list_size};
+    hpack::Encoder encoder;
+
+    // Client's settings
+    uint32_t peer_initial_window_size = default_window_size;
+    uint32_t peer_max_frame_size = default_max_frame_size;
+
+    int64_t connection_recv_window = default_window_size;
+    int64_t connection_send_window = default_window_size;
+
+    // Received bytes which have since been passed on or discarded, and have
+    // not yet been returned to the connection window
+    int64_t connection_recv_released = 0;
+
+    static uint32_t read_u32(const uint8_t* data)
+    {
+      return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
+        ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+    }
+
+    static void write_u32(std::vector<uint8_t>& out, uint32_t v)
+    {
+      out.push_back(v >> 24);
+      out.push_back(v >> 16);
+      out.push_back(v >> 8);
+      out.push_back(v);
+    }
+
+    void write_frame(
+      FrameType type,
+      uint8_t frame_flags,
+      StreamId stream_id,
+      const uint8_t* payload,
+      size_t size)
+    {
+      output.push_back(size >> 16);
+      output.push_back(size >> 8);
+      output.push_back(size);
+      output.push_back((uint8_t)type);
+      output.push_back(frame_flags);
+      write_u32(output, stream_id);
+      output.insert(output.end(), payload, payload + size);
+    }
+
+    void write_settings()
+    {
+      std::vector<uint8_t> payload;
+      auto add_setting = [&payload](SettingId id, uint32_t value) {
+        payload.push_back((uint16_t)id >> 8);
+        payload.push_back((uint16_t)id);
+        write_u32(payload, value);
+      };
+      add_setting(SettingId::MaxConcurrentStreams, max_concurrent_streams);
+      add_setting(SettingId::InitialWindowSize, initial_window_size);
+      add_setting(SettingId::MaxHeaderListSize, max_header_list_size);
+      write_frame(
+        FrameType::Settings, 0, 0, payload.data(), payload.size());
+
+      // The connection window is not affected by SETTINGS, so is extended
+      // explicitly
+      write_window_update(0, connection_window_size - default_window_size);
+      connection_recv_window = connection_window_size;
+    }
+
+    void write_window_update(StreamId stream_id, uint32_t increment)
+    {
+      std::vector<uint8_t> payload;
+      write_u32(payload, increment);
+      write_frame(
+        FrameType::WindowUpdate, 0, stream_id, payload.data(), payload.size());
+    }
+
+    void write_rst_stream(StreamId stream_id, ErrorCode code)
+    {
+      std::vector<uint8_t> payload;
+      write_u32(payload, (uint32_t)code);
+      write_frame(
+        FrameType::RstStream, 0, stream_id, payload.data(), payload.size());
+    }
+
+    void write_goaway(ErrorCode code, const std::string& debug_data)
+    {
+      std::vector<uint8_t> payload;
+      write_u32(payload, last_stream_id);
+      write_u32(payload, (uint32_t)code);
+      payload.insert(payload.end(), debug_data.begin(), debug_data.end());
+      write_frame(FrameType::GoAway, 0, 0, payload.data(), payload.size());
+      goaway_sent = true;
+    }
+
+    void reset_stream(StreamId stream_id, ErrorCode code)
+    {
+      write_rst_stream(stream_id, code);
+      close_stream(stream_id);
+    }
+
+    // Forget a stream which is closed before its response is sent, releasing
+    // its buffered request body
+    void close_stream(StreamId stream_id)
+    {
+      auto it = streams.find(stream_id);
+      if (it == streams.end())
+      {
+        return;
+      }
+
+      auto& stream = it->second;
+      if (!stream.end_stream_received)
+      {
+        release_recv_window(stream.body.size());
+      }
+      else if (!stream.response_body.has_value())
+      {
+        abandoned_requests.insert(stream_id);
+      }
+      streams.erase(it);
+    }
+
+    // Payload of a frame which may be padded, without its padding
+    static std::pair<const uint8_t*, size_t> remove_padding(
+      const FrameHeader& header, const uint8_t* payload)
+    {
+      size_t size = header.length;
+      if ((header.flags & flags::PADDED) == 0)
+      {
+        return {payload, size};
+      }
+
+      if (size < 1 || payload[0] >= size)
+      {
+        throw ConnectionError(
+          ErrorCode::ProtocolError, "Padding exceeds frame payload");
+      }
+      const auto pad_length = payload[0];
+      return {payload + 1, size - 1 - pad_length};
+    }
+
+    // Charge a DATA frame's payload to one of the client's windows
+    static void consume_recv_window(int64_t& window, uint32_t length)
+    {
+      window -= length;
+      if (window < 0)
+      {
+        throw ConnectionError(
+          ErrorCode::FlowControlError, "Flow control window exceeded");
+      }
+    }
+
+    // Return bytes which have been passed on or discarded to the connection
+    // window, once they amount to half of it
+    void release_recv_window(size_t length)
+    {
+      connection_recv_released += length;
+      if (connection_recv_released >= connection_window_size / 2)
+      {
+        write_window_update(0, connection_recv_released);
+        connection_recv_window += connection_recv_released;
+        connection_recv_released = 0;
+      }
+    }
+
+    void handle_data(const FrameHeader& header, const uint8_t* payload)
+    {
+      if (header.stream_id == 0)
+      {
+        throw ConnectionError(
+          ErrorCode::ProtocolError, "DATA frame on stream 0");
+      }
+
+      // Flow control covers the whole payload, including padding, and
+      // applies to the connection even if the stream is closed
+      consume_recv_window(connection_recv_window, header.length);
+
+      auto it = streams.find(header.stream_id);
+      if (it == streams.end())
+      {
+        if (header.stream_id > last_stream_id)
+        {
+          throw ConnectionError(
+            ErrorCode::ProtocolError, "DATA frame on idle stream");
+        }
+        release_recv_window(header.length);
+        throw StreamError(
+          ErrorCode::StreamClosed, "DATA frame on closed stream");
+      }
+
+      auto& stream = it->second;
+      if (stream.end_stream_received)
+      {
+        release_recv_window(header.length);
+        throw StreamError(
+          ErrorCode::StreamClosed, "DATA frame after END_STREAM");
+      }
+
+      // The stream window is never extended, so also caps the body size
+      consume_recv_window(stream.recv_window, header.length);
+
+      const auto [data, size] = remove_padding(header, payload);
+      stream.body.insert(stream.body.end(), data, data + size);
+      release_recv_window(header.length - size);
+
+      if ((header.flags & flags::END_STREAM) != 0)
+      {
+        complete_request(header.stream_id, stream);
+      }
+    }
+
+    void handle_headers(const FrameHeader& header, const uint8_t* payload)
+    {
+      if (header.stream_id == 0 || header.stream_id % 2 == 0)
+      {
+        throw ConnectionError(
+          ErrorCode::ProtocolError,
+          "HEADERS frame on stream which may not be opened by client");
+      }
+
+      auto [data, size] = remove_padding(header, payload);
+      if ((header.flags & flags::PRIORITY) != 0)
+      {
+        // Stream dependency and weight, which are ignored
+        if (size < 5)
+        {
+          throw ConnectionError(
+            ErrorCode::FrameSizeError, "HEADERS frame too short for priority");
+        }
+        data += 5;
+        size -= 5;
+      }
+
+      header_block.assign(data, data + size);
+      continuation_end_stream = (header.flags & flags::END_STREAM) != 0;
+      if ((header.flags & flags::END_HEADERS) != 0)
+      {
+        handle_header_block(header.stream_id);
+      }
+      else
+      {
+        continuation_stream_id = header.stream_id;
+      }
+    }
+
+    void handle_continuation(const FrameHeader& header, const uint8_t* payload)
+    {
+      if (
+        !continuation_stream_id.has_value() ||
+        continuation_stream_id.value() != header.stream_id)
+      {
+        throw ConnectionError(
+          ErrorCode::ProtocolError, "Unexpected CONTINUATION frame");
+      }
+
+      if (header_block.size() + header.length > max_header_list_size)
+      {
+        throw ConnectionError(
+          ErrorCode::EnhanceYourCalm, "Header block is too large");
+      }
+
+      header_block.insert(
+        header_block.end(), payload, payload + header.length);
+      if ((header.flags & flags::END_HEADERS) != 0)
+      {
+        continuation_stream_id = std::nullopt;
+        handle_header_block(header.stream_id);
+      }
+    }
+
+    void handle_header_block(StreamId stream_id)
+    {
+      // Decoded even if the stream is to be refused, to keep the dynamic
+      // table in step with the client's
+      hpack::HeaderList fields;
+      try
+      {
+        fields = decoder.decode(header_block.data(), header_block.size());
+      }
+      catch (const hpack::CompressionError& e)
+      {
+        throw ConnectionError(ErrorCode::CompressionError, e.what());
+      }
+      header_block.clear();
+
+      auto it = streams.find(stream_id);
+      if (it != streams.end())
+      {
+        // Trailers, which must end the stream and are otherwise ignored
+        auto& stream = it->second;
+        if (stream.end_stream_received)
+        {
+          throw StreamError(
+            ErrorCode::StreamClosed, "HEADERS frame after END_STREAM");
+        }
+        if (!continuation_end_stream)
+        {
+          throw StreamError(
+            ErrorCode::ProtocolError, "Trailers must end the stream");
+        }
+        complete_request(stream_id, stream);
+        return;
+      }
+
+      if (stream_id <= last_stream_id)
+      {
+        throw ConnectionError(
+          ErrorCode::StreamClosed, "HEADERS frame on closed stream");
+      }
+      last_stream_id = stream_id;
+
+      if (
+        streams.size() + abandoned_requests.size() >= max_concurrent_streams)
+      {
+        write_rst_stream(stream_id, ErrorCode::RefusedStream);
+        return;
+      }
+
+      Stream stream;
+      stream.begin_time = ds::LatencyClock::now();
+      stream.recv_window = initial_window_size;
+      stream.send_window = peer_initial_window_size;
+      parse_request_headers(std::move(fields), stream);
+
+      auto inserted = streams.emplace(stream_id, std::move(stream)).first;
+      if (continuation_end_stream)
+      {
+        complete_request(stream_id, inserted->second);
+      }
+    }
+
+    static bool is_connection_specific(const std::string& name)
+    {
+      return name == "connection" || name == "keep-alive" ||
+        name == "proxy-connection" || name == "transfer-encoding" ||
+        name == "upgrade";
+    }
+
+    // Malformed requests (RFC 7540, 8.1.2.6) are reset with a stream error
+    void parse_request_headers(hpack::HeaderList&& fields, Stream& stream)
+    {
+      std::optional<std::string> method, scheme, path, authority;
+      bool regular_seen = false;
+
+      for (auto& field : fields)
+      {
+        if (std::any_of(field.name.begin(), field.name.end(), [](char c) {
+              return c >= 'A' && c <= 'Z';
+            }))
+        {
+          throw StreamError(
+            ErrorCode::ProtocolError, "Header field names must be lowercase");
+        }
+
+        if (!field.name.empty() && field.name[0] == ':')
+        {
+          if (regular_seen)
+          {
+            throw StreamError(
+              ErrorCode::ProtocolError,
+              "Pseudo-header field after regular header field");
+          }
+
+          std::optional<std::string>* target = nullptr;
+          if (field.name == ":method")
+          {
+            target = &method;
+          }
+          else if (field.name == ":scheme")
+          {
+            target = &scheme;
+          }
+          else if (field.name == ":path")
+          {
+            target = &path;
+          }
+          else if (field.name == ":authority")
+          {
+            target = &authority;
+          }
+
+          if (target == nullptr || target->has_value())
+          {
+            throw StreamError(
+              ErrorCode::ProtocolError,
+              fmt::format("Invalid pseudo-header field {}", field.name));
+          }
+          *target = std::move(field.value);
+          continue;
+        }
+
+        regular_seen = true;
+        if (
+          is_connection_specific(field.name) ||
+          (field.name == "te" && field.value != "trailers"))
+        {
+          throw StreamError(
+            ErrorCode::ProtocolError,
+            fmt::format("Connection-specific header field {}", field.name));
+        }
+
+        // Repeated fields are combined, as HTTP/1.1 would have received them
+        auto [it, inserted] =
+          stream.headers.emplace(field.name, std::move(field.value));
+        if (!inserted)
+        {
+          it->second += field.name == "cookie" ? "; " : ", ";
+          it->second += field.value;
+        }
+      }
+
+      if (!method.has_value() || !scheme.has_value() || !path.has_value())
+      {
+        throw StreamError(
+          ErrorCode::ProtocolError,
+          "Request is missing :method, :scheme or :path");
+      }
+
+      try
+      {
+        stream.method = http::http_method_from_str(method->c_str());
+      }
+      catch (const std::logic_error& e)
+      {
+        throw StreamError(ErrorCode::ProtocolError, e.what());
+      }
+      stream.url = std::move(path.value());
+
+      if (authority.has_value())
+      {
+        stream.headers.emplace(http::headers::HOST, authority.value());
+      }
+    }
+
+    void complete_request(StreamId stream_id, Stream& stream)
+    {
+      stream.end_stream_received = true;
+      release_recv_window(stream.body.size());
+      proc.handle_stream_request(
+        stream_id,
+        stream.method,
+        stream.url,
+        std::move(stream.headers),
+        std::move(stream.body),
+        stream.begin_time);
+    }
+
+    void handle_priority(const FrameHeader& header)
+    {
+      if (header.stream_id == 0)
+      {
+        throw ConnectionError(
+          ErrorCode::ProtocolError, "PRIORITY frame on stream 0");
+      }
+      if (header.length != 5)
+      {
+        throw StreamError(
+          ErrorCode::FrameSizeError, "PRIORITY frame has invalid length");
+      }
+    }
+
+    void handle_rst_stream(const FrameHeader& header)
+    {
+      if (header.stream_id == 0)
+      {
+        throw ConnectionError(
+          ErrorCode::ProtocolError, "RST_STREAM frame on stream 0");
+      }
+      if (header.length != 4)
+      {
+        throw ConnectionError(
+          ErrorCode::FrameSizeError, "RST_STREAM frame has invalid length");
+      }
+      if (header.stream_id > last_stream_id)
+      {
+        throw ConnectionError(
+          ErrorCode::ProtocolError, "RST_STREAM frame on idle stream");
+      }
+
+      LOG_TRACE_FMT("Stream {} reset by client", header.stream_id);
+      // Any response produced later is discarded
+      close_stream(header.stream_id);
+    }
+
+    void handle_settings(const FrameHeader& header, const uint8_t* payload)
+    {
+      if (header.stream_id != 0)
+      {
+        throw ConnectionError(
+          ErrorCode::ProtocolError, "SETTINGS frame on stream other than 0");
+      }
+
+      if ((header.flags & flags::ACK) != 0)
+      {
+        if (header.length != 0)
+        {
+          throw ConnectionError(
+            ErrorCode::FrameSizeError, "SETTINGS ACK frame has a payload");
+        }
+        return;
+      }
+
+      if (header.length % 6 != 0)
+      {
+        throw ConnectionError(
+          ErrorCode::FrameSizeError, "SETTINGS frame has invalid length");
+      }
+
+      for (size_t i = 0; i < header.length; i += 6)
+      {
+        const auto id =
+          (SettingId)(((uint16_t)payload[i] << 8) | payload[i + 1]);
+        const auto value = read_u32(payload + i + 2);
+        switch (id)
+        {
+          case SettingId::HeaderTableSize:
+          {
+            encoder.set_max_table_size(value);
+            break;
+          }
+
+          case SettingId::EnablePush:
+          {
+            // Server push is never used
+            if (value > 1)
+            {
+              throw ConnectionError(
+                ErrorCode::ProtocolError, "Invalid SETTINGS_ENABLE_PUSH");
+            }
+            break;
+          }
+
+          case SettingId::InitialWindowSize:
+          {
+            if (value > max_window_size)
+            {
+              throw ConnectionError(
+                ErrorCode::FlowControlError,
+                "Invalid SETTINGS_INITIAL_WINDOW_SIZE");
+            }
+
+            // Applies to the windows of all open streams
+            const auto delta = (int64_t)value - peer_initial_window_size;
+            for (auto& [id, stream] : streams)
+            {
+              stream.send_window += delta;
+              if (stream.send_window > max_window_size)
+              {
+                throw ConnectionError(
+                  ErrorCode::FlowControlError, "Stream window overflow");
+              }
+            }
+            peer_initial_window_size = value;
+            break;
+          }
+
+          case SettingId::MaxFrameSize:
+          {
+            if (value < default_max_frame_size || value > max_max_frame_size)
+            {
+              throw ConnectionError(
+                ErrorCode::ProtocolError, "Invalid SETTINGS_MAX_FRAME_SIZE");
+            }
+            peer_max_frame_size = value;
+            break;
+          }
+
+          default:
+          {
+            // Limits on streams opened by the server, and unknown settings
+            break;
+          }
+        }
+      }
+
+      write_frame(FrameType::Settings, flags::ACK, 0, nullptr, 0);
+      send_pending_data();
+    }
+
+    void handle_ping(const FrameHeader& header, const uint8_t* payload)
+    {
+      if (header.stream_id != 0)
+      {
+        throw ConnectionError(
+          ErrorCode::ProtocolError, "PING frame on stream other than 0");
+      }
+      if (header.length != 8)
+      {
+        throw ConnectionError(
+          ErrorCode::FrameSizeError, "PING frame has invalid length");
+      }
+
+      if ((header.flags & flags::ACK) == 0)
+      {
+        write_frame(FrameType::Ping, flags::ACK, 0, payload, header.length);
+      }
+    }
+
+    void handle_goaway(const FrameHeader& header)
+    {
+      if (header.stream_id != 0)
+      {
+        throw ConnectionError(
+          ErrorCode::ProtocolError, "GOAWAY frame on stream other than 0");
+      }
+      if (header.length < 8)
+      {
+        throw ConnectionError(
+          ErrorCode::FrameSizeError, "GOAWAY frame has invalid length");
+      }
+
+      // Requests already received are still answered
+      LOG_TRACE_FMT("GOAWAY received");
+    }
+
+    void handle_window_update(const FrameHeader& header, const uint8_t* payload)
+    {
+      if (header.length != 4)
+      {
+        throw ConnectionError(
+          ErrorCode::FrameSizeError, "WINDOW_UPDATE frame has invalid length");
+      }
+
+      const auto increment = read_u32(payload) & 0x7fffffff;
+      if (header.stream_id == 0)
+      {
+        if (increment == 0)
+        {
+          throw ConnectionError(
+            ErrorCode::ProtocolError, "WINDOW_UPDATE with 0 increment");
+        }
+        connection_send_window += increment;
+        if (connection_send_window > max_window_size)
+        {
+          throw ConnectionError(
+            ErrorCode::FlowControlError, "Connection window overflow");
+        }
+      }
+      else
+      {
+        auto it = streams.find(header.stream_id);
+        if (it == streams.end())
+        {
+          if (header.stream_id > last_stream_id)
+          {
+            throw ConnectionError(
+              ErrorCode::ProtocolError, "WINDOW_UPDATE frame on idle stream");
+          }
+          // May arrive shortly after the stream has closed
+          return;
+        }
+
+        if (increment == 0)
+        {
+          throw StreamError(
+            ErrorCode::ProtocolError, "WINDOW_UPDATE with 0 increment");
+        }
+        it->second.send_window += increment;
+        if (it->second.send_window > max_window_size)
+        {
+          throw StreamError(
+            ErrorCode::FlowControlError, "Stream window overflow");
+        }
+      }
+
+      send_pending_data();
+    }
+
+    void handle_frame(const FrameHeader& header, const uint8_t* payload)
+    {
+      if (
+        continuation_stream_id.has_value() &&
+        header.type != FrameType::Continuation)
+      {
+        throw ConnectionError(
+          ErrorCode::ProtocolError, "Expected CONTINUATION frame");
+      }
+
+      if (!settings_received)
+      {
+        if (header.type != FrameType::Settings)
+        {
+          throw ConnectionError(
+            ErrorCode::ProtocolError, "Client preface must end with SETTINGS");
+        }
+        settings_received = true;
+      }
+
+      try
+      {
+        switch (header.type)
+        {
+          case FrameType::Data:
+            handle_data(header, payload);
+            break;
+          case FrameType::Headers:
+            handle_headers(header, payload);
+            break;
+          case FrameType::Priority:
+            handle_priority(header);
+            break;
+          case FrameType::RstStream:
+            handle_rst_stream(header);
+            break;
+          case FrameType::Settings:
+            handle_settings(header, payload);
+            break;
+          case FrameType::PushPromise:
+            throw ConnectionError(
+              ErrorCode::ProtocolError, "PUSH_PROMISE sent by client");
+          case FrameType::Ping:
+            handle_ping(header, payload);
+            break;
+          case FrameType::GoAway:
+            handle_goaway(header);
+            break;
+          case FrameType::WindowUpdate:
+            handle_window_update(header, payload);
+            break;
+          case FrameType::Continuation:
+            handle_continuation(header, payload);
+            break;
+          default:
+            // Unknown frame types are ignored
+            break;
+        }
+      }
+      catch (const StreamError& e)
+      {
+        LOG_DEBUG_FMT("Resetting stream {}: {}", header.stream_id, e.what());
+        reset_stream(header.stream_id, e.code);
+      }
+    }
+
+    // Send as much of each stream's pending response body as flow control
+    // allows, closing the streams whose responses are complete
+    void send_pending_data()
+    {
+      for (auto it = streams.begin(); it != streams.end();)
+      {
+        auto& stream = it->second;
+        if (!stream.response_body.has_value())
+        {
+          ++it;
+          continue;
+        }
+
+        const auto& body = stream.response_body.value();
+        while (stream.response_body_sent < body.size())
+        {
+          const auto available =
+            std::min(connection_send_window, stream.send_window);
+          if (available <= 0)
+          {
+            break;
+          }
+
+          const auto size = std::min(
+            {(size_t)available,
+             (size_t)peer_max_frame_size,
+             body.size() - stream.response_body_sent});
+          const bool last = stream.response_body_sent + size == body.size();
+          write_frame(
+            FrameType::Data,
+            last ? flags::END_STREAM : 0,
+            it->first,
+            body.data() + stream.response_body_sent,
+            size);
+          stream.response_body_sent += size;
+          stream.send_window -= size;
+          connection_send_window -= size;
+        }
+
+        if (stream.response_body_sent == body.size())
+        {
+          it = streams.erase(it);
+        }
+        else
+        {
+          ++it;
+        }
+      }
+    }
+
+  public:
+    ServerSession(StreamRequestProcessor& proc_) : proc(proc_)
+    {
+      write_settings();
+    }
+
+    /** Process bytes received from the client, starting with the client
+     * preface. Protocol errors are reported to the client with GOAWAY, after
+     * which further bytes are ignored.
+     */
+    void recv(const uint8_t* data, size_t size)
+    {
+      if (goaway_sent)
+      {
+        return;
+      }
+
+      input.insert(input.end(), data, data + size);
+
+      size_t offset = 0;
+      try
+      {
+        if (!preface_received)
+        {
+          const auto n = std::min(input.size(), client_preface.size());
+          if (std::memcmp(input.data(), client_preface.data(), n) != 0)
+          {
+            throw ConnectionError(
+              ErrorCode::ProtocolError, "Invalid client preface");
+          }
+          if (n < client_preface.size())
+          {
+            return;
+          }
+          offset = client_preface.size();
+          preface_received = true;
+        }
+
+        while (input.size() - offset >= frame_header_size)
+        {
+          const auto h = input.data() + offset;
+          FrameHeader header;
+          header.length =
+            ((uint32_t)h[0] << 16) | ((uint32_t)h[1] << 8) | (uint32_t)h[2];
+          header.type = (FrameType)h[3];
+          header.flags = h[4];
+          header.stream_id = read_u32(h + 5) & 0x7fffffff;
+
+          // Our SETTINGS_MAX_FRAME_SIZE is the default
+          if (header.length > default_max_frame_size)
+          {
+            throw ConnectionError(
+              ErrorCode::FrameSizeError,
+              fmt::format("Frame of {} bytes is too large", header.length));
+          }
+
+          if (input.size() - offset < frame_header_size + header.length)
+          {
+            break;
+          }
+
+          handle_frame(header, h + frame_header_size);
+          offset += frame_header_size + header.length;
+        }
+      }
+      catch (const ConnectionError& e)
+      {
+        LOG_DEBUG_FMT("HTTP/2 connection error: {}", e.what());
+        write_goaway(e.code, e.what());
+        input.clear();
+        return;
+      }
+
+      input.erase(input.begin(), input.begin() + offset);
+    }
+
+    /** Send the response to the request received on stream_id. Dropped if
+     * the client has since reset the stream. Must be called exactly once for
+     * each request passed to the StreamRequestProcessor.
+     */
+    void send_response(
+      StreamId stream_id,
+      http_status status,
+      const http::HeaderMap& headers,
+      std::vector<uint8_t>&& body)
+    {
+      auto it = streams.find(stream_id);
+      if (it == streams.end() || !it->second.end_stream_received)
+      {
+        abandoned_requests.erase(stream_id);
+        LOG_DEBUG_FMT("Dropping response to closed stream {}", stream_id);
+        return;
+      }
+
+      hpack::HeaderList fields;
+      fields.push_back({":status", std::to_string(status)});
+      for (const auto& [name, value] : headers)
+      {
+        auto lower_name = name;
+        nonstd::to_lower(lower_name);
+        if (!is_connection_specific(lower_name))
+        {
+          fields.push_back({std::move(lower_name), value});
+        }
+      }
+
+      std::vector<uint8_t> block;
+      encoder.encode(fields, block);
+
+      // The header block is split into frames of at most the client's maximum
+      // frame size, which must be sent contiguously
+      const bool end_stream = body.empty();
+      size_t sent = 0;
+      do
+      {
+        const auto size =
+          std::min(block.size() - sent, (size_t)peer_max_frame_size);
+        const bool first = sent == 0;
+        const bool last = sent + size == block.size();
+        uint8_t frame_flags = last ? flags::END_HEADERS : 0;
+        if (first && end_stream)
+        {
+          frame_flags |= flags::END_STREAM;
+        }
+        write_frame(
+          first ? FrameType::Headers : FrameType::Continuation,
+          frame_flags,
+          stream_id,
+          block.data() + sent,
+          size);
+        sent += size;
+      } while (sent < block.size());
+
+      it->second.response_body = std::move(body);
+      send_pending_data();
+    }
+
+    /// Bytes to be sent to the client
+    std::vector<uint8_t> take_output()
+    {
+      std::vector<uint8_t> out;
+      std::swap(out, output);
+      return out;
+    }
+
+    /// True once GOAWAY has been sent, after which the connection should be
+    /// closed once the output has been sent
+    bool is_closed() const
+    {
+      return goaway_sent;
+    }
+
+    size_t get_open_streams() const
+    {
+      return streams.size();
+    }
+
+    /// Requests on streams reset by the client, whose responses have not yet
+    /// been produced
+    size_t get_abandoned_requests() const
+    {
+      return abandoned_requests.size();
+    }
+  };
+
+  // Requests received on HTTP/2 streams are answered through a session id
+  // which identifies both the connection and the stream, so that responses
+  // which are produced asynchronously reach the right stream. These ids have
+  // bit 62 set, and so are distinct from those of host-assigned sessions and
+  // of client sessions created inside the enclave.
+  static constexpr size_t stream_session_flag = 1ull << 62;
+  static constexpr size_t stream_session_shift = 30;
+
+  inline size_t make_stream_session_id(size_t session_id, StreamId stream_id)
+  {
+    if (session_id >= (1ull << 32))
+    {
+      throw std::logic_error(
+        fmt::format("Session id {} is too large for streams", session_id));
+    }
+
+    // Client-initiated stream ids are odd, and less than 2^31
+    return stream_session_flag | (session_id << stream_session_shift) |
+      (stream_id >> 1);
+  }
+
+  inline std::optional<std::pair<size_t, StreamId>>
+  parse_stream_session_id(size_t id)
+  {
+    if ((id >> 62) != 1)
+    {
+      return std::nullopt;
+    }
+
+    const auto mask = (1ull << stream_session_shift) - 1;
+    return std::make_pair(
+      (id & ~stream_session_flag) >> stream_session_shift,
+      (StreamId)(((id & mask) << 1) | 1));
+  }
+}
@@ -5,9 +5,12 @@
 #include "ds/logger.h"
 #include "enclave/client_endpoint.h"
 #include "enclave/rpc_map.h"
+#include "http2_session.h"
 #include "http_parser.h"
 #include "http_rpc_context.h"
 
+#include <cstring>
+
 namespace http
 {
   class HTTPEndpoint : public enclave::TLSEndpoint
@@ -24,6 +27,12 @@ namespace http
       p(p_)
     {}
 
+    // Parses data read from the connection
+    virtual void parse(const uint8_t* data, size_t size)
+    {
+      p.execute(data, size);
+    }
+
   public:
     static void recv_cb(std::unique_ptr<threading::Tmsg<SendRecvMsg>> msg)
     {
@@ -37,8 +46,7 @@ namespace http
       msg->data.self = this->shared_from_this();
       msg->data.data.assign(data, data + size);
 
-      threading::ThreadMessaging::thread_messaging.add_task(
-        execution_thread, std::move(msg));
+      add_session_task(std::move(msg));
     }
 
     void recv_(const uint8_t* data_, size_t size_)
@@ -63,7 +71,7 @@ namespace http
 
         try
         {
-          p.execute(data, n_read);
+          parse(data, n_read);
 
           // Used all provided bytes - check if more are available
           n_read = read(buf.data(), buf.size(), false);
@@ -90,7 +98,9 @@ namespace http
     }
   };
 
-  class HTTPServerEndpoint : public HTTPEndpoint, public http::RequestProcessor
+  class HTTPServerEndpoint : public HTTPEndpoint,
+                             public http::RequestProcessor,
+                             public http2::StreamRequestProcessor
   {
   private:
     http::RequestParser request_parser;
@@ -101,7 +111,231 @@ namespace http
     size_t session_id;
     size_t request_index = 0;
 
+    // Clients select HTTP/2 either through ALPN or with prior knowledge. In
+    // both cases, they then start the connection with the HTTP/2 preface,
+    // which is not a valid HTTP/1.1 request, so the protocol is detected from
+    // the first bytes received.
+    enum class Protocol
+    {
+      Unknown,
+      Http1,
+      Http2
+    };
+
+    Protocol protocol = Protocol::Unknown;
+    std::vector<uint8_t> preface_buf;
+    std::unique_ptr<http2::ServerSession> h2_session;
+    bool h2_closing = false;
+
+    struct StreamRequestMsg
+    {
+      std::shared_ptr<Endpoint> self;
+      http2::StreamId stream_id;
+      std::shared_ptr<enclave::RpcContext> rpc_ctx;
+    };
+
+    struct StreamResponseMsg
+    {
+      std::shared_ptr<Endpoint> self;
+      http2::StreamId stream_id;
+      std::vector<uint8_t> data;
+      // Declared after self, so that it is released while self is alive
+      SessionTask session_task;
+    };
+
+    std::shared_ptr<enclave::SessionContext> get_session_ctx()
+    {
+      if (session_ctx == nullptr)
+      {
+        session_ctx =
+          std::make_shared<enclave::SessionContext>(session_id, peer_cert());
+      }
+      return session_ctx;
+    }
+
+    // Resolves the frontend for the request and processes it, returning the
+    // serialised response, or nothing if the response will be sent
+    // asynchronously
+    std::optional<std::vector<uint8_t>> process_request(
+      const std::shared_ptr<enclave::RpcContext>& rpc_ctx)
+    {
+      const auto actor_opt = http::extract_actor(*rpc_ctx);
+      if (!actor_opt.has_value())
+      {
+        rpc_ctx->set_error(
+          HTTP_STATUS_NOT_FOUND,
+          ccf::errors::ResourceNotFound,
+          fmt::format(
+            "Request path must contain '/[actor]/[method]'. Unable to parse "
+            "'{}'.",
+            rpc_ctx->get_method()));
+        return rpc_ctx->serialise_response();
+      }
+
+      const auto& actor_s = actor_opt.value();
+      auto actor = rpc_map->resolve(actor_s);
+      auto search = rpc_map->find(actor);
+      if (actor == ccf::ActorsType::unknown || !search.has_value())
+      {
+        rpc_ctx->set_error(
+          HTTP_STATUS_NOT_FOUND,
+          ccf::errors::ResourceNotFound,
+          fmt::format("Unknown actor '{}'.", actor_s));
+        return rpc_ctx->serialise_response();
+      }
+
+      return search.value()->process(rpc_ctx);
+    }
+
+    void parse(const uint8_t* data, size_t size) override
+    {
+      if (protocol == Protocol::Unknown)
+      {
+        preface_buf.insert(preface_buf.end(), data, data + size);
+        const auto& preface = http2::client_preface;
+        const auto n = std::min(preface_buf.size(), preface.size());
+        if (memcmp(preface_buf.data(), preface.data(), n) != 0)
+        {
+          protocol = Protocol::Http1;
+        }
+        else if (n == preface.size())
+        {
+          LOG_TRACE_FMT("Session {} is using HTTP/2", session_id);
+          protocol = Protocol::Http2;
+          h2_session = std::make_unique<http2::ServerSession>(*this);
+        }
+        else
+        {
+          return;
+        }
+
+        auto buffered = std::move(preface_buf);
+        parse(buffered.data(), buffered.size());
+        return;
+      }
+
+      if (protocol == Protocol::Http2)
+      {
+        h2_session->recv(data, size);
+        flush_h2();
+      }
+      else
+      {
+        p.execute(data, size);
+      }
+    }
+
+    void flush_h2()
+    {
+      auto output = h2_session->take_output();
+      if (!output.empty())
+      {
+        send_buffered(output);
+        flush();
+      }
+
+      if (h2_session->is_closed() && !h2_closing)
+      {
+        LOG_DEBUG_FMT("Closing HTTP/2 session {}", session_id);
+        h2_closing = true;
+        close();
+      }
+    }
+
+    // Runs on a worker thread, so that the streams of a connection are
+    // processed concurrently
+    static void process_stream_request_cb(
+      std::unique_ptr<threading::Tmsg<StreamRequestMsg>> msg)
+    {
+      auto self = reinterpret_cast<HTTPServerEndpoint*>(msg->data.self.get());
+      std::optional<std::vector<uint8_t>> response;
+      try
+      {
+        response = self->process_request(msg->data.rpc_ctx);
+      }
+      catch (const std::exception& e)
+      {
+        // Only this stream fails, and the connection remains open
+        LOG_FAIL_FMT("Failed to process request on stream");
+        LOG_DEBUG_FMT("Failed to process request on stream: {}", e.what());
+        response = http::error(
+          HTTP_STATUS_INTERNAL_SERVER_ERROR,
+          ccf::errors::InternalError,
+          fmt::format("Exception: {}", e.what()));
+      }
+
+      if (!response.has_value())
+      {
+        // If the RPC is pending, the response is sent later via the
+        // stream's session id
+        LOG_TRACE_FMT("Pending");
+        return;
+      }
+
+      self->send_on_stream(msg->data.stream_id, std::move(response.value()));
+    }
+
+    static void send_on_stream_cb(
+      std::unique_ptr<threading::Tmsg<StreamResponseMsg>> msg)
+    {
+      reinterpret_cast<HTTPServerEndpoint*>(msg->data.self.get())
+        ->send_on_stream_thread(msg->data.stream_id, std::move(msg->data.data));
+    }
+
+    void send_on_stream_thread(
+      http2::StreamId stream_id, std::vector<uint8_t>&& data)
+    {
+      if (h2_session == nullptr)
+      {
+        send_buffered(data);
+        flush();
+        return;
+      }
+
+      if (stream_id == 0)
+      {
+        LOG_FAIL_FMT(
+          "Dropping response sent to HTTP/2 session {} without a stream",
+          session_id);
+        return;
+      }
+
+      // Responses are serialised as HTTP/1.1, and converted to HTTP/2 frames
+      // here
+      http::SimpleResponseProcessor processor;
+      http::ResponseParser parser(processor);
+      try
+      {
+        parser.execute(data.data(), data.size());
+      }
+      catch (const std::exception& e)
+      {
+        LOG_FAIL_FMT("Unable to parse response to stream");
+        LOG_DEBUG_FMT("Unable to parse response to stream: {}", e.what());
+      }
+
+      if (processor.received.size() == 1)
+      {
+        auto& response = processor.received.front();
+        h2_session->send_response(
+          stream_id,
+          response.status,
+          response.headers,
+          std::move(response.body));
+      }
+      else
+      {
+        h2_session->send_response(
+          stream_id, HTTP_STATUS_INTERNAL_SERVER_ERROR, {}, {});
+      }
+
+      flush_h2();
+    }
+
   public:
+    // Application protocols offered through ALPN, in order of preference
+    static inline const char* alpn_protocols[] = {"h2", "http/1.1", nullptr};
+
     HTTPServerEndpoint(
       std::shared_ptr<enclave::RPCMap> rpc_map,
       size_t session_id,
@@ -115,7 +349,19 @@ namespace http
 
     void send(std::vector<uint8_t>&& data) override
     {
-      send_raw(std::move(data));
+      send_on_stream(0, std::move(data));
+    }
+
+    void send_on_stream(
+      uint32_t stream_id, std::vector<uint8_t>&& data) override
+    {
+      auto msg = std::make_unique<threading::Tmsg<StreamResponseMsg>>(
+        &send_on_stream_cb);
+      msg->data.self = this->shared_from_this();
+      msg->data.stream_id = stream_id;
+      msg->data.data = std::move(data);
+
+      add_session_task(std::move(msg));
     }
 
     void handle_request(
@@ -132,22 +378,18 @@ namespace http
 
       try
       {
-        if (session_ctx == nullptr)
-        {
-          session_ctx =
-            std::make_shared<enclave::SessionContext>(session_id, peer_cert());
-        }
-
         std::shared_ptr<enclave::RpcContext> rpc_ctx = nullptr;
         try
         {
           rpc_ctx = std::make_shared<HttpRpcContext>(
             request_index++,
-            session_ctx,
+            get_session_ctx(),
             verb,
             url,
             std::move(headers),
             std::move(body));
+          rpc_ctx->parse_duration =
+            ds::LatencyClock::since(request_parser.get_message_begin_time());
         }
         catch (std::exception& e)
         {
@@ -155,36 +397,10 @@ namespace http
             HTTP_STATUS_INTERNAL_SERVER_ERROR,
             ccf::errors::InternalError,
             e.what()));
-        }
-
-        const auto actor_opt = http::extract_actor(*rpc_ctx);
-        if (!actor_opt.has_value())
-        {
-          rpc_ctx->set_error(
-            HTTP_STATUS_NOT_FOUND,
-            ccf::errors::ResourceNotFound,
-            fmt::format(
-              "Request path must contain '/[actor]/[method]'. Unable to parse "
-              "'{}'.",
-              rpc_ctx->get_method()));
-          send_raw(rpc_ctx->serialise_response());
-          return;
-        }
-
-        const auto& actor_s = actor_opt.value();
-        auto actor = rpc_map->resolve(actor_s);
-        auto search = rpc_map->find(actor);
-        if (actor == ccf::ActorsType::unknown || !search.has_value())
-        {
-          rpc_ctx->set_error(
-            HTTP_STATUS_NOT_FOUND,
-            ccf::errors::ResourceNotFound,
-            fmt::format("Unknown actor '{}'.", actor_s));
-          send_raw(rpc_ctx->serialise_response());
           return;
         }
 
-        auto response = search.value()->process(rpc_ctx);
+        auto response = process_request(rpc_ctx);
 
         if (!response.has_value())
         {
@@ -212,6 +428,64 @@ namespace http
         throw;
       }
     }
+
+    void handle_stream_request(
+      http2::StreamId stream_id,
+      llhttp_method verb,
+      const std::string_view& url,
+      http::HeaderMap&& headers,
+      std::vector<uint8_t>&& body,
+      std::optional<ds::LatencyClock::time_point> begin_time) override
+    {
+      LOG_TRACE_FMT(
+        "Processing msg({}, {} [{} bytes]) on stream {}",
+        llhttp_method_name(verb),
+        url,
+        body.size(),
+        stream_id);
+
+      std::shared_ptr<enclave::RpcContext> rpc_ctx = nullptr;
+      try
+      {
+        // Each stream has its own session context, which carries its session
+        // id. The caller's certificate digest is computed once, and shared by
+        // all of them.
+        auto connection_ctx = get_session_ctx();
+        connection_ctx->get_caller_cert_digest();
+        auto stream_ctx =
+          std::make_shared<enclave::SessionContext>(*connection_ctx);
+        stream_ctx->client_session_id =
+          http2::make_stream_session_id(session_id, stream_id);
+
+        rpc_ctx = std::make_shared<HttpRpcContext>(
+          request_index++,
+          stream_ctx,
+          verb,
+          url,
+          std::move(headers),
+          std::move(body));
+        rpc_ctx->parse_duration = ds::LatencyClock::since(begin_time);
+      }
+      catch (const std::exception& e)
+      {
+        send_on_stream(
+          stream_id,
+          http::error(
+            HTTP_STATUS_INTERNAL_SERVER_ERROR,
+            ccf::errors::InternalError,
+            e.what()));
+        return;
+      }
+
+      auto msg = std::make_unique<threading::Tmsg<StreamRequestMsg>>(
+        &process_stream_request_cb);
+      msg->data.self = this->shared_from_this();
+      msg->data.stream_id = stream_id;
+      msg->data.rpc_ctx = rpc_ctx;
+
+      auto& tm = threading::ThreadMessaging::thread_messaging;
+      tm.add_task(tm.get_least_loaded_execution_thread(), std::move(msg));
+    }
   };
 
   class HTTPClientEndpoint : public HTTPEndpoint,
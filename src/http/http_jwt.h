@@ -39,6 +39,8 @@ namespace http
       nlohmann::json payload;
       std::vector<uint8_t> signature;
       std::string_view signed_content;
+      // Entire encoded token, including the signature
+      std::string_view raw;
     };
 
     static bool parse_auth_scheme(
@@ -124,7 +126,7 @@ namespace http
         return std::nullopt;
       }
       Token parsed = {
-        header, header_typed, payload, signature_raw, signed_content};
+        header, header_typed, payload, signature_raw, signed_content, token};
       return parsed;
     }
 
@@ -147,16 +149,21 @@ namespace http
     }
 
     static bool validate_token_signature(
-      const Token& token, std::vector<uint8_t> cert_der)
+      const Token& token, crypto::Verifier& verifier)
     {
-      auto verifier = crypto::make_unique_verifier(cert_der);
-      bool valid = verifier->verify(
+      return verifier.verify(
         (uint8_t*)token.signed_content.data(),
         token.signed_content.size(),
         token.signature.data(),
         token.signature.size(),
         crypto::MDType::SHA256);
-      return valid;
+    }
+
+    static bool validate_token_signature(
+      const Token& token, std::vector<uint8_t> cert_der)
+    {
+      auto verifier = crypto::make_unique_verifier(cert_der);
+      return validate_token_signature(token, *verifier);
     }
   };
 }
\ No newline at end of file
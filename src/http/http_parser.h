@@ -3,12 +3,14 @@
 #pragma once
 
 #include "ds/hex.h"
+#include "ds/latency_clock.h"
 #include "enclave/tls_endpoint.h"
 #include "http_builder.h"
 #include "http_proc.h"
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <llhttp/llhttp.h>
 #include <map>
 #include <queue>
@@ -187,6 +189,10 @@ namespace http
 
     std::pair<std::string, std::string> partial_parsed_header = {};
 
+    // When parsing of the current message began, if stage timing is enabled
+    std::optional<ds::LatencyClock::time_point> message_begin_time =
+      std::nullopt;
+
     void complete_header()
     {
       headers.emplace(partial_parsed_header);
@@ -251,6 +257,7 @@ namespace http
       {
         LOG_TRACE_FMT("Entering new message");
         state = IN_MESSAGE;
+        message_begin_time = ds::LatencyClock::now();
         body_buf.clear();
         headers.clear();
       }
@@ -263,6 +270,11 @@ namespace http
 
     virtual void handle_completed_message() = 0;
 
+    std::optional<ds::LatencyClock::time_point> get_message_begin_time() const
+    {
+      return message_begin_time;
+    }
+
     void end_message()
     {
       if (state == IN_MESSAGE)
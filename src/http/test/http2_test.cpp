@@ -0,0 +1,807 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+
+#include "http/http2_hpack.h"
+#include "http/http2_session.h"
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+#include <string>
+#include <vector>
+
+using namespace http2;
+
+std::vector<uint8_t> from_hex(const std::string& s)
+{
+  std::vector<uint8_t> v;
+  for (size_t i = 0; i < s.size(); i += 2)
+  {
+    v.push_back(std::stoi(s.substr(i, 2), nullptr, 16));
+  }
+  return v;
+}
+
+std::vector<uint8_t> to_bytes(const std::string_view& s)
+{
+  return std::vector<uint8_t>(s.begin(), s.end());
+}
+
+namespace http2::hpack
+{
+  bool operator==(const HeaderField& a, const HeaderField& b)
+  {
+    return a.name == b.name && a.value == b.value;
+  }
+}
+
+TEST_CASE("HPACK integers")
+{
+  // RFC 7541, C.1
+  std::vector<uint8_t> out;
+  hpack::encode_integer(10, 5, 0, out);
+  REQUIRE(out == std::vector<uint8_t>{0x0a});
+
+  out.clear();
+  hpack::encode_integer(1337, 5, 0, out);
+  REQUIRE(out == std::vector<uint8_t>{0x1f, 0x9a, 0x0a});
+
+  out.clear();
+  hpack::encode_integer(42, 8, 0, out);
+  REQUIRE(out == std::vector<uint8_t>{0x2a});
+
+  const uint8_t* data = out.data();
+  size_t size = out.size();
+  REQUIRE(hpack::decode_integer(data, size, 8) == 42);
+  REQUIRE(size == 0);
+
+  const auto encoded = std::vector<uint8_t>{0x1f, 0x9a, 0x0a};
+  data = encoded.data();
+  size = encoded.size();
+  REQUIRE(hpack::decode_integer(data, size, 5) == 1337);
+
+  INFO("Truncated and oversized integers are rejected");
+  const auto truncated = std::vector<uint8_t>{0x1f, 0x9a};
+  data = truncated.data();
+  size = truncated.size();
+  REQUIRE_THROWS_AS(
+    hpack::decode_integer(data, size, 5), hpack::CompressionError);
+
+  const auto oversized =
+    std::vector<uint8_t>{0x1f, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01};
+  data = oversized.data();
+  size = oversized.size();
+  REQUIRE_THROWS_AS(
+    hpack::decode_integer(data, size, 5), hpack::CompressionError);
+}
+
+TEST_CASE("Huffman coding")
+{
+  // RFC 7541, C.4.1
+  const std::string s = "www.example.com";
+  const auto expected = from_hex("f1e3c2e5f23a6ba0ab90f4ff");
+
+  std::vector<uint8_t> encoded;
+  hpack::huffman_encode(s, encoded);
+  REQUIRE(encoded == expected);
+  REQUIRE(hpack::huffman_encoded_size(s) == expected.size());
+  REQUIRE(hpack::huffman_decode(encoded.data(), encoded.size()) == s);
+
+  std::string all_bytes;
+  for (size_t i = 0; i < 256; ++i)
+  {
+    all_bytes.push_back((char)i);
+  }
+  encoded.clear();
+  hpack::huffman_encode(all_bytes, encoded);
+  REQUIRE(hpack::huffman_decode(encoded.data(), encoded.size()) == all_bytes);
+
+  INFO("Padding must be a short prefix of EOS");
+  auto bad_padding = expected;
+  bad_padding.back() &= 0xfe;
+  REQUIRE_THROWS_AS(
+    hpack::huffman_decode(bad_padding.data(), bad_padding.size()),
+    hpack::CompressionError);
+
+  auto long_padding = expected;
+  long_padding.push_back(0xff);
+  REQUIRE_THROWS_AS(
+    hpack::huffman_decode(long_padding.data(), long_padding.size()),
+    hpack::CompressionError);
+}
+
+TEST_CASE("HPACK request examples")
+{
+  hpack::Decoder decoder(ServerSession::max_header_list_size);
+
+  SUBCASE("Without Huffman coding")
+  {
+    // RFC 7541, C.3
+    const auto first = from_hex("828684410f7777772e6578616d706c652e636f6d");
+    REQUIRE(
+      decoder.decode(first.data(), first.size()) ==
+      hpack::HeaderList{
+        {":method", "GET"},
+        {":scheme", "http"},
+        {":path", "/"},
+        {":authority", "www.example.com"}});
+
+    const auto second = from_hex("828684be58086e6f2d6361636865");
+    REQUIRE(
+      decoder.decode(second.data(), second.size()) ==
+      hpack::HeaderList{
+        {":method", "GET"},
+        {":scheme", "http"},
+        {":path", "/"},
+        {":authority", "www.example.com"},
+        {"cache-control", "no-cache"}});
+
+    const auto third = from_hex(
+      "828785bf400a637573746f6d2d6b65790c637573746f6d2d76616c7565");
+    REQUIRE(
+      decoder.decode(third.data(), third.size()) ==
+      hpack::HeaderList{
+        {":method", "GET"},
+        {":scheme", "https"},
+        {":path", "/index.html"},
+        {":authority", "www.example.com"},
+        {"custom-key", "custom-value"}});
+  }
+
+  SUBCASE("With Huffman coding")
+  {
+    // RFC 7541, C.4
+    const auto first = from_hex("828684418cf1e3c2e5f23a6ba0ab90f4ff");
+    REQUIRE(
+      decoder.decode(first.data(), first.size()) ==
+      hpack::HeaderList{
+        {":method", "GET"},
+        {":scheme", "http"},
+        {":path", "/"},
+        {":authority", "www.example.com"}});
+
+    const auto second = from_hex("828684be5886a8eb10649cbf");
+    REQUIRE(
+      decoder.decode(second.data(), second.size()).back() ==
+      hpack::HeaderField{"cache-control", "no-cache"});
+
+    const auto third =
+      from_hex("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf");
+    REQUIRE(
+      decoder.decode(third.data(), third.size()).back() ==
+      hpack::HeaderField{"custom-key", "custom-value"});
+  }
+
+  INFO("Indices beyond the dynamic table are rejected");
+  const auto out_of_range = from_hex("c8");
+  REQUIRE_THROWS_AS(
+    decoder.decode(out_of_range.data(), out_of_range.size()),
+    hpack::CompressionError);
+}
+
+TEST_CASE("HPACK encoder")
+{
+  hpack::Encoder encoder;
+  hpack::Decoder decoder(ServerSession::max_header_list_size);
+
+  const hpack::HeaderList fields = {
+    {":status", "200"},
+    {"content-type", "application/json"},
+    {"content-length", "42"},
+    {"x-ms-ccf-transaction-id", "2.18"},
+    {"authorization", "secret"}};
+
+  std::vector<uint8_t> first;
+  encoder.encode(fields, first);
+  REQUIRE(decoder.decode(first.data(), first.size()) == fields);
+
+  INFO("Repeated fields are encoded from the dynamic table");
+  std::vector<uint8_t> second;
+  encoder.encode(fields, second);
+  REQUIRE(second.size() < first.size());
+  REQUIRE(decoder.decode(second.data(), second.size()) == fields);
+
+  INFO("Table size reductions are signalled to the decoder");
+  encoder.set_max_table_size(0);
+  encoder.set_max_table_size(100);
+  std::vector<uint8_t> third;
+  encoder.encode(fields, third);
+  REQUIRE(third[0] == 0x20);
+  REQUIRE(decoder.decode(third.data(), third.size()) == fields);
+  REQUIRE(encoder.get_table_size() <= 100);
+}
+
+// Minimal HTTP/2 client, which frames requests and parses the server's
+// frames
+struct Frame
+{
+  FrameType type;
+  uint8_t flags;
+  StreamId stream_id;
+  std::vector<uint8_t> payload;
+};
+
+std::vector<uint8_t> make_frame(
+  FrameType type,
+  uint8_t frame_flags,
+  StreamId stream_id,
+  const std::vector<uint8_t>& payload = {})
+{
+  std::vector<uint8_t> f;
+  f.push_back(payload.size() >> 16);
+  f.push_back(payload.size() >> 8);
+  f.push_back(payload.size());
+  f.push_back((uint8_t)type);
+  f.push_back(frame_flags);
+  f.push_back(stream_id >> 24);
+  f.push_back(stream_id >> 16);
+  f.push_back(stream_id >> 8);
+  f.push_back(stream_id);
+  f.insert(f.end(), payload.begin(), payload.end());
+  return f;
+}
+
+std::vector<uint8_t> u32(uint32_t v)
+{
+  return {
+    (uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v};
+}
+
+std::vector<uint8_t> setting(SettingId id, uint32_t value)
+{
+  std::vector<uint8_t> s = {(uint8_t)((uint16_t)id >> 8), (uint8_t)id};
+  const auto v = u32(value);
+  s.insert(s.end(), v.begin(), v.end());
+  return s;
+}
+
+std::vector<Frame> parse_frames(const std::vector<uint8_t>& data)
+{
+  std::vector<Frame> frames;
+  size_t offset = 0;
+  while (offset < data.size())
+  {
+    REQUIRE(data.size() - offset >= frame_header_size);
+    const auto h = data.data() + offset;
+    const size_t length = (h[0] << 16) | (h[1] << 8) | h[2];
+    Frame f;
+    f.type = (FrameType)h[3];
+    f.flags = h[4];
+    f.stream_id = (h[5] << 24) | (h[6] << 16) | (h[7] << 8) | h[8];
+    REQUIRE(data.size() - offset - frame_header_size >= length);
+    f.payload.assign(
+      h + frame_header_size, h + frame_header_size + length);
+    frames.push_back(f);
+    offset += frame_header_size + length;
+  }
+  return frames;
+}
+
+struct TestProcessor : public StreamRequestProcessor
+{
+  struct Request
+  {
+    StreamId stream_id;
+    llhttp_method method;
+    std::string url;
+    http::HeaderMap headers;
+    std::vector<uint8_t> body;
+  };
+
+  std::vector<Request> requests;
+
+  void handle_stream_request(
+    StreamId stream_id,
+    llhttp_method method,
+    const std::string_view& url,
+    http::HeaderMap&& headers,
+    std::vector<uint8_t>&& body,
+    std::optional<ds::LatencyClock::time_point>) override
+  {
+    requests.push_back(
+      {stream_id, method, std::string(url), std::move(headers), body});
+  }
+};
+
+struct TestClient
+{
+  TestProcessor processor;
+  ServerSession session{processor};
+  hpack::Encoder encoder;
+  hpack::Decoder decoder{ServerSession::max_header_list_size};
+
+  TestClient(const std::vector<uint8_t>& settings = {})
+  {
+    auto preface = to_bytes(client_preface);
+    session.recv(preface.data(), preface.size());
+    send(make_frame(FrameType::Settings, 0, 0, settings));
+
+    const auto frames = receive();
+    REQUIRE(frames.size() == 3);
+    REQUIRE(frames[0].type == FrameType::Settings);
+    REQUIRE(frames[1].type == FrameType::WindowUpdate);
+    REQUIRE(frames[2].type == FrameType::Settings);
+    REQUIRE(frames[2].flags == flags::ACK);
+  }
+
+  void send(const std::vector<uint8_t>& data)
+  {
+    session.recv(data.data(), data.size());
+  }
+
+  std::vector<Frame> receive()
+  {
+    return parse_frames(session.take_output());
+  }
+
+  void send_request(
+    StreamId stream_id,
+    const std::string& method,
+    const std::string& path,
+    const std::vector<uint8_t>& body = {})
+  {
+    std::vector<uint8_t> block;
+    encoder.encode(
+      {{":method", method},
+       {":scheme", "https"},
+       {":path", path},
+       {":authority", "localhost"},
+       {"content-type", "application/json"}},
+      block);
+    send(make_frame(
+      FrameType::Headers,
+      flags::END_HEADERS | (body.empty() ? flags::END_STREAM : 0),
+      stream_id,
+      block));
+    if (!body.empty())
+    {
+      // Split across frames
+      const auto mid = body.begin() + body.size() / 2;
+      send(make_frame(
+        FrameType::Data,
+        0,
+        stream_id,
+        std::vector<uint8_t>(body.begin(), mid)));
+      send(make_frame(
+        FrameType::Data,
+        flags::END_STREAM,
+        stream_id,
+        std::vector<uint8_t>(mid, body.end())));
+    }
+  }
+
+  void respond(StreamId stream_id, const std::string& body)
+  {
+    session.send_response(
+      stream_id,
+      HTTP_STATUS_OK,
+      {{"Content-Type", "text/plain"},
+       {"Content-Length", std::to_string(body.size())},
+       {"Connection", "close"}},
+      to_bytes(body));
+  }
+
+  hpack::HeaderList decode_headers(const Frame& frame)
+  {
+    REQUIRE(frame.type == FrameType::Headers);
+    REQUIRE((frame.flags & flags::END_HEADERS) != 0);
+    return decoder.decode(frame.payload.data(), frame.payload.size());
+  }
+};
+
+// Send size bytes of request body on stream_id, in frames of the largest
+// size the server accepts
+void send_data(
+  TestClient& client, StreamId stream_id, size_t size, uint8_t frame_flags = 0)
+{
+  do
+  {
+    const auto n = std::min(size, (size_t)default_max_frame_size);
+    size -= n;
+    client.send(make_frame(
+      FrameType::Data,
+      size == 0 ? frame_flags : 0,
+      stream_id,
+      std::vector<uint8_t>(n, 'x')));
+  } while (size > 0);
+}
+
+TEST_CASE("HTTP/2 requests and responses")
+{
+  TestClient client;
+
+  client.send_request(1, "GET", "/app/log?id=42");
+  REQUIRE(client.processor.requests.size() == 1);
+  const auto& request = client.processor.requests[0];
+  REQUIRE(request.stream_id == 1);
+  REQUIRE(request.method == HTTP_GET);
+  REQUIRE(request.url == "/app/log?id=42");
+  REQUIRE(request.headers.at("host") == "localhost");
+  REQUIRE(request.headers.at("content-type") == "application/json");
+  REQUIRE(request.body.empty());
+
+  client.respond(1, "hello");
+  const auto frames = client.receive();
+  REQUIRE(frames.size() == 2);
+  const auto headers = client.decode_headers(frames[0]);
+  REQUIRE(frames[0].stream_id == 1);
+  REQUIRE(
+    headers ==
+    hpack::HeaderList{{":status", "200"},
+                      {"content-length", "5"},
+                      {"content-type", "text/plain"}});
+  REQUIRE(frames[1].type == FrameType::Data);
+  REQUIRE(frames[1].flags == flags::END_STREAM);
+  REQUIRE(frames[1].payload == to_bytes("hello"));
+  REQUIRE(client.session.get_open_streams() == 0);
+
+  INFO("Empty responses end the stream with their headers");
+  client.send_request(3, "POST", "/app/log", to_bytes("{\"id\": 42}"));
+  REQUIRE(client.processor.requests.size() == 2);
+  REQUIRE(client.processor.requests[1].method == HTTP_POST);
+  REQUIRE(client.processor.requests[1].body == to_bytes("{\"id\": 42}"));
+  client.respond(3, "");
+  const auto empty = client.receive();
+  REQUIRE(empty.size() == 1);
+  REQUIRE(empty[0].flags == (flags::END_HEADERS | flags::END_STREAM));
+
+  INFO("PING is acknowledged");
+  const auto ping_data = from_hex("0102030405060708");
+  client.send(make_frame(FrameType::Ping, 0, 0, ping_data));
+  const auto ping = client.receive();
+  REQUIRE(ping.size() == 1);
+  REQUIRE(ping[0].flags == flags::ACK);
+  REQUIRE(ping[0].payload == ping_data);
+}
+
+TEST_CASE("HTTP/2 streams are multiplexed")
+{
+  TestClient client;
+
+  client.send_request(1, "GET", "/first");
+  client.send_request(3, "POST", "/second", to_bytes("second body"));
+  client.send_request(5, "GET", "/third");
+  REQUIRE(client.processor.requests.size() == 3);
+  REQUIRE(client.session.get_open_streams() == 3);
+
+  // Responses are sent in the order in which they complete
+  client.respond(5, "third");
+  client.respond(1, "first");
+  client.respond(3, "second");
+
+  const auto frames = client.receive();
+  REQUIRE(frames.size() == 6);
+  REQUIRE(frames[1].stream_id == 5);
+  REQUIRE(frames[1].payload == to_bytes("third"));
+  REQUIRE(frames[3].stream_id == 1);
+  REQUIRE(frames[3].payload == to_bytes("first"));
+  REQUIRE(frames[5].stream_id == 3);
+  REQUIRE(frames[5].payload == to_bytes("second"));
+
+  INFO("Responses to streams reset by the client are dropped");
+  client.send_request(7, "GET", "/fourth");
+  client.send(make_frame(
+    FrameType::RstStream, 0, 7, u32((uint32_t)ErrorCode::Cancel)));
+  client.respond(7, "fourth");
+  REQUIRE(client.receive().empty());
+}
+
+TEST_CASE("HTTP/2 flow control")
+{
+  TestClient client(setting(SettingId::InitialWindowSize, 10));
+
+  const std::string body = "0123456789abcdefghijKLMNO";
+  client.send_request(1, "GET", "/");
+  client.respond(1, body);
+
+  auto frames = client.receive();
+  REQUIRE(frames.size() == 2);
+  REQUIRE(frames[1].payload == to_bytes("0123456789"));
+  REQUIRE(frames[1].flags == 0);
+
+  client.send(make_frame(FrameType::WindowUpdate, 0, 1, u32(10)));
+  frames = client.receive();
+  REQUIRE(frames.size() == 1);
+  REQUIRE(frames[0].payload == to_bytes("abcdefghij"));
+
+  INFO("Changes to the initial window size apply to open streams");
+  client.send(make_frame(
+    FrameType::Settings, 0, 0, setting(SettingId::InitialWindowSize, 15)));
+  frames = client.receive();
+  REQUIRE(frames.size() == 2);
+  REQUIRE(frames[0].type == FrameType::Settings);
+  REQUIRE(frames[1].payload == to_bytes("KLMNO"));
+  REQUIRE(frames[1].flags == flags::END_STREAM);
+  REQUIRE(client.session.get_open_streams() == 0);
+
+  INFO("The connection window is shared by all streams");
+  // 65535 - 25 bytes of the connection window remain
+  const std::string large(70000, 'x');
+  client.send(make_frame(
+    FrameType::Settings, 0, 0, setting(SettingId::InitialWindowSize, 100000)));
+  client.receive();
+  client.send_request(3, "GET", "/");
+  client.respond(3, large);
+  size_t received = 0;
+  for (const auto& frame : client.receive())
+  {
+    if (frame.type == FrameType::Data)
+    {
+      REQUIRE(frame.payload.size() <= default_max_frame_size);
+      received += frame.payload.size();
+    }
+  }
+  REQUIRE(received == default_window_size - body.size());
+
+  client.send(make_frame(FrameType::WindowUpdate, 0, 0, u32(100000)));
+  for (const auto& frame : client.receive())
+  {
+    received += frame.payload.size();
+  }
+  REQUIRE(received == large.size());
+  REQUIRE(client.session.get_open_streams() == 0);
+}
+
+TEST_CASE("HTTP/2 request headers split across frames")
+{
+  TestClient client;
+
+  std::vector<uint8_t> block;
+  client.encoder.encode(
+    {{":method", "PUT"},
+     {":scheme", "https"},
+     {":path", "/continued"},
+     {"cookie", "a=b"},
+     {"cookie", "c=d"}},
+    block);
+  const auto mid = block.begin() + block.size() / 2;
+
+  // Padded, with priority
+  std::vector<uint8_t> first = {2, 0, 0, 0, 0, 16};
+  first.insert(first.end(), block.begin(), mid);
+  first.insert(first.end(), {0, 0});
+  client.send(make_frame(
+    FrameType::Headers, flags::PADDED | flags::PRIORITY, 1, first));
+  REQUIRE(client.processor.requests.empty());
+
+  client.send(make_frame(
+    FrameType::Continuation,
+    flags::END_HEADERS,
+    1,
+    std::vector<uint8_t>(mid, block.end())));
+  REQUIRE(client.processor.requests.empty());
+
+  client.send(make_frame(FrameType::Data, flags::END_STREAM, 1, {}));
+  REQUIRE(client.processor.requests.size() == 1);
+  REQUIRE(client.processor.requests[0].method == HTTP_PUT);
+  REQUIRE(client.processor.requests[0].url == "/continued");
+  REQUIRE(client.processor.requests[0].headers.at("cookie") == "a=b; c=d");
+}
+
+TEST_CASE("HTTP/2 errors")
+{
+  SUBCASE("Invalid preface")
+  {
+    TestProcessor processor;
+    ServerSession session(processor);
+    session.take_output();
+
+    const auto request = to_bytes("GET / HTTP/1.1\r\n\r\n");
+    session.recv(request.data(), request.size());
+    const auto frames = parse_frames(session.take_output());
+    REQUIRE(frames.size() == 1);
+    REQUIRE(frames[0].type == FrameType::GoAway);
+    REQUIRE(frames[0].payload[7] == (uint8_t)ErrorCode::ProtocolError);
+    REQUIRE(session.is_closed());
+  }
+
+  SUBCASE("Malformed requests reset the stream")
+  {
+    TestClient client;
+    std::vector<uint8_t> block;
+    client.encoder.encode({{":method", "GET"}, {":path", "/"}}, block);
+    client.send(make_frame(
+      FrameType::Headers, flags::END_HEADERS | flags::END_STREAM, 1, block));
+    auto frames = client.receive();
+    REQUIRE(frames.size() == 1);
+    REQUIRE(frames[0].type == FrameType::RstStream);
+    REQUIRE(frames[0].stream_id == 1);
+    REQUIRE(client.processor.requests.empty());
+
+    block.clear();
+    client.encoder.encode(
+      {{":method", "GET"},
+       {":scheme", "https"},
+       {":path", "/"},
+       {"connection", "keep-alive"}},
+      block);
+    client.send(make_frame(
+      FrameType::Headers, flags::END_HEADERS | flags::END_STREAM, 3, block));
+    frames = client.receive();
+    REQUIRE(frames.size() == 1);
+    REQUIRE(frames[0].type == FrameType::RstStream);
+    REQUIRE(!client.session.is_closed());
+  }
+
+  SUBCASE("Streams beyond the concurrency limit are refused")
+  {
+    TestClient client;
+    for (StreamId i = 0; i < ServerSession::max_concurrent_streams; ++i)
+    {
+      client.send_request(2 * i + 1, "GET", "/");
+    }
+    REQUIRE(client.receive().empty());
+
+    const StreamId refused = 2 * ServerSession::max_concurrent_streams + 1;
+    client.send_request(refused, "GET", "/");
+    const auto frames = client.receive();
+    REQUIRE(frames.size() == 1);
+    REQUIRE(frames[0].type == FrameType::RstStream);
+    REQUIRE(frames[0].stream_id == refused);
+    REQUIRE(frames[0].payload == u32((uint32_t)ErrorCode::RefusedStream));
+  }
+
+  SUBCASE("Stream ids must increase")
+  {
+    TestClient client;
+    client.send_request(3, "GET", "/");
+    client.send_request(1, "GET", "/");
+    const auto frames = client.receive();
+    REQUIRE(frames.size() == 1);
+    REQUIRE(frames[0].type == FrameType::GoAway);
+    REQUIRE(client.session.is_closed());
+
+    INFO("Nothing more is processed after GOAWAY");
+    client.send_request(5, "GET", "/");
+    REQUIRE(client.processor.requests.size() == 1);
+    REQUIRE(client.receive().empty());
+  }
+
+  SUBCASE("Invalid header blocks close the connection")
+  {
+    TestClient client;
+    client.send(make_frame(
+      FrameType::Headers,
+      flags::END_HEADERS | flags::END_STREAM,
+      1,
+      from_hex("ff00")));
+    const auto frames = client.receive();
+    REQUIRE(frames.size() == 1);
+    REQUIRE(frames[0].type == FrameType::GoAway);
+    REQUIRE(frames[0].payload[7] == (uint8_t)ErrorCode::CompressionError);
+  }
+
+  SUBCASE("Request bodies are capped by the stream window")
+  {
+    TestClient client;
+    client.send(make_frame(
+      FrameType::Headers, flags::END_HEADERS, 1, from_hex("828684")));
+    send_data(client, 1, ServerSession::initial_window_size);
+
+    // The stream window is not extended while the body is buffered
+    REQUIRE(client.receive().empty());
+    REQUIRE(!client.session.is_closed());
+
+    send_data(client, 1, 1);
+    const auto frames = client.receive();
+    REQUIRE(frames.size() == 1);
+    REQUIRE(frames[0].type == FrameType::GoAway);
+    REQUIRE(frames[0].payload[7] == (uint8_t)ErrorCode::FlowControlError);
+    REQUIRE(client.processor.requests.empty());
+  }
+}
+
+TEST_CASE("HTTP/2 request flow control")
+{
+  TestClient client;
+  const auto body_size = ServerSession::initial_window_size;
+  const auto streams =
+    ServerSession::connection_window_size / ServerSession::initial_window_size;
+  for (StreamId i = 0; i < streams; ++i)
+  {
+    client.send(make_frame(
+      FrameType::Headers, flags::END_HEADERS, 2 * i + 1, from_hex("828684")));
+    send_data(client, 2 * i + 1, body_size);
+  }
+
+  INFO("The connection window is not extended while bodies are buffered");
+  REQUIRE(client.receive().empty());
+  REQUIRE(!client.session.is_closed());
+
+  INFO("It is extended once half of it has been passed on or discarded");
+  send_data(client, 1, 0, flags::END_STREAM);
+  REQUIRE(client.processor.requests.size() == 1);
+  REQUIRE(client.processor.requests[0].body.size() == body_size);
+  REQUIRE(client.receive().empty());
+
+  client.send(make_frame(
+    FrameType::RstStream, 0, 3, u32((uint32_t)ErrorCode::Cancel)));
+  auto frames = client.receive();
+  REQUIRE(frames.size() == 1);
+  REQUIRE(frames[0].type == FrameType::WindowUpdate);
+  REQUIRE(frames[0].stream_id == 0);
+  REQUIRE(frames[0].payload == u32(2 * body_size));
+
+  INFO("Data received on closed streams is discarded");
+  send_data(client, 3, 2 * body_size);
+  size_t resets = 0;
+  size_t updates = 0;
+  for (const auto& frame : client.receive())
+  {
+    if (frame.type == FrameType::RstStream)
+    {
+      ++resets;
+    }
+    else
+    {
+      REQUIRE(frame.type == FrameType::WindowUpdate);
+      REQUIRE(frame.payload == u32(2 * body_size));
+      ++updates;
+    }
+  }
+  REQUIRE(resets == 2 * body_size / default_max_frame_size);
+  REQUIRE(updates == 1);
+  REQUIRE(!client.session.is_closed());
+}
+
+TEST_CASE("HTTP/2 reset streams count until answered")
+{
+  TestClient client;
+  for (StreamId i = 0; i < ServerSession::max_concurrent_streams; ++i)
+  {
+    client.send_request(2 * i + 1, "GET", "/");
+    client.send(make_frame(
+      FrameType::RstStream, 0, 2 * i + 1, u32((uint32_t)ErrorCode::Cancel)));
+  }
+  REQUIRE(
+    client.processor.requests.size() == ServerSession::max_concurrent_streams);
+  REQUIRE(client.session.get_open_streams() == 0);
+  REQUIRE(
+    client.session.get_abandoned_requests() ==
+    ServerSession::max_concurrent_streams);
+  REQUIRE(client.receive().empty());
+
+  INFO("New streams are refused while their requests are processed");
+  const StreamId next = 2 * ServerSession::max_concurrent_streams + 1;
+  client.send_request(next, "GET", "/");
+  auto frames = client.receive();
+  REQUIRE(frames.size() == 1);
+  REQUIRE(frames[0].type == FrameType::RstStream);
+  REQUIRE(frames[0].payload == u32((uint32_t)ErrorCode::RefusedStream));
+  REQUIRE(
+    client.processor.requests.size() == ServerSession::max_concurrent_streams);
+
+  INFO("Dropping a response frees its slot");
+  client.respond(1, "dropped");
+  REQUIRE(client.receive().empty());
+  REQUIRE(
+    client.session.get_abandoned_requests() ==
+    ServerSession::max_concurrent_streams - 1);
+  client.send_request(next + 2, "GET", "/");
+  REQUIRE(client.receive().empty());
+  REQUIRE(
+    client.processor.requests.size() ==
+    ServerSession::max_concurrent_streams + 1);
+}
+
+TEST_CASE("Stream session ids")
+{
+  const size_t session_id = 42;
+  const auto id = make_stream_session_id(session_id, 7);
+  REQUIRE(id != session_id);
+  REQUIRE(
+    parse_stream_session_id(id) == std::make_pair(session_id, (StreamId)7));
+
+  const auto last_stream = (StreamId)((1u << 31) - 1);
+  const auto last_session = (size_t)((1ull << 32) - 1);
+  REQUIRE(
+    parse_stream_session_id(
+      make_stream_session_id(last_session, last_stream)) ==
+    std::make_pair(last_session, last_stream));
+  REQUIRE_THROWS(make_stream_session_id(last_session + 1, 1));
+
+  INFO("Other session ids are not stream session ids");
+  REQUIRE(!parse_stream_session_id(session_id).has_value());
+  const auto enclave_client_session_id =
+    std::numeric_limits<size_t>::max() / 2 + 1;
+  REQUIRE(!parse_stream_session_id(enclave_client_session_id).has_value());
+}
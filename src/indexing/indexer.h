@@ -0,0 +1,159 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+#pragma once
+
+#include "ccf/indexing/strategy.h"
+#include "kv/store.h"
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace ccf::indexing
+{
+  /** Feeds installed strategies from the store's global commit hooks, which
+   * are called with the writes of each committed transaction, in order, when
+   * the store is compacted. The indexer adds one global hook to each indexed
+   * map, alongside any other global hooks on that map.
+   */
+  class Indexer : public AbstractIndexer
+  {
+  protected:
+    kv::Store& store;
+
+    // Serialises installation and removal of strategies. Global hooks are
+    // added and removed while holding only this lock, since the store calls
+    // them with its maps locked and they take the lock below.
+    std::mutex install_lock;
+
+    std::mutex lock;
+    std::map<std::string, std::vector<StrategyPtr>> strategies;
+
+    // Global hook added to each indexed map, guarded by install_lock
+    std::map<std::string, kv::Store::GlobalHookId> hook_ids;
+
+    void handle_committed_writes(
+      const std::string& map_name,
+      kv::Version version,
+      const kv::untyped::Write& writes)
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      const auto it = strategies.find(map_name);
+      if (it == strategies.end())
+      {
+        return;
+      }
+
+      for (auto& strategy : it->second)
+      {
+        strategy->handle_committed_writes(version, writes);
+      }
+    }
+
+  public:
+    Indexer(kv::Store& store_) : store(store_) {}
+
+    void install_strategy(const StrategyPtr& strategy) override
+    {
+      if (strategy == nullptr)
+      {
+        throw std::logic_error("Cannot install null indexing strategy");
+      }
+
+      std::lock_guard<std::mutex> install_guard(install_lock);
+      const auto& map_name = strategy->get_indexed_map_name();
+
+      {
+        std::lock_guard<std::mutex> guard(lock);
+
+        // Writes which are already committed will not be reported again
+        strategy->reset(std::max(
+          store.compacted_version(), store.last_snapshot_version()) + 1);
+
+        strategies[map_name].push_back(strategy);
+      }
+
+      if (hook_ids.find(map_name) == hook_ids.end())
+      {
+        hook_ids[map_name] = store.add_global_hook(
+          map_name,
+          [this, map_name](kv::Version version, const kv::untyped::Write& w) {
+            handle_committed_writes(map_name, version, w);
+          });
+      }
+    }
+
+    /** Restart every strategy, or only those over maps in domain, from
+     * first_seqno. Must be called whenever the state of indexed maps is
+     * replaced wholesale (i.e. a snapshot is applied, or private maps are
+     * swapped in on recovery), since the individual writes before first_seqno
+     * are never reported. The replaced state is reported by the next
+     * compaction, at earlier versions, and ignored.
+     */
+    void reset_strategies(
+      ccf::SeqNo first_seqno,
+      std::optional<kv::SecurityDomain> domain = std::nullopt)
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      for (auto& [map_name, map_strategies] : strategies)
+      {
+        if (
+          domain.has_value() &&
+          kv::get_security_domain(map_name) != domain.value())
+        {
+          continue;
+        }
+
+        for (auto& strategy : map_strategies)
+        {
+          strategy->reset(first_seqno);
+        }
+      }
+    }
+
+    bool uninstall_strategy(const StrategyPtr& strategy) override
+    {
+      if (strategy == nullptr)
+      {
+        return false;
+      }
+
+      std::lock_guard<std::mutex> install_guard(install_lock);
+      const auto& map_name = strategy->get_indexed_map_name();
+
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        const auto it = strategies.find(map_name);
+        if (it == strategies.end())
+        {
+          return false;
+        }
+
+        auto& map_strategies = it->second;
+        const auto strategy_it =
+          std::find(map_strategies.begin(), map_strategies.end(), strategy);
+        if (strategy_it == map_strategies.end())
+        {
+          return false;
+        }
+
+        map_strategies.erase(strategy_it);
+        if (!map_strategies.empty())
+        {
+          return true;
+        }
+        strategies.erase(it);
+      }
+
+      const auto hook_it = hook_ids.find(map_name);
+      if (hook_it != hook_ids.end())
+      {
+        store.remove_global_hook(map_name, hook_it->second);
+        hook_ids.erase(hook_it);
+      }
+
+      return true;
+    }
+  };
+}
@@ -0,0 +1,236 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+
+#include "ccf/indexing/strategies/seqnos_by_key.h"
+#include "indexing/indexer.h"
+#include "kv/store.h"
+#include "kv/test/null_encryptor.h"
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+using StringString = kv::Map<std::string, std::string>;
+using Seqnos = std::vector<ccf::SeqNo>;
+using Ranges = std::vector<std::pair<ccf::SeqNo, ccf::SeqNo>>;
+
+ccf::SeqNo write(
+  kv::Store& store,
+  const StringString& map,
+  const std::map<std::string, std::optional<std::string>>& writes)
+{
+  auto tx = store.create_tx();
+  auto handle = tx.rw(map);
+  for (const auto& [k, v] : writes)
+  {
+    if (v.has_value())
+    {
+      handle->put(k, v.value());
+    }
+    else
+    {
+      handle->remove(k);
+    }
+  }
+  REQUIRE(tx.commit() == kv::CommitResult::SUCCESS);
+  return tx.commit_version();
+}
+
+TEST_CASE("SeqnosByKey indexes committed writes")
+{
+  kv::Store store;
+  StringString map("public:map");
+  StringString other_map("public:other_map");
+
+  ccf::indexing::Indexer indexer(store);
+  auto index =
+    std::make_shared<ccf::indexing::strategies::SeqnosByKey<StringString>>(
+      map);
+  indexer.install_strategy(index);
+  REQUIRE(index->get_indexed_from() == 1);
+
+  const auto a = write(store, map, {{"foo", "1"}, {"bar", "1"}});
+  const auto b = write(store, other_map, {{"foo", "2"}});
+  const auto c = write(store, map, {{"foo", "3"}});
+  const auto d = write(store, map, {{"foo", std::nullopt}});
+
+  {
+    INFO("Writes are only indexed once committed");
+    REQUIRE(index->get_write_txs_in_range("foo", 1, d) == Seqnos{});
+    store.compact(c);
+    REQUIRE(index->get_write_txs_in_range("foo", 1, d) == Seqnos{a, c});
+    store.compact(d);
+  }
+
+  {
+    INFO("Removals are indexed, and other maps are ignored");
+    REQUIRE(index->get_write_txs_in_range("foo", 1, d) == Seqnos{a, c, d});
+    REQUIRE(index->get_write_txs_in_range("bar", 1, d) == Seqnos{a});
+    REQUIRE(index->get_write_txs_in_range("baz", 1, d) == Seqnos{});
+    REQUIRE(index->get_write_txs_in_range("foo", b, c) == Seqnos{c});
+    REQUIRE(index->get_write_txs_in_range("foo", d + 1, d + 10) == Seqnos{});
+  }
+
+  {
+    INFO("Strategies installed later only index later transactions");
+    auto late_index =
+      std::make_shared<ccf::indexing::strategies::SeqnosByKey<StringString>>(
+        map);
+    indexer.install_strategy(late_index);
+    REQUIRE(late_index->get_indexed_from() == d + 1);
+    REQUIRE_FALSE(late_index->get_write_txs_in_range("foo", 1, d).has_value());
+
+    const auto e = write(store, map, {{"foo", "4"}});
+    store.compact(e);
+    REQUIRE(late_index->get_write_txs_in_range("foo", d + 1, e) == Seqnos{e});
+    REQUIRE(index->get_write_txs_in_range("foo", 1, e) == Seqnos{a, c, d, e});
+
+    INFO("Uninstalled strategies are no longer updated");
+    REQUIRE(indexer.uninstall_strategy(late_index));
+    REQUIRE_FALSE(indexer.uninstall_strategy(late_index));
+    const auto f = write(store, map, {{"foo", "5"}});
+    store.compact(f);
+    REQUIRE(late_index->get_write_txs_in_range("foo", d + 1, f) == Seqnos{e});
+    REQUIRE(
+      index->get_write_txs_in_range("foo", 1, f) == Seqnos{a, c, d, e, f});
+  }
+}
+
+TEST_CASE("Indexing does not replace other global hooks")
+{
+  kv::Store store;
+  StringString map("public:map");
+
+  std::vector<ccf::SeqNo> hooked;
+  store.set_global_hook(
+    map.get_name(),
+    map.wrap_commit_hook(
+      [&hooked](kv::Version v, const StringString::Write&) {
+        hooked.push_back(v);
+      }));
+
+  ccf::indexing::Indexer indexer(store);
+  auto index =
+    std::make_shared<ccf::indexing::strategies::SeqnosByKey<StringString>>(
+      map);
+  indexer.install_strategy(index);
+
+  const auto a = write(store, map, {{"foo", "1"}});
+  store.compact(a);
+  REQUIRE(hooked == Seqnos{a});
+  REQUIRE(index->get_write_txs_in_range("foo", 1, a) == Seqnos{a});
+
+  REQUIRE(indexer.uninstall_strategy(index));
+  const auto b = write(store, map, {{"foo", "2"}});
+  store.compact(b);
+  REQUIRE(hooked == Seqnos{a, b});
+}
+
+TEST_CASE("SeqnosByKeyBucketed indexes committed writes")
+{
+  kv::Store store;
+  StringString map("public:map");
+
+  ccf::indexing::Indexer indexer(store);
+  constexpr size_t bucket_size = 5;
+  auto index = std::make_shared<
+    ccf::indexing::strategies::SeqnosByKeyBucketed<StringString>>(
+    map, bucket_size);
+  indexer.install_strategy(index);
+
+  // Write foo at 1, 2, 7, 11 and 23, and bar everywhere else
+  ccf::SeqNo last = 0;
+  for (ccf::SeqNo seqno = 1; seqno <= 25; ++seqno)
+  {
+    const auto key =
+      (seqno == 1 || seqno == 2 || seqno == 7 || seqno == 11 || seqno == 23) ?
+      "foo" :
+      "bar";
+    last = write(store, map, {{key, std::to_string(seqno)}});
+    REQUIRE(last == seqno);
+  }
+  store.compact(last);
+
+  REQUIRE(
+    index->get_write_ranges_in_range("foo", 1, last) ==
+    Ranges{{1, 14}, {20, 24}});
+  REQUIRE(
+    index->get_write_ranges_in_range("foo", 3, 21) ==
+    Ranges{{3, 14}, {20, 21}});
+  REQUIRE(index->get_write_ranges_in_range("foo", 15, 19) == Ranges{});
+  REQUIRE(index->get_write_ranges_in_range("bar", 1, last) == Ranges{{1, 25}});
+  REQUIRE(index->get_write_ranges_in_range("baz", 1, last) == Ranges{});
+}
+
+TEST_CASE("Indexes restart from the last applied snapshot")
+{
+  StringString map("public:map");
+
+  kv::Store source_store;
+  write(source_store, map, {{"foo", "1"}});
+  const auto snapshot_version = write(source_store, map, {{"foo", "2"}});
+  auto snapshot = source_store.serialise_snapshot(
+    source_store.snapshot(snapshot_version));
+
+  kv::Store store;
+  ccf::indexing::Indexer indexer(store);
+  auto index =
+    std::make_shared<ccf::indexing::strategies::SeqnosByKey<StringString>>(
+      map);
+  indexer.install_strategy(index);
+
+  kv::ConsensusHookPtrs hooks;
+  REQUIRE(
+    store.deserialise_snapshot(snapshot, hooks) == kv::ApplyResult::PASS);
+  REQUIRE(store.last_snapshot_version() == snapshot_version);
+  indexer.reset_strategies(snapshot_version + 1);
+
+  const auto next = write(store, map, {{"foo", "3"}});
+  store.compact(next);
+
+  INFO("The snapshotted state is not mistaken for individual writes");
+  REQUIRE(index->get_indexed_from() == snapshot_version + 1);
+  REQUIRE_FALSE(
+    index->get_write_txs_in_range("foo", 1, snapshot_version).has_value());
+  REQUIRE(
+    index->get_write_txs_in_range("foo", snapshot_version + 1, next) ==
+    Seqnos{next});
+}
+
+TEST_CASE("Indexes can be restarted for a single security domain")
+{
+  kv::Store store;
+  store.set_encryptor(std::make_shared<kv::NullTxEncryptor>());
+  StringString public_map("public:map");
+  StringString private_map("map");
+
+  ccf::indexing::Indexer indexer(store);
+  auto public_index =
+    std::make_shared<ccf::indexing::strategies::SeqnosByKey<StringString>>(
+      public_map);
+  auto private_index =
+    std::make_shared<ccf::indexing::strategies::SeqnosByKey<StringString>>(
+      private_map);
+  indexer.install_strategy(public_index);
+  indexer.install_strategy(private_index);
+
+  const auto first = write(store, public_map, {{"foo", "1"}});
+  write(store, private_map, {{"foo", "2"}});
+  const auto reset_version = write(store, private_map, {{"foo", "3"}});
+
+  INFO("Only strategies over private maps are restarted");
+  indexer.reset_strategies(reset_version + 1, kv::SecurityDomain::PRIVATE);
+  REQUIRE(public_index->get_indexed_from() == 1);
+  REQUIRE(private_index->get_indexed_from() == reset_version + 1);
+
+  const auto next = write(store, private_map, {{"foo", "4"}});
+  store.compact(next);
+
+  INFO("Writes before the reset are ignored by restarted strategies");
+  REQUIRE(
+    public_index->get_write_txs_in_range("foo", 1, next) == Seqnos{first});
+  REQUIRE_FALSE(private_index->get_write_txs_in_range("foo", 1, reset_version)
+                  .has_value());
+  REQUIRE(
+    private_index->get_write_txs_in_range("foo", reset_version + 1, next) ==
+    Seqnos{next});
+}
@@ -4,9 +4,11 @@
 
 #include "ds/champ_map.h"
 #include "ds/hash.h"
+#include "ds/rb_map.h"
 #include "kv/kv_types.h"
 
 #include <map>
+#include <variant>
 
 namespace kv
 {
@@ -17,6 +19,12 @@ namespace kv
   template <typename K, typename V, typename H>
   using Snapshot = champ::Snapshot<K, VersionV<V>, H>;
 
+  // Persistent, ordered index over the keys present in a State (including
+  // deleted keys, which remain in the State with a deleted version). This is
+  // only maintained for maps which are accessed through ordered handles.
+  template <typename K>
+  using OrderedKeys = RBMap<K, std::monostate>;
+
   // This is a map of keys and with a tuple of the key's write version and the
   // version of last transaction which read the key and committed successfully
   using LastReadVersion = Version;
@@ -41,6 +49,10 @@ namespace kv
     const State<K, V, H> committed = {};
     const Version start_version = {};
 
+    // Ordered index over the keys of state. Only present if this change set
+    // was created for an ordered handle.
+    std::optional<OrderedKeys<K>> ordered_keys = std::nullopt;
+
     Version read_version = NoVersion;
     Read<K> reads = {};
     Write<K, V> writes = {};
@@ -49,11 +61,14 @@ namespace kv
       size_t rollbacks,
       State<K, V, H>& current_state,
       State<K, V, H>& committed_state,
-      Version current_version) :
+      Version current_version,
+      const std::optional<OrderedKeys<K>>& current_ordered_keys =
+        std::nullopt) :
       rollback_counter(rollbacks),
       state(current_state),
       committed(committed_state),
-      start_version(current_version)
+      start_version(current_version),
+      ordered_keys(current_ordered_keys)
     {}
 
     ChangeSet(ChangeSet&) = delete;
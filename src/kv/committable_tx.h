@@ -4,9 +4,11 @@
 
 #include "apply_changes.h"
 #include "ccf/tx.h"
+#include "ds/latency_clock.h"
 #include "kv_serialiser.h"
 #include "kv_types.h"
 
+#include <chrono>
 #include <list>
 
 namespace kv
@@ -42,6 +44,11 @@ namespace kv
 
     kv::TxHistory::RequestID req_id;
 
+    // Time spent handing the serialised transaction to the store, which
+    // appends it to the history and passes it to consensus for replication
+    std::optional<ds::LatencyClock::duration> replication_handoff_time =
+      std::nullopt;
+
     std::vector<uint8_t> serialise(bool include_reads = false)
     {
       if (!committed)
@@ -208,10 +215,23 @@ namespace kv
             return CommitResult::SUCCESS;
           }
 
-          return store->commit(
+          // Hash the serialised (and encrypted) entry here, concurrently with
+          // other transactions, so that the store only has to append the
+          // digest to the history while holding its version lock.
+          std::optional<crypto::Sha256Hash> digest = std::nullopt;
+          if (store->get_history() != nullptr)
+          {
+            digest = crypto::Sha256Hash({data.data(), data.size()});
+          }
+
+          const auto handoff_start = ds::LatencyClock::now();
+          const auto result = store->commit(
             {commit_view, version},
-            std::make_unique<MovePendingTx>(std::move(data), std::move(hooks)),
+            std::make_unique<MovePendingTx>(
+              std::move(data), std::move(hooks), std::move(digest)),
             false);
+          replication_handoff_time = ds::LatencyClock::since(handoff_start);
+          return result;
         }
         catch (const std::exception& e)
         {
@@ -277,6 +297,15 @@ namespace kv
       return max_conflict_version;
     }
 
+    /** Time taken by the last call to commit() to hand the transaction to the
+     * store for replication, if it got that far and stage timing is enabled
+     */
+    std::optional<ds::LatencyClock::duration> get_replication_handoff_time()
+      const
+    {
+      return replication_handoff_time;
+    }
+
     std::optional<TxID> get_txid()
     {
       if (!committed)
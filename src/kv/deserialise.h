@@ -5,6 +5,7 @@
 #include "apply_changes.h"
 #include "consensus/aft/request.h"
 #include "kv/committable_tx.h"
+#include "kv_serialiser.h"
 #include "kv_types.h"
 #include "node/progress_tracker.h"
 #include "node/signatures.h"
@@ -13,9 +14,33 @@
 
 namespace kv
 {
+  // A serialised entry whose header has been read and whose private domain
+  // has been decrypted, ready for its map changes to be deserialised
+  struct DecryptedEntry
+  {
+    std::unique_ptr<KvStoreDeserialiser> d;
+    kv::Version version = 0;
+    kv::Version max_conflict_version = 0;
+    kv::Term term = 0;
+  };
+
   class ExecutionWrapperStore
   {
   public:
+    virtual std::unique_ptr<DecryptedEntry> decrypt_entry(
+      const std::vector<uint8_t>& data,
+      bool public_only,
+      bool out_of_order = false) = 0;
+
+    virtual bool fill_maps(
+      DecryptedEntry& entry,
+      kv::Version& v,
+      kv::Version& max_conflict_version,
+      kv::Term& view,
+      kv::OrderedChanges& changes,
+      kv::MapCollection& new_maps,
+      bool ignore_strict_versions = false) = 0;
+
     virtual bool fill_maps(
       const std::vector<uint8_t>& data,
       bool public_only,
@@ -46,6 +71,7 @@ namespace kv
     OrderedChanges changes;
     MapCollection new_maps;
     kv::ConsensusHookPtrs hooks;
+    std::unique_ptr<DecryptedEntry> decrypted;
 
   public:
     CFTExecutionWrapper(
@@ -59,19 +85,47 @@ namespace kv
       public_only(public_only_)
     {}
 
+    void prepare() override
+    {
+      // Decryption may fail here if this entry is encrypted with a ledger
+      // secret introduced by an earlier entry that has not yet been applied.
+      // apply() then decrypts the entry again, in order.
+      try
+      {
+        decrypted = store->decrypt_entry(data, public_only, true);
+      }
+      catch (const std::exception& e)
+      {
+        LOG_DEBUG_FMT("Could not decrypt entry ahead of apply: {}", e.what());
+        decrypted = nullptr;
+      }
+    }
+
     ApplyResult apply() override
     {
       kv::Version max_conflict_version;
       kv::Term view;
-      if (!store->fill_maps(
-            data,
-            public_only,
-            v,
-            max_conflict_version,
-            view,
-            changes,
-            new_maps,
-            true))
+      bool filled = false;
+      if (decrypted != nullptr)
+      {
+        filled = store->fill_maps(
+          *decrypted, v, max_conflict_version, view, changes, new_maps, true);
+        decrypted = nullptr;
+      }
+      else
+      {
+        filled = store->fill_maps(
+          data,
+          public_only,
+          v,
+          max_conflict_version,
+          view,
+          changes,
+          new_maps,
+          true);
+      }
+
+      if (!filled)
       {
         return ApplyResult::FAIL;
       }
@@ -25,6 +25,7 @@ namespace kv
     TxID tx_id;
     Version max_conflict_version;
     bool is_snapshot;
+    uint8_t flags;
 
     std::shared_ptr<AbstractTxEncryptor> crypto_util;
 
@@ -59,10 +60,12 @@ namespace kv
       std::shared_ptr<AbstractTxEncryptor> e,
       const TxID& tx_id_,
       const Version& max_conflict_version_,
-      bool is_snapshot_ = false) :
+      bool is_snapshot_ = false,
+      uint8_t flags_ = 0) :
       tx_id(tx_id_),
       max_conflict_version(max_conflict_version_),
       is_snapshot(is_snapshot_),
+      flags(flags_),
       crypto_util(e)
     {
       set_current_domain(SecurityDomain::PUBLIC);
@@ -92,6 +95,14 @@ namespace kv
       serialise_internal(raw);
     }
 
+    // Serialises size bytes, written directly to the serialised output by
+    // write_to, rather than through an intermediate buffer
+    template <typename F>
+    void serialise_raw(size_t size, F&& write_to)
+    {
+      current_writer->append_raw(size, std::forward<F>(write_to));
+    }
+
     void serialise_view_history(const std::vector<Version>& view_history)
     {
       serialise_internal(view_history);
@@ -145,7 +156,7 @@ namespace kv
 
       SerialisedEntryHeader entry_header;
       entry_header.version = entry_format_v1;
-      entry_header.flags = 0;
+      entry_header.flags = flags;
 
       // If no crypto util is set (unit test only), only the header and public
       // domain are serialised
@@ -226,6 +237,7 @@ namespace kv
     bool is_snapshot;
     Version version;
     Version max_conflict_version;
+    uint8_t flags = 0;
     std::shared_ptr<AbstractTxEncryptor> crypto_util;
     std::optional<SecurityDomain> domain_restriction;
 
@@ -265,6 +277,7 @@ namespace kv
         tx_header.size,
         size_);
 
+      flags = tx_header.flags;
       auto gcm_hdr_data = data_;
 
       switch (tx_header.version)
@@ -325,6 +338,11 @@ namespace kv
       return std::make_tuple(version, max_conflict_version);
     }
 
+    uint8_t get_flags() const
+    {
+      return flags;
+    }
+
     std::optional<std::string> start_map()
     {
       if (current_reader->is_eos())
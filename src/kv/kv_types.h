@@ -15,6 +15,7 @@
 #include <functional>
 #include <limits>
 #include <memory>
+#include <optional>
 #include <set>
 #include <string>
 #include <unordered_set>
@@ -77,6 +78,37 @@ namespace kv
   DECLARE_JSON_TYPE(TxID);
   DECLARE_JSON_REQUIRED_FIELDS(TxID, term, version)
 
+  /** Identifies the contents of a single map, as seen by some transaction.
+   * This changes whenever the map is written to or rolled back, so equal
+   * values read from the same map imply that its contents are unchanged.
+   */
+  struct MapVersion
+  {
+    size_t rollback_counter = 0;
+    Version version = NoVersion;
+
+    bool operator==(const MapVersion& other) const
+    {
+      return rollback_counter == other.rollback_counter &&
+        version == other.version;
+    }
+
+    bool operator!=(const MapVersion& other) const
+    {
+      return !(*this == other);
+    }
+
+    // Contents seen after a rollback are newer than any seen before it
+    bool operator<(const MapVersion& other) const
+    {
+      if (rollback_counter != other.rollback_counter)
+      {
+        return rollback_counter < other.rollback_counter;
+      }
+      return version < other.version;
+    }
+  };
+
   struct Configuration
   {
     struct NodeInfo
@@ -357,6 +389,7 @@ namespace kv
       const std::vector<uint8_t>& request,
       uint8_t frame_format) = 0;
     virtual void append(const std::vector<uint8_t>& data) = 0;
+    virtual void append_entry(const crypto::Sha256Hash& digest) = 0;
     virtual void rollback(
       const kv::TxID& tx_id, kv::Term term_of_next_version_) = 0;
     virtual void compact(Version v) = 0;
@@ -475,6 +508,15 @@ namespace kv
   {
   public:
     virtual PendingTxInfo call() = 0;
+
+    // Digest of the data returned by call(), if it was computed before the
+    // pending transaction reached the store. Lets the store append it to the
+    // history without hashing under its version lock.
+    virtual std::optional<crypto::Sha256Hash> get_digest()
+    {
+      return std::nullopt;
+    }
+
     virtual ~PendingTx() = default;
   };
 
@@ -483,11 +525,16 @@ namespace kv
   private:
     std::vector<uint8_t> data;
     ConsensusHookPtrs hooks;
+    std::optional<crypto::Sha256Hash> digest;
 
   public:
-    MovePendingTx(std::vector<uint8_t>&& data_, ConsensusHookPtrs&& hooks_) :
+    MovePendingTx(
+      std::vector<uint8_t>&& data_,
+      ConsensusHookPtrs&& hooks_,
+      std::optional<crypto::Sha256Hash> digest_ = std::nullopt) :
       data(std::move(data_)),
-      hooks(std::move(hooks_))
+      hooks(std::move(hooks_)),
+      digest(std::move(digest_))
     {}
 
     PendingTxInfo call() override
@@ -495,6 +542,11 @@ namespace kv
       return PendingTxInfo(
         CommitResult::SUCCESS, std::move(data), std::move(hooks));
     }
+
+    std::optional<crypto::Sha256Hash> get_digest() override
+    {
+      return digest;
+    }
   };
 
   class AbstractTxEncryptor
@@ -550,6 +602,11 @@ namespace kv
     virtual ~AbstractHandle() = default;
   };
 
+  // Handles deriving from this require their change set to contain an ordered
+  // index of the map's keys
+  class AbstractOrderedHandle : public AbstractHandle
+  {};
+
   struct NamedHandleMixin
   {
   protected:
@@ -574,6 +631,7 @@ namespace kv
     {
     public:
       virtual ~Snapshot() = default;
+      virtual const std::string& get_name() const = 0;
       virtual void serialise(KvStoreSerialiser& s) = 0;
       virtual SecurityDomain get_security_domain() = 0;
     };
@@ -593,6 +651,8 @@ namespace kv
       bool include_reads) = 0;
     virtual void compact(Version v) = 0;
     virtual std::unique_ptr<Snapshot> snapshot(Version v) = 0;
+    virtual std::unique_ptr<Snapshot> delta_snapshot(
+      Version v, const Snapshot* base) = 0;
     virtual void post_compact() = 0;
     virtual void rollback(Version v) = 0;
     virtual void lock() = 0;
@@ -611,6 +671,13 @@ namespace kv
   {
   public:
     virtual ~AbstractExecutionWrapper() = default;
+
+    /** Do any work for apply() which does not depend on earlier entries
+     * having been applied, e.g. decryption. May be called from any thread,
+     * concurrently with the preparation or application of other entries.
+     */
+    virtual void prepare() {}
+
     virtual kv::ApplyResult apply() = 0;
     virtual kv::ConsensusHookPtrs& get_hooks() = 0;
     virtual const std::vector<uint8_t>& get_entry() = 0;
@@ -646,6 +713,11 @@ namespace kv
     public:
       virtual ~AbstractSnapshot() = default;
       virtual Version get_version() const = 0;
+      // Only set for a delta snapshot, holding the changes since a previous
+      // (full or delta) snapshot at this version
+      virtual std::optional<Version> get_base_version() const = 0;
+      virtual std::vector<std::unique_ptr<AbstractMap::Snapshot>>&
+      get_map_snapshots() = 0;
       virtual std::vector<uint8_t> serialise(
         std::shared_ptr<AbstractTxEncryptor> encryptor) = 0;
     };
@@ -689,6 +761,8 @@ namespace kv
       bool globally_committable) = 0;
 
     virtual std::unique_ptr<AbstractSnapshot> snapshot(Version v) = 0;
+    virtual std::unique_ptr<AbstractSnapshot> delta_snapshot(
+      Version v, AbstractSnapshot& base) = 0;
     virtual std::vector<uint8_t> serialise_snapshot(
       std::unique_ptr<AbstractSnapshot> snapshot) = 0;
     virtual ApplyResult deserialise_snapshot(
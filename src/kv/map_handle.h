@@ -108,6 +108,19 @@ namespace kv
         KSerialiser::to_serialised(key));
     }
 
+    /** Get the version of the whole map seen by this transaction.
+     *
+     * This identifies the last applied write to any key in the map, and does
+     * not include this transaction's pending writes. Unlike @c get or @c has,
+     * this does not introduce a read dependency on any key.
+     *
+     * @return Version of the map's applied state
+     */
+    MapVersion get_map_version() const
+    {
+      return read_handle.get_map_version();
+    }
+
     /** Iterate over all entries in the map.
      *
      * The passed functor should have the signature `bool(const K& k, const V&
@@ -26,6 +26,14 @@ namespace kv
       arr.push_back(obj);
     }
 
+    template <typename F>
+    void append_raw(size_t size, F&& write_to)
+    {
+      std::vector<uint8_t> raw(size);
+      write_to(raw.data());
+      append(raw);
+    }
+
     void clear()
     {
       arr.clear();
@@ -0,0 +1,53 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+#pragma once
+
+#include "kv/map.h"
+#include "kv/ordered_map_handle.h"
+
+namespace kv
+{
+  /** Defines the schema of an ordered map within the @c kv::Store. This
+   * behaves as a @c kv::TypedMap, and is stored, replicated and snapshotted
+   * identically, but its handles additionally support iterating over entries
+   * in key order, within a range of keys, and in reverse.
+   *
+   * Keys are ordered by the byte-wise comparison of their serialised form.
+   * KSerialiser should therefore preserve the natural order of K; by default
+   * this uses @c kv::serialisers::OrderedBlitSerialiser.
+   *
+   * An ordered index of the map's keys is maintained by the @c kv::Store once
+   * a handle over this map has been requested, and is updated incrementally as
+   * transactions are applied. The same underlying map can still be accessed
+   * with unordered handles.
+   */
+  template <typename K, typename V, typename KSerialiser, typename VSerialiser>
+  class TypedOrderedMap : public TypedMap<K, V, KSerialiser, VSerialiser>
+  {
+  public:
+    using ReadOnlyHandle =
+      kv::ReadableOrderedMapHandle<K, V, KSerialiser, VSerialiser>;
+    using Handle = kv::OrderedMapHandle<K, V, KSerialiser, VSerialiser>;
+
+    using TypedMap<K, V, KSerialiser, VSerialiser>::TypedMap;
+  };
+
+  template <
+    typename K,
+    typename V,
+    template <typename>
+    typename KSerialiser,
+    template <typename> typename VSerialiser = KSerialiser>
+  using OrderedMapSerialisedWith =
+    TypedOrderedMap<K, V, KSerialiser<K>, VSerialiser<V>>;
+
+  /** Short name for ordered maps, with order-preserving key serialisation and
+   * JSON-serialised values.
+   */
+  template <typename K, typename V>
+  using OrderedMap = TypedOrderedMap<
+    K,
+    V,
+    kv::serialisers::OrderedBlitSerialiser<K>,
+    kv::serialisers::JsonSerialiser<V>>;
+}
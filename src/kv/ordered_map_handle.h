@@ -0,0 +1,157 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+#pragma once
+
+#include "kv/map_handle.h"
+
+namespace kv
+{
+  /** Grants read access to a @c kv::OrderedMap, as part of a @c kv::Tx.
+   *
+   * In addition to the operations of @c kv::ReadableMapHandle, this supports
+   * iterating over entries in key order. Keys are ordered by the byte-wise
+   * comparison of their serialised form, which matches the natural order of
+   * K only for serialisers which preserve it (see
+   * @c kv::serialisers::OrderedBlitSerialiser).
+   *
+   * All ordered iterations record a read dependency on the entire map, in the
+   * same way as @c foreach, so a transaction calling them will conflict with
+   * any concurrent write to this map.
+   */
+  template <typename K, typename V, typename KSerialiser, typename VSerialiser>
+  class ReadableOrderedMapHandle
+    : public ReadableMapHandle<K, V, KSerialiser, VSerialiser>
+  {
+  protected:
+    using ReadableBase = ReadableMapHandle<K, V, KSerialiser, VSerialiser>;
+
+    template <class F>
+    void range_internal(
+      const std::optional<K>& from,
+      const std::optional<K>& to,
+      bool reverse,
+      F&& f)
+    {
+      std::optional<kv::serialisers::SerialisedEntry> from_rep = std::nullopt;
+      if (from.has_value())
+      {
+        from_rep = KSerialiser::to_serialised(from.value());
+      }
+
+      std::optional<kv::serialisers::SerialisedEntry> to_rep = std::nullopt;
+      if (to.has_value())
+      {
+        to_rep = KSerialiser::to_serialised(to.value());
+      }
+
+      auto g = [&](
+                 const kv::serialisers::SerialisedEntry& k_rep,
+                 const kv::serialisers::SerialisedEntry& v_rep) {
+        return f(
+          KSerialiser::from_serialised(k_rep),
+          VSerialiser::from_serialised(v_rep));
+      };
+      this->read_handle.range(from_rep, to_rep, reverse, g);
+    }
+
+  public:
+    using ReadableBase::ReadableBase;
+
+    /** Iterate over the entries whose key is in [from, to), in ascending key
+     * order.
+     *
+     * Iteration termination follows the same rules as
+     * @c kv::ReadableMapHandle::foreach. The functor must not modify this map,
+     * and any attempt to do so throws.
+     *
+     * @param from Inclusive lower bound
+     * @param to Exclusive upper bound
+     * @param f Functor instance, taking (const K& k, const V& v) and returning
+     * a bool. Return value determines whether the iteration should continue
+     * (true) or stop (false)
+     */
+    template <class F>
+    void range(const K& from, const K& to, F&& f)
+    {
+      range_internal(from, to, false, f);
+    }
+
+    /** Iterate over the entries whose key is in [from, to), in descending key
+     * order.
+     *
+     * @see range
+     */
+    template <class F>
+    void range_reverse(const K& from, const K& to, F&& f)
+    {
+      range_internal(from, to, true, f);
+    }
+
+    /** Iterate over all entries in the map, in ascending key order.
+     *
+     * @see range
+     */
+    template <class F>
+    void foreach_ordered(F&& f)
+    {
+      range_internal(std::nullopt, std::nullopt, false, f);
+    }
+
+    /** Iterate over all entries in the map, in descending key order. Stopping
+     * this iteration early can be used to retrieve the last N entries.
+     *
+     * @see range
+     */
+    template <class F>
+    void foreach_reverse(F&& f)
+    {
+      range_internal(std::nullopt, std::nullopt, true, f);
+    }
+
+    /** Get the first entry whose key is not less than key.
+     *
+     * @param key Key to search for
+     *
+     * @return Optional containing the entry, or empty if all keys in the map
+     * are less than key
+     */
+    std::optional<std::pair<K, V>> lower_bound(const K& key)
+    {
+      std::optional<std::pair<K, V>> entry = std::nullopt;
+      range_internal(
+        key, std::nullopt, false, [&entry](const K& k, const V& v) {
+          entry = std::make_pair(k, v);
+          return false;
+        });
+      return entry;
+    }
+  };
+
+  /** Grants read and write access to a @c kv::OrderedMap, as part of a
+   * @c kv::Tx.
+   *
+   * @see kv::ReadableOrderedMapHandle
+   * @see kv::WriteableMapHandle
+   */
+  template <typename K, typename V, typename KSerialiser, typename VSerialiser>
+  class OrderedMapHandle
+    : public AbstractOrderedHandle,
+      public ReadableOrderedMapHandle<K, V, KSerialiser, VSerialiser>,
+      public WriteableMapHandle<K, V, KSerialiser, VSerialiser>
+  {
+  protected:
+    kv::untyped::MapHandle untyped_handle;
+
+    using ReadableBase =
+      ReadableOrderedMapHandle<K, V, KSerialiser, VSerialiser>;
+    using WriteableBase = WriteableMapHandle<K, V, KSerialiser, VSerialiser>;
+
+  public:
+    OrderedMapHandle(
+      kv::untyped::ChangeSet& changes, const std::string& map_name) :
+      ReadableBase(untyped_handle),
+      WriteableBase(untyped_handle),
+      untyped_handle(changes, map_name)
+    {}
+  };
+}
@@ -88,6 +88,17 @@ namespace kv
       }
     }
 
+    // Appends a size-prefixed entry of size bytes, which is written in place
+    // by write_to
+    template <typename F>
+    void append_raw(size_t size, F&& write_to)
+    {
+      serialise_entry(size);
+      size_t size_before = buf.size();
+      buf.resize(buf.size() + size);
+      write_to(buf.data() + size_before);
+    }
+
     void clear()
     {
       buf.clear();
@@ -79,4 +79,58 @@ namespace kv::serialisers
       }
     }
   };
-}
\ No newline at end of file
+
+  /** Serialises keys such that the byte-wise order of their serialisations
+   * matches the natural order of the unserialised values, for use with
+   * @c kv::OrderedMap. Strings and byte containers are copied directly, while
+   * unsigned integrals are written big-endian.
+   */
+  template <typename T>
+  struct OrderedBlitSerialiser
+  {
+    static SerialisedEntry to_serialised(const T& t)
+    {
+      if constexpr (std::is_integral_v<T>)
+      {
+        static_assert(
+          std::is_unsigned_v<T>,
+          "Only unsigned integrals can be serialised in order");
+        SerialisedEntry s(sizeof(t));
+        for (size_t i = 0; i < sizeof(t); ++i)
+        {
+          s[i] = static_cast<uint8_t>(t >> (8 * (sizeof(t) - 1 - i)));
+        }
+        return s;
+      }
+      else
+      {
+        return BlitSerialiser<T>::to_serialised(t);
+      }
+    }
+
+    static T from_serialised(const SerialisedEntry& rep)
+    {
+      if constexpr (std::is_integral_v<T>)
+      {
+        if (rep.size() != sizeof(T))
+        {
+          throw std::logic_error(fmt::format(
+            "Wrong serialised size {} for deserialisation of integral of size "
+            "{}",
+            rep.size(),
+            sizeof(T)));
+        }
+        T t = 0;
+        for (size_t i = 0; i < sizeof(T); ++i)
+        {
+          t = static_cast<T>((t << 8) | rep[i]);
+        }
+        return t;
+      }
+      else
+      {
+        return BlitSerialiser<T>::from_serialised(rep);
+      }
+    }
+  };
+}
@@ -10,6 +10,12 @@ namespace kv
 {
   static constexpr auto entry_format_v1 = 1;
 
+  enum SerialisedEntryFlags : uint8_t
+  {
+    // The entry is a snapshot holding only the changes since another snapshot
+    DELTA_SNAPSHOT = 1 << 0,
+  };
+
   // 6 bytes are used for the size of the serialised entry
   static const size_t max_entry_size = 1UL << 48;
 
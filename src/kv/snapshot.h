@@ -10,13 +10,18 @@ namespace kv
   {
   private:
     Version version;
+    std::optional<Version> base_version = std::nullopt;
 
     std::vector<std::unique_ptr<kv::AbstractMap::Snapshot>> snapshots;
     std::optional<std::vector<uint8_t>> hash_at_snapshot = std::nullopt;
     std::optional<std::vector<Version>> view_history = std::nullopt;
 
   public:
-    StoreSnapshot(Version version_) : version(version_) {}
+    StoreSnapshot(
+      Version version_, std::optional<Version> base_version_ = std::nullopt) :
+      version(version_),
+      base_version(base_version_)
+    {}
 
     void add_map_snapshot(std::unique_ptr<kv::AbstractMap::Snapshot> snapshot)
     {
@@ -38,6 +43,17 @@ namespace kv
       return version;
     }
 
+    std::optional<Version> get_base_version() const
+    {
+      return base_version;
+    }
+
+    std::vector<std::unique_ptr<kv::AbstractMap::Snapshot>>&
+    get_map_snapshots()
+    {
+      return snapshots;
+    }
+
     std::vector<uint8_t> serialise(
       std::shared_ptr<AbstractTxEncryptor> encryptor)
     {
@@ -46,7 +62,18 @@ namespace kv
       // serialized.
       // Note: Snapshots are always taken at compacted state so version only is
       // unique enough to prevent IV reuse
-      KvStoreSerialiser serialiser(encryptor, {0, version}, version - 1, true);
+      KvStoreSerialiser serialiser(
+        encryptor,
+        {0, version},
+        version - 1,
+        true,
+        base_version.has_value() ? SerialisedEntryFlags::DELTA_SNAPSHOT : 0);
+
+      // A delta snapshot can only be applied on top of its base
+      if (base_version.has_value())
+      {
+        serialiser.serialise_entry_version(base_version.value());
+      }
 
       if (hash_at_snapshot.has_value())
       {
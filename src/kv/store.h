@@ -34,6 +34,10 @@ namespace kv
     Version last_new_map = kv::NoVersion;
     Version compacted = 0;
 
+    // Version of the last snapshot applied to this store. The individual
+    // writes at or before this version were never seen by this store.
+    Version last_snapshot = 0;
+
     // Term at which write future transactions should be committed.
     Term term_of_next_version = 0;
 
@@ -61,6 +65,7 @@ namespace kv
 
       version = 0;
       compacted = 0;
+      last_snapshot = 0;
       term_of_next_version = 0;
       term_of_last_version = 0;
 
@@ -75,7 +80,18 @@ namespace kv
                 public ExecutionWrapperStore
   {
   private:
-    using Hooks = std::map<std::string, kv::untyped::Map::CommitHook>;
+  public:
+    using GlobalHookId = size_t;
+
+  private:
+    // Each map may have several global hooks. The one set with
+    // set_global_hook() is recorded under default_global_hook_id, while
+    // add_global_hook() hands out a new id for each subscriber.
+    static constexpr GlobalHookId default_global_hook_id = 0;
+    GlobalHookId next_global_hook_id = default_global_hook_id + 1;
+
+    using GlobalHooks = std::map<GlobalHookId, kv::untyped::Map::CommitHook>;
+    using Hooks = std::map<std::string, GlobalHooks>;
     using MapHooks = std::map<std::string, kv::untyped::Map::MapHook>;
     Hooks global_hooks;
     MapHooks map_hooks;
@@ -288,7 +304,7 @@ namespace kv
         const auto global_it = global_hooks.find(map_name);
         if (global_it != global_hooks.end())
         {
-          map->set_global_hook(global_it->second);
+          map->set_global_hooks(get_global_hooks(global_it->second));
         }
 
         const auto map_it = map_hooks.find(map_name);
@@ -331,6 +347,26 @@ namespace kv
     }
 
     std::unique_ptr<AbstractSnapshot> snapshot(Version v) override
+    {
+      return snapshot_(v, nullptr);
+    }
+
+    std::unique_ptr<AbstractSnapshot> delta_snapshot(
+      Version v, AbstractSnapshot& base) override
+    {
+      if (base.get_version() >= v)
+      {
+        throw std::logic_error(fmt::format(
+          "Cannot take delta snapshot at version {} from base at version {}",
+          v,
+          base.get_version()));
+      }
+
+      return snapshot_(v, &base);
+    }
+
+    std::unique_ptr<AbstractSnapshot> snapshot_(
+      Version v, AbstractSnapshot* base)
     {
       auto cv = compacted_version();
       if (v < cv)
@@ -351,7 +387,18 @@ namespace kv
           current_version()));
       }
 
-      auto snapshot = std::make_unique<StoreSnapshot>(v);
+      std::optional<Version> base_version = std::nullopt;
+      std::map<std::string, const AbstractMap::Snapshot*> base_maps;
+      if (base != nullptr)
+      {
+        base_version = base->get_version();
+        for (const auto& map_snapshot : base->get_map_snapshots())
+        {
+          base_maps[map_snapshot->get_name()] = map_snapshot.get();
+        }
+      }
+
+      auto snapshot = std::make_unique<StoreSnapshot>(v, base_version);
 
       {
         std::lock_guard<std::mutex> mguard(maps_lock);
@@ -365,7 +412,16 @@ namespace kv
         for (auto& it : maps)
         {
           auto& [_, map] = it.second;
-          snapshot->add_map_snapshot(map->snapshot(v));
+          if (base == nullptr)
+          {
+            snapshot->add_map_snapshot(map->snapshot(v));
+          }
+          else
+          {
+            auto base_map = base_maps.find(it.first);
+            snapshot->add_map_snapshot(map->delta_snapshot(
+              v, base_map == base_maps.end() ? nullptr : base_map->second));
+          }
         }
 
         auto h = get_history();
@@ -418,6 +474,25 @@ namespace kv
       }
       auto [v, _] = v_.value();
 
+      // A delta snapshot only holds the changes since its base snapshot, which
+      // must be the last one applied to this store
+      const bool is_delta =
+        d.get_flags() & SerialisedEntryFlags::DELTA_SNAPSHOT;
+      if (is_delta)
+      {
+        const auto base_version = d.deserialise_entry_version();
+        if (base_version != current_version())
+        {
+          LOG_FAIL_FMT(
+            "Cannot apply delta snapshot at version {} from base version {} "
+            "to store at version {}",
+            v,
+            base_version,
+            current_version());
+          return ApplyResult::FAIL;
+        }
+      }
+
       std::lock_guard<std::mutex> mguard(maps_lock);
 
       for (auto& it : maps)
@@ -476,7 +551,8 @@ namespace kv
           return ApplyResult::FAIL;
         }
 
-        auto deserialised_snapshot_changes =
+        auto deserialised_snapshot_changes = is_delta ?
+          map->deserialise_snapshot_delta_changes(d) :
           map->deserialise_snapshot_changes(d);
 
         // Take ownership of the produced change set, store it to be committed
@@ -515,6 +591,7 @@ namespace kv
         version = v;
         last_replicated = v;
         last_committable = v;
+        last_snapshot = v;
       }
 
       if (h)
@@ -689,25 +766,66 @@ namespace kv
       MapCollection& new_maps,
       bool ignore_strict_versions = false) override
     {
-      // This will return FAILED if the serialised transaction is being
-      // applied out of order.
-      // Processing transactions locally and also deserialising to the
-      // same store will result in a store version mismatch and
-      // deserialisation will then fail.
-      auto e = get_encryptor();
+      auto entry = decrypt_entry(data, public_only);
+      if (entry == nullptr)
+      {
+        LOG_FAIL_FMT("Initialisation of deserialise object failed");
+        return false;
+      }
 
-      auto d = KvStoreDeserialiser(
-        e,
+      return fill_maps(
+        *entry,
+        v,
+        max_conflict_version,
+        view,
+        changes,
+        new_maps,
+        ignore_strict_versions);
+    }
+
+    std::unique_ptr<DecryptedEntry> decrypt_entry(
+      const std::vector<uint8_t>& data,
+      bool public_only,
+      bool out_of_order = false) override
+    {
+      // Ledger secrets are usually looked up assuming that entries are
+      // decrypted in order. Entries decrypted ahead of earlier ones must not
+      // rely on (or advance) that, so use the same lookup as historical
+      // entries.
+      auto entry = std::make_unique<DecryptedEntry>();
+      entry->d = std::make_unique<KvStoreDeserialiser>(
+        get_encryptor(),
         public_only ? kv::SecurityDomain::PUBLIC :
                       std::optional<kv::SecurityDomain>());
 
-      auto v_ = d.init(data.data(), data.size(), view, is_historical);
+      auto v_ = entry->d->init(
+        data.data(), data.size(), entry->term, is_historical || out_of_order);
       if (!v_.has_value())
       {
-        LOG_FAIL_FMT("Initialisation of deserialise object failed");
-        return false;
+        return nullptr;
       }
-      std::tie(v, max_conflict_version) = v_.value();
+      std::tie(entry->version, entry->max_conflict_version) = v_.value();
+      return entry;
+    }
+
+    bool fill_maps(
+      DecryptedEntry& entry,
+      kv::Version& v,
+      kv::Version& max_conflict_version,
+      kv::Term& view,
+      OrderedChanges& changes,
+      MapCollection& new_maps,
+      bool ignore_strict_versions = false) override
+    {
+      // This will return FAILED if the serialised transaction is being
+      // applied out of order.
+      // Processing transactions locally and also deserialising to the
+      // same store will result in a store version mismatch and
+      // deserialisation will then fail.
+      auto& d = *entry.d;
+      v = entry.version;
+      max_conflict_version = entry.max_conflict_version;
+      view = entry.term;
 
       // Throw away any local commits that have not propagated via the
       // consensus.
@@ -967,6 +1085,12 @@ namespace kv
       return compacted;
     }
 
+    Version last_snapshot_version()
+    {
+      std::lock_guard<std::mutex> vguard(version_lock);
+      return last_snapshot;
+    }
+
     Term commit_view() override
     {
       // Must lock in case the commit_view is being incremented.
@@ -1032,6 +1156,7 @@ namespace kv
 
           auto& [pending_tx_, committable_] = search->second;
           auto [success_, data_, hooks_] = pending_tx_->call();
+          auto digest_ = pending_tx_->get_digest();
           auto data_shared =
             std::make_shared<std::vector<uint8_t>>(std::move(data_));
           auto hooks_shared =
@@ -1048,7 +1173,17 @@ namespace kv
 
           if (h)
           {
-            h->append(*data_shared);
+            // Most transactions are serialised and hashed by the thread that
+            // executed them, before reaching this point. Only those that were
+            // not (e.g. signatures) are hashed under the version lock.
+            if (digest_.has_value())
+            {
+              h->append_entry(digest_.value());
+            }
+            else
+            {
+              h->append(*data_shared);
+            }
           }
 
           LOG_DEBUG_FMT(
@@ -1259,29 +1394,87 @@ namespace kv
       }
     }
 
-    void set_global_hook(
-      const std::string& map_name, const kv::untyped::Map::CommitHook& hook)
+  private:
+    static std::vector<kv::untyped::Map::CommitHook> get_global_hooks(
+      const GlobalHooks& hooks)
     {
-      global_hooks[map_name] = hook;
-
-      const auto it = maps.find(map_name);
-      if (it != maps.end())
+      std::vector<kv::untyped::Map::CommitHook> result;
+      result.reserve(hooks.size());
+      for (const auto& [_, hook] : hooks)
       {
-        it->second.second->set_global_hook(hook);
+        result.push_back(hook);
       }
+      return result;
     }
 
-    void unset_global_hook(const std::string& map_name)
+    // Must be called with maps_lock held, since maps read their global hooks
+    // during compaction
+    void update_global_hooks(const std::string& map_name)
     {
-      global_hooks.erase(map_name);
+      std::vector<kv::untyped::Map::CommitHook> hooks;
+      const auto hooks_it = global_hooks.find(map_name);
+      if (hooks_it != global_hooks.end())
+      {
+        if (hooks_it->second.empty())
+        {
+          global_hooks.erase(hooks_it);
+        }
+        else
+        {
+          hooks = get_global_hooks(hooks_it->second);
+        }
+      }
 
       const auto it = maps.find(map_name);
       if (it != maps.end())
       {
-        it->second.second->unset_global_hook();
+        it->second.second->set_global_hooks(std::move(hooks));
       }
     }
 
+  public:
+    /** Set the global hook on map_name, replacing any previously set by this
+     * function. Hooks added with add_global_hook() are unaffected. Must not
+     * be called from a global hook.
+     */
+    void set_global_hook(
+      const std::string& map_name, const kv::untyped::Map::CommitHook& hook)
+    {
+      std::lock_guard<std::mutex> mguard(maps_lock);
+      global_hooks[map_name][default_global_hook_id] = hook;
+      update_global_hooks(map_name);
+    }
+
+    void unset_global_hook(const std::string& map_name)
+    {
+      std::lock_guard<std::mutex> mguard(maps_lock);
+      global_hooks[map_name].erase(default_global_hook_id);
+      update_global_hooks(map_name);
+    }
+
+    /** Add a global hook on map_name, called alongside any other global hooks
+     * on that map, in the order in which they were added. Must not be called
+     * from a global hook.
+     *
+     * @return Id with which to remove the hook
+     */
+    GlobalHookId add_global_hook(
+      const std::string& map_name, const kv::untyped::Map::CommitHook& hook)
+    {
+      std::lock_guard<std::mutex> mguard(maps_lock);
+      const auto id = next_global_hook_id++;
+      global_hooks[map_name][id] = hook;
+      update_global_hooks(map_name);
+      return id;
+    }
+
+    void remove_global_hook(const std::string& map_name, GlobalHookId id)
+    {
+      std::lock_guard<std::mutex> mguard(maps_lock);
+      global_hooks[map_name].erase(id);
+      update_global_hooks(map_name);
+    }
+
     ReadOnlyTx create_read_only_tx()
     {
       return ReadOnlyTx(this);
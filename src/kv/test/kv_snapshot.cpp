@@ -151,6 +151,91 @@ TEST_CASE("Simple snapshot" * doctest::test_suite("snapshot"))
   }
 }
 
+TEST_CASE("Delta snapshot" * doctest::test_suite("snapshot"))
+{
+  kv::Store store;
+  MapTypes::StringString string_map("public:string_map");
+  MapTypes::NumNum num_map("public:num_map");
+  MapTypes::NumNum new_map("public:new_map");
+
+  auto tx1 = store.create_tx();
+  auto handle_1s = tx1.rw(string_map);
+  handle_1s->put("foo", "bar");
+  handle_1s->put("baz", "hello");
+  tx1.rw(num_map)->put(42, 100);
+  REQUIRE(tx1.commit() == kv::CommitResult::SUCCESS);
+  const auto base_version = tx1.commit_version();
+
+  std::shared_ptr<kv::AbstractStore::AbstractSnapshot> base_snapshot =
+    store.snapshot(base_version);
+  const auto serialised_base =
+    base_snapshot->serialise(store.get_encryptor());
+
+  auto tx2 = store.create_tx();
+  auto handle_2s = tx2.rw(string_map);
+  handle_2s->remove("baz");
+  handle_2s->put("new", "value");
+  tx2.rw(new_map)->put(1, 2);
+  REQUIRE(tx2.commit() == kv::CommitResult::SUCCESS);
+  const auto delta_version = tx2.commit_version();
+
+  INFO("Delta snapshot must be taken after its base");
+  {
+    REQUIRE_THROWS_AS(
+      store.delta_snapshot(base_version, *base_snapshot), std::logic_error);
+  }
+
+  auto delta_snapshot = store.delta_snapshot(delta_version, *base_snapshot);
+  REQUIRE(delta_snapshot->get_base_version() == base_version);
+  const auto serialised_delta =
+    store.serialise_snapshot(std::move(delta_snapshot));
+
+  INFO("Delta snapshot only holds changed entries");
+  {
+    auto full_snapshot = store.snapshot(delta_version);
+    const auto serialised_full =
+      store.serialise_snapshot(std::move(full_snapshot));
+    REQUIRE(serialised_delta.size() < serialised_full.size());
+  }
+
+  INFO("Delta snapshot cannot be applied without its base");
+  {
+    kv::Store new_store;
+    kv::ConsensusHookPtrs hooks;
+    REQUIRE_EQ(
+      new_store.deserialise_snapshot(serialised_delta, hooks),
+      kv::ApplyResult::FAIL);
+  }
+
+  INFO("Apply base and delta snapshots to new store");
+  {
+    kv::Store new_store;
+    kv::ConsensusHookPtrs hooks;
+    REQUIRE_EQ(
+      new_store.deserialise_snapshot(serialised_base, hooks),
+      kv::ApplyResult::PASS);
+    REQUIRE_EQ(
+      new_store.deserialise_snapshot(serialised_delta, hooks),
+      kv::ApplyResult::PASS);
+    REQUIRE_EQ(new_store.current_version(), delta_version);
+
+    auto tx = new_store.create_tx();
+    auto handle_s = tx.rw(string_map);
+    REQUIRE_EQ(handle_s->get("foo").value(), "bar");
+    REQUIRE_EQ(handle_s->get_version_of_previous_write("foo"), base_version);
+    REQUIRE_FALSE(handle_s->has("baz"));
+    REQUIRE_EQ(handle_s->get("new").value(), "value");
+    REQUIRE_EQ(handle_s->get_version_of_previous_write("new"), delta_version);
+
+    // Maps unchanged since the base are left as they were
+    auto handle_n = tx.rw(num_map);
+    REQUIRE_EQ(handle_n->get(42).value(), 100);
+    REQUIRE_EQ(handle_n->get_version_of_previous_write(42), base_version);
+
+    REQUIRE_EQ(tx.rw(new_map)->get(1).value(), 2);
+  }
+}
+
 TEST_CASE(
   "Commit transaction while applying snapshot" *
   doctest::test_suite("snapshot"))
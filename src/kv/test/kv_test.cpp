@@ -4,6 +4,7 @@
 #include "ds/logger.h"
 #include "kv/kv_serialiser.h"
 #include "kv/map.h"
+#include "kv/ordered_map.h"
 #include "kv/set.h"
 #include "kv/store.h"
 #include "kv/test/null_encryptor.h"
@@ -1023,6 +1024,183 @@ TEST_CASE("foreach")
   }
 }
 
+TEST_CASE("Ordered map range iteration")
+{
+  kv::Store kv_store;
+  using OrderedNumString = kv::OrderedMap<size_t, std::string>;
+  OrderedNumString map("public:ordered_map");
+
+  using Entries = std::vector<std::pair<size_t, std::string>>;
+  Entries iterated_entries;
+  auto store_iterated = [&iterated_entries](const auto& k, const auto& v) {
+    iterated_entries.emplace_back(k, v);
+    return true;
+  };
+
+  {
+    auto tx = kv_store.create_tx();
+    auto handle = tx.rw(map);
+    for (size_t i = 0; i < 300; i += 10)
+    {
+      handle->put(i, std::to_string(i));
+    }
+    REQUIRE(tx.commit() == kv::CommitResult::SUCCESS);
+  }
+
+  SUBCASE("Committed entries are visited in key order")
+  {
+    auto tx = kv_store.create_tx();
+    auto handle = tx.ro(map);
+    handle->range(25, 70, store_iterated);
+    REQUIRE(
+      iterated_entries ==
+      Entries{{30, "30"}, {40, "40"}, {50, "50"}, {60, "60"}});
+
+    iterated_entries.clear();
+    handle->range_reverse(25, 70, store_iterated);
+    REQUIRE(
+      iterated_entries ==
+      Entries{{60, "60"}, {50, "50"}, {40, "40"}, {30, "30"}});
+
+    iterated_entries.clear();
+    handle->range(70, 25, store_iterated);
+    REQUIRE(iterated_entries.empty());
+  }
+
+  SUBCASE("Own writes are merged into the iteration")
+  {
+    auto tx = kv_store.create_tx();
+    auto handle = tx.rw(map);
+    handle->put(35, "35");
+    handle->put(40, "replaced40");
+    handle->remove(50);
+    handle->put(1000, "1000");
+    handle->range(25, 70, store_iterated);
+    REQUIRE(
+      iterated_entries ==
+      Entries{{30, "30"}, {35, "35"}, {40, "replaced40"}, {60, "60"}});
+
+    iterated_entries.clear();
+    handle->range_reverse(25, 70, store_iterated);
+    REQUIRE(
+      iterated_entries ==
+      Entries{{60, "60"}, {40, "replaced40"}, {35, "35"}, {30, "30"}});
+
+    auto lb = handle->lower_bound(41);
+    REQUIRE(lb.has_value());
+    REQUIRE(lb->first == 60);
+
+    lb = handle->lower_bound(295);
+    REQUIRE(lb.has_value());
+    REQUIRE(lb->first == 1000);
+  }
+
+  SUBCASE("Latest entries via reverse iteration")
+  {
+    auto tx = kv_store.create_tx();
+    auto handle = tx.ro(map);
+    handle->foreach_reverse([&](const auto& k, const auto& v) {
+      iterated_entries.emplace_back(k, v);
+      return iterated_entries.size() < 3;
+    });
+    REQUIRE(
+      iterated_entries == Entries{{290, "290"}, {280, "280"}, {270, "270"}});
+  }
+
+  SUBCASE("Index is maintained across commits and rollback")
+  {
+    {
+      auto tx = kv_store.create_tx();
+      auto handle = tx.rw(map);
+      handle->put(5, "5");
+      handle->remove(10);
+      REQUIRE(tx.commit() == kv::CommitResult::SUCCESS);
+    }
+
+    {
+      auto tx = kv_store.create_tx();
+      auto handle = tx.ro(map);
+      handle->range(0, 25, store_iterated);
+      REQUIRE(iterated_entries == Entries{{0, "0"}, {5, "5"}, {20, "20"}});
+    }
+
+    kv_store.rollback({kv_store.commit_view(), 1}, kv_store.commit_view());
+    iterated_entries.clear();
+
+    {
+      auto tx = kv_store.create_tx();
+      auto handle = tx.ro(map);
+      handle->range(0, 25, store_iterated);
+      REQUIRE(iterated_entries == Entries{{0, "0"}, {10, "10"}, {20, "20"}});
+    }
+  }
+
+  SUBCASE("Index is rebuilt from snapshots")
+  {
+    auto snapshot = kv_store.snapshot(kv_store.current_version());
+    auto serialised_snapshot =
+      kv_store.serialise_snapshot(std::move(snapshot));
+
+    kv::Store new_store;
+    kv::ConsensusHookPtrs hooks;
+    REQUIRE(
+      new_store.deserialise_snapshot(serialised_snapshot, hooks) ==
+      kv::ApplyResult::PASS);
+
+    auto tx = new_store.create_tx();
+    auto handle = tx.ro(map);
+    handle->range_reverse(0, 25, store_iterated);
+    REQUIRE(iterated_entries == Entries{{20, "20"}, {10, "10"}, {0, "0"}});
+  }
+
+  SUBCASE("Ordered and unordered handles over the same map")
+  {
+    MapTypes::NumString unordered_map("public:ordered_map");
+    auto tx = kv_store.create_tx();
+    auto unordered_handle = tx.rw(unordered_map);
+    REQUIRE(unordered_handle->size() == 30);
+    auto handle = tx.rw(map);
+    handle->range(0, 15, store_iterated);
+    REQUIRE(iterated_entries == Entries{{0, "0"}, {10, "10"}});
+  }
+
+  SUBCASE("Range reads conflict with concurrent writes")
+  {
+    auto tx1 = kv_store.create_tx();
+    auto tx2 = kv_store.create_tx();
+
+    auto handle1 = tx1.rw(map);
+    handle1->range(0, 15, store_iterated);
+    handle1->put(1, "1");
+
+    auto handle2 = tx2.rw(map);
+    handle2->put(500, "500");
+    REQUIRE(tx2.commit() == kv::CommitResult::SUCCESS);
+    REQUIRE(tx1.commit() == kv::CommitResult::FAIL_CONFLICT);
+  }
+
+  SUBCASE("Writes cannot be modified during range iteration")
+  {
+    auto tx = kv_store.create_tx();
+    auto handle = tx.rw(map);
+    handle->put(15, "15");
+    REQUIRE_THROWS_AS(
+      handle->range(
+        0,
+        25,
+        [&](const auto& k, const auto&) {
+          handle->remove(k);
+          return true;
+        }),
+      std::logic_error);
+
+    INFO("The handle can be modified once the iteration has completed");
+    handle->remove(15);
+    handle->range(0, 25, store_iterated);
+    REQUIRE(iterated_entries == Entries{{0, "0"}, {10, "10"}, {20, "20"}});
+  }
+}
+
 TEST_CASE("Modifications during foreach iteration")
 {
   kv::Store kv_store;
@@ -1641,6 +1819,60 @@ TEST_CASE("Global commit hooks")
   }
 }
 
+TEST_CASE("Multiple global commit hooks")
+{
+  using Write = MapTypes::StringString::Write;
+
+  std::vector<std::string> calls;
+  auto make_hook = [&](const std::string& name) {
+    return [&calls, name](kv::Version, const Write&) {
+      calls.push_back(name);
+    };
+  };
+
+  kv::Store kv_store;
+  using MapT = kv::Map<std::string, std::string>;
+  MapT map("public:map");
+
+  auto commit_and_compact = [&]() {
+    calls.clear();
+    auto tx = kv_store.create_tx();
+    tx.rw(map)->put("key", "value");
+    REQUIRE(tx.commit() == kv::CommitResult::SUCCESS);
+    kv_store.compact(kv_store.current_version());
+  };
+
+  kv_store.set_global_hook(
+    map.get_name(), map.wrap_commit_hook(make_hook("a")));
+  const auto b = kv_store.add_global_hook(
+    map.get_name(), map.wrap_commit_hook(make_hook("b")));
+  const auto c = kv_store.add_global_hook(
+    map.get_name(), map.wrap_commit_hook(make_hook("c")));
+
+  INFO("Every hook is called");
+  commit_and_compact();
+  REQUIRE(calls == std::vector<std::string>{"a", "b", "c"});
+
+  INFO("Setting the global hook does not affect added hooks");
+  kv_store.set_global_hook(
+    map.get_name(), map.wrap_commit_hook(make_hook("d")));
+  commit_and_compact();
+  REQUIRE(calls == std::vector<std::string>{"d", "b", "c"});
+
+  INFO("Hooks can be removed independently");
+  kv_store.remove_global_hook(map.get_name(), b);
+  commit_and_compact();
+  REQUIRE(calls == std::vector<std::string>{"d", "c"});
+
+  kv_store.unset_global_hook(map.get_name());
+  commit_and_compact();
+  REQUIRE(calls == std::vector<std::string>{"c"});
+
+  kv_store.remove_global_hook(map.get_name(), c);
+  commit_and_compact();
+  REQUIRE(calls.empty());
+}
+
 TEST_CASE("Deserialising from other Store")
 {
   auto encryptor = std::make_shared<kv::NullTxEncryptor>();
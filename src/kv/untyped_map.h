@@ -12,6 +12,7 @@
 #include <list>
 #include <optional>
 #include <unordered_set>
+#include <vector>
 
 namespace kv::untyped
 {
@@ -27,6 +28,7 @@ namespace kv::untyped
     Version version;
     State state;
     Write writes;
+    std::optional<OrderedKeys> ordered_keys = std::nullopt;
     LocalCommit* next = nullptr;
     LocalCommit* prev = nullptr;
   };
@@ -77,7 +79,7 @@ namespace kv::untyped
   private:
     AbstractStore* store;
     Roll roll;
-    CommitHook global_hook = nullptr;
+    std::vector<CommitHook> global_hooks;
     MapHook hook = nullptr;
     std::list<std::pair<Version, Write>> commit_deltas;
     std::mutex sl;
@@ -85,6 +87,60 @@ namespace kv::untyped
     const bool replicated;
     const bool include_conflict_read_version;
 
+    // Whether each local commit in the roll maintains an ordered index of its
+    // keys. Enabled the first time an ordered handle is requested over this
+    // map.
+    bool ordered = false;
+
+    static OrderedKeys build_ordered_keys(const State& state)
+    {
+      OrderedKeys keys;
+      state.foreach([&keys](const K& k, const VersionV&) {
+        keys = keys.put(k, {});
+        return true;
+      });
+      return keys;
+    }
+
+    static OrderedKeys update_ordered_keys(
+      const OrderedKeys& keys, const Write& writes)
+    {
+      // Removed keys are never discarded from the state, so only new keys need
+      // to be added to the index
+      OrderedKeys updated = keys;
+      for (const auto& [k, v] : writes)
+      {
+        if (v.has_value() && updated.getp(k) == nullptr)
+        {
+          updated = updated.put(k, {});
+        }
+      }
+      return updated;
+    }
+
+    void enable_ordered_keys()
+    {
+      // Builds the index for every local commit currently in the roll. The
+      // Map expects to be locked while this happens.
+      const OrderedKeys* previous = nullptr;
+      for (auto current = roll.commits->get_head(); current != nullptr;
+           current = current->next)
+      {
+        if (previous == nullptr)
+        {
+          current->ordered_keys = build_ordered_keys(current->state);
+        }
+        else
+        {
+          current->ordered_keys =
+            update_ordered_keys(*previous, current->writes);
+        }
+        previous = &current->ordered_keys.value();
+      }
+
+      ordered = true;
+    }
+
   public:
     class HandleCommitter : public AbstractCommitter
     {
@@ -266,8 +322,13 @@ namespace kv::untyped
           if (change_set.writes.empty())
           {
             commit_version = change_set.start_version;
-            map.roll.commits->insert_back(map.roll.create_new_local_commit(
-              commit_version, std::move(state), change_set.writes));
+            auto c = map.roll.create_new_local_commit(
+              commit_version, std::move(state), change_set.writes);
+            if (map.ordered)
+            {
+              c->ordered_keys = roll.commits->get_tail()->ordered_keys;
+            }
+            map.roll.commits->insert_back(c);
             return;
           }
         }
@@ -300,8 +361,15 @@ namespace kv::untyped
 
         if (changes)
         {
-          map.roll.commits->insert_back(map.roll.create_new_local_commit(
-            v, std::move(state), change_set.writes));
+          auto c = map.roll.create_new_local_commit(
+            v, std::move(state), change_set.writes);
+          if (map.ordered)
+          {
+            c->ordered_keys = update_ordered_keys(
+              roll.commits->get_tail()->ordered_keys.value(),
+              change_set.writes);
+          }
+          map.roll.commits->insert_back(c);
         }
       }
 
@@ -331,26 +399,61 @@ namespace kv::untyped
 
       StateSnapshot map_snapshot;
 
+      // Only set for a delta snapshot, to the version of the map in the base
+      // snapshot
+      const std::optional<kv::Version> base_version;
+
     public:
       Snapshot(
         const std::string& name_,
         SecurityDomain security_domain_,
         kv::Version version_,
-        StateSnapshot&& map_snapshot_) :
+        StateSnapshot&& map_snapshot_,
+        std::optional<kv::Version> base_version_ = std::nullopt) :
         name(name_),
         security_domain(security_domain_),
         version(version_),
-        map_snapshot(std::move(map_snapshot_))
+        map_snapshot(std::move(map_snapshot_)),
+        base_version(base_version_)
       {}
 
+      const std::string& get_name() const override
+      {
+        return name;
+      }
+
+      kv::Version get_version() const
+      {
+        return version;
+      }
+
+      const State& get_state() const
+      {
+        return map_snapshot.get_map();
+      }
+
+      bool is_unchanged() const
+      {
+        return base_version.has_value() && base_version.value() == version;
+      }
+
       void serialise(KvStoreSerialiser& s) override
       {
+        // Maps which have not been written to since the base snapshot are
+        // omitted from a delta snapshot
+        if (is_unchanged())
+        {
+          return;
+        }
+
         s.start_map(name, security_domain);
         s.serialise_entry_version(version);
 
-        std::vector<uint8_t> ret(map_snapshot.get_serialized_size());
-        map_snapshot.serialize(ret.data());
-        s.serialise_raw(ret);
+        // The state is serialised straight into the snapshot, so that no more
+        // than one copy of it is held at a time
+        s.serialise_raw(
+          map_snapshot.get_serialized_size(),
+          [this](uint8_t* data) { map_snapshot.serialize(data); });
       }
 
       SecurityDomain get_security_domain() override
@@ -497,9 +600,14 @@ namespace kv::untyped
         r->state = change_set.state;
         r->version = change_set.version;
 
+        if (map.ordered)
+        {
+          r->ordered_keys = build_ordered_keys(r->state);
+        }
+
         // Executing hooks from snapshot requires copying the entire snapshotted
         // state so only do it if there's a hook on the table
-        if (map.hook || map.global_hook)
+        if (map.hook || !map.global_hooks.empty())
         {
           r->state.foreach([&r](const K& k, const VersionV& v) {
             if (!is_deleted(v.version))
@@ -528,6 +636,18 @@ namespace kv::untyped
         State::deserialize_map(map_snapshot), v);
     }
 
+    ChangeSetPtr deserialise_snapshot_delta_changes(KvStoreDeserialiser& d)
+    {
+      // Create a new change set holding the current state of the map, with the
+      // entries from a delta snapshot applied on top of it. The Map expects to
+      // be locked.
+      auto v = d.deserialise_entry_version();
+      auto map_delta = d.deserialise_raw();
+
+      return std::make_unique<SnapshotChangeSet>(
+        State::deserialize_map(map_delta, roll.commits->get_tail()->state), v);
+    }
+
     ChangeSetPtr deserialise_changes(KvStoreDeserialiser& d, Version version)
     {
       return deserialise_internal(d, version);
@@ -619,20 +739,13 @@ namespace kv::untyped
       hook = nullptr;
     }
 
-    /** Set handler to be called on global transaction commit
+    /** Set handlers to be called on global transaction commit, in order
      *
-     * @param hook function to be called on global transaction commit
-     */
-    void set_global_hook(const CommitHook& hook)
-    {
-      global_hook = hook;
-    }
-
-    /** Reset global transaction commit handler
+     * @param hooks functions to be called on global transaction commit
      */
-    void unset_global_hook()
+    void set_global_hooks(std::vector<CommitHook>&& hooks)
     {
-      global_hook = nullptr;
+      global_hooks = std::move(hooks);
     }
 
     /** Get security domain of a Map
@@ -711,27 +824,57 @@ namespace kv::untyped
       return !(*this == that);
     }
 
-    std::unique_ptr<AbstractMap::Snapshot> snapshot(Version v) override
+    LocalCommit* get_last_commit_at(Version v)
     {
-      // This takes a snapshot of the state of the map at the last entry
-      // committed at or before this version. The Map expects to be locked while
-      // taking the snapshot.
-      auto r = roll.commits->get_head();
-
       for (auto current = roll.commits->get_tail(); current != nullptr;
            current = current->prev)
       {
         if (current->version <= v)
         {
-          r = current;
-          break;
+          return current;
         }
       }
+      return roll.commits->get_head();
+    }
+
+    std::unique_ptr<AbstractMap::Snapshot> snapshot(Version v) override
+    {
+      // This takes a snapshot of the state of the map at the last entry
+      // committed at or before this version. The Map expects to be locked while
+      // taking the snapshot.
+      auto r = get_last_commit_at(v);
 
       return std::make_unique<Snapshot>(
         name, security_domain, r->version, StateSnapshot(r->state));
     }
 
+    std::unique_ptr<AbstractMap::Snapshot> delta_snapshot(
+      Version v, const AbstractMap::Snapshot* base) override
+    {
+      // As snapshot(), but only includes the entries written since base, a
+      // previous snapshot of this map. If base is null, the map did not exist
+      // at the time of the base snapshot and all entries are included.
+      auto r = get_last_commit_at(v);
+
+      auto base_snapshot = dynamic_cast<const Snapshot*>(base);
+      if (base_snapshot == nullptr)
+      {
+        return std::make_unique<Snapshot>(
+          name,
+          security_domain,
+          r->version,
+          StateSnapshot(r->state, State()),
+          NoVersion);
+      }
+
+      return std::make_unique<Snapshot>(
+        name,
+        security_domain,
+        r->version,
+        StateSnapshot(r->state, base_snapshot->get_state()),
+        base_snapshot->get_version());
+    }
+
     void compact(Version v) override
     {
       // This discards available rollback state before version v, and populates
@@ -745,7 +888,7 @@ namespace kv::untyped
         if (r->version == v)
         {
           // We know that write set is not empty.
-          if (global_hook)
+          if (!global_hooks.empty())
           {
             commit_deltas.emplace_back(r->version, std::move(r->writes));
           }
@@ -753,7 +896,7 @@ namespace kv::untyped
         }
 
         // Discardable, so move to commit_deltas.
-        if (global_hook && !r->writes.empty())
+        if (!global_hooks.empty() && !r->writes.empty())
         {
           commit_deltas.emplace_back(r->version, std::move(r->writes));
         }
@@ -770,7 +913,7 @@ namespace kv::untyped
       // There is only one roll. We may need to call the commit hook.
       auto r = roll.commits->get_head();
 
-      if (global_hook && !r->writes.empty())
+      if (!global_hooks.empty() && !r->writes.empty())
       {
         commit_deltas.emplace_back(r->version, std::move(r->writes));
       }
@@ -778,9 +921,9 @@ namespace kv::untyped
 
     void post_compact() override
     {
-      if (global_hook)
+      for (auto& [version, writes] : commit_deltas)
       {
-        for (auto& [version, writes] : commit_deltas)
+        for (const auto& global_hook : global_hooks)
         {
           global_hook(version, writes);
         }
@@ -819,6 +962,11 @@ namespace kv::untyped
       // The Map expects to be locked before clearing it.
       roll.reset_commits();
       roll.rollback_counter = 0;
+
+      if (ordered)
+      {
+        roll.commits->get_head()->ordered_keys = OrderedKeys();
+      }
     }
 
     void lock() override
@@ -839,12 +987,19 @@ namespace kv::untyped
           "Attempted to swap maps with incompatible types");
 
       std::swap(roll, map->roll);
+      std::swap(ordered, map->ordered);
     }
 
-    ChangeSetPtr create_change_set(Version version)
+    ChangeSetPtr create_change_set(
+      Version version, bool with_ordered_keys = false)
     {
       lock();
 
+      if (with_ordered_keys && !ordered)
+      {
+        enable_ordered_keys();
+      }
+
       ChangeSetPtr changes = nullptr;
 
       // Find the last entry committed at or before this version.
@@ -857,7 +1012,8 @@ namespace kv::untyped
             roll.rollback_counter,
             current->state,
             roll.commits->get_head()->state,
-            current->version);
+            current->version,
+            with_ordered_keys ? current->ordered_keys : std::nullopt);
           break;
         }
       }
@@ -869,6 +1025,44 @@ namespace kv::untyped
       return changes;
     }
 
+    void add_ordered_keys(ChangeSet& change_set)
+    {
+      // Populates the ordered index of a change set which was originally
+      // created without one
+      if (change_set.ordered_keys.has_value())
+      {
+        return;
+      }
+
+      lock();
+
+      if (!ordered)
+      {
+        enable_ordered_keys();
+      }
+
+      for (auto current = roll.commits->get_tail(); current != nullptr;
+           current = current->prev)
+      {
+        if (
+          current->version == change_set.start_version &&
+          roll.rollback_counter == change_set.rollback_counter)
+        {
+          change_set.ordered_keys = current->ordered_keys;
+          break;
+        }
+      }
+
+      unlock();
+
+      if (!change_set.ordered_keys.has_value())
+      {
+        // The state this change set was created from is no longer in the
+        // roll, so build its index directly
+        change_set.ordered_keys = build_ordered_keys(change_set.state);
+      }
+    }
+
     Roll& get_roll()
     {
       return roll;
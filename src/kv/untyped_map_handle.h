@@ -21,6 +21,7 @@ namespace kv::untyped
   using ChangeSetPtr = std::unique_ptr<ChangeSet>;
   using SnapshotChangeSet = kv::
     SnapshotChangeSet<SerialisedEntry, SerialisedEntry, SerialisedKeyHasher>;
+  using OrderedKeys = kv::OrderedKeys<SerialisedEntry>;
 
   class MapHandle : public kv::AbstractHandle
   {
@@ -34,6 +35,19 @@ namespace kv::untyped
     ChangeSet& tx_changes;
     std::string map_name;
 
+    // Set while range() iterates over this transaction's writes in place,
+    // during which they must not be modified
+    bool in_range = false;
+
+    void check_not_in_range()
+    {
+      if (in_range)
+      {
+        throw std::logic_error(fmt::format(
+          "Cannot modify {} during range iteration over it", map_name));
+      }
+    }
+
     /** Get pointer to current value if this key exists, else nullptr if it does
      * not exist or has been deleted. If non-null, points to something owned by
      * tx_changes - expect this is used/dereferenced immediately, and there is
@@ -82,6 +96,64 @@ namespace kv::untyped
       return &search->value;
     }
 
+    // Merges the committed entries in [from, to) with this transaction's
+    // writes in [w_it, w_end), both visited in the order given by before.
+    // Writes take precedence over committed entries with the same key.
+    template <class It, class Before, class F>
+    void merge_range(
+      const std::optional<KeyType>& from,
+      const std::optional<KeyType>& to,
+      bool reverse,
+      It w_it,
+      It w_end,
+      Before&& before,
+      F& f)
+    {
+      bool should_continue = true;
+
+      // Visits w_it, returning the result of f if it is not a deletion
+      auto visit_write = [&f, &w_it]() {
+        bool c = true;
+        if (w_it->second.has_value())
+        {
+          c = f(w_it->first, w_it->second.value());
+        }
+        ++w_it;
+        return c;
+      };
+
+      tx_changes.ordered_keys->foreach_in_range(
+        from, to, reverse, [&](const KeyType& k, const std::monostate&) {
+          while (w_it != w_end && before(w_it->first, k))
+          {
+            if (!visit_write())
+            {
+              should_continue = false;
+              return should_continue;
+            }
+          }
+
+          if (w_it != w_end && !before(k, w_it->first))
+          {
+            // Overwritten (or removed) by this transaction
+            should_continue = visit_write();
+            return should_continue;
+          }
+
+          const auto search = tx_changes.state.getp(k);
+          if (search != nullptr && !is_deleted(search->version))
+          {
+            should_continue = f(k, search->value);
+          }
+          return should_continue;
+        });
+
+      while (should_continue && w_it != w_end)
+      {
+        should_continue = visit_write();
+      }
+    }
+
   public:
     MapHandle(ChangeSet& cs, const std::string& map_name) :
       tx_changes(cs),
@@ -129,6 +201,11 @@ namespace kv::untyped
       return search->version;
     }
 
+    MapVersion get_map_version() const
+    {
+      return {tx_changes.rollback_counter, tx_changes.start_version};
+    }
+
     std::optional<ValueType> get_globally_committed(const KeyType& key)
     {
       // If there is no committed value, return empty.
@@ -161,6 +238,7 @@ namespace kv::untyped
     void put(const KeyType& key, const ValueType& value)
     {
       LOG_TRACE_FMT("KV[{}]::put({}, {})", map_name, key, value);
+      check_not_in_range();
       // Record in the write set.
       tx_changes.writes[key] = value;
     }
@@ -168,6 +246,7 @@ namespace kv::untyped
     bool remove(const KeyType& key)
     {
       LOG_TRACE_FMT("KV[{}]::remove({})", map_name, key);
+      check_not_in_range();
       auto write = tx_changes.writes.find(key);
       auto exists_in_state = tx_changes.state.getp(key) != nullptr;
 
@@ -249,6 +328,77 @@ namespace kv::untyped
       }
     }
 
+    /** Iterate over the entries whose key is in [from, to), in the
+     * byte-wise order of the serialised keys (descending if reverse is set).
+     * A missing bound is unbounded. Only valid on change sets created for
+     * ordered handles.
+     *
+     * Like foreach, this records a dependency on the entire map. Unlike
+     * foreach, this transaction's writes are iterated in place rather than
+     * copied, so f must not modify this map (put and remove throw until the
+     * iteration completes).
+     */
+    template <class F>
+    void range(
+      const std::optional<KeyType>& from,
+      const std::optional<KeyType>& to,
+      bool reverse,
+      F&& f)
+    {
+      if (!tx_changes.ordered_keys.has_value())
+      {
+        throw std::logic_error(fmt::format(
+          "Range iteration over {} requires an ordered handle", map_name));
+      }
+
+      // Record a global read dependency.
+      tx_changes.read_version = tx_changes.start_version;
+
+      if (from.has_value() && to.has_value() && !(from.value() < to.value()))
+      {
+        return;
+      }
+
+      const auto& w = tx_changes.writes;
+      auto w_begin = from.has_value() ? w.lower_bound(from.value()) : w.begin();
+      auto w_end = to.has_value() ? w.lower_bound(to.value()) : w.end();
+
+      // Restores the previous state on exit, so that nested ranges work
+      struct RangeGuard
+      {
+        bool& in_range;
+        const bool previous;
+        ~RangeGuard()
+        {
+          in_range = previous;
+        }
+      } guard{in_range, in_range};
+      in_range = true;
+
+      if (!reverse)
+      {
+        merge_range(
+          from,
+          to,
+          reverse,
+          w_begin,
+          w_end,
+          [](const KeyType& a, const KeyType& b) { return a < b; },
+          f);
+      }
+      else
+      {
+        merge_range(
+          from,
+          to,
+          reverse,
+          std::make_reverse_iterator(w_end),
+          std::make_reverse_iterator(w_begin),
+          [](const KeyType& a, const KeyType& b) { return b < a; },
+          f);
+      }
+    }
+
     size_t size()
     {
       size_t size_ = 0;
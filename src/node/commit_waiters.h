@@ -0,0 +1,259 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+#pragma once
+
+#include "ccf/tx_id.h"
+#include "ds/logger.h"
+#include "enclave/forwarder_types.h"
+#include "node/rpc/tx_status.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace ccf
+{
+  /** Holds client requests waiting for a transaction to reach a final status
+   * (Committed or Invalid), so that clients do not need to poll for it.
+   *
+   * Waiters are indexed by seqno. Consensus calls collect_committed() whenever
+   * the commit watermark advances, which removes the waiters for every seqno
+   * it covers, and re-examines the others when the committed view changes.
+   * Consensus holds its lock while doing so, so the removed waiters are
+   * answered by a later call to complete(), once that lock is released.
+   * Waiters which are not completed within their timeout are answered by
+   * tick(). The number of waiters is bounded, and further waiters are
+   * refused until some complete.
+   */
+  class CommitWaiters
+  {
+  public:
+    /** Produces the response to a waiting request. Called with the final
+     * status of the transaction, or with std::nullopt if the wait timed out
+     * first.
+     */
+    using ResponseFn =
+      std::function<std::vector<uint8_t>(std::optional<TxStatus>)>;
+
+    using GetView = std::function<View(SeqNo)>;
+
+    enum class AddResult
+    {
+      Added,
+      // The transaction's status is already final, and should be reported
+      // immediately
+      AlreadyFinal,
+      TooManyWaiters
+    };
+
+    static constexpr size_t default_max_waiters = 10000;
+
+    struct Completion
+    {
+      size_t session_id;
+      ResponseFn response_fn;
+      std::optional<TxStatus> status;
+    };
+
+    using Completions = std::vector<Completion>;
+
+  private:
+    struct Waiter
+    {
+      TxID tx_id;
+      size_t session_id;
+      ResponseFn response_fn;
+      std::multimap<std::chrono::milliseconds, SeqNo>::iterator expiry_it;
+    };
+
+    using WaitersBySeqNo = std::multimap<SeqNo, Waiter>;
+
+    std::shared_ptr<enclave::AbstractRPCResponder> responder;
+    const size_t max_waiters;
+
+    std::mutex lock;
+    WaitersBySeqNo waiters;
+
+    // Deadline of each waiter, measured in time elapsed since construction.
+    // Each entry refers to the waiter in waiters with the same expiry_it.
+    std::multimap<std::chrono::milliseconds, SeqNo> expiries;
+    std::chrono::milliseconds elapsed = std::chrono::milliseconds(0);
+
+    SeqNo last_committed_seqno = 0;
+    View last_committed_view = 0;
+
+    void remove(WaitersBySeqNo::iterator it, Completions& completed)
+    {
+      auto& waiter = it->second;
+      completed.push_back({waiter.session_id, std::move(waiter.response_fn)});
+      expiries.erase(waiter.expiry_it);
+      waiters.erase(it);
+    }
+
+  public:
+    CommitWaiters(
+      std::shared_ptr<enclave::AbstractRPCResponder> responder_,
+      size_t max_waiters_ = default_max_waiters) :
+      responder(responder_),
+      max_waiters(max_waiters_)
+    {}
+
+    /** Wait for tx_id to reach a final status, or for timeout to elapse,
+     * then send the response produced by response_fn to session_id.
+     */
+    AddResult add(
+      const TxID& tx_id,
+      size_t session_id,
+      std::chrono::milliseconds timeout,
+      ResponseFn response_fn)
+    {
+      std::lock_guard<std::mutex> guard(lock);
+
+      // Checked under the lock so that a commit cannot be missed between the
+      // caller reading the transaction's status and adding the waiter
+      if (
+        tx_id.seqno <= last_committed_seqno ||
+        tx_id.view < last_committed_view)
+      {
+        return AddResult::AlreadyFinal;
+      }
+
+      if (waiters.size() >= max_waiters)
+      {
+        return AddResult::TooManyWaiters;
+      }
+
+      auto expiry_it = expiries.emplace(elapsed + timeout, tx_id.seqno);
+      waiters.emplace(
+        tx_id.seqno,
+        Waiter{tx_id, session_id, std::move(response_fn), expiry_it});
+      return AddResult::Added;
+    }
+
+    /** Called by consensus when the commit watermark advances. Removes the
+     * waiters whose transaction has reached a final status, without answering
+     * them.
+     *
+     * @param committed_seqno Highest globally committed seqno
+     * @param get_view Returns the view of a seqno in the local ledger, or
+     *  VIEW_UNKNOWN if it is not known
+     * @return Removed waiters, to be passed to complete()
+     */
+    Completions collect_committed(
+      SeqNo committed_seqno, const GetView& get_view)
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      Completions completed;
+      if (committed_seqno <= last_committed_seqno)
+      {
+        return completed;
+      }
+
+      const auto committed_view = get_view(committed_seqno);
+      const auto view_changed = committed_view > last_committed_view;
+      last_committed_seqno = committed_seqno;
+      last_committed_view = committed_view;
+
+      // If the committed view has not changed, only waiters for newly
+      // committed seqnos can have reached a final status
+      const auto end = view_changed ? waiters.end() :
+                                      waiters.upper_bound(committed_seqno);
+      for (auto it = waiters.begin(); it != end;)
+      {
+        const auto& tx_id = it->second.tx_id;
+        const auto status = evaluate_tx_status(
+          tx_id.view,
+          tx_id.seqno,
+          get_view(tx_id.seqno),
+          committed_view,
+          committed_seqno);
+        if (status == TxStatus::Committed || status == TxStatus::Invalid)
+        {
+          auto next = std::next(it);
+          remove(it, completed);
+          completed.back().status = status;
+          it = next;
+        }
+        else
+        {
+          ++it;
+        }
+      }
+
+      return completed;
+    }
+
+    /** Produce and send the responses of waiters removed by
+     * collect_committed(). Must not be called while consensus holds its lock.
+     */
+    void complete(Completions&& completed)
+    {
+      for (auto& completion : completed)
+      {
+        try
+        {
+          auto response = completion.response_fn(completion.status);
+          if (!responder->reply_async(
+                completion.session_id, std::move(response)))
+          {
+            LOG_DEBUG_FMT(
+              "Session {} closed while waiting for commit",
+              completion.session_id);
+          }
+        }
+        catch (const std::exception& e)
+        {
+          LOG_FAIL_FMT("Failed to respond to commit waiter: {}", e.what());
+        }
+      }
+    }
+
+    /** Collect the waiters completed by committed_seqno, and answer them.
+     */
+    void commit(SeqNo committed_seqno, const GetView& get_view)
+    {
+      complete(collect_committed(committed_seqno, get_view));
+    }
+
+    /** Answer the waiters whose timeout has elapsed.
+     */
+    void tick(std::chrono::milliseconds elapsed_)
+    {
+      Completions completed;
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        elapsed += elapsed_;
+
+        while (!expiries.empty() && expiries.begin()->first <= elapsed)
+        {
+          const auto expiry_it = expiries.begin();
+          auto [begin, end] = waiters.equal_range(expiry_it->second);
+          const auto it = std::find_if(begin, end, [&](const auto& entry) {
+            return entry.second.expiry_it == expiry_it;
+          });
+          if (it == end)
+          {
+            // Every expiry has a waiter, but never spin if that is broken
+            expiries.erase(expiry_it);
+            continue;
+          }
+          remove(it, completed);
+        }
+      }
+
+      complete(std::move(completed));
+    }
+
+    size_t size()
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      return waiters.size();
+    }
+  };
+}
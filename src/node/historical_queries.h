@@ -5,12 +5,14 @@
 #include "ccf/historical_queries_interface.h"
 #include "consensus/ledger_enclave_types.h"
 #include "ds/ccf_assert.h"
+#include "ds/serialized.h"
 #include "kv/store.h"
 #include "node/encryptor.h"
 #include "node/history.h"
 #include "node/ledger_secrets.h"
 #include "node/rpc/node_interface.h"
 
+#include <algorithm>
 #include <list>
 #include <map>
 #include <memory>
@@ -81,6 +83,26 @@ namespace ccf::historical
       return historical_ledger_secrets->get_first();
     }
 
+    // Adds size to total for as long as it is alive. Shared by every request
+    // holding the same store, so that it is only counted once.
+    struct CachedStoreSize
+    {
+      CacheSize& total;
+      const size_t size;
+
+      CachedStoreSize(CacheSize& total_, size_t size_) :
+        total(total_),
+        size(size_)
+      {
+        total += size;
+      }
+
+      ~CachedStoreSize()
+      {
+        total -= size;
+      }
+    };
+
     struct StoreDetails
     {
       RequestStage current_stage = RequestStage::Fetching;
@@ -89,6 +111,10 @@ namespace ccf::historical
       bool is_signature = false;
       TxReceiptPtr receipt = nullptr;
       ccf::TxID transaction_id;
+
+      // Size of the serialised ledger entry this store was deserialised from,
+      // used as an estimate of the memory held by the store
+      std::shared_ptr<CachedStoreSize> cached_size = nullptr;
     };
     using StoreDetailsPtr = std::shared_ptr<StoreDetails>;
 
@@ -99,6 +125,9 @@ namespace ccf::historical
       std::vector<StoreDetailsPtr> requested_stores;
       std::chrono::milliseconds time_to_expiry;
 
+      // Position of this request in lru_requests
+      std::list<RequestHandle>::iterator lru_position;
+
       // Entries from outside the requested range (such as the next signature)
       // may be needed to trust this range. They are stored here, distinct from
       // user-requested stores.
@@ -132,6 +161,23 @@ namespace ccf::historical
         return nullptr;
       }
 
+      template <typename F>
+      void foreach_store_details(F&& f) const
+      {
+        for (const auto& details : requested_stores)
+        {
+          if (details != nullptr)
+          {
+            f(details);
+          }
+        }
+
+        if (supporting_signature.has_value())
+        {
+          f(supporting_signature->second);
+        }
+      }
+
       // Keep as many existing entries as possible, return indices that weren't
       // already present to indicate they should be fetched. For example, if we
       // were previously fetching:
@@ -352,27 +398,144 @@ namespace ccf::historical
     // Guard all access to internal state with this lock
     std::mutex requests_lock;
 
+    // Estimated size of all cached stores. Declared before requests, which
+    // update it as they release stores.
+    CacheSize cached_bytes = 0;
+
     // Track all things currently requested by external callers
     std::map<RequestHandle, Request> requests;
 
+    // Handles of all requests, from least to most recently accessed
+    std::list<RequestHandle> lru_requests;
+
     std::set<ccf::SeqNo> pending_fetches;
 
     ExpiryDuration default_expiry_duration = std::chrono::seconds(1800);
 
-    void fetch_entry_at(ccf::SeqNo seqno)
+    static constexpr CacheSize default_soft_cache_limit = 512 * 1024 * 1024;
+    CacheSize soft_cache_limit = default_soft_cache_limit;
+
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+
+    std::map<RequestHandle, Request>::iterator erase_request_unsafe(
+      std::map<RequestHandle, Request>::iterator it)
+    {
+      lru_requests.erase(it->second.lru_position);
+      return requests.erase(it);
+    }
+
+    // Drop least recently accessed requests until the cache fits within its
+    // soft limit. The most recently accessed request is always kept.
+    void enforce_soft_cache_limit_unsafe()
     {
-      const auto ib = pending_fetches.insert(seqno);
-      if (ib.second)
+      while (cached_bytes > soft_cache_limit && requests.size() > 1)
+      {
+        const auto lru_handle = lru_requests.front();
+        LOG_DEBUG_FMT(
+          "Historical cache holds {} bytes, over soft limit of {} - evicting "
+          "request {}",
+          cached_bytes,
+          soft_cache_limit,
+          lru_handle);
+        erase_request_unsafe(requests.find(lru_handle));
+        ++evictions;
+      }
+    }
+
+    // Find a store for seqno which another request has already fetched and
+    // trusts, so that it can be shared rather than fetched again
+    StoreDetailsPtr find_trusted_store_details(
+      RequestHandle handle, ccf::SeqNo seqno) const
+    {
+      for (const auto& [other_handle, request] : requests)
+      {
+        if (other_handle == handle)
+        {
+          continue;
+        }
+
+        auto details = request.get_store_details(seqno);
+        if (
+          details != nullptr && details->current_stage == RequestStage::Trusted)
+        {
+          return details;
+        }
+      }
+
+      return nullptr;
+    }
+
+    void request_entries(ccf::SeqNo from, ccf::SeqNo to)
+    {
+      if (from == to)
       {
-        // Newly requested seqno
         RINGBUFFER_WRITE_MESSAGE(
           consensus::ledger_get,
           to_host,
-          static_cast<consensus::Index>(seqno),
+          static_cast<consensus::Index>(from),
+          consensus::LedgerRequestPurpose::HistoricalQuery);
+      }
+      else
+      {
+        RINGBUFFER_WRITE_MESSAGE(
+          consensus::ledger_get_range,
+          to_host,
+          static_cast<consensus::Index>(from),
+          static_cast<consensus::Index>(to),
           consensus::LedgerRequestPurpose::HistoricalQuery);
       }
     }
 
+    // Requests every seqno in [from, to] which is not already being fetched,
+    // with a single message for each run of adjacent newly requested seqnos
+    void fetch_entries_range(ccf::SeqNo from, ccf::SeqNo to)
+    {
+      std::optional<ccf::SeqNo> run_start = std::nullopt;
+      for (auto seqno = from; seqno <= to; ++seqno)
+      {
+        const auto ib = pending_fetches.insert(seqno);
+        if (ib.second)
+        {
+          if (!run_start.has_value())
+          {
+            run_start = seqno;
+          }
+        }
+        else if (run_start.has_value())
+        {
+          request_entries(run_start.value(), seqno - 1);
+          run_start.reset();
+        }
+      }
+
+      if (run_start.has_value())
+      {
+        request_entries(run_start.value(), to);
+      }
+    }
+
+    void fetch_entries(const std::set<ccf::SeqNo>& seqnos)
+    {
+      auto it = seqnos.begin();
+      while (it != seqnos.end())
+      {
+        const auto from = *it;
+        auto to = from;
+        while (++it != seqnos.end() && *it == to + 1)
+        {
+          to = *it;
+        }
+        fetch_entries_range(from, to);
+      }
+    }
+
+    void fetch_entry_at(ccf::SeqNo seqno)
+    {
+      fetch_entries_range(seqno, seqno);
+    }
+
     std::optional<ccf::NodeInfo> get_node_info(const ccf::NodeId& node_id)
     {
       // Current solution: Use current state of Nodes table from real store.
@@ -467,9 +630,13 @@ namespace ccf::historical
     void process_deserialised_store(
       const StorePtr& store,
       const crypto::Sha256Hash& entry_digest,
+      size_t entry_size,
       ccf::SeqNo seqno,
       bool is_signature)
     {
+      // Shared by every request which receives this store
+      std::shared_ptr<CachedStoreSize> cached_size = nullptr;
+
       auto request_it = requests.begin();
       while (request_it != requests.end())
       {
@@ -489,7 +656,7 @@ namespace ccf::historical
           {
             // Invalid! Erase this request: host gave us junk, need to start
             // over
-            request_it = requests.erase(request_it);
+            request_it = erase_request_unsafe(request_it);
             continue;
           }
 
@@ -503,12 +670,8 @@ namespace ccf::historical
           {
             // Newly have all required secrets - begin fetching the actual
             // entries
-            for (auto seqno = request.first_requested_seqno;
-                 seqno <= request.last_requested_seqno;
-                 ++seqno)
-            {
-              fetch_entry_at(seqno);
-            }
+            fetch_entries_range(
+              request.first_requested_seqno, request.last_requested_seqno);
           }
 
           // In either case, done with this request, try the next
@@ -533,6 +696,12 @@ namespace ccf::historical
           }
 
           details->entry_digest = entry_digest;
+          if (cached_size == nullptr)
+          {
+            cached_size =
+              std::make_shared<CachedStoreSize>(cached_bytes, entry_size);
+          }
+          details->cached_size = cached_size;
 
           CCF_ASSERT_FMT(
             details->store == nullptr,
@@ -562,7 +731,7 @@ namespace ccf::historical
             }
             case (Request::UpdateTrustedResult::Invalidated):
             {
-              request_it = requests.erase(request_it);
+              request_it = erase_request_unsafe(request_it);
               break;
             }
             case (Request::UpdateTrustedResult::FetchNext):
@@ -631,15 +800,53 @@ namespace ccf::historical
       {
         // This is a new handle - insert a newly created Request for it
         it = requests.emplace_hint(it, handle, Request());
+        it->second.lru_position =
+          lru_requests.insert(lru_requests.end(), handle);
+      }
+      else
+      {
+        lru_requests.splice(
+          lru_requests.end(), lru_requests, it->second.lru_position);
       }
 
       Request& request = it->second;
 
+      const auto end_seqno =
+        static_cast<ccf::SeqNo>(start_seqno + num_following_indices);
+      const bool range_changed = request.requested_stores.empty() ||
+        request.first_requested_seqno != start_seqno ||
+        request.last_requested_seqno != end_seqno;
+
       // Update this Request to represent the currently requested range,
       // returning any newly requested indices
       auto new_indices =
         request.adjust_range(start_seqno, num_following_indices);
 
+      // Reuse any trusted stores already held by other requests, rather than
+      // fetching them from the ledger again
+      auto new_it = new_indices.begin();
+      while (new_it != new_indices.end() && *new_it <= end_seqno)
+      {
+        auto shared_details = find_trusted_store_details(handle, *new_it);
+        if (shared_details != nullptr)
+        {
+          request.requested_stores[*new_it - start_seqno] =
+            std::move(shared_details);
+          new_it = new_indices.erase(new_it);
+        }
+        else
+        {
+          ++new_it;
+        }
+      }
+
+      if (range_changed)
+      {
+        const size_t fetched = std::distance(new_indices.begin(), new_it);
+        misses += fetched;
+        hits += num_following_indices + 1 - fetched;
+      }
+
       // If the earliest target entry cannot be deserialised with the earliest
       // known ledger secret, record the target seqno and begin fetching the
       // previous historical ledger secret.
@@ -660,10 +867,7 @@ namespace ccf::historical
         // If we have sufficiently early secrets, begin fetching any newly
         // requested entries. If we don't fall into this branch, they'll only
         // begin to be fetched once the secret arrives.
-        for (const auto new_seqno : new_indices)
-        {
-          fetch_entry_at(new_seqno);
-        }
+        fetch_entries(new_indices);
       }
 
       // Reset the expiry timer as this has just been requested
@@ -706,7 +910,7 @@ namespace ccf::historical
       {
         if (request_it->second.get_store_details(seqno) != nullptr)
         {
-          request_it = requests.erase(request_it);
+          request_it = erase_request_unsafe(request_it);
         }
         else
         {
@@ -715,6 +919,112 @@ namespace ccf::historical
       }
     }
 
+    void handle_no_entries_unsafe(ccf::SeqNo from_seqno, ccf::SeqNo to_seqno)
+    {
+      // The host failed or refused to give these entries. Currently just
+      // forget about them and drop any requests which were looking for them -
+      // don't have a mechanism for remembering this failure and reporting it
+      // to users.
+      for (auto seqno = from_seqno; seqno <= to_seqno; ++seqno)
+      {
+        const auto fetches_it = pending_fetches.find(seqno);
+        if (fetches_it != pending_fetches.end())
+        {
+          delete_all_interested_requests(seqno);
+
+          pending_fetches.erase(fetches_it);
+        }
+      }
+    }
+
+    bool handle_ledger_entry_unsafe(ccf::SeqNo seqno, const LedgerEntry& data)
+    {
+      const auto it = pending_fetches.find(seqno);
+      if (it == pending_fetches.end())
+      {
+        // Unexpected entry - ignore it?
+        return false;
+      }
+
+      pending_fetches.erase(it);
+
+      // Create a new store and try to deserialise this entry into it
+      StorePtr store = std::make_shared<kv::Store>(
+        false /* Do not start from very first seqno */,
+        true /* Make use of historical secrets */);
+
+      // If this is older than the node's currently known ledger secrets, use
+      // the historical encryptor (which should have older secrets)
+      if (seqno < source_ledger_secrets->get_first().first)
+      {
+        store->set_encryptor(historical_encryptor);
+      }
+      else
+      {
+        store->set_encryptor(source_store.get_encryptor());
+      }
+
+      kv::ApplyResult deserialise_result;
+
+      try
+      {
+        // Encrypted ledger secrets are deserialised in public-only mode. Their
+        // Merkle tree integrity is not verified: even if the recovered ledger
+        // secret was bogus, the deserialisation of subsequent ledger entries
+        // would fail.
+        bool public_only = false;
+        for (const auto& [_, request] : requests)
+        {
+          if (
+            request.ledger_secret_recovery_info != nullptr &&
+            request.ledger_secret_recovery_info->target_seqno == seqno)
+          {
+            public_only = true;
+            break;
+          }
+        }
+
+        deserialise_result =
+          store->deserialize(data, ConsensusType::CFT, public_only)->apply();
+      }
+      catch (const std::exception& e)
+      {
+        LOG_FAIL_FMT(
+          "Exception while attempting to deserialise entry {}: {}",
+          seqno,
+          e.what());
+        deserialise_result = kv::ApplyResult::FAIL;
+      }
+
+      if (deserialise_result == kv::ApplyResult::FAIL)
+      {
+        return false;
+      }
+
+      const auto is_signature =
+        deserialise_result == kv::ApplyResult::PASS_SIGNATURE;
+      if (is_signature)
+      {
+        // This looks like a signature - check that we trust it
+        if (!verify_signature(store, seqno))
+        {
+          LOG_FAIL_FMT("Bad signature at {}", seqno);
+          delete_all_interested_requests(seqno);
+          return false;
+        }
+      }
+
+      LOG_DEBUG_FMT(
+        "Processing historical store at {} ({})",
+        seqno,
+        (size_t)deserialise_result);
+      const auto entry_digest = crypto::Sha256Hash(data);
+      process_deserialised_store(
+        store, entry_digest, data.size(), seqno, is_signature);
+
+      return true;
+    }
+
   public:
     StateCache(
       kv::Store& store,
@@ -807,116 +1117,108 @@ namespace ccf::historical
       default_expiry_duration = duration;
     }
 
-    bool drop_request(RequestHandle handle) override
+    void set_soft_cache_limit(CacheSize cache_limit) override
     {
       std::lock_guard<std::mutex> guard(requests_lock);
-      const auto erased_count = requests.erase(handle);
-      return erased_count > 0;
+      soft_cache_limit = cache_limit;
+      enforce_soft_cache_limit_unsafe();
     }
 
-    bool handle_ledger_entry(ccf::SeqNo seqno, const LedgerEntry& data)
+    CacheMetrics get_metrics() override
     {
       std::lock_guard<std::mutex> guard(requests_lock);
-      const auto it = pending_fetches.find(seqno);
-      if (it == pending_fetches.end())
+      CacheMetrics m;
+      m.hits = hits;
+      m.misses = misses;
+      m.evictions = evictions;
+      m.requests = requests.size();
+      m.cached_bytes = cached_bytes;
+      m.soft_limit_bytes = soft_cache_limit;
+      return m;
+    }
+
+    bool drop_request(RequestHandle handle) override
+    {
+      std::lock_guard<std::mutex> guard(requests_lock);
+      auto it = requests.find(handle);
+      if (it == requests.end())
       {
-        // Unexpected entry - ignore it?
         return false;
       }
 
-      pending_fetches.erase(it);
-
-      // Create a new store and try to deserialise this entry into it
-      StorePtr store = std::make_shared<kv::Store>(
-        false /* Do not start from very first seqno */,
-        true /* Make use of historical secrets */);
+      erase_request_unsafe(it);
+      return true;
+    }
 
-      // If this is older than the node's currently known ledger secrets, use
-      // the historical encryptor (which should have older secrets)
-      if (seqno < source_ledger_secrets->get_first().first)
-      {
-        store->set_encryptor(historical_encryptor);
-      }
-      else
-      {
-        store->set_encryptor(source_store.get_encryptor());
-      }
+    bool handle_ledger_entry(ccf::SeqNo seqno, const LedgerEntry& data)
+    {
+      std::lock_guard<std::mutex> guard(requests_lock);
+      const auto accepted = handle_ledger_entry_unsafe(seqno, data);
+      enforce_soft_cache_limit_unsafe();
+      return accepted;
+    }
 
-      kv::ApplyResult deserialise_result;
+    /** Handle the adjacent framed ledger entries [from_seqno, to_seqno], as
+     * returned by the host for a ledger_get_range request. Returns the number
+     * of entries which were accepted.
+     */
+    size_t handle_ledger_entries(
+      ccf::SeqNo from_seqno,
+      ccf::SeqNo to_seqno,
+      const uint8_t* data,
+      size_t size)
+    {
+      std::lock_guard<std::mutex> guard(requests_lock);
 
-      try
+      size_t accepted = 0;
+      for (auto seqno = from_seqno; seqno <= to_seqno; ++seqno)
       {
-        // Encrypted ledger secrets are deserialised in public-only mode. Their
-        // Merkle tree integrity is not verified: even if the recovered ledger
-        // secret was bogus, the deserialisation of subsequent ledger entries
-        // would fail.
-        bool public_only = false;
-        for (const auto& [_, request] : requests)
+        if (size < kv::serialised_entry_header_size)
         {
-          if (
-            request.ledger_secret_recovery_info != nullptr &&
-            request.ledger_secret_recovery_info->target_seqno == seqno)
-          {
-            public_only = true;
-            break;
-          }
+          LOG_FAIL_FMT(
+            "Range of ledger entries {} - {} is truncated at {}",
+            from_seqno,
+            to_seqno,
+            seqno);
+          handle_no_entries_unsafe(seqno, to_seqno);
+          break;
         }
 
-        deserialise_result =
-          store->deserialize(data, ConsensusType::CFT, public_only)->apply();
-      }
-      catch (const std::exception& e)
-      {
-        LOG_FAIL_FMT(
-          "Exception while attempting to deserialise entry {}: {}",
-          seqno,
-          e.what());
-        deserialise_result = kv::ApplyResult::FAIL;
-      }
-
-      if (deserialise_result == kv::ApplyResult::FAIL)
-      {
-        return false;
-      }
+        const auto header =
+          serialized::peek<kv::SerialisedEntryHeader>(data, size);
+        const size_t entry_size =
+          kv::serialised_entry_header_size + header.size;
+        if (entry_size > size)
+        {
+          LOG_FAIL_FMT(
+            "Range of ledger entries {} - {} is truncated at {}",
+            from_seqno,
+            to_seqno,
+            seqno);
+          handle_no_entries_unsafe(seqno, to_seqno);
+          break;
+        }
 
-      const auto is_signature =
-        deserialise_result == kv::ApplyResult::PASS_SIGNATURE;
-      if (is_signature)
-      {
-        // This looks like a signature - check that we trust it
-        if (!verify_signature(store, seqno))
+        if (handle_ledger_entry_unsafe(seqno, {data, data + entry_size}))
         {
-          LOG_FAIL_FMT("Bad signature at {}", seqno);
-          delete_all_interested_requests(seqno);
-          return false;
+          ++accepted;
         }
+        serialized::skip(data, size, entry_size);
       }
 
-      LOG_DEBUG_FMT(
-        "Processing historical store at {} ({})",
-        seqno,
-        (size_t)deserialise_result);
-      const auto entry_digest = crypto::Sha256Hash(data);
-      process_deserialised_store(store, entry_digest, seqno, is_signature);
-
-      return true;
+      enforce_soft_cache_limit_unsafe();
+      return accepted;
     }
 
     void handle_no_entry(ccf::SeqNo seqno)
     {
-      std::lock_guard<std::mutex> guard(requests_lock);
-
-      // The host failed or refused to give this entry. Currently just
-      // forget about it and drop any requests which were looking for it - don't
-      // have a mechanism for remembering this failure and reporting it to
-      // users.
-      const auto fetches_it = pending_fetches.find(seqno);
-      if (fetches_it != pending_fetches.end())
-      {
-        delete_all_interested_requests(seqno);
+      handle_no_entries(seqno, seqno);
+    }
 
-        pending_fetches.erase(fetches_it);
-      }
+    void handle_no_entries(ccf::SeqNo from_seqno, ccf::SeqNo to_seqno)
+    {
+      std::lock_guard<std::mutex> guard(requests_lock);
+      handle_no_entries_unsafe(from_seqno, to_seqno);
     }
 
     void tick(const std::chrono::milliseconds& elapsed_ms)
@@ -928,7 +1230,7 @@ namespace ccf::historical
         auto& request = it->second;
         if (elapsed_ms >= request.time_to_expiry)
         {
-          it = requests.erase(it);
+          it = erase_request_unsafe(it);
         }
         else
         {
@@ -135,6 +135,11 @@ namespace ccf
       version++;
     }
 
+    void append_entry(const crypto::Sha256Hash&) override
+    {
+      version++;
+    }
+
     kv::TxHistory::Result verify_and_sign(
       PrimarySignature&, kv::Term*, kv::Configuration::Nodes&) override
     {
@@ -400,7 +405,7 @@ namespace ccf
       tree = new HistoryTree(serialised);
     }
 
-    void append(crypto::Sha256Hash& hash)
+    void append(const crypto::Sha256Hash& hash)
     {
       tree->insert(merkle::Hash(hash.h));
     }
@@ -875,6 +880,13 @@ namespace ccf
       log_hash(rh, APPEND);
       replicated_state_tree.append(rh);
     }
+
+    void append_entry(const crypto::Sha256Hash& digest) override
+    {
+      std::lock_guard<std::mutex> guard(state_lock);
+      log_hash(digest, APPEND);
+      replicated_state_tree.append(digest);
+    }
   };
 
   using MerkleTxHistory = HashedTxHistory<MerkleTreeHistory>;
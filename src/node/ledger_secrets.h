@@ -44,11 +44,13 @@ namespace ccf
         // iterator on the last used secret to access ledger secrets in constant
         // time.
         auto& last_used_secret_it_ = last_used_secret_it.value();
-        if (
+        while (
           std::next(last_used_secret_it_) != ledger_secrets.end() &&
           version >= std::next(last_used_secret_it_)->first)
         {
-          // Across a rekey, start using the next key
+          // Across a rekey, start using the next key. Entries decrypted out
+          // of order (e.g. ahead of execution) use the slow path, so this
+          // may have to skip over several rekeys at once.
           ++last_used_secret_it_;
         }
 
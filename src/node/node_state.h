@@ -3,6 +3,7 @@
 #pragma once
 
 #include "blit.h"
+#include "commit_waiters.h"
 #include "consensus/aft/raft_consensus.h"
 #include "consensus/ledger_enclave.h"
 #include "crypto/entropy.h"
@@ -18,6 +19,7 @@
 #include "genesis_gen.h"
 #include "history.h"
 #include "hooks.h"
+#include "indexing/indexer.h"
 #include "js/wrap.h"
 #include "network_state.h"
 #include "node/jwt_key_auto_refresh.h"
@@ -116,6 +118,7 @@ namespace ccf
     std::shared_ptr<NodeToNode> n2n_channels;
     std::shared_ptr<Forwarder<NodeToNode>> cmd_forwarder;
     std::shared_ptr<enclave::RPCSessions> rpcsessions;
+    std::shared_ptr<CommitWaiters> commit_waiters;
 
     std::shared_ptr<kv::TxHistory> history;
     std::shared_ptr<ccf::ProgressTracker> progress_tracker;
@@ -124,6 +127,7 @@ namespace ccf
 
     ShareManager& share_manager;
     std::shared_ptr<Snapshotter> snapshotter;
+    std::shared_ptr<indexing::Indexer> indexer;
 
     //
     // recovery
@@ -138,6 +142,19 @@ namespace ccf
     RecoveredEncryptedLedgerSecrets recovery_ledger_secrets;
     consensus::Index ledger_idx = 0;
 
+    // While reading the ledger, entries are requested from the host up to
+    // this many ahead of the one being recovered, so that they are read while
+    // earlier entries are deserialised. They are requested as ranges of at
+    // least ledger_prefetch_batch entries (unless near the end of what is to
+    // be read), and are buffered until all earlier entries have been
+    // recovered.
+    static constexpr size_t ledger_prefetch_window = 64;
+    static constexpr size_t ledger_prefetch_batch = ledger_prefetch_window / 2;
+    consensus::Index last_requested_ledger_idx = 0;
+    std::map<consensus::Index, std::vector<uint8_t>> prefetched_ledger_entries;
+    // First index for which the host has no entry, i.e. the end of the ledger
+    std::optional<consensus::Index> ledger_end_idx = std::nullopt;
+
     //
     // JWT key auto-refresh
     //
@@ -146,6 +163,7 @@ namespace ccf
     struct StartupSnapshotInfo
     {
       std::vector<uint8_t>& raw;
+      std::vector<std::vector<uint8_t>>& deltas;
       consensus::Index seqno;
       consensus::Index evidence_seqno;
 
@@ -163,9 +181,11 @@ namespace ccf
       StartupSnapshotInfo(
         const std::shared_ptr<kv::Store>& store_,
         std::vector<uint8_t>& raw_,
+        std::vector<std::vector<uint8_t>>& deltas_,
         consensus::Index seqno_,
         consensus::Index evidence_seqno_) :
         raw(raw_),
+        deltas(deltas_),
         seqno(seqno_),
         evidence_seqno(evidence_seqno_),
         store(store_)
@@ -176,9 +196,35 @@ namespace ccf
         return has_evidence && is_evidence_committed;
       }
 
+      // Applies the snapshot, followed by its deltas
+      kv::ApplyResult apply(
+        kv::Store& target_store,
+        kv::ConsensusHookPtrs& hooks,
+        std::vector<kv::Version>* view_history,
+        bool public_only = false)
+      {
+        auto rc = target_store.deserialise_snapshot(
+          raw, hooks, view_history, public_only);
+        for (const auto& delta : deltas)
+        {
+          if (rc != kv::ApplyResult::PASS)
+          {
+            break;
+          }
+          rc = target_store.deserialise_snapshot(
+            delta, hooks, view_history, public_only);
+        }
+        return rc;
+      }
+
       ~StartupSnapshotInfo()
       {
         reset_data(raw);
+        for (auto& delta : deltas)
+        {
+          reset_data(delta);
+        }
+        deltas.clear();
       }
     };
     std::unique_ptr<StartupSnapshotInfo> startup_snapshot_info = nullptr;
@@ -221,11 +267,20 @@ namespace ccf
       }
 
       LOG_INFO_FMT(
-        "Deserialising public snapshot ({})", config.startup_snapshot.size());
+        "Deserialising public snapshot ({}, {} deltas)",
+        config.startup_snapshot.size(),
+        config.startup_snapshot_deltas.size());
+
+      startup_snapshot_info = std::make_unique<StartupSnapshotInfo>(
+        snapshot_store,
+        config.startup_snapshot,
+        config.startup_snapshot_deltas,
+        0,
+        config.startup_snapshot_evidence_seqno);
 
       kv::ConsensusHookPtrs hooks;
-      auto rc = snapshot_store->deserialise_snapshot(
-        config.startup_snapshot, hooks, &view_history, true);
+      auto rc = startup_snapshot_info->apply(
+        *snapshot_store, hooks, &view_history, true);
       if (rc != kv::ApplyResult::PASS)
       {
         throw std::logic_error(
@@ -238,14 +293,16 @@ namespace ccf
 
       startup_seqno = snapshot_store->current_version();
 
+      if (recovery)
+      {
+        // The snapshot was applied to the main store
+        indexer->reset_strategies(startup_seqno.value() + 1);
+      }
+
       ledger_idx = snapshot_store->current_version();
       last_recovered_signed_idx = ledger_idx;
 
-      startup_snapshot_info = std::make_unique<StartupSnapshotInfo>(
-        snapshot_store,
-        config.startup_snapshot,
-        ledger_idx,
-        config.startup_snapshot_evidence_seqno);
+      startup_snapshot_info->seqno = ledger_idx;
     }
 
   public:
@@ -263,6 +320,7 @@ namespace ccf
       to_host(writer_factory.create_writer_to_outside()),
       network(network),
       rpcsessions(rpcsessions),
+      commit_waiters(std::make_shared<CommitWaiters>(rpcsessions)),
       share_manager(share_manager)
     {
       if (network.consensus_type == ConsensusType::CFT)
@@ -296,6 +354,7 @@ namespace ccf
       const consensus::Configuration& consensus_config_,
       std::shared_ptr<enclave::RPCMap> rpc_map_,
       std::shared_ptr<enclave::AbstractRPCResponder> rpc_sessions_,
+      std::shared_ptr<indexing::Indexer> indexer_,
       size_t sig_tx_interval_,
       size_t sig_ms_interval_)
     {
@@ -304,6 +363,7 @@ namespace ccf
 
       consensus_config = consensus_config_;
       rpc_map = rpc_map_;
+      indexer = indexer_;
       sig_tx_interval = sig_tx_interval_;
       sig_ms_interval = sig_ms_interval_;
 
@@ -582,8 +642,8 @@ namespace ccf
                 startup_snapshot_info->raw.size());
               std::vector<kv::Version> view_history;
               kv::ConsensusHookPtrs hooks;
-              auto rc = network.tables->deserialise_snapshot(
-                startup_snapshot_info->raw,
+              auto rc = startup_snapshot_info->apply(
+                *network.tables,
                 hooks,
                 &view_history,
                 resp.network_info.public_only);
@@ -609,6 +669,7 @@ namespace ccf
 
               auto seqno = network.tables->current_version();
               consensus->init_as_backup(seqno, sig->view, view_history);
+              indexer->reset_strategies(seqno + 1);
 
               if (!resp.network_info.public_only)
               {
@@ -765,13 +826,145 @@ namespace ccf
       }
 
       LOG_INFO_FMT("Starting to read public ledger");
-      read_ledger_idx(++ledger_idx);
+      start_reading_ledger_unsafe(ledger_idx + 1);
     }
 
-    void recover_public_ledger_entry(const std::vector<uint8_t>& ledger_entry)
+    void recover_ledger_entry(
+      consensus::Index idx, std::vector<uint8_t>&& ledger_entry)
     {
       std::lock_guard<std::mutex> guard(lock);
+      if (!is_reading_ledger_unsafe())
+      {
+        LOG_FAIL_FMT(
+          "Cannot recover ledger entry {}: Unexpected node state {}",
+          idx,
+          sm.value());
+        return;
+      }
+
+      if (idx < ledger_idx || idx > last_requested_ledger_idx)
+      {
+        LOG_DEBUG_FMT("Ignoring unexpected ledger entry {}", idx);
+        return;
+      }
+
+      prefetched_ledger_entries.emplace(idx, std::move(ledger_entry));
+      recover_prefetched_ledger_entries_unsafe();
+    }
+
+    void recover_ledger_no_entry(consensus::Index idx)
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      if (
+        !is_reading_ledger_unsafe() || idx < ledger_idx ||
+        idx > last_requested_ledger_idx)
+      {
+        // Entries requested beyond the end of the ledger may be reported
+        // missing after the end has been handled
+        LOG_DEBUG_FMT("Ignoring unexpected missing ledger entry {}", idx);
+        return;
+      }
+
+      if (!ledger_end_idx.has_value() || idx < ledger_end_idx.value())
+      {
+        ledger_end_idx = idx;
+      }
+      recover_prefetched_ledger_entries_unsafe();
+    }
+
+    bool is_reading_ledger_unsafe() const
+    {
+      return sm.check(State::readingPublicLedger) ||
+        sm.check(State::verifyingSnapshot) ||
+        sm.check(State::readingPrivateLedger);
+    }
+
+    void start_reading_ledger_unsafe(consensus::Index from)
+    {
+      ledger_idx = from;
+      last_requested_ledger_idx = from - 1;
+      prefetched_ledger_entries.clear();
+      ledger_end_idx = std::nullopt;
+      prefetch_ledger_entries_unsafe();
+    }
+
+    void prefetch_ledger_entries_unsafe()
+    {
+      const auto window_end = ledger_idx + ledger_prefetch_window - 1;
+      auto last_idx = window_end;
+      if (ledger_end_idx.has_value())
+      {
+        last_idx = std::min(last_idx, ledger_end_idx.value());
+      }
+      const auto recovery_idx = static_cast<consensus::Index>(recovery_v);
+      if (sm.check(State::readingPrivateLedger) && recovery_idx >= ledger_idx)
+      {
+        // The private ledger is only read up to the end of the public ledger
+        last_idx = std::min(last_idx, recovery_idx);
+      }
+
+      if (last_requested_ledger_idx >= last_idx)
+      {
+        return;
+      }
+
+      // Until the end of what is to be read is in sight, wait for a whole
+      // batch of the window to be free, so that the host is not sent one
+      // request per recovered entry. At least half the window is still
+      // requested, so this never stalls.
+      if (
+        last_idx == window_end &&
+        last_idx - last_requested_ledger_idx < ledger_prefetch_batch)
+      {
+        return;
+      }
+
+      read_ledger_range(last_requested_ledger_idx + 1, last_idx);
+      last_requested_ledger_idx = last_idx;
+    }
+
+    void recover_prefetched_ledger_entries_unsafe()
+    {
+      auto it = prefetched_ledger_entries.begin();
+      while (it != prefetched_ledger_entries.end() && it->first == ledger_idx)
+      {
+        const auto ledger_entry = std::move(it->second);
+        prefetched_ledger_entries.erase(it);
+
+        const bool keep_reading = sm.check(State::readingPrivateLedger) ?
+          recover_private_ledger_entry_unsafe(ledger_entry) :
+          recover_public_ledger_entry_unsafe(ledger_entry);
+        if (!keep_reading)
+        {
+          prefetched_ledger_entries.clear();
+          return;
+        }
+
+        ++ledger_idx;
+        it = prefetched_ledger_entries.begin();
+      }
+
+      if (ledger_end_idx.has_value() && ledger_idx >= ledger_end_idx.value())
+      {
+        prefetched_ledger_entries.clear();
+        if (sm.check(State::verifyingSnapshot))
+        {
+          verify_snapshot_end_unsafe();
+        }
+        else
+        {
+          recover_ledger_end_unsafe();
+        }
+        return;
+      }
+
+      prefetch_ledger_entries_unsafe();
+    }
 
+    // Returns false if reading the ledger should stop
+    bool recover_public_ledger_entry_unsafe(
+      const std::vector<uint8_t>& ledger_entry)
+    {
       std::shared_ptr<kv::Store> store;
       if (sm.check(State::readingPublicLedger))
       {
@@ -788,7 +981,7 @@ namespace ccf
           "Node should be in state {} or {} to recover public ledger entry",
           State::readingPublicLedger,
           State::verifyingSnapshot);
-        return;
+        return false;
       }
 
       LOG_INFO_FMT(
@@ -800,7 +993,7 @@ namespace ccf
       {
         LOG_FAIL_FMT("Failed to deserialise entry in public ledger");
         recover_public_ledger_end_unsafe();
-        return;
+        return false;
       }
 
       // Not synchronised because consensus isn't effectively running then
@@ -876,7 +1069,10 @@ namespace ccf
             throw std::logic_error("Invalid snapshot evidence");
           }
 
-          if (evidence->hash == crypto::Sha256Hash(startup_snapshot_info->raw))
+          if (
+            evidence->hash ==
+            get_snapshot_evidence_hash(
+              startup_snapshot_info->raw, startup_snapshot_info->deltas))
           {
             LOG_DEBUG_FMT(
               "Snapshot evidence for snapshot found at {}",
@@ -886,12 +1082,11 @@ namespace ccf
         }
       }
 
-      read_ledger_idx(++ledger_idx);
+      return true;
     }
 
-    void verify_snapshot_end()
+    void verify_snapshot_end_unsafe()
     {
-      std::lock_guard<std::mutex> guard(lock);
       if (!sm.check(State::verifyingSnapshot))
       {
         LOG_FAIL_FMT(
@@ -1071,14 +1266,15 @@ namespace ccf
     //
     // funcs in state "readingPrivateLedger"
     //
-    void recover_private_ledger_entry(const std::vector<uint8_t>& ledger_entry)
+    // Returns false if reading the ledger should stop
+    bool recover_private_ledger_entry_unsafe(
+      const std::vector<uint8_t>& ledger_entry)
     {
-      std::lock_guard<std::mutex> guard(lock);
       if (!sm.check(State::readingPrivateLedger))
       {
         LOG_FAIL_FMT(
           "Node is state {} cannot recover private ledger entry", sm.value());
-        return;
+        return false;
       }
 
       LOG_INFO_FMT(
@@ -1094,7 +1290,7 @@ namespace ccf
         // be discarded
         recovery_store->rollback({0, ledger_idx - 1}, 0);
         recover_private_ledger_end_unsafe();
-        return;
+        return false;
       }
 
       if (result == kv::ApplyResult::PASS_SIGNATURE)
@@ -1106,11 +1302,10 @@ namespace ccf
       {
         LOG_INFO_FMT("Reached recovery final version at {}", recovery_v);
         recover_private_ledger_end_unsafe();
+        return false;
       }
-      else
-      {
-        read_ledger_idx(++ledger_idx);
-      }
+
+      return true;
     }
 
     void recover_private_ledger_end_unsafe()
@@ -1140,6 +1335,10 @@ namespace ccf
       network.tables->swap_private_maps(*recovery_store.get());
       recovery_store.reset();
 
+      // Writes to private maps before recovery_v were only applied to the
+      // recovery store
+      indexer->reset_strategies(recovery_v + 1, kv::SecurityDomain::PRIVATE);
+
       // Raft should deserialise all security domains when network is opened
       consensus->enable_all_domains();
 
@@ -1214,10 +1413,8 @@ namespace ccf
     //
     // funcs in state "readingPublicLedger" or "readingPrivateLedger"
     //
-    void recover_ledger_end()
+    void recover_ledger_end_unsafe()
     {
-      std::lock_guard<std::mutex> guard(lock);
-
       if (is_reading_public_ledger())
       {
         recover_public_ledger_end_unsafe();
@@ -1267,8 +1464,8 @@ namespace ccf
           startup_snapshot_info->raw.size());
         std::vector<kv::Version> view_history;
         kv::ConsensusHookPtrs hooks;
-        auto rc = recovery_store->deserialise_snapshot(
-          startup_snapshot_info->raw, hooks, &view_history);
+        auto rc =
+          startup_snapshot_info->apply(*recovery_store, hooks, &view_history);
         if (rc != kv::ApplyResult::PASS)
         {
           throw std::logic_error(fmt::format(
@@ -1385,10 +1582,8 @@ namespace ccf
       reset_recovery_hook();
 
       // Start reading private security domain of ledger
-      ledger_idx = recovery_store->current_version();
-      read_ledger_idx(++ledger_idx);
-
       sm.advance(State::readingPrivateLedger);
+      start_reading_ledger_unsafe(recovery_store->current_version() + 1);
     }
 
     //
@@ -1396,6 +1591,8 @@ namespace ccf
     //
     void tick(std::chrono::milliseconds elapsed)
     {
+      commit_waiters->tick(elapsed);
+
       if (
         !sm.check(State::partOfNetwork) &&
         !sm.check(State::partOfPublicNetwork) &&
@@ -1572,6 +1769,11 @@ namespace ccf
       return sm;
     }
 
+    CommitWaiters& get_commit_waiters() override
+    {
+      return *commit_waiters;
+    }
+
   private:
     std::vector<crypto::SubjectAltName> get_subject_alternative_names()
     {
@@ -1778,10 +1980,8 @@ namespace ccf
       setup_one_off_secret_hook();
 
       // Start reading private security domain of ledger
-      ledger_idx = recovery_store->current_version();
-      read_ledger_idx(++ledger_idx);
-
       sm.advance(State::readingPrivateLedger);
+      start_reading_ledger_unsafe(recovery_store->current_version() + 1);
     }
 
     void setup_basic_hooks()
@@ -1975,6 +2175,7 @@ namespace ccf
         sig_tx_interval,
         public_only,
         initial_state);
+      raft->set_commit_waiters(commit_waiters);
 
       consensus = std::make_shared<RaftConsensusType>(
         std::move(raft), network.consensus_type);
@@ -2043,7 +2244,10 @@ namespace ccf
     void setup_snapshotter()
     {
       snapshotter = std::make_shared<Snapshotter>(
-        writer_factory, network.tables, config.snapshot_tx_interval);
+        writer_factory,
+        network.tables,
+        config.snapshot_tx_interval,
+        config.max_snapshot_deltas);
     }
 
     void setup_tracker_store()
@@ -2055,12 +2259,13 @@ namespace ccf
       }
     }
 
-    void read_ledger_idx(consensus::Index idx)
+    void read_ledger_range(consensus::Index from, consensus::Index to)
     {
       RINGBUFFER_WRITE_MESSAGE(
-        consensus::ledger_get,
+        consensus::ledger_get_range,
         to_host,
-        idx,
+        from,
+        to,
         consensus::LedgerRequestPurpose::Recovery);
     }
 
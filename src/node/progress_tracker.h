@@ -110,26 +110,30 @@ namespace ccf
           cert, bft_node_sig, tx_id.view, tx_id.seqno, node_id);
         cert.my_nonce = my_nonce;
         cert.have_primary_signature = true;
-        for (auto sig = cert.sigs.begin(); sig != cert.sigs.end();)
+
+        std::vector<NodeSignature> pending_sigs;
+        for (const auto& [node, sig] : cert.sigs)
+        {
+          if (!sig.is_primary)
+          {
+            pending_sigs.push_back(sig);
+          }
+        }
+        const auto valid = store->verify_signatures(cert.root, pending_sigs);
+        cert.unverified_sigs.clear();
+        for (size_t i = 0; i < pending_sigs.size(); ++i)
         {
-          if (
-            !sig->second.is_primary &&
-            !store->verify_signature(
-              sig->second.node,
-              cert.root,
-              sig->second.sig.size(),
-              sig->second.sig.data()))
+          if (!valid[i])
           {
-            sig = cert.sigs.erase(sig);
+            cert.sigs.erase(pending_sigs[i].node);
           }
           else
           {
             LOG_TRACE_FMT(
               "Signature verification from {} passed, view:{}, seqno:{}",
-              sig->second.node,
+              pending_sigs[i].node,
               tx_id.view,
               tx_id.seqno);
-            ++sig;
           }
         }
         cert.sigs.insert(
@@ -383,10 +387,23 @@ namespace ccf
       }
 
       auto& cert = it->second;
+      if (cert.sigs.find(node_id) == cert.sigs.end())
+      {
+        cert.unmatched_nonces.insert(std::pair<NodeId, Nonce>(node_id, nonce));
+        return;
+      }
+
+      // Nonces only count towards commit once their signatures are verified
+      verify_pending_signatures(cert, tx_id);
       auto it_node_sig = cert.sigs.find(node_id);
       if (it_node_sig == cert.sigs.end())
       {
-        cert.unmatched_nonces.insert(std::pair<NodeId, Nonce>(node_id, nonce));
+        LOG_FAIL_FMT(
+          "Ignoring nonce from {} whose signature failed verification, "
+          "view:{}, seqno:{}",
+          node_id,
+          tx_id.view,
+          tx_id.seqno);
         return;
       }
 
@@ -506,6 +523,8 @@ namespace ccf
       }
 
       auto& cert = it->second;
+      verify_pending_signatures(cert, highest_prepared_level);
+
       auto m = std::make_unique<ViewChangeRequest>();
       m->seqno = highest_prepared_level.seqno;
       m->root = cert.root;
@@ -565,10 +584,12 @@ namespace ccf
         "Applying view-change from:{}, view:{}, seqno:{}", from, view, seqno);
       bool verified_signatures = true;
 
-      for (auto& sig : view_change.signatures)
+      const auto valid =
+        store->verify_signatures(view_change.root, view_change.signatures);
+      for (size_t i = 0; i < view_change.signatures.size(); ++i)
       {
-        if (!store->verify_signature(
-              sig.node, view_change.root, sig.sig.size(), sig.sig.data()))
+        const auto& sig = view_change.signatures[i];
+        if (!valid[i])
         {
           LOG_FAIL_FMT(
             "signatures do not match, view-change from:{}, view:{}, seqno:{}, "
@@ -581,7 +602,6 @@ namespace ccf
             sig.sig,
             sig.sig.size());
           verified_signatures = false;
-          continue;
         }
       }
 
@@ -714,27 +734,6 @@ namespace ccf
           std::pair<ccf::TxID, CommitCert>(tx_id, CommitCert()));
         it = r.first;
       }
-      else
-      {
-        if (
-          node_id != id && it->second.have_primary_signature &&
-          !store->verify_signature(
-            node_id, it->second.root, signature_size, sig.data()))
-        {
-          throw ccf::ccf_logic_error(fmt::format(
-            "add_signatures: Signature verification from {} FAILED, view:{}, "
-            "seqno:{}",
-            node_id,
-            tx_id.view,
-            tx_id.seqno));
-          return kv::TxHistory::Result::FAIL;
-        }
-        LOG_TRACE_FMT(
-          "Signature verification from {} passed, view:{}, seqno:{}",
-          node_id,
-          tx_id.view,
-          tx_id.seqno);
-      }
 
       auto& cert = it->second;
       if (cert.wrote_sig_to_ledger)
@@ -763,8 +762,17 @@ namespace ccf
       BftNodeSignature bft_node_sig(std::move(sig_vec), node_id, hashed_nonce);
       try_match_unmatched_nonces(
         cert, bft_node_sig, tx_id.view, tx_id.seqno, node_id);
-      cert.sigs.insert(
-        std::pair<NodeId, BftNodeSignature>(node_id, std::move(bft_node_sig)));
+      const auto inserted = cert.sigs
+                              .insert(std::pair<NodeId, BftNodeSignature>(
+                                node_id, std::move(bft_node_sig)))
+                              .second;
+
+      // Signatures from other nodes are verified together, once there are
+      // enough of them to send an ack (see can_send_sig_ack)
+      if (inserted && node_id != id && cert.have_primary_signature)
+      {
+        cert.unverified_sigs.insert(node_id);
+      }
 
       if (can_send_sig_ack(cert, tx_id, config))
       {
@@ -862,35 +870,91 @@ namespace ccf
       return std::equal(n_1.h.begin(), n_1.h.end(), n_2.h.begin());
     }
 
+    // Verifies the signatures in cert that have not yet been checked against
+    // its root. Any that fail are dropped from the cert, with the nonces
+    // matched to them, so that they are never counted as endorsements.
+    // Returns false if any signature was dropped.
+    bool verify_pending_signatures(CommitCert& cert, const ccf::TxID& tx_id)
+    {
+      if (cert.unverified_sigs.empty())
+      {
+        return true;
+      }
+
+      std::vector<NodeSignature> pending_sigs;
+      for (const auto& node_id : cert.unverified_sigs)
+      {
+        pending_sigs.push_back(cert.sigs.at(node_id));
+      }
+      cert.unverified_sigs.clear();
+
+      bool all_valid = true;
+      const auto valid = store->verify_signatures(cert.root, pending_sigs);
+      for (size_t i = 0; i < pending_sigs.size(); ++i)
+      {
+        const auto& node_id = pending_sigs[i].node;
+        if (!valid[i])
+        {
+          LOG_FAIL_FMT(
+            "Signature verification from {} FAILED, view:{}, seqno:{}",
+            node_id,
+            tx_id.view,
+            tx_id.seqno);
+          cert.sigs.erase(node_id);
+          cert.nonce_set.erase(node_id);
+          all_valid = false;
+          continue;
+        }
+        LOG_TRACE_FMT(
+          "Signature verification from {} passed, view:{}, seqno:{}",
+          node_id,
+          tx_id.view,
+          tx_id.seqno);
+      }
+      return all_valid;
+    }
+
     bool can_send_sig_ack(
       CommitCert& cert,
       const ccf::TxID& tx_id,
       const kv::Configuration::Nodes& config)
     {
-      uint32_t endorsements = count_endorsements_in_config(cert.sigs, config);
+      if (cert.ack_sent || !cert.have_primary_signature)
+      {
+        return false;
+      }
 
+      const auto threshold = get_endorsement_threshold(config.size());
+      if (count_endorsements_in_config(cert.sigs, config) < threshold)
+      {
+        return false;
+      }
+
+      // Only verified signatures count, so recount once any that failed
+      // verification have been dropped
       if (
-        endorsements >= get_endorsement_threshold(config.size()) &&
-        !cert.ack_sent && cert.have_primary_signature)
+        !verify_pending_signatures(cert, tx_id) &&
+        count_endorsements_in_config(cert.sigs, config) < threshold)
       {
-        if (tx_id.seqno > highest_prepared_level.seqno)
+        return false;
+      }
+
+      if (tx_id.seqno > highest_prepared_level.seqno)
+      {
+        if (tx_id.view < highest_prepared_level.view)
         {
-          if (tx_id.view < highest_prepared_level.view)
-          {
-            LOG_INFO_FMT(
-              "Prepared terms are moving backwards new_term:{}, "
-              "current_term:{}",
-              tx_id.view,
-              highest_prepared_level.view);
-            return false;
-          }
-          highest_prepared_level = tx_id;
+          LOG_INFO_FMT(
+            "Prepared terms are moving backwards new_term:{}, "
+            "current_term:{}",
+            tx_id.view,
+            highest_prepared_level.view);
+          return false;
         }
-
-        cert.ack_sent = true;
-        return true;
+        highest_prepared_level = tx_id;
       }
-      return false;
+
+      cert.ack_sent = true;
+      return true;
     }
 
     bool can_send_reply_and_nonce(
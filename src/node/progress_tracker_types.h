@@ -5,8 +5,11 @@
 #include "backup_signatures.h"
 #include "blit.h"
 #include "consensus/aft/revealed_nonces.h"
+#include "crypto/batch_verifier.h"
 #include "crypto/hash.h"
 #include "crypto/verifier.h"
+#include "ds/ring_buffer.h"
+#include "ds/thread_messaging.h"
 #include "kv/committable_tx.h"
 #include "node_signature.h"
 #include "tls/tls.h"
@@ -48,6 +51,9 @@ namespace ccf
     std::set<NodeId> sig_acks;
     std::set<NodeId> nonce_set;
     std::map<NodeId, Nonce> unmatched_nonces;
+    // Signatures in sigs, received once root was known, which have not yet
+    // been verified against it
+    std::set<NodeId> unverified_sigs;
     Nonce my_nonce;
     bool have_primary_signature = false;
     bool ack_sent = false;
@@ -70,6 +76,22 @@ namespace ccf
       crypto::Sha256Hash& root,
       uint32_t sig_size,
       uint8_t* sig) = 0;
+
+    /** Returns, for each signature, whether it is a valid signature over root
+     * by its node. By default, each is checked with verify_signature().
+     */
+    virtual std::vector<bool> verify_signatures(
+      crypto::Sha256Hash& root, std::vector<NodeSignature>& sigs)
+    {
+      std::vector<bool> results;
+      results.reserve(sigs.size());
+      for (auto& sig : sigs)
+      {
+        results.push_back(
+          verify_signature(sig.node, root, sig.sig.size(), sig.sig.data()));
+      }
+      return results;
+    }
     virtual void sign_view_change_request(
       ViewChangeRequest& view_change, ccf::View view) = 0;
     virtual bool verify_view_change_request(
@@ -172,20 +194,74 @@ namespace ccf
       uint8_t* sig) override
     {
       kv::ReadOnlyTx tx(&store);
-      auto ni_tv = tx.ro(nodes);
-
-      auto ni = ni_tv->get(node_id);
-      if (!ni.has_value())
+      auto from_cert = get_node_verifier(tx, node_id);
+      if (from_cert == nullptr)
       {
-        LOG_FAIL_FMT(
-          "No node info, and therefore no cert for node {}", node_id);
         return false;
       }
-      crypto::VerifierPtr from_cert = crypto::make_verifier(ni.value().cert);
       return from_cert->verify_hash(
         root.h.data(), root.h.size(), sig, sig_size, crypto::MDType::SHA256);
     }
 
+    std::vector<bool> verify_signatures(
+      crypto::Sha256Hash& root, std::vector<NodeSignature>& sigs) override
+    {
+      kv::ReadOnlyTx tx(&store);
+      const std::vector<uint8_t> hash(root.h.begin(), root.h.end());
+
+      auto batch = std::make_shared<crypto::BatchVerifier>();
+      std::vector<std::optional<size_t>> batch_indices;
+      batch_indices.reserve(sigs.size());
+      for (const auto& sig : sigs)
+      {
+        auto from_cert = get_node_verifier(tx, sig.node);
+        if (from_cert == nullptr)
+        {
+          batch_indices.push_back(std::nullopt);
+        }
+        else
+        {
+          batch_indices.push_back(batch->add_verify_hash(
+            from_cert, hash, sig.sig, crypto::MDType::SHA256));
+        }
+      }
+
+      // Other execution threads help with the batch, while this thread
+      // verifies whatever they have not claimed. It then waits only for
+      // verifications already in progress elsewhere.
+      const auto current_tid = threading::get_current_thread_id();
+      for (size_t i = 1;
+           i < std::min<size_t>(
+                 batch->size(), threading::ThreadMessaging::thread_count);
+           ++i)
+      {
+        const auto tid = threading::ThreadMessaging::get_execution_thread(i);
+        if (tid != current_tid)
+        {
+          auto msg =
+            std::make_unique<threading::Tmsg<VerifyBatchMsg>>(&verify_batch_cb);
+          msg->data.batch = batch;
+          threading::ThreadMessaging::thread_messaging.add_task(
+            tid, std::move(msg));
+        }
+      }
+
+      batch->run();
+      while (!batch->is_complete())
+      {
+        CCF_PAUSE();
+      }
+
+      const auto batch_results = batch->get_results();
+      std::vector<bool> results;
+      results.reserve(sigs.size());
+      for (const auto& idx : batch_indices)
+      {
+        results.push_back(idx.has_value() && batch_results[idx.value()]);
+      }
+      return results;
+    }
+
     void sign_view_change_request(
       ViewChangeRequest& view_change, ccf::View view) override
     {
@@ -202,15 +278,11 @@ namespace ccf
       crypto::Sha256Hash h = hash_view_change(view_change, view);
 
       kv::ReadOnlyTx tx(&store);
-      auto ni_tv = tx.ro(nodes);
-
-      auto ni = ni_tv->get(from);
-      if (!ni.has_value())
+      auto from_cert = get_node_verifier(tx, from);
+      if (from_cert == nullptr)
       {
-        LOG_FAIL_FMT("No node info, and therefore no cert for node {}", from);
         return false;
       }
-      crypto::VerifierPtr from_cert = crypto::make_verifier(ni.value().cert);
       return from_cert->verify_hash(
         h.h, view_change.signature, crypto::MDType::SHA256);
     }
@@ -219,15 +291,11 @@ namespace ccf
       ViewChangeConfirmation& new_view, const NodeId& from) override
     {
       kv::ReadOnlyTx tx(&store);
-      auto ni_tv = tx.ro(nodes);
-
-      auto ni = ni_tv->get(from);
-      if (!ni.has_value())
+      auto from_cert = get_node_verifier(tx, from);
+      if (from_cert == nullptr)
       {
-        LOG_FAIL_FMT("No node info, and therefore no cert for node {}", from);
         return false;
       }
-      crypto::VerifierPtr from_cert = crypto::make_verifier(ni.value().cert);
       auto h = hash_new_view(new_view);
       return from_cert->verify_hash(
         h.h, new_view.signature, crypto::MDType::SHA256);
@@ -281,6 +349,56 @@ namespace ccf
     aft::RevealedNoncesMap revealed_nonces;
     NewViewsMap new_views;
 
+    struct VerifyBatchMsg
+    {
+      std::shared_ptr<crypto::BatchVerifier> batch;
+    };
+
+    static void verify_batch_cb(
+      std::unique_ptr<threading::Tmsg<VerifyBatchMsg>> msg)
+    {
+      msg->data.batch->run();
+    }
+
+    // Verifier for each node's certificate, so that certificates are not
+    // parsed again for every signature. Entries are replaced if the node's
+    // certificate changes, and removed once the node is retired or gone.
+    std::mutex node_verifiers_lock;
+    std::map<NodeId, std::pair<crypto::Pem, crypto::VerifierPtr>>
+      node_verifiers;
+
+    crypto::VerifierPtr get_node_verifier(
+      kv::ReadOnlyTx& tx, const NodeId& node_id)
+    {
+      auto ni_tv = tx.ro(nodes);
+      auto ni = ni_tv->get(node_id);
+      if (!ni.has_value())
+      {
+        LOG_FAIL_FMT(
+          "No node info, and therefore no cert for node {}", node_id);
+        std::lock_guard<std::mutex> guard(node_verifiers_lock);
+        node_verifiers.erase(node_id);
+        return nullptr;
+      }
+
+      std::lock_guard<std::mutex> guard(node_verifiers_lock);
+      if (ni->status == NodeStatus::RETIRED)
+      {
+        // Retired nodes are not expected to sign again, so are not cached
+        node_verifiers.erase(node_id);
+        return crypto::make_verifier(ni->cert);
+      }
+
+      auto it = node_verifiers.find(node_id);
+      if (it == node_verifiers.end() || it->second.first != ni->cert)
+      {
+        node_verifiers[node_id] =
+          std::make_pair(ni->cert, crypto::make_verifier(ni->cert));
+        it = node_verifiers.find(node_id);
+      }
+      return it->second.second;
+    }
+
     crypto::Sha256Hash hash_view_change(
       const ViewChangeRequest& v, ccf::View view) const
     {
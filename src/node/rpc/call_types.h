@@ -93,6 +93,25 @@ namespace ccf
 
   struct EndpointMetrics
   {
+    struct Bucket
+    {
+      // Inclusive bounds, in microseconds
+      uint64_t lower_us = 0;
+      uint64_t upper_us = 0;
+      size_t count = 0;
+    };
+
+    struct StageLatency
+    {
+      std::string stage;
+      size_t count = 0;
+      uint64_t sum_us = 0;
+      uint64_t min_us = 0;
+      uint64_t max_us = 0;
+      // Only buckets containing at least one sample
+      std::vector<Bucket> buckets;
+    };
+
     struct Entry
     {
       std::string path;
@@ -101,6 +120,7 @@ namespace ccf
       size_t errors = 0;
       size_t failures = 0;
       size_t retries = 0;
+      std::vector<StageLatency> latencies;
     };
 
     struct Out
@@ -6,6 +6,7 @@
 #include "consensus/aft/request.h"
 #include "crypto/verifier.h"
 #include "ds/buffer.h"
+#include "ds/latency_clock.h"
 #include "enclave/rpc_handler.h"
 #include "forwarder.h"
 #include "http/http_jwt.h"
@@ -146,6 +147,27 @@ namespace ccf
       }
     }
 
+    // Records the time spent in each stage of handling a request when it goes
+    // out of scope, however handling of the request completes
+    struct LatencyRecorder
+    {
+      endpoints::EndpointRegistry& endpoints;
+      const endpoints::EndpointDefinitionPtr& endpoint;
+      endpoints::RequestLatencies latencies = {};
+
+      ~LatencyRecorder()
+      {
+        try
+        {
+          endpoints.record_latencies(endpoint, latencies);
+        }
+        catch (const std::exception& e)
+        {
+          LOG_FAIL_FMT("Failed to record request latencies: {}", e.what());
+        }
+      }
+    };
+
     std::optional<std::vector<uint8_t>> process_command(
       std::shared_ptr<enclave::RpcContext> ctx,
       kv::CommittableTx& tx,
@@ -194,11 +216,20 @@ namespace ccf
       // are not counted against any particular endpoint.
       endpoints.increment_metrics_calls(endpoint);
 
+      LatencyRecorder recorder{endpoints, endpoint};
+      auto& latencies = recorder.latencies;
+      if (ctx->parse_duration.has_value())
+      {
+        latencies.add(
+          endpoints::LatencyStage::Parse, ctx->parse_duration.value());
+      }
+
       std::unique_ptr<AuthnIdentity> identity = nullptr;
 
       // If any auth policy was required, check that at least one is accepted
       if (!endpoint->authn_policies.empty())
       {
+        const auto authn_start = ds::LatencyClock::now();
         std::string auth_error_reason;
         for (const auto& policy : endpoint->authn_policies)
         {
@@ -208,6 +239,9 @@ namespace ccf
             break;
           }
         }
+        latencies.add(
+          endpoints::LatencyStage::Authenticate,
+          ds::LatencyClock::since(authn_start));
 
         if (identity == nullptr)
         {
@@ -290,7 +324,17 @@ namespace ccf
             pre_exec(tx, *ctx.get());
           }
 
+          const auto execute_start = ds::LatencyClock::now();
           endpoints.execute_endpoint(endpoint, args);
+          latencies.add(
+            endpoints::LatencyStage::Execute,
+            ds::LatencyClock::since(execute_start));
+
+          if (ctx->response_is_pending)
+          {
+            // The endpoint will respond later, so hold the connection
+            return std::nullopt;
+          }
 
           if (!ctx->should_apply_writes())
           {
@@ -298,6 +342,7 @@ namespace ccf
             return ctx->serialise_response();
           }
 
+          const auto commit_start = ds::LatencyClock::now();
           kv::CommitResult result;
           bool track_read_versions =
             (consensus != nullptr && consensus->type() == ConsensusType::BFT);
@@ -318,6 +363,24 @@ namespace ccf
             result = tx.commit(track_read_versions);
           }
 
+          // Time spent handing the transaction to replication is reported
+          // separately from the rest of the commit
+          const auto commit_duration = ds::LatencyClock::since(commit_start);
+          const auto handoff_duration = tx.get_replication_handoff_time();
+          if (commit_duration.has_value() && handoff_duration.has_value())
+          {
+            latencies.add(
+              endpoints::LatencyStage::Commit,
+              commit_duration.value() - handoff_duration.value());
+            latencies.add(
+              endpoints::LatencyStage::ReplicationHandoff,
+              handoff_duration.value());
+          }
+          else
+          {
+            latencies.add(endpoints::LatencyStage::Commit, commit_duration);
+          }
+
           switch (result)
           {
             case kv::CommitResult::SUCCESS:
@@ -330,6 +393,12 @@ namespace ccf
                 // Also, only report a TxID if the consensus is set, as the
                 // consensus is required to verify that a TxID is valid.
                 ctx->set_tx_id(tx_id.value());
+
+                if (handoff_duration.has_value())
+                {
+                  endpoints.record_pending_global_commit(
+                    endpoint, tx_id.value());
+                }
               }
 
               if (
@@ -702,6 +771,7 @@ namespace ccf
       // value for stats
       size_t tx_count = tx_count_since_tick.exchange(0u);
 
+      endpoints.record_global_commit_latencies();
       endpoints.tick(elapsed, tx_count);
     }
   };
@@ -8,6 +8,7 @@
 #include "ccf/json_handler.h"
 #include "ccf/version.h"
 #include "crypto/hash.h"
+#include "ds/thread_messaging.h"
 #include "frontend.h"
 #include "node/entities.h"
 #include "node/network_state.h"
@@ -44,9 +45,34 @@ namespace ccf
   DECLARE_JSON_TYPE(GetQuotes::Out)
   DECLARE_JSON_REQUIRED_FIELDS(GetQuotes::Out, quotes)
 
+  struct ThreadQueueMetrics
+  {
+    size_t thread_id;
+    size_t pending_tasks;
+    size_t assigned_sessions;
+    uint64_t tasks_run;
+    uint64_t batches;
+    uint64_t tasks_run_last_tick;
+    // Entry i counts tasks which waited less than 2^i milliseconds to run
+    std::vector<uint64_t> latency_histogram;
+  };
+
+  DECLARE_JSON_TYPE(ThreadQueueMetrics)
+  DECLARE_JSON_REQUIRED_FIELDS(
+    ThreadQueueMetrics,
+    thread_id,
+    pending_tasks,
+    assigned_sessions,
+    tasks_run,
+    batches,
+    tasks_run_last_tick,
+    latency_histogram)
+
   struct NodeMetrics
   {
     ccf::SessionMetrics sessions;
+    ccf::historical::CacheMetrics historical_cache;
+    std::vector<ThreadQueueMetrics> thread_queues;
   };
 
   DECLARE_JSON_TYPE(ccf::SessionMetrics)
@@ -54,7 +80,8 @@ namespace ccf
     ccf::SessionMetrics, active, peak, soft_cap, hard_cap)
 
   DECLARE_JSON_TYPE(NodeMetrics)
-  DECLARE_JSON_REQUIRED_FIELDS(NodeMetrics, sessions)
+  DECLARE_JSON_REQUIRED_FIELDS(
+    NodeMetrics, sessions, historical_cache, thread_queues)
 
   struct JavaScriptMetrics
   {
@@ -228,7 +255,7 @@ namespace ccf
       openapi_info.description =
         "This API provides public, uncredentialed access to service and node "
         "state.";
-      openapi_info.document_version = "1.4.0";
+      openapi_info.document_version = "1.8.0";
     }
 
     void init_handlers() override
@@ -946,6 +973,21 @@ namespace ccf
       auto node_metrics = [this](auto& args) {
         NodeMetrics nm;
         nm.sessions = context.get_node_state().get_session_metrics();
+        nm.historical_cache = context.get_historical_state().get_metrics();
+
+        const auto task_stats =
+          threading::ThreadMessaging::thread_messaging.get_stats();
+        for (size_t tid = 0; tid < task_stats.size(); ++tid)
+        {
+          const auto& stats = task_stats[tid];
+          nm.thread_queues.push_back({tid,
+                                      stats.pending_tasks,
+                                      stats.assigned_sessions,
+                                      stats.tasks_run,
+                                      stats.batches,
+                                      stats.tasks_run_last_tick,
+                                      stats.latency_histogram});
+        }
 
         args.rpc_ctx->set_response_status(HTTP_STATUS_OK);
         args.rpc_ctx->set_response_header(
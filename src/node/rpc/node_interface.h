@@ -28,6 +28,8 @@ namespace ccf
     size_t hard_cap;
   };
 
+  class CommitWaiters;
+
   class AbstractNodeState
   {
   public:
@@ -56,5 +58,6 @@ namespace ccf
       CodeDigest& code_digest) = 0;
     virtual std::optional<kv::Version> get_startup_snapshot_seqno() = 0;
     virtual SessionMetrics get_session_metrics() = 0;
+    virtual CommitWaiters& get_commit_waiters() = 0;
   };
 }
\ No newline at end of file
@@ -94,9 +94,28 @@ namespace ccf
   DECLARE_JSON_TYPE(GetNodes::Out)
   DECLARE_JSON_REQUIRED_FIELDS(GetNodes::Out, nodes)
 
+  DECLARE_JSON_TYPE(EndpointMetrics::Bucket)
+  DECLARE_JSON_REQUIRED_FIELDS(
+    EndpointMetrics::Bucket, lower_us, upper_us, count)
+  DECLARE_JSON_TYPE(EndpointMetrics::StageLatency)
+  DECLARE_JSON_REQUIRED_FIELDS(
+    EndpointMetrics::StageLatency,
+    stage,
+    count,
+    sum_us,
+    min_us,
+    max_us,
+    buckets)
   DECLARE_JSON_TYPE(EndpointMetrics::Entry)
   DECLARE_JSON_REQUIRED_FIELDS(
-    EndpointMetrics::Entry, path, method, calls, errors, failures, retries)
+    EndpointMetrics::Entry,
+    path,
+    method,
+    calls,
+    errors,
+    failures,
+    retries,
+    latencies)
   DECLARE_JSON_TYPE(EndpointMetrics::Out)
   DECLARE_JSON_REQUIRED_FIELDS(EndpointMetrics::Out, metrics)
 
@@ -9,7 +9,9 @@
 #include "ccf/user_frontend.h"
 #include "consensus/aft/request.h"
 #include "ds/files.h"
+#include "ds/latency_clock.h"
 #include "ds/logger.h"
+#include "http/authentication/jwt_auth.h"
 #include "kv/map.h"
 #include "kv/test/null_encryptor.h"
 #include "kv/test/stub_consensus.h"
@@ -22,6 +24,7 @@
 #include "node/rpc/serdes.h"
 #include "node/test/channel_stub.h"
 #include "node_stub.h"
+#include "tls/base64.h"
 
 #include <doctest/doctest.h>
 #include <iostream>
@@ -242,6 +245,8 @@ public:
       ctx.rpc_ctx->set_response_status(HTTP_STATUS_OK);
     };
     make_endpoint("/{foo}/{bar}/{baz}", HTTP_POST, endpoint).install();
+    make_endpoint("/records/{id}.json", HTTP_POST, endpoint).install();
+    make_endpoint("/ranges/{a}-{b}", HTTP_POST, endpoint).install();
   }
 };
 
@@ -735,6 +740,369 @@ TEST_CASE("process with caller")
   }
 }
 
+TEST_CASE("Caller certificate digest is cached per session")
+{
+  NetworkState network;
+  prepare_callers(network);
+  TestUserFrontend frontend(*network.tables);
+
+  auto session = make_shared<enclave::SessionContext>(
+    enclave::InvalidSessionId, user_caller_der);
+  const auto serialized_call =
+    create_simple_request("/empty_function").build_request();
+
+  INFO("First request computes the digest");
+  {
+    REQUIRE_FALSE(session->caller_cert_digest.has_value());
+    auto rpc_ctx = enclave::make_rpc_context(session, serialized_call);
+    auto response = parse_response(frontend.process(rpc_ctx).value());
+    REQUIRE(response.status == HTTP_STATUS_OK);
+    REQUIRE(session->caller_cert_digest.has_value());
+    REQUIRE(session->caller_cert_digest.value() == user_id.value());
+  }
+
+  INFO("Later requests reuse the digest");
+  {
+    auto rpc_ctx = enclave::make_rpc_context(session, serialized_call);
+    auto response = parse_response(frontend.process(rpc_ctx).value());
+    REQUIRE(response.status == HTTP_STATUS_OK);
+    REQUIRE(session->caller_cert_digest.value() == user_id.value());
+  }
+
+  INFO("Removing the user is seen by the next request");
+  {
+    auto tx = network.tables->create_tx();
+    GenesisGenerator g(network, tx);
+    g.remove_user(user_id);
+    REQUIRE(tx.commit() == kv::CommitResult::SUCCESS);
+
+    auto rpc_ctx = enclave::make_rpc_context(session, serialized_call);
+    auto response = parse_response(frontend.process(rpc_ctx).value());
+    REQUIRE(response.status == HTTP_STATUS_UNAUTHORIZED);
+  }
+}
+
+class TestJwtAuthnPolicy : public JwtAuthnPolicy
+{
+public:
+  using JwtAuthnPolicy::get_token_cache_expiry;
+  using JwtAuthnPolicy::JwtAuthnPolicy;
+  using JwtAuthnPolicy::validate_token;
+
+  size_t cached_verifiers()
+  {
+    return verifiers.size();
+  }
+
+  size_t cached_tokens()
+  {
+    return validated_tokens.size();
+  }
+};
+
+std::string b64url_from_raw(const std::vector<uint8_t>& raw)
+{
+  auto s = tls::b64_from_raw(raw);
+  std::replace(s.begin(), s.end(), '+', '-');
+  std::replace(s.begin(), s.end(), '/', '_');
+  s.erase(s.find_last_not_of('=') + 1);
+  return s;
+}
+
+std::string make_jwt(
+  crypto::KeyPair& signing_kp,
+  const std::string& kid,
+  const nlohmann::json& payload = nlohmann::json::object())
+{
+  const nlohmann::json header = {{"alg", "RS256"}, {"kid", kid}};
+  const auto header_s = header.dump();
+  const auto payload_s = payload.dump();
+  const auto signed_content =
+    b64url_from_raw({header_s.begin(), header_s.end()}) + "." +
+    b64url_from_raw({payload_s.begin(), payload_s.end()});
+  const auto signature =
+    signing_kp.sign(signed_content, crypto::MDType::SHA256);
+  return signed_content + "." + b64url_from_raw(signature);
+}
+
+http::JwtVerifier::Token parse_jwt(const std::string& jwt)
+{
+  std::string_view token = jwt;
+  std::string error_reason;
+  auto parsed = http::JwtVerifier::parse_token(token, error_reason);
+  REQUIRE(parsed.has_value());
+  return parsed.value();
+}
+
+void set_jwt_key(
+  NetworkState& network,
+  const std::string& kid,
+  const std::optional<std::vector<uint8_t>>& cert_der)
+{
+  auto tx = network.tables->create_tx();
+  auto keys = tx.rw<JwtPublicSigningKeys>(Tables::JWT_PUBLIC_SIGNING_KEYS);
+  if (cert_der.has_value())
+  {
+    keys->put(kid, cert_der.value());
+  }
+  else
+  {
+    keys->remove(kid);
+  }
+  REQUIRE(tx.commit() == kv::CommitResult::SUCCESS);
+}
+
+bool validate_jwt(
+  NetworkState& network,
+  TestJwtAuthnPolicy& policy,
+  const http::JwtVerifier::Token& token,
+  std::string& error_reason)
+{
+  auto tx = network.tables->create_read_only_tx();
+  auto keys = tx.ro<JwtPublicSigningKeys>(Tables::JWT_PUBLIC_SIGNING_KEYS);
+  return policy.validate_token(*keys, token, error_reason);
+}
+
+TEST_CASE("JWT verifiers and validated tokens are cached")
+{
+  NetworkState network;
+  network.tables->set_encryptor(encryptor);
+  const std::string kid = "kid";
+  set_jwt_key(network, kid, user_caller_der);
+
+  // The token cache is only used once the enclave has a clock
+  enclave::last_value = std::chrono::seconds(10);
+
+  TestJwtAuthnPolicy policy;
+  const auto jwt = make_jwt(*kp, kid);
+  const auto token = parse_jwt(jwt);
+  std::string error_reason;
+
+  // Same encoded token, but the signature is not checked on a cache hit
+  auto forged_token = token;
+  forged_token.signature.back() ^= 0xff;
+
+  INFO("A valid token is cached");
+  {
+    REQUIRE(validate_jwt(network, policy, token, error_reason));
+    REQUIRE(policy.cached_verifiers() == 1);
+    REQUIRE(policy.cached_tokens() == 1);
+  }
+
+  INFO("Later requests with the same token skip signature verification");
+  {
+    REQUIRE(validate_jwt(network, policy, forged_token, error_reason));
+    REQUIRE(policy.cached_tokens() == 1);
+
+    TestJwtAuthnPolicy uncached_policy(std::chrono::seconds(0));
+    REQUIRE_FALSE(
+      validate_jwt(network, uncached_policy, forged_token, error_reason));
+    REQUIRE(uncached_policy.cached_tokens() == 0);
+  }
+
+  INFO("A reader of the old key is not affected by a newer cache");
+  {
+    auto old_tx = network.tables->create_read_only_tx();
+    auto old_keys =
+      old_tx.ro<JwtPublicSigningKeys>(Tables::JWT_PUBLIC_SIGNING_KEYS);
+    REQUIRE(old_keys->has(kid));
+
+    INFO("Rotating the key invalidates both caches");
+    set_jwt_key(network, kid, invalid_caller_der);
+    REQUIRE_FALSE(validate_jwt(network, policy, forged_token, error_reason));
+    REQUIRE_FALSE(validate_jwt(network, policy, token, error_reason));
+    REQUIRE(error_reason == "JWT signature is invalid");
+    REQUIRE(policy.cached_tokens() == 0);
+
+    const auto rotated_jwt = make_jwt(*kp_other, kid);
+    const auto rotated_token = parse_jwt(rotated_jwt);
+    REQUIRE(validate_jwt(network, policy, rotated_token, error_reason));
+    REQUIRE(policy.cached_tokens() == 1);
+
+    REQUIRE(policy.validate_token(*old_keys, token, error_reason));
+    REQUIRE_FALSE(
+      policy.validate_token(*old_keys, rotated_token, error_reason));
+    REQUIRE(policy.cached_tokens() == 1);
+  }
+
+  INFO("Removing the key rejects cached tokens");
+  {
+    set_jwt_key(network, kid, std::nullopt);
+    const auto rotated_jwt = make_jwt(*kp_other, kid);
+    const auto rotated_token = parse_jwt(rotated_jwt);
+    REQUIRE_FALSE(validate_jwt(network, policy, rotated_token, error_reason));
+    REQUIRE(error_reason == "JWT signing key not found");
+  }
+
+  enclave::last_value = std::chrono::microseconds(0);
+}
+
+TEST_CASE("JWT token cache expiry is capped by the token's exp claim")
+{
+  TestJwtAuthnPolicy policy(std::chrono::seconds(30));
+  const auto now = std::chrono::seconds(100);
+
+  INFO("Without an exp claim, tokens are cached for the TTL");
+  {
+    const auto jwt = make_jwt(*kp, "kid");
+    const auto token = parse_jwt(jwt);
+    REQUIRE(
+      policy.get_token_cache_expiry(token, now) == std::chrono::seconds(130));
+  }
+
+  INFO("A later exp does not extend the TTL");
+  {
+    const auto jwt = make_jwt(*kp, "kid", {{"exp", 200}});
+    const auto token = parse_jwt(jwt);
+    REQUIRE(
+      policy.get_token_cache_expiry(token, now) == std::chrono::seconds(130));
+  }
+
+  INFO("An earlier exp shortens the TTL");
+  {
+    const auto jwt = make_jwt(*kp, "kid", {{"exp", 110}});
+    const auto token = parse_jwt(jwt);
+    REQUIRE(
+      policy.get_token_cache_expiry(token, now) == std::chrono::seconds(110));
+  }
+
+  INFO("Expired tokens are not cached");
+  {
+    NetworkState network;
+    network.tables->set_encryptor(encryptor);
+    set_jwt_key(network, "kid", user_caller_der);
+    enclave::last_value = now;
+
+    const auto jwt = make_jwt(*kp, "kid", {{"exp", 50}});
+    const auto token = parse_jwt(jwt);
+    std::string error_reason;
+    REQUIRE(validate_jwt(network, policy, token, error_reason));
+    REQUIRE(policy.cached_verifiers() == 1);
+    REQUIRE(policy.cached_tokens() == 0);
+
+    enclave::last_value = std::chrono::microseconds(0);
+  }
+}
+
+class TestVerifierCache : public VerifierCache
+{
+public:
+  using VerifierCache::VerifierCache;
+
+  size_t num_shards()
+  {
+    return shards.size();
+  }
+
+  size_t get_shard_index(const crypto::Pem& pem)
+  {
+    const auto digest = crypto::Sha256Hash({pem.data(), pem.size()}).h;
+    const auto& shard = get_shard(digest);
+    for (size_t i = 0; i < shards.size(); ++i)
+    {
+      if (shards[i].get() == &shard)
+      {
+        return i;
+      }
+    }
+    throw std::logic_error("Shard not found");
+  }
+
+  size_t size()
+  {
+    size_t n = 0;
+    for (const auto& shard : shards)
+    {
+      n += shard->verifiers.size();
+    }
+    return n;
+  }
+};
+
+std::vector<crypto::Pem> make_certs(size_t n)
+{
+  std::vector<crypto::Pem> certs;
+  for (size_t i = 0; i < n; ++i)
+  {
+    certs.push_back(
+      crypto::make_key_pair()->self_sign(fmt::format("CN=cert{}", i)));
+  }
+  return certs;
+}
+
+TEST_CASE("Verifier cache shards")
+{
+  const auto certs = make_certs(8);
+
+  INFO("There are never more shards than entries");
+  {
+    TestVerifierCache cache(2, 16);
+    REQUIRE(cache.num_shards() == 2);
+    REQUIRE_THROWS(TestVerifierCache(0, 1));
+    REQUIRE_THROWS(TestVerifierCache(1, 0));
+  }
+
+  INFO("Each certificate is always found in the same shard");
+  {
+    TestVerifierCache cache(1024, 16);
+    std::set<size_t> used_shards;
+    for (const auto& cert : certs)
+    {
+      const auto index = cache.get_shard_index(cert);
+      REQUIRE(index < cache.num_shards());
+      REQUIRE(cache.get_shard_index(cert) == index);
+      used_shards.insert(index);
+    }
+
+    // Certificates are spread across shards
+    REQUIRE(used_shards.size() > 1);
+  }
+
+  INFO("Cached verifiers are reused");
+  {
+    TestVerifierCache cache(1024, 16);
+    std::vector<crypto::VerifierPtr> verifiers;
+    for (const auto& cert : certs)
+    {
+      verifiers.push_back(cache.get_verifier(cert));
+    }
+    REQUIRE(cache.size() == certs.size());
+
+    for (size_t i = 0; i < certs.size(); ++i)
+    {
+      REQUIRE(cache.get_verifier(certs[i]) == verifiers[i]);
+    }
+    REQUIRE(cache.size() == certs.size());
+  }
+}
+
+TEST_CASE("Verifier cache eviction")
+{
+  const auto certs = make_certs(3);
+  const auto& a = certs[0];
+  const auto& b = certs[1];
+  const auto& c = certs[2];
+
+  TestVerifierCache cache(2, 1);
+  const auto verifier_a = cache.get_verifier(a);
+  const auto verifier_b = cache.get_verifier(b);
+  REQUIRE(cache.size() == 2);
+
+  INFO("A hit marks the entry as most recently used");
+  REQUIRE(cache.get_verifier(a) == verifier_a);
+
+  INFO("The least recently used entry is evicted");
+  cache.get_verifier(c);
+  REQUIRE(cache.size() == 2);
+  REQUIRE(cache.get_verifier(a) == verifier_a);
+
+  INFO("An evicted entry is reconstructed on its next use");
+  const auto new_verifier_b = cache.get_verifier(b);
+  REQUIRE(new_verifier_b != verifier_b);
+  REQUIRE(new_verifier_b->cert_der() == verifier_b->cert_der());
+  REQUIRE(cache.size() == 2);
+}
+
 TEST_CASE("No certs table")
 {
   NetworkState network;
@@ -1146,6 +1514,75 @@ TEST_CASE("Templated paths")
   }
 }
 
+TEST_CASE("Templated paths with literals in segments")
+{
+  NetworkState network;
+  prepare_callers(network);
+  TestTemplatedPaths frontend(*network.tables);
+
+  const auto get_params = [&](const std::string& path) {
+    auto request = create_simple_request(path);
+    const auto serialized_request = request.build_request();
+
+    auto rpc_ctx = enclave::make_rpc_context(user_session, serialized_request);
+    auto response = parse_response(frontend.process(rpc_ctx).value());
+    REQUIRE(response.status == HTTP_STATUS_OK);
+
+    const auto response_json = nlohmann::json::parse(response.body);
+    return response_json.get<std::map<std::string, std::string>>();
+  };
+
+  {
+    std::map<std::string, std::string> expected_mapping;
+    expected_mapping["id"] = "42";
+    CHECK(get_params("/records/42.json") == expected_mapping);
+  }
+
+  {
+    INFO("Parameters are matched greedily");
+    std::map<std::string, std::string> expected_mapping;
+    expected_mapping["a"] = "fin-fang";
+    expected_mapping["b"] = "foom";
+    CHECK(get_params("/ranges/fin-fang-foom") == expected_mapping);
+  }
+
+  {
+    INFO("Literals within a segment must match exactly");
+    auto request = create_simple_request("/records/42xjson");
+    const auto serialized_request = request.build_request();
+
+    auto rpc_ctx = enclave::make_rpc_context(user_session, serialized_request);
+    auto response = parse_response(frontend.process(rpc_ctx).value());
+    CHECK(response.status == HTTP_STATUS_NOT_FOUND);
+  }
+}
+
+TEST_CASE("Ambiguous templated paths are rejected on install")
+{
+  ccf::endpoints::EndpointRegistry registry("test");
+  auto endpoint = [](auto& ctx) {};
+  const auto install = [&](const std::string& path, RESTVerb verb) {
+    registry.make_endpoint(path, verb, endpoint, no_auth_required).install();
+  };
+
+  install("/users/{id}", HTTP_GET);
+  install("/users/{id}/address", HTTP_GET);
+  install("/files/{name}.json", HTTP_GET);
+  install("/files/{name}.xml", HTTP_GET);
+
+  // Replacing an existing endpoint is not ambiguous
+  install("/users/{id}", HTTP_GET);
+
+  // Neither is an overlapping template for a different verb
+  install("/{kind}/{id}", HTTP_POST);
+
+  CHECK_THROWS(install("/users/{name}", HTTP_GET));
+  CHECK_THROWS(install("/{kind}/{id}", HTTP_GET));
+  CHECK_THROWS(install("/{kind}/{id}/address", HTTP_GET));
+  CHECK_THROWS(install("/users/{id}.json", HTTP_GET));
+  CHECK_THROWS(install("/files/{name}", HTTP_GET));
+}
+
 TEST_CASE("Signed read requests can be executed on backup")
 {
   NetworkState network;
@@ -1542,6 +1979,175 @@ TEST_CASE("Retry on conflict")
   }
 }
 
+TEST_CASE("Endpoint latency metrics")
+{
+  NetworkState network;
+  prepare_callers(network);
+  TestExplicitCommitability frontend(*network.tables);
+
+  auto send_requests = [&](size_t count) {
+    for (size_t i = 0; i < count; ++i)
+    {
+      http::Request request("maybe_commit", HTTP_POST);
+      const nlohmann::json request_body = {{"value", i},
+                                           {"status", HTTP_STATUS_OK}};
+      const auto serialized_body = serdes::pack(request_body, default_pack);
+      request.set_body(&serialized_body);
+
+      const auto serialized_request = request.build_request();
+      auto rpc_ctx =
+        enclave::make_rpc_context(user_session, serialized_request);
+      const auto response = parse_response(frontend.process(rpc_ctx).value());
+      REQUIRE(response.status == HTTP_STATUS_OK);
+    }
+  };
+
+  auto get_metrics = [&]() {
+    http::Request request("api/metrics", HTTP_GET);
+    const auto serialized_request = request.build_request();
+    auto rpc_ctx = enclave::make_rpc_context(user_session, serialized_request);
+    const auto response = parse_response(frontend.process(rpc_ctx).value());
+    REQUIRE(response.status == HTTP_STATUS_OK);
+
+    const auto body = serdes::unpack(response.body, serdes::Pack::Text);
+    const auto metrics = body.get<ccf::EndpointMetrics::Out>().metrics;
+    const auto it = std::find_if(
+      metrics.begin(), metrics.end(), [](const auto& entry) {
+        return entry.path == "maybe_commit" && entry.method == "POST";
+      });
+    REQUIRE(it != metrics.end());
+    return *it;
+  };
+
+  INFO("No latencies are recorded unless stage timing is enabled");
+  {
+    REQUIRE_FALSE(ds::LatencyClock::is_enabled());
+    send_requests(1);
+    const auto metrics = get_metrics();
+    CHECK(metrics.calls == 1);
+    CHECK(metrics.latencies.empty());
+  }
+
+  ds::LatencyClock::set_enabled(true);
+  constexpr size_t request_count = 3;
+  send_requests(request_count);
+  ds::LatencyClock::set_enabled(false);
+
+  INFO("Latencies are reported for each stage the requests reached");
+  {
+    const auto metrics = get_metrics();
+    CHECK(metrics.calls == request_count + 1);
+
+    // Requests were not parsed from a session, and required no
+    // authentication, so only the later stages are reported
+    std::vector<std::string> stages;
+    for (const auto& latency : metrics.latencies)
+    {
+      stages.push_back(latency.stage);
+      CHECK(latency.count == request_count);
+      CHECK(latency.min_us <= latency.max_us);
+
+      size_t bucket_total = 0;
+      for (const auto& bucket : latency.buckets)
+      {
+        CHECK(bucket.lower_us <= bucket.upper_us);
+        bucket_total += bucket.count;
+      }
+      CHECK(bucket_total == request_count);
+    }
+    CHECK(
+      stages ==
+      std::vector<std::string>{"execute", "commit", "replication_handoff"});
+  }
+
+  INFO("Latencies are exported in Prometheus' text format");
+  {
+    http::Request request("api/metrics/prometheus", HTTP_GET);
+    const auto serialized_request = request.build_request();
+    auto rpc_ctx = enclave::make_rpc_context(user_session, serialized_request);
+    const auto response = parse_response(frontend.process(rpc_ctx).value());
+    REQUIRE(response.status == HTTP_STATUS_OK);
+
+    const std::string text(response.body.begin(), response.body.end());
+    const auto contains = [&text](const std::string& line) {
+      return text.find(line + "\n") != std::string::npos;
+    };
+    const std::string labels = "path=\"maybe_commit\",method=\"POST\"";
+
+    CHECK(contains("# TYPE ccf_endpoint_latency_microseconds histogram"));
+    CHECK(contains(fmt::format("ccf_endpoint_calls_total{{{}}} 4", labels)));
+    CHECK(contains(fmt::format(
+      "ccf_endpoint_latency_microseconds_count{{{},stage=\"execute\"}} 3",
+      labels)));
+    CHECK(contains(fmt::format(
+      "ccf_endpoint_latency_microseconds_bucket{{{},stage=\"commit\",le=\"+"
+      "Inf\"}} 3",
+      labels)));
+  }
+}
+
+TEST_CASE("Latency to global commit")
+{
+  using namespace ccf::endpoints;
+  LatencyMetrics metrics;
+
+  INFO("Nothing is recorded unless stage timing is enabled");
+  {
+    RequestLatencies latencies;
+    latencies.add(LatencyStage::Execute, std::chrono::milliseconds(1));
+    metrics.record("path", "POST", latencies);
+    CHECK(metrics.get_summaries().empty());
+  }
+
+  ds::LatencyClock::set_enabled(true);
+
+  const auto committed_at = std::chrono::steady_clock::now();
+  metrics.add_pending_global_commit("path", "POST", {2, 10}, committed_at);
+  metrics.add_pending_global_commit("path", "POST", {2, 11}, committed_at);
+  metrics.add_pending_global_commit("path", "POST", {2, 12}, committed_at);
+
+  auto get_global_commit_count = [&]() -> size_t {
+    auto summaries = metrics.get_summaries();
+    for (const auto& summary : summaries["path"]["POST"])
+    {
+      if (summary.stage == LatencyStage::GlobalCommit)
+      {
+        return summary.count;
+      }
+    }
+    return 0;
+  };
+
+  auto get_view = [](ccf::SeqNo seqno) -> ccf::View {
+    // 11 was rolled back, and replaced in a later view
+    return seqno == 11 ? 3 : 2;
+  };
+
+  INFO("Transactions are only recorded once committed");
+  {
+    metrics.record_global_commits(9, get_view, committed_at);
+    CHECK(get_global_commit_count() == 0);
+
+    const auto now = committed_at + std::chrono::milliseconds(5);
+    metrics.record_global_commits(10, get_view, now);
+    CHECK(get_global_commit_count() == 1);
+
+    const auto summary = metrics.get_summaries()["path"]["POST"].front();
+    CHECK(summary.sum == 5000);
+  }
+
+  INFO("Rolled back transactions are dropped");
+  {
+    metrics.record_global_commits(12, get_view, committed_at);
+    CHECK(get_global_commit_count() == 2);
+
+    metrics.record_global_commits(20, get_view, committed_at);
+    CHECK(get_global_commit_count() == 2);
+  }
+
+  ds::LatencyClock::set_enabled(false);
+}
+
 int main(int argc, char** argv)
 {
   doctest::Context context;
@@ -19,6 +19,9 @@ using namespace serdes;
 
 using TResponse = http::SimpleResponseProcessor::Response;
 
+threading::ThreadMessaging threading::ThreadMessaging::thread_messaging;
+std::atomic<uint16_t> threading::ThreadMessaging::thread_count = 0;
+
 auto kp = crypto::make_key_pair();
 auto member_cert = kp -> self_sign("CN=name_member");
 auto node_id = 0;
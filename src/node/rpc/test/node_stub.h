@@ -3,18 +3,36 @@
 #pragma once
 
 #include "ccf/historical_queries_interface.h"
+#include "ccf/indexing/strategy.h"
 #include "kv/test/stub_consensus.h"
+#include "node/commit_waiters.h"
 #include "node/rpc/node_interface.h"
 #include "node/share_manager.h"
 
 namespace ccf
 {
+  class StubRPCResponder : public enclave::AbstractRPCResponder
+  {
+  public:
+    std::vector<std::pair<size_t, std::vector<uint8_t>>> replies;
+
+    bool reply_async(size_t id, std::vector<uint8_t>&& data) override
+    {
+      replies.emplace_back(id, std::move(data));
+      return true;
+    }
+  };
+
   class StubNodeState : public ccf::AbstractNodeState
   {
   private:
     bool is_public = false;
 
   public:
+    std::shared_ptr<StubRPCResponder> responder =
+      std::make_shared<StubRPCResponder>();
+    CommitWaiters commit_waiters{responder};
+
     void transition_service_to_open(kv::Tx& tx) override
     {
       return;
@@ -116,6 +134,11 @@ namespace ccf
     {
       return {};
     }
+
+    CommitWaiters& get_commit_waiters() override
+    {
+      return commit_waiters;
+    }
   };
 
   class StubNodeStateCache : public historical::AbstractStateCache
@@ -125,6 +148,13 @@ namespace ccf
       historical::ExpiryDuration seconds_until_expiry)
     {}
 
+    void set_soft_cache_limit(historical::CacheSize cache_limit) {}
+
+    historical::CacheMetrics get_metrics()
+    {
+      return {};
+    }
+
     historical::StorePtr get_store_at(
       historical::RequestHandle handle,
       ccf::SeqNo seqno,
@@ -176,11 +206,23 @@ namespace ccf
     }
   };
 
+  class StubIndexer : public indexing::AbstractIndexer
+  {
+  public:
+    void install_strategy(const indexing::StrategyPtr& strategy) override {}
+
+    bool uninstall_strategy(const indexing::StrategyPtr& strategy) override
+    {
+      return true;
+    }
+  };
+
   struct StubNodeContext : public ccfapp::AbstractNodeContext
   {
   public:
     StubNodeState state = {};
     StubNodeStateCache cache = {};
+    StubIndexer indexer = {};
 
     ccf::historical::AbstractStateCache& get_historical_state()
     {
@@ -191,6 +233,11 @@ namespace ccf
     {
       return state;
     }
+
+    indexing::AbstractIndexer& get_indexer()
+    {
+      return indexer;
+    }
   };
 
   class StubRecoverableNodeState : public StubNodeState
@@ -218,6 +265,7 @@ namespace ccf
   public:
     StubRecoverableNodeState state;
     StubNodeStateCache cache = {};
+    StubIndexer indexer = {};
 
     StubRecoverableNodeContext(ShareManager& sm) : state(sm) {}
 
@@ -230,5 +278,10 @@ namespace ccf
     {
       return state;
     }
+
+    indexing::AbstractIndexer& get_indexer()
+    {
+      return indexer;
+    }
   };
 }
\ No newline at end of file
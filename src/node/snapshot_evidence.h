@@ -24,4 +24,30 @@ namespace ccf
   // As we only keep track of the latest snapshot, the key for the
   // SnapshotEvidence table is always 0.
   using SnapshotEvidence = ServiceMap<size_t, SnapshotHash>;
+
+  /** The evidence for a delta snapshot covers the evidence of its base as
+   * well, so that a snapshot and the chain of deltas applied on top of it can
+   * be verified against the evidence recorded for the last delta only.
+   */
+  inline crypto::Sha256Hash chain_snapshot_hash(
+    const crypto::Sha256Hash& base_hash,
+    const std::vector<uint8_t>& serialised_delta)
+  {
+    const auto delta_hash = crypto::Sha256Hash(serialised_delta);
+    std::vector<uint8_t> data(base_hash.h.begin(), base_hash.h.end());
+    data.insert(data.end(), delta_hash.h.begin(), delta_hash.h.end());
+    return crypto::Sha256Hash(data);
+  }
+
+  inline crypto::Sha256Hash get_snapshot_evidence_hash(
+    const std::vector<uint8_t>& serialised_snapshot,
+    const std::vector<std::vector<uint8_t>>& serialised_deltas)
+  {
+    auto hash = crypto::Sha256Hash(serialised_snapshot);
+    for (const auto& delta : serialised_deltas)
+    {
+      hash = chain_snapshot_hash(hash, delta);
+    }
+    return hash;
+  }
 }
\ No newline at end of file
@@ -12,7 +12,9 @@
 #include "node/network_state.h"
 #include "node/snapshot_evidence.h"
 
+#include <atomic>
 #include <deque>
+#include <map>
 #include <optional>
 
 namespace ccf
@@ -31,6 +33,19 @@ namespace ccf
     // Snapshots are never generated by default (e.g. during public recovery)
     size_t snapshot_tx_interval = max_tx_interval;
 
+    // Number of delta snapshots, each only holding the state changed since the
+    // previous snapshot, generated between two full snapshots
+    size_t max_snapshot_deltas = 0;
+    size_t snapshot_deltas_count = 0;
+
+    // Base of the next delta snapshot
+    std::shared_ptr<kv::AbstractStore::AbstractSnapshot> last_snapshot =
+      nullptr;
+
+    // Set when a delta could not be applied to the latest snapshot known by
+    // the host, so that the next snapshot is a full one
+    std::atomic<bool> force_full_snapshot = false;
+
     struct SnapshotInfo
     {
       consensus::Index idx;
@@ -55,13 +70,38 @@ namespace ccf
     // Indices at which a snapshot will be next generated
     std::deque<consensus::Index> next_snapshot_indices;
 
+    // Snapshots are sent to the host in chunks of at most this size, so that
+    // large snapshots are not limited by the maximum ringbuffer message size
+    static constexpr size_t max_snapshot_chunk_size = 1 << 20;
+
     void record_snapshot(
       consensus::Index idx,
       consensus::Index evidence_idx,
+      consensus::Index base_idx,
       const std::vector<uint8_t>& serialised_snapshot)
     {
+      size_t offset = 0;
+      while (serialised_snapshot.size() - offset > max_snapshot_chunk_size)
+      {
+        RINGBUFFER_WRITE_MESSAGE(
+          consensus::snapshot_chunk,
+          to_host,
+          idx,
+          evidence_idx,
+          base_idx,
+          serializer::ByteRange{serialised_snapshot.data() + offset,
+                                max_snapshot_chunk_size});
+        offset += max_snapshot_chunk_size;
+      }
+
       RINGBUFFER_WRITE_MESSAGE(
-        consensus::snapshot, to_host, idx, evidence_idx, serialised_snapshot);
+        consensus::snapshot,
+        to_host,
+        idx,
+        evidence_idx,
+        base_idx,
+        serializer::ByteRange{serialised_snapshot.data() + offset,
+                              serialised_snapshot.size() - offset});
     }
 
     void commit_snapshot(
@@ -73,27 +113,99 @@ namespace ccf
         consensus::snapshot_commit, to_host, snapshot_idx, evidence_commit_idx);
     }
 
-    struct SnapshotMsg
+    struct SnapshotSerialisation
     {
       std::shared_ptr<Snapshotter> self;
-      std::unique_ptr<kv::AbstractStore::AbstractSnapshot> snapshot;
+      std::shared_ptr<kv::AbstractStore::AbstractSnapshot> snapshot;
+
+      // Order in which the snapshot was taken
+      size_t generation;
+
+      std::vector<uint8_t> serialised;
+    };
+
+    struct SnapshotMsg
+    {
+      std::shared_ptr<SnapshotSerialisation> serialisation;
     };
 
+    // Snapshots are serialised concurrently but recorded in the order in which
+    // they were taken, since the evidence for a delta snapshot covers that of
+    // its base
+    std::mutex record_lock;
+    size_t next_generation = 0;
+    size_t next_generation_to_record = 0;
+    std::map<size_t, std::shared_ptr<SnapshotSerialisation>> serialised;
+
+    // Latest snapshot sent to the host, to which the next delta applies
+    consensus::Index last_recorded_idx = 0;
+    crypto::Sha256Hash last_recorded_hash;
+
     static void snapshot_cb(std::unique_ptr<threading::Tmsg<SnapshotMsg>> msg)
     {
-      msg->data.self->snapshot_(std::move(msg->data.snapshot));
+      // Each map is serialised straight into the snapshot in turn, so that
+      // only one copy of the snapshotted state is held at a time. The whole
+      // snapshot is still built before it is hashed and sent to the host: it
+      // is a single KV entry, whose header (size, then GCM IV and tag over
+      // the private domain) precedes the maps' state, so it cannot be
+      // streamed or hashed map by map without changing the snapshot format.
+      auto& serialisation = msg->data.serialisation;
+      auto& self = serialisation->self;
+      serialisation->serialised =
+        serialisation->snapshot->serialise(self->store->get_encryptor());
+      self->record_serialised(serialisation);
+    }
+
+    void record_serialised(
+      const std::shared_ptr<SnapshotSerialisation>& serialisation)
+    {
+      std::lock_guard<std::mutex> guard(record_lock);
+
+      serialised.emplace(serialisation->generation, serialisation);
+      auto it = serialised.begin();
+      while (it != serialised.end() &&
+             it->first == next_generation_to_record)
+      {
+        auto next = it->second;
+        snapshot_(next->snapshot, next->serialised);
+        next->self = nullptr;
+        it = serialised.erase(it);
+        next_generation_to_record++;
+      }
     }
 
     void snapshot_(
-      std::unique_ptr<kv::AbstractStore::AbstractSnapshot> snapshot)
+      const std::shared_ptr<kv::AbstractStore::AbstractSnapshot>& snapshot,
+      const std::vector<uint8_t>& serialised_snapshot)
     {
       auto snapshot_version = snapshot->get_version();
+      auto base_version = snapshot->get_base_version();
 
-      auto serialised_snapshot = store->serialise_snapshot(std::move(snapshot));
+      crypto::Sha256Hash snapshot_hash;
+      consensus::Index base_idx = 0;
+      if (base_version.has_value())
+      {
+        base_idx = static_cast<consensus::Index>(base_version.value());
+        if (base_idx != last_recorded_idx)
+        {
+          LOG_FAIL_FMT(
+            "Dropping delta snapshot for seqno {} as its base {} was not "
+            "recorded",
+            snapshot_version,
+            base_idx);
+          force_full_snapshot = true;
+          return;
+        }
+        snapshot_hash =
+          chain_snapshot_hash(last_recorded_hash, serialised_snapshot);
+      }
+      else
+      {
+        snapshot_hash = crypto::Sha256Hash(serialised_snapshot);
+      }
 
       auto tx = store->create_tx();
       auto evidence = tx.rw<SnapshotEvidence>(Tables::SNAPSHOT_EVIDENCE);
-      auto snapshot_hash = crypto::Sha256Hash(serialised_snapshot);
       evidence->put(0, {snapshot_hash, snapshot_version});
 
       auto rc = tx.commit();
@@ -103,12 +215,14 @@ namespace ccf
           "Could not commit snapshot evidence for seqno {}: {}",
           snapshot_version,
           rc);
+        force_full_snapshot = true;
         return;
       }
 
       auto evidence_version = tx.commit_version();
 
-      record_snapshot(snapshot_version, evidence_version, serialised_snapshot);
+      record_snapshot(
+        snapshot_version, evidence_version, base_idx, serialised_snapshot);
       consensus::Index snapshot_idx =
         static_cast<consensus::Index>(snapshot_version);
       consensus::Index snapshot_evidence_idx =
@@ -116,11 +230,14 @@ namespace ccf
       snapshot_evidence_indices.emplace_back(
         snapshot_idx, snapshot_evidence_idx);
 
+      last_recorded_idx = snapshot_idx;
+      last_recorded_hash = snapshot_hash;
+
       LOG_DEBUG_FMT(
-        "Snapshot successfully generated for seqno {}, with evidence seqno "
-        "{}: "
-        "{}",
+        "Snapshot successfully generated for seqno {} (base {}), with evidence "
+        "seqno {}: {}",
         snapshot_idx,
+        base_idx,
         snapshot_evidence_idx,
         snapshot_hash);
     }
@@ -159,10 +276,12 @@ namespace ccf
     Snapshotter(
       ringbuffer::AbstractWriterFactory& writer_factory,
       std::shared_ptr<kv::Store>& store_,
-      size_t snapshot_tx_interval_) :
+      size_t snapshot_tx_interval_,
+      size_t max_snapshot_deltas_ = 0) :
       to_host(writer_factory.create_writer_to_outside()),
       store(store_),
-      snapshot_tx_interval(snapshot_tx_interval_)
+      snapshot_tx_interval(snapshot_tx_interval_),
+      max_snapshot_deltas(max_snapshot_deltas_)
     {
       next_snapshot_indices.push_back(last_snapshot_idx);
     }
@@ -248,11 +367,35 @@ namespace ccf
       {
         if (generate_snapshot && snapshot_generation_enabled && snapshot_idx)
         {
+          auto serialisation = std::make_shared<SnapshotSerialisation>();
+          serialisation->self = shared_from_this();
+          serialisation->generation = next_generation++;
+
+          const bool force_full = force_full_snapshot.exchange(false);
+          if (
+            !force_full && last_snapshot != nullptr &&
+            snapshot_deltas_count < max_snapshot_deltas)
+          {
+            serialisation->snapshot =
+              store->delta_snapshot(snapshot_idx, *last_snapshot);
+            snapshot_deltas_count++;
+          }
+          else
+          {
+            serialisation->snapshot = store->snapshot(snapshot_idx);
+            snapshot_deltas_count = 0;
+          }
+
+          if (max_snapshot_deltas > 0)
+          {
+            last_snapshot = serialisation->snapshot;
+          }
+
+          // Snapshots are serialised on execution threads (round-robin)
+          static uint32_t generation_count = 0;
           auto msg =
             std::make_unique<threading::Tmsg<SnapshotMsg>>(&snapshot_cb);
-          msg->data.self = shared_from_this();
-          msg->data.snapshot = store->snapshot(snapshot_idx);
-          static uint32_t generation_count = 0;
+          msg->data.serialisation = serialisation;
           threading::ThreadMessaging::thread_messaging.add_task(
             threading::ThreadMessaging::get_execution_thread(
               generation_count++),
@@ -287,6 +430,10 @@ namespace ccf
              (snapshot_evidence_indices.back().evidence_idx > idx))
       {
         snapshot_evidence_indices.pop_back();
+
+        // The host will never commit this snapshot, so later deltas cannot
+        // be built on top of it
+        force_full_snapshot = true;
       }
     }
   };
@@ -0,0 +1,201 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the Apache 2.0 License.
+
+#include "node/commit_waiters.h"
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+#include <map>
+
+using namespace std::chrono_literals;
+
+class TestResponder : public enclave::AbstractRPCResponder
+{
+public:
+  // Status reported to each session, or "timeout"
+  std::map<size_t, std::string> replies;
+
+  bool reply_async(size_t id, std::vector<uint8_t>&& data) override
+  {
+    REQUIRE(replies.find(id) == replies.end());
+    replies[id] = std::string(data.begin(), data.end());
+    return true;
+  }
+};
+
+ccf::CommitWaiters::ResponseFn respond_with_status()
+{
+  return [](std::optional<ccf::TxStatus> status) {
+    const std::string s =
+      status.has_value() ? ccf::tx_status_to_str(status.value()) : "timeout";
+    return std::vector<uint8_t>(s.begin(), s.end());
+  };
+}
+
+// Ledger in which each seqno was written in the view given by the entry for
+// the highest seqno no greater than it
+struct Ledger
+{
+  std::map<ccf::SeqNo, ccf::View> view_starts = {{1, 2}};
+
+  ccf::View operator()(ccf::SeqNo seqno) const
+  {
+    auto it = view_starts.upper_bound(seqno);
+    REQUIRE(it != view_starts.begin());
+    return std::prev(it)->second;
+  }
+};
+
+static const auto committed = ccf::tx_status_to_str(ccf::TxStatus::Committed);
+static const auto invalid = ccf::tx_status_to_str(ccf::TxStatus::Invalid);
+
+TEST_CASE("Waiters are answered when their transaction commits")
+{
+  auto responder = std::make_shared<TestResponder>();
+  ccf::CommitWaiters waiters(responder);
+  Ledger ledger;
+
+  using AddResult = ccf::CommitWaiters::AddResult;
+  const auto respond = respond_with_status();
+  REQUIRE(waiters.add({2, 5}, 0, 1s, respond) == AddResult::Added);
+  REQUIRE(waiters.add({2, 5}, 1, 1s, respond) == AddResult::Added);
+  REQUIRE(waiters.add({2, 8}, 2, 1s, respond) == AddResult::Added);
+  REQUIRE(waiters.size() == 3);
+
+  waiters.commit(4, ledger);
+  REQUIRE(responder->replies.empty());
+
+  waiters.commit(6, ledger);
+  REQUIRE(responder->replies.size() == 2);
+  REQUIRE(responder->replies[0] == committed);
+  REQUIRE(responder->replies[1] == committed);
+  REQUIRE(waiters.size() == 1);
+
+  // Commit never regresses
+  waiters.commit(5, ledger);
+  REQUIRE(waiters.size() == 1);
+
+  waiters.commit(8, ledger);
+  REQUIRE(responder->replies[2] == committed);
+  REQUIRE(waiters.size() == 0);
+
+  INFO("Transactions which are already committed are not waited for");
+  REQUIRE(
+    waiters.add({2, 7}, 3, 1s, respond_with_status()) ==
+    AddResult::AlreadyFinal);
+  REQUIRE(waiters.size() == 0);
+}
+
+TEST_CASE("Waiters are answered when their transaction is rolled back")
+{
+  auto responder = std::make_shared<TestResponder>();
+  ccf::CommitWaiters waiters(responder);
+  Ledger ledger;
+
+  waiters.add({2, 5}, 0, 1s, respond_with_status());
+  waiters.add({2, 10}, 1, 1s, respond_with_status());
+  waiters.add({3, 12}, 2, 1s, respond_with_status());
+  waiters.commit(3, ledger);
+  REQUIRE(responder->replies.empty());
+
+  // Election in view 3, after which seqno 5 onwards were rewritten
+  ledger.view_starts[5] = 3;
+  waiters.commit(6, ledger);
+  REQUIRE(responder->replies.size() == 2);
+  REQUIRE(responder->replies[0] == invalid);
+  REQUIRE(responder->replies[1] == invalid);
+  REQUIRE(waiters.size() == 1);
+
+  waiters.commit(12, ledger);
+  REQUIRE(responder->replies[2] == committed);
+
+  INFO("Transactions from older views are not waited for");
+  REQUIRE(
+    waiters.add({2, 20}, 3, 1s, respond_with_status()) ==
+    ccf::CommitWaiters::AddResult::AlreadyFinal);
+}
+
+TEST_CASE("Collected waiters are only answered once completed")
+{
+  auto responder = std::make_shared<TestResponder>();
+  ccf::CommitWaiters waiters(responder);
+  Ledger ledger;
+
+  size_t responses_produced = 0;
+  auto respond = [&](std::optional<ccf::TxStatus> status) {
+    ++responses_produced;
+    return respond_with_status()(status);
+  };
+  waiters.add({2, 5}, 0, 1s, respond);
+  waiters.add({2, 6}, 1, 1s, respond);
+  waiters.add({2, 9}, 2, 1s, respond);
+
+  auto completed = waiters.collect_committed(6, ledger);
+  REQUIRE(completed.size() == 2);
+  REQUIRE(waiters.size() == 1);
+  REQUIRE(responses_produced == 0);
+  REQUIRE(responder->replies.empty());
+
+  INFO("Collected waiters no longer time out");
+  waiters.tick(1s);
+  REQUIRE(responder->replies.size() == 1);
+  REQUIRE(responder->replies[2] == "timeout");
+
+  waiters.complete(std::move(completed));
+  REQUIRE(responses_produced == 3);
+  REQUIRE(responder->replies[0] == committed);
+  REQUIRE(responder->replies[1] == committed);
+}
+
+TEST_CASE("Waiters time out")
+{
+  auto responder = std::make_shared<TestResponder>();
+  ccf::CommitWaiters waiters(responder);
+  Ledger ledger;
+
+  waiters.add({2, 5}, 0, 100ms, respond_with_status());
+  waiters.add({2, 5}, 1, 300ms, respond_with_status());
+  waiters.add({2, 6}, 2, 200ms, respond_with_status());
+
+  waiters.tick(50ms);
+  REQUIRE(responder->replies.empty());
+
+  waiters.tick(150ms);
+  REQUIRE(responder->replies.size() == 2);
+  REQUIRE(responder->replies[0] == "timeout");
+  REQUIRE(responder->replies[2] == "timeout");
+  REQUIRE(waiters.size() == 1);
+
+  waiters.commit(5, ledger);
+  REQUIRE(responder->replies[1] == committed);
+  REQUIRE(waiters.size() == 0);
+
+  // Answered waiters do not time out again
+  waiters.tick(1s);
+  REQUIRE(responder->replies.size() == 3);
+}
+
+TEST_CASE("Number of waiters is bounded")
+{
+  auto responder = std::make_shared<TestResponder>();
+  constexpr size_t max_waiters = 4;
+  ccf::CommitWaiters waiters(responder, max_waiters);
+  Ledger ledger;
+
+  using AddResult = ccf::CommitWaiters::AddResult;
+  for (size_t i = 0; i < max_waiters; ++i)
+  {
+    REQUIRE(
+      waiters.add({2, 10 + i}, i, 1s, respond_with_status()) ==
+      AddResult::Added);
+  }
+  REQUIRE(
+    waiters.add({2, 20}, max_waiters, 1s, respond_with_status()) ==
+    AddResult::TooManyWaiters);
+
+  waiters.commit(10, ledger);
+  REQUIRE(
+    waiters.add({2, 20}, max_waiters, 1s, respond_with_status()) ==
+    AddResult::Added);
+  REQUIRE(waiters.size() == max_waiters);
+}
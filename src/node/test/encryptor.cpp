@@ -436,4 +436,146 @@ TEST_CASE("Encryptor rollback")
 
   commit_one(store, map);
   commit_one(store, map);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Backup decrypts entries ahead of applying them")
+{
+  auto consensus = std::make_shared<kv::test::StubConsensus>();
+  StringString map("map");
+  kv::Store primary_store;
+  kv::Store backup_store;
+
+  auto primary_ledger_secrets = std::make_shared<ccf::LedgerSecrets>();
+  primary_ledger_secrets->init();
+  primary_store.set_encryptor(
+    std::make_shared<ccf::NodeEncryptor>(primary_ledger_secrets));
+  primary_store.set_consensus(consensus);
+
+  auto tx = primary_store.create_tx();
+  auto backup_ledger_secrets = std::make_shared<ccf::LedgerSecrets>();
+  backup_ledger_secrets->init_from_map(primary_ledger_secrets->get(tx));
+  backup_store.set_encryptor(
+    std::make_shared<ccf::NodeEncryptor>(backup_ledger_secrets));
+
+  INFO("Primary commits entries across several rekeys");
+  std::vector<std::pair<kv::Version, ccf::LedgerSecretPtr>> new_secrets;
+  {
+    auto current_version = primary_store.current_version();
+    for (size_t i = 2; i < 6; ++i)
+    {
+      commit_one(primary_store, map);
+      auto new_secret = ccf::make_ledger_secret();
+      new_secrets.emplace_back(current_version + i, new_secret);
+      primary_ledger_secrets->set_secret(
+        current_version + i, std::move(new_secret));
+    }
+    commit_one(primary_store, map);
+  }
+
+  std::vector<std::unique_ptr<kv::AbstractExecutionWrapper>> entries;
+  auto next_entry = consensus->pop_oldest_entry();
+  while (next_entry.has_value())
+  {
+    entries.push_back(backup_store.deserialize(
+      *std::get<1>(next_entry.value()), ConsensusType::CFT));
+    next_entry = consensus->pop_oldest_entry();
+  }
+  REQUIRE(entries.size() > new_secrets.size());
+
+  INFO("Entries are prepared out of order, before the backup has the secrets "
+       "for the later ones");
+  {
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+    {
+      (*it)->prepare();
+    }
+  }
+
+  INFO("Entries are applied in order, once the secrets are known");
+  {
+    for (auto& [version, secret] : new_secrets)
+    {
+      backup_ledger_secrets->set_secret(version, std::move(secret));
+    }
+
+    for (auto& entry : entries)
+    {
+      REQUIRE(entry->apply() == kv::ApplyResult::PASS);
+    }
+    REQUIRE(backup_store.current_version() == primary_store.current_version());
+  }
+}
+TEST_CASE("Entries decrypted ahead of applying them across several rekeys")
+{
+  auto consensus = std::make_shared<kv::test::StubConsensus>();
+  auto backup_consensus = std::make_shared<kv::test::StubConsensus>();
+  StringString map("map");
+  kv::Store primary_store;
+  kv::Store backup_store;
+
+  auto primary_ledger_secrets = std::make_shared<ccf::LedgerSecrets>();
+  primary_ledger_secrets->init();
+  primary_store.set_encryptor(
+    std::make_shared<ccf::NodeEncryptor>(primary_ledger_secrets));
+  primary_store.set_consensus(consensus);
+
+  auto tx = primary_store.create_tx();
+  auto backup_ledger_secrets = std::make_shared<ccf::LedgerSecrets>();
+  backup_ledger_secrets->init_from_map(primary_ledger_secrets->get(tx));
+  backup_store.set_encryptor(
+    std::make_shared<ccf::NodeEncryptor>(backup_ledger_secrets));
+
+  auto apply_next = [&](bool prepare_first) {
+    auto next_entry = consensus->pop_oldest_entry();
+    REQUIRE(next_entry.has_value());
+    auto entry = backup_store.deserialize(
+      *std::get<1>(next_entry.value()), ConsensusType::CFT);
+    if (prepare_first)
+    {
+      entry->prepare();
+    }
+    REQUIRE(entry->apply() == kv::ApplyResult::PASS);
+  };
+
+  INFO("Backup decrypts the first entry in order");
+  {
+    commit_one(primary_store, map);
+    apply_next(false);
+  }
+
+  INFO("Every entry across several rekeys is decrypted ahead of apply");
+  {
+    for (size_t i = 0; i < 3; ++i)
+    {
+      commit_one(primary_store, map);
+      auto version = primary_store.current_version() + 1;
+      auto new_secret = ccf::make_ledger_secret();
+      backup_ledger_secrets->set_secret(
+        version, ccf::LedgerSecretPtr(new_secret));
+      primary_ledger_secrets->set_secret(version, std::move(new_secret));
+    }
+
+    while (consensus->number_of_replicas() > 0)
+    {
+      apply_next(true);
+    }
+  }
+
+  INFO("Backup then decrypts in order with the latest secret");
+  {
+    commit_one(primary_store, map);
+    apply_next(false);
+  }
+
+  INFO("Backup encrypts with the latest secret once primary");
+  {
+    backup_store.set_consensus(backup_consensus);
+    commit_one(backup_store, map);
+
+    auto next_entry = backup_consensus->pop_oldest_entry();
+    REQUIRE(next_entry.has_value());
+    auto entry = primary_store.deserialize(
+      *std::get<1>(next_entry.value()), ConsensusType::CFT);
+    REQUIRE(entry->apply() == kv::ApplyResult::PASS);
+  }
+}
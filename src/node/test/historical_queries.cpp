@@ -296,6 +296,7 @@ TEST_CASE("StateCache point queries")
     {
       const uint8_t* data = write.contents.data();
       size_t size = write.contents.size();
+      REQUIRE(write.m == consensus::ledger_get);
       auto [seqno, purpose] =
         ringbuffer::read_message<consensus::ledger_get>(data, size);
       REQUIRE(purpose == consensus::LedgerRequestPurpose::HistoricalQuery);
@@ -600,6 +601,208 @@ TEST_CASE("StateCache range queries")
   }
 }
 
+TEST_CASE("StateCache fetches ranges in a single request")
+{
+  auto state = create_and_init_state();
+  auto& kv_store = *state.kv_store;
+
+  const auto begin_seqno = kv_store.current_version() + 1;
+  const auto end_seqno = write_transactions_and_signature(kv_store, 20);
+
+  auto stub_writer = std::make_shared<StubWriter>();
+  ccf::historical::StateCache cache(
+    kv_store, state.ledger_secrets, stub_writer);
+  auto ledger = construct_host_ledger(state.kv_store->get_consensus());
+
+  auto framed_entries = [&](ccf::SeqNo from, ccf::SeqNo to) {
+    std::vector<uint8_t> entries;
+    for (auto seqno = from; seqno <= to; ++seqno)
+    {
+      const auto& entry = ledger.at(seqno);
+      entries.insert(entries.end(), entry.begin(), entry.end());
+    }
+    return entries;
+  };
+
+  const auto range_start = begin_seqno;
+  const auto range_end = end_seqno - 1;
+  REQUIRE(cache.get_store_range(0, range_start, range_end).empty());
+
+  {
+    INFO("The whole range is requested from the host at once");
+    REQUIRE(stub_writer->writes.size() == 1);
+    const auto& write = stub_writer->writes.front();
+    REQUIRE(write.m == consensus::ledger_get_range);
+    const uint8_t* data = write.contents.data();
+    size_t size = write.contents.size();
+    auto [from, to, purpose] =
+      ringbuffer::read_message<consensus::ledger_get_range>(data, size);
+    REQUIRE(from == range_start);
+    REQUIRE(to == range_end);
+    REQUIRE(purpose == consensus::LedgerRequestPurpose::HistoricalQuery);
+  }
+
+  {
+    INFO("Re-requesting the same range does not fetch it again");
+    REQUIRE(cache.get_store_range(0, range_start, range_end).empty());
+    REQUIRE(stub_writer->writes.size() == 1);
+  }
+
+  {
+    INFO("Range responses may be split across several messages");
+    const auto mid = range_start + (range_end - range_start) / 2;
+    const auto first = framed_entries(range_start, mid);
+    REQUIRE(
+      cache.handle_ledger_entries(
+        range_start, mid, first.data(), first.size()) ==
+      mid - range_start + 1);
+
+    const auto second = framed_entries(mid + 1, range_end);
+    REQUIRE(
+      cache.handle_ledger_entries(
+        mid + 1, range_end, second.data(), second.size()) ==
+      range_end - mid);
+
+    // Entries which were not requested are ignored
+    REQUIRE(
+      cache.handle_ledger_entries(
+        range_start, mid, first.data(), first.size()) == 0);
+  }
+
+  {
+    INFO("Supporting signature is fetched and the range is returned");
+    REQUIRE(cache.get_store_range(0, range_start, range_end).empty());
+    REQUIRE(cache.handle_ledger_entry(end_seqno, ledger.at(end_seqno)));
+
+    const auto stores = cache.get_store_range(0, range_start, range_end);
+    REQUIRE(stores.size() == range_end - range_start + 1);
+    for (size_t i = 0; i < stores.size(); ++i)
+    {
+      validate_business_transaction(stores[i], range_start + i);
+    }
+  }
+
+  {
+    INFO("Truncated ranges drop the requests waiting for missing entries");
+    REQUIRE(cache.drop_request(0));
+    REQUIRE(cache.get_store_range(1, range_start, range_end).empty());
+
+    auto entries = framed_entries(range_start, range_end);
+    entries.resize(entries.size() - 1);
+    REQUIRE(
+      cache.handle_ledger_entries(
+        range_start, range_end, entries.data(), entries.size()) ==
+      range_end - range_start);
+
+    // The final entry is missing, so the request was dropped
+    REQUIRE_FALSE(cache.drop_request(1));
+  }
+}
+
+TEST_CASE("StateCache soft limit and shared stores")
+{
+  auto state = create_and_init_state();
+  auto& kv_store = *state.kv_store;
+
+  const auto first_start = kv_store.current_version() + 1;
+  const auto first_end = write_transactions_and_signature(kv_store, 10);
+  const auto second_start = first_end + 1;
+  const auto second_end = write_transactions_and_signature(kv_store, 10);
+
+  auto stub_writer = std::make_shared<StubWriter>();
+  ccf::historical::StateCache cache(
+    kv_store, state.ledger_secrets, stub_writer);
+  auto ledger = construct_host_ledger(state.kv_store->get_consensus());
+
+  auto range_bytes = [&](ccf::SeqNo from, ccf::SeqNo to) {
+    size_t size = 0;
+    for (auto seqno = from; seqno <= to; ++seqno)
+    {
+      size += ledger.at(seqno).size();
+    }
+    return size;
+  };
+
+  // Ranges end on a signature, so are trusted once all entries are provided
+  auto fetch_range = [&](
+                       ccf::historical::RequestHandle handle,
+                       ccf::SeqNo from,
+                       ccf::SeqNo to) {
+    REQUIRE(cache.get_store_range(handle, from, to).empty());
+    for (auto seqno = from; seqno <= to; ++seqno)
+    {
+      REQUIRE(cache.handle_ledger_entry(seqno, ledger.at(seqno)));
+    }
+    REQUIRE(cache.get_store_range(handle, from, to).size() == 1 + to - from);
+  };
+
+  const auto first_size = 1 + first_end - first_start;
+  const auto first_bytes = range_bytes(first_start, first_end);
+  const auto second_size = 1 + second_end - second_start;
+  const auto second_bytes = range_bytes(second_start, second_end);
+
+  {
+    INFO("Fetched entries are counted as misses");
+    fetch_range(0, first_start, first_end);
+    const auto metrics = cache.get_metrics();
+    REQUIRE(metrics.misses == first_size);
+    REQUIRE(metrics.hits == 0);
+    REQUIRE(metrics.requests == 1);
+    REQUIRE(metrics.cached_bytes == first_bytes);
+  }
+
+  {
+    INFO("Trusted stores are shared between handles, without a new fetch");
+    const auto writes_before = stub_writer->writes.size();
+    const auto stores = cache.get_store_range(1, first_start, first_end);
+    REQUIRE(stores.size() == first_size);
+    REQUIRE(stores == cache.get_store_range(0, first_start, first_end));
+    REQUIRE(stub_writer->writes.size() == writes_before);
+
+    const auto metrics = cache.get_metrics();
+    REQUIRE(metrics.hits == first_size);
+    REQUIRE(metrics.requests == 2);
+    REQUIRE(metrics.cached_bytes == first_bytes);
+    REQUIRE(cache.drop_request(1));
+  }
+
+  fetch_range(1, second_start, second_end);
+  REQUIRE(cache.get_metrics().cached_bytes == first_bytes + second_bytes);
+
+  {
+    INFO("Least recently used handle is evicted when over the soft limit");
+    cache.set_soft_cache_limit(second_bytes);
+    const auto metrics = cache.get_metrics();
+    REQUIRE(metrics.evictions == 1);
+    REQUIRE(metrics.requests == 1);
+    REQUIRE(metrics.cached_bytes == second_bytes);
+    REQUIRE(metrics.soft_limit_bytes == second_bytes);
+    REQUIRE(
+      cache.get_store_range(1, second_start, second_end).size() ==
+      second_size);
+    REQUIRE_FALSE(cache.drop_request(0));
+  }
+
+  {
+    INFO("Evicted ranges are fetched again, evicting older handles");
+    fetch_range(0, first_start, first_end);
+    const auto metrics = cache.get_metrics();
+    REQUIRE(metrics.evictions == 2);
+    REQUIRE(metrics.misses == 2 * first_size + second_size);
+    REQUIRE(metrics.requests == 1);
+    REQUIRE(metrics.cached_bytes == first_bytes);
+    REQUIRE_FALSE(cache.drop_request(1));
+  }
+
+  {
+    INFO("The most recent request is kept, even when over the soft limit");
+    cache.set_soft_cache_limit(0);
+    REQUIRE(
+      cache.get_store_range(0, first_start, first_end).size() == first_size);
+    REQUIRE(cache.get_metrics().evictions == 2);
+  }
+}
+
 TEST_CASE("StateCache concurrent access")
 {
   auto state = create_and_init_state();
@@ -653,6 +856,24 @@ TEST_CASE("StateCache concurrent access")
       {
         auto data = write.contents.data();
         auto size = write.contents.size();
+        if (write.m == consensus::ledger_get_range)
+        {
+          // Respond with the whole range in a single message
+          const auto [from, to, purpose] =
+            ringbuffer::read_message<consensus::ledger_get_range>(data, size);
+          REQUIRE(purpose == consensus::LedgerRequestPurpose::HistoricalQuery);
+
+          std::vector<uint8_t> entries;
+          for (auto seqno = from; seqno <= to; ++seqno)
+          {
+            const auto it = ledger.find(seqno);
+            REQUIRE(it != ledger.end());
+            entries.insert(entries.end(), it->second.begin(), it->second.end());
+          }
+          cache.handle_ledger_entries(from, to, entries.data(), entries.size());
+          continue;
+        }
+
         const auto [seqno, purpose] =
           ringbuffer::read_message<consensus::ledger_get>(data, size);
         REQUIRE(purpose == consensus::LedgerRequestPurpose::HistoricalQuery);
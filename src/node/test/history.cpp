@@ -14,6 +14,9 @@
 #define DOCTEST_CONFIG_IMPLEMENT
 #include <doctest/doctest.h>
 #undef FAIL
+#include <map>
+#include <mutex>
+#include <thread>
 
 threading::ThreadMessaging threading::ThreadMessaging::thread_messaging;
 std::atomic<uint16_t> threading::ThreadMessaging::thread_count = 0;
@@ -456,6 +459,83 @@ TEST_CASE(
   }
 }
 
+class RecordingConsensus : public kv::test::StubConsensus
+{
+public:
+  std::mutex lock;
+  std::map<kv::Version, std::vector<uint8_t>> entries;
+
+  bool replicate(const kv::BatchVector& entries_, ccf::View view) override
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto& [version, data, committable, hook] : entries_)
+    {
+      REQUIRE(entries.find(version) == entries.end());
+      entries.emplace(version, *data);
+    }
+    return true;
+  }
+};
+
+TEST_CASE("Concurrently committed transactions are hashed in version order")
+{
+  auto encryptor = std::make_shared<kv::NullTxEncryptor>();
+  auto kp = crypto::make_key_pair();
+
+  kv::Store store;
+  store.set_encryptor(encryptor);
+  auto consensus = std::make_shared<RecordingConsensus>();
+  store.set_consensus(consensus);
+  std::shared_ptr<kv::TxHistory> history =
+    std::make_shared<ccf::MerkleTxHistory>(
+      store, kv::test::PrimaryNodeId, *kp);
+  store.set_history(history);
+
+  MapT table("public:table");
+
+  constexpr size_t thread_count = 8;
+  constexpr size_t txs_per_thread = 200;
+  std::atomic<size_t> committed = 0;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < thread_count; ++i)
+  {
+    threads.emplace_back([&, i]() {
+      for (size_t j = 0; j < txs_per_thread; ++j)
+      {
+        auto tx = store.create_tx();
+        tx.rw(table)->put(i * txs_per_thread + j, j);
+        if (tx.commit() == kv::CommitResult::SUCCESS)
+        {
+          ++committed;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  REQUIRE(committed == thread_count * txs_per_thread);
+
+  INFO("Every transaction is replicated once, with contiguous versions");
+  REQUIRE(consensus->entries.size() == thread_count * txs_per_thread);
+  REQUIRE(consensus->entries.begin()->first == 1);
+  REQUIRE(
+    consensus->entries.rbegin()->first == thread_count * txs_per_thread);
+
+  INFO("The history matches one built by hashing each entry in order");
+  kv::Store reference_store;
+  auto reference_history = std::make_shared<ccf::MerkleTxHistory>(
+    reference_store, kv::test::PrimaryNodeId, *kp);
+  for (const auto& [version, data] : consensus->entries)
+  {
+    reference_history->append(data);
+  }
+  REQUIRE(
+    history->get_replicated_state_root() ==
+    reference_history->get_replicated_state_root());
+}
+
 int main(int argc, char** argv)
 {
   doctest::Context context;
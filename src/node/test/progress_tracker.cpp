@@ -419,6 +419,87 @@ TEST_CASE("Record primary signature")
   }
 }
 
+TEST_CASE("Invalid backup signature is not counted as an endorsement")
+{
+  using trompeloeil::_;
+
+  kv::NodeId my_node_id = kv::test::PrimaryNodeId;
+  ccf::View view = 0;
+  ccf::SeqNo seqno = 42;
+  crypto::Sha256Hash root;
+  std::array<uint8_t, MBEDTLS_ECDSA_MAX_LEN> sig;
+  ccf::Nonce nonce;
+  std::vector<uint8_t> primary_sig = {1};
+  kv::Configuration::Nodes nodes;
+  for (auto const& node_id : node_ids)
+  {
+    nodes.insert({node_id, kv::Configuration::NodeInfo()});
+  }
+
+  auto store = std::make_unique<StoreMock>();
+  StoreMock& store_mock = *store.get();
+  ccf::ProgressTracker pt(std::move(store), my_node_id);
+
+  auto h = pt.hash_data(nonce);
+  ccf::Nonce hashed_nonce;
+  std::copy(h.h.begin(), h.h.end(), hashed_nonce.h.begin());
+
+  REQUIRE_CALL(store_mock, verify_signature(_, _, _, _))
+    .WITH(_1 == kv::test::FirstBackupNodeId)
+    .RETURN(false)
+    .TIMES(1);
+  REQUIRE_CALL(store_mock, verify_signature(_, _, _, _))
+    .WITH(_1 != kv::test::FirstBackupNodeId)
+    .RETURN(true)
+    .TIMES(2);
+
+  auto result = pt.record_primary(
+    {view, seqno}, my_node_id, true, root, primary_sig, hashed_nonce, nodes);
+  REQUIRE(result == kv::TxHistory::Result::OK);
+
+  INFO("Bad signature arrives before the threshold is reached");
+  result = pt.add_signature(
+    {view, seqno},
+    kv::test::FirstBackupNodeId,
+    MBEDTLS_ECDSA_MAX_LEN,
+    sig,
+    hashed_nonce,
+    nodes,
+    true);
+  REQUIRE(result == kv::TxHistory::Result::OK);
+
+  INFO("Honest signature reaching the threshold drops the bad one");
+  result = pt.add_signature(
+    {view, seqno},
+    kv::test::SecondBackupNodeId,
+    MBEDTLS_ECDSA_MAX_LEN,
+    sig,
+    hashed_nonce,
+    nodes,
+    true);
+  REQUIRE(result == kv::TxHistory::Result::OK);
+
+  INFO("Threshold is only reached with enough verified signatures");
+  ccf::BackupSignatures written;
+  REQUIRE_CALL(store_mock, write_backup_signatures(_))
+    .LR_SIDE_EFFECT(written = _1)
+    .TIMES(1);
+  result = pt.add_signature(
+    {view, seqno},
+    kv::test::ThirdBackupNodeId,
+    MBEDTLS_ECDSA_MAX_LEN,
+    sig,
+    hashed_nonce,
+    nodes,
+    true);
+  REQUIRE(result == kv::TxHistory::Result::SEND_SIG_RECEIPT_ACK);
+  REQUIRE(written.signatures.size() == 2);
+  for (const auto& s : written.signatures)
+  {
+    REQUIRE(s.node != kv::test::FirstBackupNodeId);
+  }
+}
+
 TEST_CASE("View Changes")
 {
   using trompeloeil::_;
@@ -256,4 +256,63 @@ TEST_CASE("Rollback before evidence is committed")
       read_ringbuffer_out(eio) ==
       rb_msg({consensus::snapshot_commit, snapshot_idx}));
   }
-}
\ No newline at end of file
+}
+TEST_CASE("Delta snapshots")
+{
+  ccf::NetworkState network;
+
+  auto in_buffer = std::make_unique<ringbuffer::TestBuffer>(buffer_size);
+  auto out_buffer = std::make_unique<ringbuffer::TestBuffer>(buffer_size);
+  ringbuffer::Circuit eio(in_buffer->bd, out_buffer->bd);
+
+  std::unique_ptr<ringbuffer::WriterFactory> writer_factory =
+    std::make_unique<ringbuffer::WriterFactory>(eio);
+
+  size_t snapshot_tx_interval = 10;
+  size_t max_snapshot_deltas = 1;
+  auto snapshotter = std::make_shared<ccf::Snapshotter>(
+    *writer_factory, network.tables, snapshot_tx_interval, max_snapshot_deltas);
+
+  // Returns the index of the recorded snapshot and of its base
+  auto snapshot_and_read = [&]() {
+    issue_transactions(network, snapshot_tx_interval);
+    size_t snapshot_idx = network.tables->current_version();
+    snapshotter->record_committable(snapshot_idx);
+    snapshotter->commit(snapshot_idx, true);
+    threading::ThreadMessaging::thread_messaging.run_one();
+
+    std::optional<std::pair<consensus::Index, consensus::Index>> recorded;
+    eio.read_from_inside().read(
+      -1, [&](ringbuffer::Message m, const uint8_t* data, size_t size) {
+        REQUIRE(m == consensus::snapshot);
+        auto idx = serialized::read<consensus::Index>(data, size);
+        serialized::read<consensus::Index>(data, size); // evidence idx
+        auto base_idx = serialized::read<consensus::Index>(data, size);
+        recorded = {idx, base_idx};
+      });
+    REQUIRE(recorded.has_value());
+    REQUIRE(recorded->first == snapshot_idx);
+    return recorded.value();
+  };
+
+  INFO("First snapshot is a full snapshot");
+  auto [first_idx, first_base] = snapshot_and_read();
+  REQUIRE(first_base == 0);
+
+  INFO("Next snapshot only records changes since the first");
+  auto [second_idx, second_base] = snapshot_and_read();
+  REQUIRE(second_base == first_idx);
+
+  INFO("Full snapshot once max number of deltas is reached");
+  auto [third_idx, third_base] = snapshot_and_read();
+  REQUIRE(third_base == 0);
+
+  INFO("Evidence is recorded for the latest snapshot");
+  {
+    auto tx = network.tables->create_read_only_tx();
+    auto evidence =
+      tx.ro<ccf::SnapshotEvidence>(ccf::Tables::SNAPSHOT_EVIDENCE)->get(0);
+    REQUIRE(evidence.has_value());
+    REQUIRE(evidence->version == third_idx);
+  }
+}
@@ -126,5 +126,22 @@ namespace tls
         cfg.get(),
         state ? MBEDTLS_SSL_VERIFY_REQUIRED : MBEDTLS_SSL_VERIFY_OPTIONAL);
     }
+
+    // Application protocols offered during the handshake (ALPN), in order of
+    // preference. protocols is a null-terminated list, which must outlive
+    // this context.
+    void set_alpn_protocols(const char** protocols)
+    {
+#ifdef MBEDTLS_SSL_ALPN
+      auto rc = mbedtls_ssl_conf_alpn_protocols(cfg.get(), protocols);
+      if (rc != 0)
+      {
+        throw std::logic_error(fmt::format(
+          "mbedtls_ssl_conf_alpn_protocols failed: {}", error_string(rc)));
+      }
+#else
+      (void)protocols;
+#endif
+    }
   };
 }
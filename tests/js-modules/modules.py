@@ -115,6 +115,40 @@ def test_bytecode_cache(network, args):
     return network
 
 
+@reqs.description("Test that requests do not share JS state")
+def test_request_isolation(network, args):
+    primary, _ = network.find_nodes()
+
+    bundle_dir = os.path.join(THIS_DIR, "request-isolation")
+    network.consortium.set_js_app(primary, bundle_dir)
+
+    LOG.info("Verifying that globals and module state do not outlive a request")
+    with primary.client("user0") as c:
+        # Enough requests that each worker thread serves several of them
+        for _ in range(20):
+            r = c.get("/app/isolation")
+            assert r.status_code == http.HTTPStatus.OK, r.status_code
+            assert r.body.json() == {"version": 1, "calls": 1, "leaked": None}, r.body
+
+    LOG.info("Verifying that an updated app is used by the following requests")
+    with tempfile.TemporaryDirectory(prefix="ccf") as tmp_dir:
+        modified_bundle_dir = shutil.copytree(bundle_dir, tmp_dir, dirs_exist_ok=True)
+        module_path = os.path.join(modified_bundle_dir, "src", "isolation.js")
+        with open(module_path, "r") as f:
+            module = f.read()
+        with open(module_path, "w") as f:
+            f.write(module.replace("const version = 1;", "const version = 2;"))
+        network.consortium.set_js_app(primary, modified_bundle_dir)
+
+    with primary.client("user0") as c:
+        for _ in range(20):
+            r = c.get("/app/isolation")
+            assert r.status_code == http.HTTPStatus.OK, r.status_code
+            assert r.body.json() == {"version": 2, "calls": 1, "leaked": None}, r.body
+
+    return network
+
+
 @reqs.description("Test js app bundle")
 def test_app_bundle(network, args):
     primary, _ = network.find_nodes()
@@ -579,6 +613,7 @@ def run(args):
         network.start_and_join(args)
         network = test_module_import(network, args)
         network = test_bytecode_cache(network, args)
+        network = test_request_isolation(network, args)
         network = test_app_bundle(network, args)
         network = test_dynamic_endpoints(network, args)
         network = test_npm_app(network, args)
@@ -0,0 +1,14 @@
+const version = 1;
+let calls = 0;
+
+// Reports any state left behind by previous requests, then leaves some behind
+export function isolation() {
+  calls += 1;
+  const body = {
+    version: version,
+    calls: calls,
+    leaked: globalThis.leaked === undefined ? null : globalThis.leaked,
+  };
+  globalThis.leaked = "caller secret";
+  return { body: body };
+}